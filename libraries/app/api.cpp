@@ -27,6 +27,7 @@
 #include <graphene/app/api_access.hpp>
 #include <graphene/app/application.hpp>
 #include <graphene/app/impacted.hpp>
+#include <graphene/account_history/account_history_plugin.hpp>
 #include <graphene/chain/database.hpp>
 #include <graphene/chain/get_config.hpp>
 #include <graphene/utilities/key_conversion.hpp>
@@ -103,6 +104,10 @@ void login_api::enable_api(const std::string &api_name)
   {
     _asset_api = std::make_shared<asset_api>(std::ref(*_app.chain_database()));
   }
+  else if (api_name == "node_stats_api")
+  {
+    _node_stats_api = std::make_shared<node_stats_api>(std::ref(*_app.chain_database()));
+  }
   else if (api_name == "debug_api")
   {
     // can only enable this API if the plugin was loaded
@@ -347,6 +352,16 @@ std::vector<net::potential_peer_record> network_node_api::get_potential_peers()
   return _app.p2p_node()->get_potential_peers();
 }
 
+fc::variant_object network_node_api::get_p2p_telemetry() const
+{
+  return _app.p2p_node()->get_p2p_telemetry();
+}
+
+fc::variant_object network_node_api::get_transaction_prevalidation_statistics() const
+{
+  return _app.chain_database()->get_transaction_prevalidator().get_statistics();
+}
+
 fc::variant_object network_node_api::get_advanced_node_parameters() const
 {
   return _app.p2p_node()->get_advanced_node_parameters();
@@ -368,6 +383,19 @@ void network_node_api::set_deduce_in_verification_mode(const bool &params)
   _app.chain_database()->set_deduce_in_verification_mode(params);
 }
 
+node_stats_api::node_stats_api(graphene::chain::database &db) : _db(db) {}
+
+vector<operation_type_stats> node_stats_api::get_operation_stats() const
+{
+  return _db.get_operation_stats().get_operation_stats();
+}
+
+vector<contract_call_stats> node_stats_api::get_contract_stats(uint32_t limit) const
+{
+  FC_ASSERT(limit <= 1000);
+  return _db.get_operation_stats().get_contract_stats(limit);
+}
+
 fc::api<network_broadcast_api> login_api::network_broadcast() const
 {
   FC_ASSERT(_network_broadcast_api);
@@ -386,6 +414,12 @@ fc::api<network_node_api> login_api::network_node() const
   return *_network_node_api;
 }
 
+fc::api<node_stats_api> login_api::node_stats() const
+{
+  FC_ASSERT(_node_stats_api);
+  return *_node_stats_api;
+}
+
 fc::api<database_api> login_api::database() const
 {
   FC_ASSERT(_database_api);
@@ -414,6 +448,8 @@ fc::api<graphene::debug_witness::debug_api> login_api::debug() const
 vector<order_history_object> history_api::get_fill_order_history(asset_id_type a, asset_id_type b, uint32_t limit) const
 {
   FC_ASSERT(_app.chain_database());
+  if (const auto *store = get_market_history_store())
+    return store->get_fill_order_history(a, b, limit);
   const auto &db = *_app.chain_database();
   if (a > b)
     std::swap(a, b);
@@ -438,6 +474,33 @@ vector<order_history_object> history_api::get_fill_order_history(asset_id_type a
   return result;
 }
 
+const graphene::account_history::account_history_store *history_api::get_history_store() const
+{
+  auto plugin = _app.get_plugin<graphene::account_history::account_history_plugin>("account_history");
+  return plugin ? plugin->history_store() : nullptr;
+}
+
+vector<operation_history_object> history_api::get_stored_account_history(account_id_type account,
+                                                                         operation_history_id_type stop,
+                                                                         unsigned limit,
+                                                                         operation_history_id_type start,
+                                                                         optional<unsigned> operation_type) const
+{
+  const auto &store = *get_history_store();
+  vector<operation_history_object> result;
+  uint32_t sequence = start == operation_history_id_type() ? store.total_ops(account) : store.find_sequence(account, start);
+  for (; sequence > 0 && result.size() < limit; --sequence)
+  {
+    auto id = store.get_operation_id(account, sequence);
+    if (stop.instance != 0 && id.instance <= stop.instance)
+      break;
+    auto op = store.get_operation(id);
+    if (op && (!operation_type || op->op.which() == *operation_type))
+      result.push_back(std::move(*op));
+  }
+  return result;
+}
+
 vector<operation_history_object> history_api::get_account_history(account_id_type account,
                                                                   operation_history_id_type stop,
                                                                   unsigned limit,
@@ -446,6 +509,8 @@ vector<operation_history_object> history_api::get_account_history(account_id_typ
   FC_ASSERT(_app.chain_database());
   const auto &db = *_app.chain_database();
   FC_ASSERT(limit <= 100);
+  if (get_history_store())
+    return get_stored_account_history(account, stop, limit, start, optional<unsigned>());
   vector<operation_history_object> result;
   const auto &stats = account(db).statistics(db);
   if (stats.most_recent_op == account_transaction_history_id_type())
@@ -481,6 +546,8 @@ vector<operation_history_object> history_api::get_account_history_operations(acc
   FC_ASSERT(_app.chain_database());
   const auto &db = *_app.chain_database();
   FC_ASSERT(limit <= 100);
+  if (get_history_store())
+    return get_stored_account_history(account, stop, limit, start, operation_id);
   vector<operation_history_object> result;
   const auto &stats = account(db).statistics(db);
   if (stats.most_recent_op == account_transaction_history_id_type())
@@ -520,6 +587,18 @@ vector<operation_history_object> history_api::get_relative_account_history(accou
   const auto &db = *_app.chain_database();
   FC_ASSERT(limit <= 100);
   vector<operation_history_object> result;
+  if (const auto *store = get_history_store())
+  {
+    const uint32_t total_ops = store->total_ops(account);
+    start = start == 0 ? total_ops : std::min(total_ops, start);
+    for (uint32_t sequence = start; sequence >= std::max(stop, 1u) && result.size() < limit; --sequence)
+    {
+      auto op = store->get_operation(store->get_operation_id(account, sequence));
+      if (op)
+        result.push_back(std::move(*op));
+    }
+    return result;
+  }
   const auto &stats = account(db).statistics(db);
   if (start == 0)
     start = stats.total_ops;
@@ -543,6 +622,12 @@ vector<operation_history_object> history_api::get_relative_account_history(accou
   return result;
 }
 
+const graphene::market_history::market_history_store *history_api::get_market_history_store() const
+{
+  auto plugin = _app.get_plugin<market_history_plugin>("market_history");
+  return plugin ? plugin->history_store() : nullptr;
+}
+
 flat_set<uint32_t> history_api::get_market_history_buckets() const
 {
   auto hist = _app.get_plugin<market_history_plugin>("market_history");
@@ -556,6 +641,8 @@ vector<bucket_object> history_api::get_market_history(asset_id_type a, asset_id_
   try
   {
     FC_ASSERT(_app.chain_database());
+    if (const auto *store = get_market_history_store())
+      return store->get_market_history(a, b, bucket_seconds, start, end, 200);
     const auto &db = *_app.chain_database();
     vector<bucket_object> result;
     result.reserve(200);
@@ -585,33 +672,25 @@ vector<bucket_object> history_api::get_market_history(asset_id_type a, asset_id_
 asset_api::asset_api(graphene::chain::database &db) : _db(db) {}
 asset_api::~asset_api() {}
 
+const asset_holder_index &asset_api::get_asset_holder_index() const
+{
+  const auto &idx = dynamic_cast<const primary_index<account_balance_index> &>(_db.get_index_type<account_balance_index>());
+  return idx.get_secondary_index<asset_holder_index>();
+}
+
 vector<account_asset_balance> asset_api::get_asset_holders(asset_id_type asset_id, uint32_t start, uint32_t limit) const
 {
   FC_ASSERT(limit <= 100);
 
-  const auto &bal_idx = _db.get_index_type<account_balance_index>().indices().get<by_asset_balance>();
-  auto range = bal_idx.equal_range(boost::make_tuple(asset_id));
-
   vector<account_asset_balance> result;
-
-  uint32_t index = 0;
-  for (const account_balance_object &bal : boost::make_iterator_range(range.first, range.second))
+  for (const auto &holder : get_asset_holder_index().get_holders(asset_id, start, limit))
   {
-    if (result.size() >= limit)
-      break;
-
-    if (bal.balance == 0)
-      continue;
-
-    if (index++ < start)
-      continue;
-
-    const auto account = _db.find(bal.owner);
+    const auto account = _db.find(holder.owner);
 
     account_asset_balance aab;
     aab.name = account->name;
     aab.account_id = account->id;
-    aab.amount = bal.balance;
+    aab.amount = holder.balance;
 
     result.push_back(aab);
   }
@@ -621,13 +700,7 @@ vector<account_asset_balance> asset_api::get_asset_holders(asset_id_type asset_i
 // get number of asset holders.
 int asset_api::get_asset_holders_count(asset_id_type asset_id) const
 {
-
-  const auto &bal_idx = _db.get_index_type<account_balance_index>().indices().get<by_asset_balance>();
-  auto range = bal_idx.equal_range(boost::make_tuple(asset_id));
-
-  int count = boost::distance(range) - 1;
-
-  return count;
+  return get_asset_holder_index().holder_count(asset_id);
 }
 // function to get vector of system assets with holders count.
 vector<asset_holders> asset_api::get_all_asset_holders() const
@@ -635,22 +708,12 @@ vector<asset_holders> asset_api::get_all_asset_holders() const
 
   vector<asset_holders> result;
 
-  vector<asset_id_type> total_assets;
+  const auto &holder_idx = get_asset_holder_index();
   for (const asset_object &asset_obj : _db.get_index_type<asset_index>().indices())
   {
-    const auto &dasset_obj = asset_obj.dynamic_asset_data_id(_db);
-
-    asset_id_type asset_id;
-    asset_id = dasset_obj.id;
-
-    const auto &bal_idx = _db.get_index_type<account_balance_index>().indices().get<by_asset_balance>();
-    auto range = bal_idx.equal_range(boost::make_tuple(asset_id));
-
-    int count = boost::distance(range) - 1;
-
     asset_holders ah;
-    ah.asset_id = asset_id;
-    ah.count = count;
+    ah.asset_id = asset_obj.id;
+    ah.count = holder_idx.holder_count(asset_obj.id);
 
     result.push_back(ah);
   }
@@ -51,6 +51,7 @@
 #include <boost/algorithm/string.hpp>
 
 #include <iostream>
+#include <limits>
 #include <regex>
 
 #include <fc/log/file_appender.hpp>
@@ -129,6 +130,8 @@ public:
         _p2p_network->record_rpc_information(fc::ip::endpoint::from_string(_options->at("rpc-endpoint").as<string>()));
       _p2p_network->load_configuration(data_dir / "p2p");
       _p2p_network->set_node_delegate(this);
+      if (_options->count("p2p-io-threads"))
+        _p2p_network->set_advanced_node_parameters(fc::mutable_variant_object("io_threads", _options->at("p2p-io-threads").as<uint32_t>()));
       if (_options->count("seed-node"))
       {
         auto seeds = _options->at("seed-node").as<vector<string>>();
@@ -420,8 +423,30 @@ public:
         auto flag=_options->at("deduce_in_verification_mode").as<bool>();
         _chain_db->set_deduce_in_verification_mode(flag);
       }
-      if (_options->count("replay-blockchain"))
+      if (_options->count("contract-profile-log-interval"))
+        _chain_db->get_contract_profiler().set_log_interval(_options->at("contract-profile-log-interval").as<uint32_t>());
+      if (_options->count("operation-stats-log-interval"))
+        _chain_db->get_operation_stats().set_log_interval(_options->at("operation-stats-log-interval").as<uint32_t>());
+      if (_options->count("contract-profiling") && _options->at("contract-profiling").as<bool>())
+        _chain_db->enable_contract_profiling(true);
+      if (_options->count("contract-memory-cap"))
+        _chain_db->set_contract_memory_cap(_options->at("contract-memory-cap").as<uint64_t>());
+      if (_options->count("contract-standby-vm"))
+        _chain_db->set_contract_standby_vm(_options->at("contract-standby-vm").as<bool>());
+      if (_options->count("contract-code-compression-threshold"))
+        _chain_db->get_contract_code_cache().set_compression_threshold(_options->at("contract-code-compression-threshold").as<uint32_t>());
+      if (_options->count("contract-code-cache-size"))
+        _chain_db->get_contract_code_cache().set_capacity(_options->at("contract-code-cache-size").as<uint64_t>() * 1024 * 1024);
+      if (_options->count("block-preparation-threads"))
+        _chain_db->set_block_preparation_threads(_options->at("block-preparation-threads").as<uint32_t>());
+      if (_options->count("replay-blockchain") || _options->count("replay-benchmark"))
         _chain_db->wipe(_data_dir / "blockchain", false);
+      if (_options->count("replay-benchmark"))
+      {
+        uint32_t first = _options->count("replay-benchmark-start") ? _options->at("replay-benchmark-start").as<uint32_t>() : 1;
+        uint32_t last = _options->count("replay-benchmark-end") ? _options->at("replay-benchmark-end").as<uint32_t>() : std::numeric_limits<uint32_t>::max();
+        _chain_db->get_block_profiler().enable(_options->at("replay-benchmark").as<boost::filesystem::path>(), first, last);
+      }
       
       auto roll_back_at_height = 0;  
       if (_options->count("roll-back-at-height"))  
@@ -437,6 +462,15 @@ public:
         throw;
       }
 
+      if (_options->count("replay-benchmark"))
+      {
+        // the replay happened in open(), report it and stay off the network
+        _chain_db->get_block_profiler().flush();
+        std::cout << _chain_db->get_block_profiler().summary() << std::flush;
+        ilog("Replay benchmark written to ${f}", ("f", _options->at("replay-benchmark").as<boost::filesystem::path>().string()));
+        return;
+      }
+
       if (_options->count("force-validate"))
       {
         ilog("All transaction signatures will be validated");
@@ -563,6 +597,11 @@ public:
 
         return result;
       }
+      catch (const graphene::chain::unlinkable_block_buffered_exception &e)
+      {
+        // not an error, the fork database links the block once its parent arrives
+        FC_THROW_EXCEPTION(graphene::net::unlinkable_block_buffered_exception, "Block is kept until its parent arrives:\n${e}", ("e", e.to_string()));
+      }
       catch (const graphene::chain::unlinkable_block_exception &e)
       {
         // translate to a graphene::net exception
@@ -599,11 +638,16 @@ public:
         trx_count = 0;
       }
 
-      _chain_db->push_transaction(transaction_message.trx, 0, transaction_push_state::from_net);
+      _chain_db->push_transaction(transaction_message.trx, 0, transaction_push_state::from_net, transaction_message.prevalidated.get());
     }
     FC_CAPTURE_AND_RETHROW((transaction_message))
   }
 
+  virtual void prevalidate_transaction(const graphene::net::trx_message &transaction_message) override
+  {
+    transaction_message.prevalidated = _chain_db->prevalidate_transaction(transaction_message.trx);
+  }
+
   virtual void handle_message(const message &message_to_process) override
   {
     switch (message_to_process.msg_type)
@@ -1002,6 +1046,7 @@ void application::set_program_options(boost::program_options::options_descriptio
 {
   configuration_file_options.add_options()
                                         ("p2p-endpoint", bpo::value<string>(), "Endpoint for P2P node to listen on")
+                                        ("p2p-io-threads", bpo::value<uint32_t>(), "Number of threads doing socket I/O and message decryption for P2P connections, 0 to use the P2P thread")
                                         ("seed-node,s", bpo::value<vector<string>>()->composing(), "P2P nodes to connect to on startup (may specify multiple times)")
                                         ("seed-nodes", bpo::value<string>()->composing(), "JSON array of P2P nodes to connect to on startup")
                                         ("checkpoint,c", bpo::value<vector<string>>()->composing(), "Pairs of [BLOCK_NUM,BLOCK_ID] that should be enforced as checkpoints.")
@@ -1014,13 +1059,25 @@ void application::set_program_options(boost::program_options::options_descriptio
                                         ("api-access", bpo::value<boost::filesystem::path>(), "JSON file specifying API permissions")
                                         ("plugins", bpo::value<string>(), "Space-separated list of plugins to activate")
                                         ("contract_total_data_size", bpo::value<uint64_t>(), "limit the contract total data size")
-                                        ("contract_private_data_size", bpo::value<uint64_t>(), "limit the contract private data size");
+                                        ("contract_private_data_size", bpo::value<uint64_t>(), "limit the contract private data size")
+                                        ("contract-profiling", bpo::value<bool>()->default_value(false), "Profile contract VM execution (instructions, bindings, allocations, GC time)")
+                                        ("contract-profile-log-interval", bpo::value<uint32_t>(), "Log the contract profile every N blocks while profiling is enabled")
+                                        ("operation-stats-log-interval", bpo::value<uint32_t>(), "Log the per operation type and per contract execution statistics every N blocks")
+                                        ("contract-memory-cap", bpo::value<uint64_t>(), "Maximum bytes a single contract call may add to the VM heap when pushing or producing transactions (0 = unlimited)")
+                                        ("contract-standby-vm", bpo::value<bool>()->default_value(true), "Keep a pre-initialized contract VM ready on a background thread to replace a collapsed VM")
+                                        ("contract-code-compression-threshold", bpo::value<uint32_t>()->default_value(0), "Store contract bytecode larger than this many bytes compressed, 0 to store all bytecode as is")
+                                        ("contract-code-cache-size", bpo::value<uint64_t>()->default_value(64), "Megabytes of decompressed contract bytecode kept in memory")
+                                        ("block-preparation-threads", bpo::value<uint32_t>()->default_value(GRAPHENE_DEFAULT_BLOCK_PREPARATION_THREADS), "Number of threads that hash, size and validate the transactions of a block before it is applied, 0 to do it on the main thread");
   command_line_options.add(configuration_file_options);
   command_line_options.add_options()("create-genesis-json", bpo::value<boost::filesystem::path>(),
                                      "Path to create a Genesis State at. If a well-formed JSON file exists at the path, it will be parsed and any "
                                      "missing fields in a Genesis State will be added, and any unknown fields will be removed. If no file or an "
                                      "invalid file is found, it will be replaced with an example Genesis State.")
                                      ("replay-blockchain", "Rebuild object graph by replaying all blocks")
+                                     ("replay-benchmark", bpo::value<boost::filesystem::path>()->implicit_value("replay_benchmark.csv"),
+                                      "Replay all blocks like --replay-blockchain, write the time spent in each phase of every block to this CSV file, print a summary and exit")
+                                     ("replay-benchmark-start", bpo::value<uint32_t>(), "First block timed by --replay-benchmark, earlier blocks are replayed untimed")
+                                     ("replay-benchmark-end", bpo::value<uint32_t>(), "Last block replayed by --replay-benchmark")
                                      ("resync-blockchain", "Delete all blocks and re-sync with network from scratch")
                                      ("roll-back-at-height", bpo::value<uint32_t>(), "Roll back to this Height ")
                                      ("force-validate", "Force validation of all transactions")
@@ -109,6 +109,8 @@ class database_api_impl : public std::enable_shared_from_this<database_api_impl>
     // Blocks and transactions
     optional<block_header> get_block_header(uint32_t block_num) const;
     map<uint32_t, optional<block_header>> get_block_header_batch(const vector<uint32_t> block_nums) const;
+    vector<block_header_info> get_block_headers(uint32_t start_block_num, uint32_t limit) const;
+    vector<vector<char>> get_packed_blocks(uint32_t start_block_num, uint32_t limit) const;
     optional<signed_block> get_block(uint32_t block_num) const;
     optional<signed_block> get_block_by_id(const block_id_type& block_id) const;
     processed_transaction get_transaction(uint32_t block_num, uint32_t trx_in_block) const;
@@ -243,6 +245,8 @@ class database_api_impl : public std::enable_shared_from_this<database_api_impl>
         }
     }
 
+    // objects as API readers see them, independent of how this node stores them
+    fc::variant object_to_variant(const object &obj) const;
     void broadcast_updates(const vector<variant> &updates);
     void broadcast_market_updates(const market_queue_type &queue);
     void handle_object_changed(bool force_notify, bool full_object, const vector<object_id_type> &ids, const flat_set<account_id_type> &impacted_accounts, std::function<const object *(object_id_type id)> find_object);
@@ -338,7 +342,7 @@ fc::variants database_api_impl::get_objects(const vector<object_id_type> &ids) c
     std::transform(ids.begin(), ids.end(), std::back_inserter(result),
                    [this](object_id_type id) -> fc::variant {
                        if (auto obj = _db.find_object(id))
-                           return obj->to_variant();
+                           return object_to_variant(*obj);
                        return {};
                    });
 
@@ -415,9 +419,9 @@ optional<block_header> database_api::get_block_header(uint32_t block_num) const
 
 optional<block_header> database_api_impl::get_block_header(uint32_t block_num) const
 {
-    auto result = _db.fetch_block_by_number(block_num);
+    auto result = _db.fetch_block_header_by_number(block_num);
     if (result)
-        return *result;
+        return result->header;
     return {};
 }
 map<uint32_t, optional<block_header>> database_api::get_block_header_batch(const vector<uint32_t> block_nums) const
@@ -435,6 +439,49 @@ map<uint32_t, optional<block_header>> database_api_impl::get_block_header_batch(
     return results;
 }
 
+vector<block_header_info> database_api::get_block_headers(uint32_t start_block_num, uint32_t limit) const
+{
+    return my->get_block_headers(start_block_num, limit);
+}
+
+vector<block_header_info> database_api_impl::get_block_headers(uint32_t start_block_num, uint32_t limit) const
+{
+    FC_ASSERT(limit <= 1000);
+    vector<block_header_info> results;
+    results.reserve(limit);
+    for (uint32_t block_num = start_block_num; block_num < start_block_num + limit; ++block_num)
+    {
+        auto header = _db.fetch_block_header_by_number(block_num);
+        if (!header)
+            break;
+        results.push_back(std::move(*header));
+    }
+    return results;
+}
+
+vector<vector<char>> database_api::get_packed_blocks(uint32_t start_block_num, uint32_t limit) const
+{
+    return my->get_packed_blocks(start_block_num, limit);
+}
+
+vector<vector<char>> database_api_impl::get_packed_blocks(uint32_t start_block_num, uint32_t limit) const
+{
+    FC_ASSERT(limit <= 1000);
+    // keeps a single response from holding up the connection, the caller asks again for the rest
+    const size_t max_response_size = 4 * 1024 * 1024;
+    vector<vector<char>> results;
+    size_t response_size = 0;
+    for (uint32_t block_num = start_block_num; block_num < start_block_num + limit && response_size < max_response_size; ++block_num)
+    {
+        auto packed = _db.fetch_packed_block_by_number(block_num);
+        if (!packed)
+            break;
+        response_size += packed->size();
+        results.push_back(std::move(*packed));
+    }
+    return results;
+}
+
 optional<signed_block> database_api::get_block(uint32_t block_num) const
 {
     return my->get_block(block_num);
@@ -1990,10 +2037,11 @@ set<public_key_type> database_api::get_required_signatures(const signed_transact
 set<public_key_type> database_api_impl::get_required_signatures(const signed_transaction &trx, const flat_set<public_key_type> &available_keys) const
 {
     //wdump((trx)(available_keys));
+    auto &authorities = _db.get_authority_cache();
     auto result = trx.get_required_signatures(_db.get_chain_id(),
                                               available_keys,
-                                              [&](account_id_type id) { return &id(_db).active; },
-                                              [&](account_id_type id) { return &id(_db).owner; },
+                                              [&](account_id_type id) { return authorities.get_active(id); },
+                                              [&](account_id_type id) { return authorities.get_owner(id); },
                                               _db.get_global_properties().parameters.max_authority_depth);
     //wdump((result));
     return result;
@@ -2272,6 +2320,24 @@ void database_api_impl::broadcast_market_updates(const market_queue_type &queue)
     }
 }
 
+fc::variant database_api_impl::object_to_variant(const object &obj) const
+{
+    // whether bytecode is compressed depends on the node's compression threshold, readers always
+    // get the uncompressed code so every node returns the same object
+    if (obj.id.space() == implementation_ids && obj.id.type() == impl_contract_bin_code_type)
+    {
+        const auto &code = static_cast<const contract_bin_code_object &>(obj);
+        if (code.compressed)
+        {
+            contract_bin_code_object inflated = code;
+            inflated.lua_code_b = _db.get_contract_code(code);
+            inflated.compressed = false;
+            return fc::variant(inflated);
+        }
+    }
+    return obj.to_variant();
+}
+
 void database_api_impl::on_objects_removed(const vector<object_id_type> &ids, const vector<const object *> &objs, const flat_set<account_id_type> &impacted_accounts)
 {
     handle_object_changed(_notify_remove_create, false, ids, impacted_accounts,
@@ -2315,7 +2381,7 @@ void database_api_impl::handle_object_changed(bool force_notify, bool full_objec
                     auto obj = find_object(id);
                     if (obj)
                     {
-                        updates.emplace_back(obj->to_variant());
+                        updates.emplace_back(object_to_variant(*obj));
                     }
                 }
                 else
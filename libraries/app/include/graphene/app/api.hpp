@@ -28,6 +28,8 @@
 #include <graphene/chain/protocol/types.hpp>
 
 #include <graphene/market_history/market_history_plugin.hpp>
+#include <graphene/market_history/market_history_store.hpp>
+#include <graphene/account_history/account_history_store.hpp>
 
 #include <graphene/debug_witness/debug_api.hpp>
 
@@ -146,6 +148,15 @@ public:
   flat_set<uint32_t> get_market_history_buckets() const;
 
 private:
+  const graphene::account_history::account_history_store *get_history_store() const;
+  /// get_account_history and get_account_history_operations served from the on-disk store
+  vector<operation_history_object> get_stored_account_history(account_id_type account,
+                                                              operation_history_id_type stop,
+                                                              unsigned limit,
+                                                              operation_history_id_type start,
+                                                              optional<unsigned> operation_type) const;
+  const graphene::market_history::market_history_store *get_market_history_store() const;
+
   application &_app;
 };
 
@@ -271,10 +282,51 @@ public:
           */
   std::vector<net::potential_peer_record> get_potential_peers() const;
 
+  /**
+          * @brief Return latency and throughput histograms per message type and per peer,
+          *        along with block propagation delay and node delegate call timing
+          *
+          * Times are in microseconds and sizes in bytes.  Each histogram reports count, sum, min, mean,
+          * p50, p90, p99 and max; percentiles are the upper bound of the power-of-two bucket they fall in.
+          * Peers are keyed by their remote endpoint.
+          */
+  fc::variant_object get_p2p_telemetry() const;
+
+  /**
+          * @brief Return how many transactions from the network passed the speculative checks,
+          *        and how many were rejected for each reason
+          */
+  fc::variant_object get_transaction_prevalidation_statistics() const;
+
 private:
   application &_app;
   bool enable_set;
 };
+
+/**
+    * @brief The node_stats_api class reports how this node spends its time applying operations
+    *
+    * Not part of the default access policy, grant it to a user in the api-access file to use it.
+    */
+class node_stats_api
+{
+public:
+  node_stats_api(graphene::chain::database &db);
+
+  /**
+          * @brief Count, time, failures and undo objects of every operation type applied since startup
+          */
+  vector<operation_type_stats> get_operation_stats() const;
+
+  /**
+          * @brief The same counters for the contracts with the most call time
+          * @param limit Maximum number of contracts to return, up to 1000
+          */
+  vector<contract_call_stats> get_contract_stats(uint32_t limit) const;
+
+private:
+  graphene::chain::database &_db;
+};
 /**
     * @brief
     */
@@ -289,6 +341,8 @@ public:
   vector<asset_holders> get_all_asset_holders() const;
 
 private:
+  const asset_holder_index &get_asset_holder_index() const;
+
   graphene::chain::database &_db;
 };
 
@@ -327,6 +381,8 @@ public:
   //fc::api<crypto_api> crypto() const;
   /// @brief Retrieve the asset API
   fc::api<asset_api> asset() const;
+  /// @brief Retrieve the node stats API
+  fc::api<node_stats_api> node_stats() const;
   /// @brief Retrieve the debug API (if available)
   fc::api<graphene::debug_witness::debug_api> debug() const;
 
@@ -343,6 +399,7 @@ private:
   optional<fc::api<history_api>> _history_api;
   //optional<fc::api<crypto_api>> _crypto_api;
   optional<fc::api<asset_api>> _asset_api;
+  optional<fc::api<node_stats_api>> _node_stats_api;
   optional<fc::api<graphene::debug_witness::debug_api>> _debug_api;
 };
 
@@ -369,8 +426,10 @@ FC_API(graphene::app::block_api,
 FC_API(graphene::app::network_broadcast_api,
        (broadcast_transaction)(broadcast_transaction_with_callback)(broadcast_transaction_synchronous)(broadcast_block))
 FC_API(graphene::app::network_node_api,
-       (get_info)(add_node)(get_connected_peers)(get_potential_peers)(get_advanced_node_parameters)(set_advanced_node_parameters)(set_message_send_cache_size)(set_deduce_in_verification_mode))
+       (get_info)(add_node)(get_connected_peers)(get_potential_peers)(get_p2p_telemetry)(get_transaction_prevalidation_statistics)(get_advanced_node_parameters)(set_advanced_node_parameters)(set_message_send_cache_size)(set_deduce_in_verification_mode))
+FC_API(graphene::app::node_stats_api,
+       (get_operation_stats)(get_contract_stats))
 FC_API(graphene::app::asset_api,
        (get_asset_holders)(get_asset_holders_count)(get_all_asset_holders))
 FC_API(graphene::app::login_api,
-       (login)(block)(network_broadcast)(database)(history)(network_node)(asset)(debug))
+       (login)(block)(network_broadcast)(database)(history)(network_node)(asset)(node_stats)(debug))
@@ -155,6 +155,8 @@ class database_api
        * @return The objects retrieved, in the order they are mentioned in ids
        *
        * If any of the provided IDs does not map to an object, a null variant is returned in its position.
+       * Contract bytecode objects are returned with their code uncompressed, whatever the node's
+       * compression threshold, so every node returns the same object.
        */
       fc::variants get_objects(const vector<object_id_type> &ids) const;
 
@@ -190,6 +192,23 @@ class database_api
       */
       map<uint32_t, optional<block_header>> get_block_header_batch(const vector<uint32_t> block_nums) const;
 
+      /**
+      * @brief Page through block headers without fetching the blocks' transactions
+      * @param start_block_num Height of the first block whose header should be returned
+      * @param limit Maximum number of headers to return, at most 1000
+      * @return headers with their block id, signature, transaction count and size, up to the first missing block
+      */
+      vector<block_header_info> get_block_headers(uint32_t start_block_num, uint32_t limit) const;
+
+      /**
+      * @brief Fetch a range of blocks in their packed form, for nodes and indexers catching up
+      * @param start_block_num Height of the first block to return
+      * @param limit Maximum number of blocks to return, at most 1000
+      * @return fc::raw::pack of each block, as stored in the block database, up to the first missing block;
+      *         fewer blocks are returned once the response passes 4 MiB, so callers should ask again from the next one
+      */
+      vector<vector<char>> get_packed_blocks(uint32_t start_block_num, uint32_t limit) const;
+
       /**
        * @brief Retrieve a full, signed block
        * @param block_num Height of the block to be returned
@@ -685,7 +704,7 @@ FC_API(graphene::app::database_api,
        (set_subscribe_callback)(set_pending_transaction_callback)(set_block_applied_callback)(cancel_all_subscriptions)
 
        // Blocks and transactions
-       (get_block_header)(get_block_header_batch)(get_block)(get_block_by_id)(get_transaction)(get_recent_transaction_by_id)
+       (get_block_header)(get_block_header_batch)(get_block_headers)(get_packed_blocks)(get_block)(get_block_by_id)(get_transaction)(get_recent_transaction_by_id)
 
        // Globals
        (get_chain_properties)(get_global_properties)(get_config)(get_chain_id)(get_dynamic_global_properties)(get_global_property_extensions)
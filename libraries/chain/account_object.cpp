@@ -90,6 +90,58 @@ set<address> account_member_index::get_address_members(const account_object& a)c
    return result;
 }
 
+void asset_holder_index::insert(const account_balance_object& b)
+{
+   if( b.balance != 0 )
+      holders.insert( holder{ b.asset_type, b.balance, b.owner } );
+}
+
+void asset_holder_index::remove(const account_balance_object& b)
+{
+   auto itr = holders.find( boost::make_tuple( b.asset_type, b.balance, b.owner ) );
+   if( itr != holders.end() )
+      holders.erase( itr );
+}
+
+void asset_holder_index::object_inserted(const object& obj)
+{
+   insert( static_cast<const account_balance_object&>(obj) );
+}
+
+void asset_holder_index::object_removed(const object& obj)
+{
+   remove( static_cast<const account_balance_object&>(obj) );
+}
+
+void asset_holder_index::about_to_modify(const object& before)
+{
+   remove( static_cast<const account_balance_object&>(before) );
+}
+
+void asset_holder_index::object_modified(const object& after)
+{
+   insert( static_cast<const account_balance_object&>(after) );
+}
+
+uint32_t asset_holder_index::holder_count(asset_id_type asset)const
+{
+   return holders.rank( holders.upper_bound( boost::make_tuple( asset ) ) )
+        - holders.rank( holders.lower_bound( boost::make_tuple( asset ) ) );
+}
+
+vector<asset_holder_index::holder> asset_holder_index::get_holders(asset_id_type asset, uint32_t start, uint32_t limit)const
+{
+   vector<holder> result;
+   const auto first = holders.rank( holders.lower_bound( boost::make_tuple( asset ) ) );
+   const auto end = holders.rank( holders.upper_bound( boost::make_tuple( asset ) ) );
+   if( first + start >= end )
+      return result;
+   result.reserve( std::min<size_t>( limit, end - first - start ) );
+   for( auto itr = holders.nth( first + start ); itr != holders.end() && itr->asset_type == asset && result.size() < limit; ++itr )
+      result.push_back( *itr );
+   return result;
+}
+
 void account_member_index::object_inserted(const object& obj)
 {
     assert( dynamic_cast<const account_object*>(&obj) ); // for debug only
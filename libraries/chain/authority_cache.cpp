@@ -0,0 +1,69 @@
+#include <graphene/chain/authority_cache.hpp>
+#include <graphene/chain/database.hpp>
+#include <graphene/chain/account_object.hpp>
+#include <graphene/chain/temporary_authority.hpp>
+
+namespace graphene
+{
+namespace chain
+{
+
+namespace
+{
+
+class account_authority_observer : public graphene::db::index_observer
+{
+  public:
+    explicit account_authority_observer(authority_cache &cache) : _cache(cache) {}
+    virtual void on_add(const object &obj) override { invalidate(obj); }
+    virtual void on_remove(const object &obj) override { invalidate(obj); }
+    virtual void on_modify(const object &obj) override { invalidate(obj); }
+
+  private:
+    void invalidate(const object &obj) { _cache.invalidate(static_cast<const account_object &>(obj).id); }
+    authority_cache &_cache;
+};
+
+class temporary_active_observer : public graphene::db::index_observer
+{
+  public:
+    explicit temporary_active_observer(authority_cache &cache) : _cache(cache) {}
+    virtual void on_add(const object &obj) override { invalidate(obj); }
+    virtual void on_remove(const object &obj) override { invalidate(obj); }
+    virtual void on_modify(const object &obj) override { invalidate(obj); }
+
+  private:
+    void invalidate(const object &obj) { _cache.invalidate(static_cast<const temporary_active_object &>(obj).owner); }
+    authority_cache &_cache;
+};
+
+} // namespace
+
+const authority *authority_cache::get_active(account_id_type id)
+{
+    auto itr = _active.find(id);
+    if (itr != _active.end())
+        return &itr->second;
+
+    authority active = id(_db).active;
+    auto &index = _db.get_index_type<temporary_active_index>().indices().get<by_account_id_type>();
+    auto temporary = index.find(id);
+    if (temporary != index.end())
+        active.key_auths.insert(temporary->temporary_active.begin(), temporary->temporary_active.end());
+    return &_active.emplace(id, std::move(active)).first->second;
+}
+
+const authority *authority_cache::get_owner(account_id_type id) const
+{
+    return &id(_db).owner;
+}
+
+void authority_cache::observe(graphene::db::index &accounts, graphene::db::index &temporary_actives)
+{
+    _active.clear();
+    accounts.add_observer(std::make_shared<account_authority_observer>(*this));
+    temporary_actives.add_observer(std::make_shared<temporary_active_observer>(*this));
+}
+
+} // namespace chain
+} // namespace graphene
@@ -34,6 +34,40 @@ struct index_entry
    uint32_t      block_size = 0;
    block_id_type block_id;
 };
+
+struct header_entry
+{
+   static const size_t max_header_size = 160;
+
+   block_id_type block_id;
+   uint32_t      transaction_count = 0;
+   uint32_t      block_size = 0;
+   uint16_t      header_size = 0; ///< 0 if there is no record, or the header did not fit
+   char          packed_header[max_header_size];
+
+   /// the signed_block_header is the first thing in a packed signed_block, followed by block_id and the transactions
+   static header_entry from_packed_block( const block_id_type& id, const vector<char>& packed )
+   {
+      header_entry h;
+      h.block_id = id;
+      h.block_size = packed.size();
+      fc::datastream<const char*> ds( packed.data(), packed.size() );
+      signed_block_header header;
+      fc::raw::unpack( ds, header );
+      const size_t header_size = ds.tellp();
+      block_id_type block_id;
+      fc::raw::unpack( ds, block_id );
+      unsigned_int transaction_count;
+      fc::raw::unpack( ds, transaction_count );
+      h.transaction_count = transaction_count.value;
+      if( header_size <= max_header_size )
+      {
+         h.header_size = header_size;
+         memcpy( h.packed_header, packed.data(), header_size );
+      }
+      return h;
+   }
+};
  }}
 FC_REFLECT( graphene::chain::index_entry, (block_pos)(block_size)(block_id) );
 
@@ -46,6 +80,13 @@ void block_database::open( const fc::path& dbdir )
    _blocks.exceptions(std::ios_base::failbit | std::ios_base::badbit);
 
    _index_filename = dbdir / "index";
+   const auto headers_filename = (dbdir/"headers").generic_string();
+   if( !fc::exists( _index_filename ) || !fc::exists( headers_filename ) )
+     // filled in as blocks are stored, or on first lookup for blocks stored before it existed
+     _block_num_to_header.open( headers_filename.c_str(), std::fstream::binary | std::fstream::in | std::fstream::out | std::fstream::trunc );
+   else
+     _block_num_to_header.open( headers_filename.c_str(), std::fstream::binary | std::fstream::in | std::fstream::out );
+   _block_num_to_header.exceptions(std::ios_base::failbit | std::ios_base::badbit);
    if( !fc::exists( _index_filename ) )
    {
      _block_num_to_pos.open( _index_filename.generic_string().c_str(), std::fstream::binary | std::fstream::in | std::fstream::out | std::fstream::trunc);
@@ -67,12 +108,14 @@ void block_database::close()
 {
   _blocks.close();
   _block_num_to_pos.close();
+  _block_num_to_header.close();
 }
 
 void block_database::flush()
 {
   _blocks.flush();
   _block_num_to_pos.flush();
+  _block_num_to_header.flush();
 }
 
 void block_database::store( const block_id_type& _id, const signed_block& b )
@@ -83,15 +126,26 @@ void block_database::store( const block_id_type& _id, const signed_block& b )
       id = b.make_id();
       elog( "id argument of block_database::store() was not initialized for block ${id}", ("id", id) );
    }
+   store( id, fc::raw::pack( b ) );
+}
+
+void block_database::store( const block_id_type& id, const vector<char>& vec )
+{
    _block_num_to_pos.seekp( sizeof( index_entry ) * int64_t(block_header::num_from_id(id)) );
    index_entry e;
    _blocks.seekp( 0, _blocks.end );
-   auto vec = fc::raw::pack( b );
    e.block_pos  = _blocks.tellp();
    e.block_size = vec.size();
    e.block_id   = id;
    _blocks.write( vec.data(), vec.size() );
    _block_num_to_pos.write( (char*)&e, sizeof(e) );
+   store_header( block_header::num_from_id(id), header_entry::from_packed_block( id, vec ) );
+}
+
+void block_database::store_header( uint32_t block_num, const header_entry& h )const
+{
+   _block_num_to_header.seekp( sizeof( header_entry ) * int64_t(block_num) );
+   _block_num_to_header.write( (const char*)&h, sizeof(h) );
 }
 
 void block_database::remove( const block_id_type& id )
@@ -206,6 +260,92 @@ optional<signed_block> block_database::fetch_by_number( uint32_t block_num )cons
    return optional<signed_block>();
 }
 
+optional<vector<char>> block_database::fetch_packed_by_number( uint32_t block_num )const
+{
+   try
+   {
+      index_entry e;
+      int64_t index_pos = sizeof(e) * int64_t(block_num);
+      _block_num_to_pos.seekg( 0, _block_num_to_pos.end );
+      if ( _block_num_to_pos.tellg() <= index_pos )
+         return {};
+
+      _block_num_to_pos.seekg( index_pos, _block_num_to_pos.beg );
+      _block_num_to_pos.read( (char*)&e, sizeof(e) );
+      if( e.block_size == 0 )
+         return {};
+
+      vector<char> data( e.block_size );
+      _blocks.seekg( e.block_pos );
+      _blocks.read( data.data(), e.block_size );
+      return data;
+   }
+   catch (const fc::exception&)
+   {
+   }
+   catch (const std::exception&)
+   {
+   }
+   return optional<vector<char>>();
+}
+
+optional<block_header_info> block_database::fetch_header_by_number( uint32_t block_num )const
+{
+   try
+   {
+      index_entry e;
+      int64_t index_pos = sizeof(e) * int64_t(block_num);
+      _block_num_to_pos.seekg( 0, _block_num_to_pos.end );
+      if ( _block_num_to_pos.tellg() <= index_pos )
+         return {};
+
+      _block_num_to_pos.seekg( index_pos, _block_num_to_pos.beg );
+      _block_num_to_pos.read( (char*)&e, sizeof(e) );
+      if( e.block_size == 0 )
+         return {};
+
+      header_entry h;
+      int64_t header_pos = sizeof(h) * int64_t(block_num);
+      _block_num_to_header.seekg( 0, _block_num_to_header.end );
+      if( _block_num_to_header.tellg() >= int64_t(header_pos + sizeof(h)) )
+      {
+         _block_num_to_header.seekg( header_pos );
+         _block_num_to_header.read( (char*)&h, sizeof(h) );
+      }
+
+      block_header_info result;
+      if( h.block_id != e.block_id || h.header_size == 0 )
+      {
+         // stored before there were header records, or the header was too large for one: parse it out of the block
+         vector<char> data( e.block_size );
+         _blocks.seekg( e.block_pos );
+         _blocks.read( data.data(), e.block_size );
+         h = header_entry::from_packed_block( e.block_id, data );
+         if( h.header_size > 0 )
+            store_header( block_num, h );
+         fc::datastream<const char*> ds( data.data(), data.size() );
+         fc::raw::unpack( ds, result.header );
+      }
+      else
+      {
+         fc::datastream<const char*> ds( h.packed_header, h.header_size );
+         fc::raw::unpack( ds, result.header );
+      }
+      result.id = e.block_id;
+      result.transaction_count = h.transaction_count;
+      result.block_size = h.block_size;
+      FC_ASSERT( result.header.make_id() == e.block_id );
+      return result;
+   }
+   catch (const fc::exception&)
+   {
+   }
+   catch (const std::exception&)
+   {
+   }
+   return optional<block_header_info>();
+}
+
 optional<index_entry> block_database::last_index_entry()const {
    try
    {
@@ -0,0 +1,155 @@
+#include <graphene/chain/block_phase_profiler.hpp>
+#include <graphene/chain/operation_stats.hpp>
+#include <fc/log/logger.hpp>
+
+#include <algorithm>
+#include <iomanip>
+#include <sstream>
+
+namespace graphene
+{
+namespace chain
+{
+
+const char *block_phase_profiler::phase_name(phase p)
+{
+    static const char *const names[phase_count] = {
+        "prepare", "merkle", "evaluate", "contract", "maintenance",
+        "clear_expired_transactions", "clear_expired_nh_asset_orders", "clear_expired_proposals",
+        "clear_expired_orders", "clear_expired_timed_task", "update_expired_feeds", "clear_expired_active",
+        "applied_block", "notify_changed_objects"};
+    return names[p];
+}
+
+block_phase_profiler::scoped_phase::scoped_phase(block_phase_profiler &profiler, phase p)
+    : profiler(profiler), p(p), recording(profiler._recording)
+{
+    if (recording)
+        start = fc::time_point::now();
+}
+
+block_phase_profiler::scoped_phase::~scoped_phase()
+{
+    if (recording)
+        profiler._current.phases[p] += (fc::time_point::now() - start).count();
+}
+
+block_phase_profiler::scoped_operation::scoped_operation(block_phase_profiler &profiler, const operation &op)
+    : profiler(profiler), op(op), recording(profiler._recording)
+{
+    if (!recording)
+        return;
+    profiler._operation_depth++;
+    start = fc::time_point::now();
+}
+
+block_phase_profiler::scoped_operation::~scoped_operation()
+{
+    if (!recording)
+        return;
+    uint64_t elapsed = (fc::time_point::now() - start).count();
+    auto &entry = profiler._operations[op.which()];
+    entry.count++;
+    entry.total_time += elapsed;
+    entry.max_time = std::max(entry.max_time, elapsed);
+    if (--profiler._operation_depth > 0)
+        return;
+    profiler._current.operations++;
+    bool is_contract = op.which() == operation::tag<call_contract_function_operation>::value;
+    profiler._current.phases[is_contract ? contract : evaluate] += elapsed;
+}
+
+void block_phase_profiler::enable(const fc::path &csv_file, uint32_t first_block, uint32_t last_block)
+{
+    FC_ASSERT(first_block <= last_block, "empty block range", ("first", first_block)("last", last_block));
+    _csv.exceptions(std::ios_base::failbit | std::ios_base::badbit);
+    _csv.open(csv_file.generic_string().c_str(), std::ofstream::out | std::ofstream::trunc);
+    _csv << "block_num,transactions,operations,total_us";
+    for (int p = 0; p < phase_count; p++)
+        _csv << "," << phase_name(phase(p)) << "_us";
+    _csv << ",other_us\n";
+    _first_block = first_block;
+    _last_block = last_block;
+    _enabled = true;
+}
+
+void block_phase_profiler::begin_block(uint32_t block_num, uint32_t transactions)
+{
+    _recording = _enabled && block_num >= _first_block && block_num <= _last_block;
+    if (!_recording)
+        return;
+    _current = block_record();
+    _current.block_num = block_num;
+    _current.transactions = transactions;
+    _operation_depth = 0;
+    _current.start = fc::time_point::now();
+}
+
+void block_phase_profiler::end_block()
+{
+    if (!_recording)
+        return;
+    _recording = false;
+    uint64_t total = (fc::time_point::now() - _current.start).count();
+    uint64_t accounted = 0;
+    _csv << _current.block_num << "," << _current.transactions << "," << _current.operations << "," << total;
+    for (int p = 0; p < phase_count; p++)
+    {
+        _csv << "," << _current.phases[p];
+        accounted += _current.phases[p];
+        _phase_totals[p] += _current.phases[p];
+        _phase_max[p] = std::max(_phase_max[p], _current.phases[p]);
+    }
+    _csv << "," << (total > accounted ? total - accounted : 0) << "\n";
+    _blocks++;
+    _transactions += _current.transactions;
+    _total_time += total;
+}
+
+void block_phase_profiler::flush()
+{
+    if (_csv.is_open())
+        _csv.flush();
+}
+
+string block_phase_profiler::summary() const
+{
+    std::ostringstream out;
+    out << std::fixed << std::setprecision(1);
+    out << "replayed " << _blocks << " blocks with " << _transactions << " transactions in "
+        << _total_time / 1000000.0 << " s\n\n";
+
+    out << std::left << std::setw(32) << "phase" << std::right << std::setw(14) << "total ms" << std::setw(8) << "%"
+        << std::setw(14) << "avg us/block" << std::setw(12) << "max us" << "\n";
+    uint64_t accounted = 0;
+    for (int p = 0; p < phase_count; p++)
+    {
+        accounted += _phase_totals[p];
+        out << std::left << std::setw(32) << phase_name(phase(p)) << std::right
+            << std::setw(14) << _phase_totals[p] / 1000.0
+            << std::setw(8) << (_total_time ? 100.0 * _phase_totals[p] / _total_time : 0.0)
+            << std::setw(14) << (_blocks ? double(_phase_totals[p]) / _blocks : 0.0)
+            << std::setw(12) << _phase_max[p] << "\n";
+    }
+    uint64_t other = _total_time > accounted ? _total_time - accounted : 0;
+    out << std::left << std::setw(32) << "other" << std::right << std::setw(14) << other / 1000.0
+        << std::setw(8) << (_total_time ? 100.0 * other / _total_time : 0.0)
+        << std::setw(14) << (_blocks ? double(other) / _blocks : 0.0) << "\n\n";
+
+    vector<std::pair<int, operation_phase_profile>> operations(_operations.begin(), _operations.end());
+    std::sort(operations.begin(), operations.end(), [](const auto &a, const auto &b) { return a.second.total_time > b.second.total_time; });
+    out << std::left << std::setw(40) << "operation" << std::right << std::setw(12) << "count" << std::setw(14) << "total ms"
+        << std::setw(12) << "avg us" << std::setw(12) << "max us" << "\n";
+    for (const auto &item : operations)
+    {
+        out << std::left << std::setw(40) << operation_type_name(item.first) << std::right
+            << std::setw(12) << item.second.count
+            << std::setw(14) << item.second.total_time / 1000.0
+            << std::setw(12) << double(item.second.total_time) / item.second.count
+            << std::setw(12) << item.second.max_time << "\n";
+    }
+    return out.str();
+}
+
+} // namespace chain
+} // namespace graphene
@@ -0,0 +1,61 @@
+#include <graphene/chain/contract_code_cache.hpp>
+#include <graphene/chain/contract_object.hpp>
+#include <fc/compress/zlib.hpp>
+
+namespace graphene
+{
+namespace chain
+{
+
+void contract_code_cache::store(contract_bin_code_object &obj, const fc::sha256 &hash, vector<char> &&code) const
+{
+    obj.code_hash = hash;
+    obj.code_size = code.size();
+    obj.compressed = false;
+    if (_compression_threshold != 0 && code.size() > _compression_threshold)
+    {
+        string deflated = fc::zlib_compress(string(code.begin(), code.end()));
+        if (deflated.size() < code.size())
+        {
+            obj.lua_code_b.assign(deflated.begin(), deflated.end());
+            obj.compressed = true;
+            return;
+        }
+    }
+    obj.lua_code_b = std::move(code);
+}
+
+const vector<char> &contract_code_cache::get(const contract_bin_code_object &obj)
+{
+    if (!obj.compressed)
+        return obj.lua_code_b;
+    auto itr = _entries.find(obj.code_hash);
+    if (itr != _entries.end())
+    {
+        _lru.splice(_lru.begin(), _lru, itr->second.lru);
+        return itr->second.code;
+    }
+
+    string inflated;
+    try
+    {
+        inflated = fc::zlib_decompress(string(obj.lua_code_b.begin(), obj.lua_code_b.end()));
+    }
+    FC_RETHROW_EXCEPTIONS(error, "corrupt contract code ${id}", ("id", obj.id))
+    FC_ASSERT(inflated.size() == obj.code_size, "corrupt contract code ${id}", ("id", obj.id)("size", inflated.size())("expected", obj.code_size));
+    _lru.push_front(obj.code_hash);
+    itr = _entries.emplace(obj.code_hash, entry{vector<char>(inflated.begin(), inflated.end()), _lru.begin()}).first;
+    _bytes += obj.code_size;
+    // the entry just inflated stays even if it alone exceeds the capacity
+    while (_bytes > _capacity && _lru.size() > 1)
+    {
+        auto oldest = _entries.find(_lru.back());
+        _bytes -= oldest->second.code.size();
+        _entries.erase(oldest);
+        _lru.pop_back();
+    }
+    return itr->second.code;
+}
+
+} // namespace chain
+} // namespace graphene
@@ -11,6 +11,34 @@ uint64_t contract_private_data_size = 3 * 1024;
 uint64_t contract_total_data_size = 10 * 1024 * 1024;
 uint64_t contract_max_data_size = 2 * 1024 * 1024 * 1024;
 
+namespace
+{
+// contracts with identical bytecode share one contract_bin_code_object
+const contract_bin_code_object &acquire_contract_code(database &d, contract_id_type contract, vector<char> &&code)
+{
+    auto hash = fc::sha256::hash(code.data(), code.size());
+    const auto &by_hash = d.get_index_type<contract_bin_code_index>().indices().get<by_code_hash>();
+    auto itr = by_hash.find(hash);
+    if (itr != by_hash.end())
+    {
+        d.modify(*itr, [](contract_bin_code_object &cbo) { cbo.ref_count++; });
+        return *itr;
+    }
+    return d.create<contract_bin_code_object>([&](contract_bin_code_object &cbo) {
+        cbo.contract_id = contract;
+        d.get_contract_code_cache().store(cbo, hash, std::move(code));
+    });
+}
+
+void release_contract_code(database &d, const contract_bin_code_object &code)
+{
+    if (code.ref_count > 1)
+        d.modify(code, [](contract_bin_code_object &cbo) { cbo.ref_count--; });
+    else
+        d.remove(code);
+}
+} // namespace
+
 void_result contract_create_evaluator::do_evaluate(const operation_type &o)
 {
     try
@@ -35,7 +63,9 @@ object_id_result contract_create_evaluator::do_apply(const operation_type &o)
         auto next_id = d.get_index_type<contract_index>().get_next_id();
         co.id=next_id;
         lua_table aco = co.do_contract(o.data,d.get_luaVM().mState);
-        auto code_bin_object= d.create<contract_bin_code_object>([&](contract_bin_code_object&cbo){cbo.contract_id=next_id;co.get_code(cbo.lua_code_b);});
+        vector<char> code;
+        co.get_code(code);
+        const auto &code_bin_object = acquire_contract_code(d, next_id, std::move(code));
         contract_object contract = d.create<contract_object>([&](contract_object &c) {
             c.owner = o.owner;
             c.name = o.name;
@@ -123,10 +153,13 @@ logger_result revise_contract_evaluator::do_apply(const operation_type &o)
         auto &old_contract = o.contract_id(_db);
         contract_object co = old_contract;
         lua_table aco = co.do_contract(o.data, _db.get_luaVM().mState);
-        auto &_old_code_bin_object=old_contract.lua_code_b_id(_db);
-        _db.modify(_old_code_bin_object,[&](contract_bin_code_object&cbo){co.get_code(cbo.lua_code_b);});
+        vector<char> code;
+        co.get_code(code);
+        const auto &code_bin_object = acquire_contract_code(_db, old_contract.id, std::move(code));
+        release_contract_code(_db, old_contract.lua_code_b_id(_db));
         string previous_version;
         _db.modify(old_contract, [&](contract_object &c) {
+            c.lua_code_b_id = code_bin_object.id;
             previous_version = fc::string(c.current_version);
             c.current_version = trx_state->_trx->hash();
             c.contract_ABI = aco.v;
@@ -306,7 +339,7 @@ contract_result call_contract_function_evaluator::do_apply_function(account_id_t
         //auto contract_itr = contract_core_index.find(contract_id);
         //FC_ASSERT(contract_itr != contract_core_index.end(), "The specified contract does not exist.contract_id:${contract_id}", ("contract_id", contract_id));
         contract_object contract = *contract_pir;
-        contract.set_code(contract_code_pir->lua_code_b);        
+        contract.set_code(_db.get_contract_code(*contract_code_pir));
         contract.set_mode(trx_state);
         contract.set_process_encryption_helper(process_encryption_helper(_db.get_chain_id().str(), string(CONTRACT_PROCESS_CIPHER), _db.head_block_time()));
         if (trx_state->run_mode == transaction_apply_mode::apply_block_mode && _contract_result->existed_pv)
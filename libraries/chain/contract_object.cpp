@@ -255,7 +255,7 @@ void contract_object::do_actual_contract_function(account_id_type caller, string
     {
         try
         {
-            auto &baseENV = contract_bin_code_id_type(0)(db);
+            auto &baseENV = contract_id_type()(db).lua_code_b_id(db);
             auto abi_itr = contract_ABI.find(lua_types(lua_string(function_name)));
             FC_ASSERT(abi_itr != contract_ABI.end(), "${function_name} maybe a internal function", ("function_name", function_name));
             if(!abi_itr->second.get<lua_function>().is_var_arg)
@@ -265,22 +265,28 @@ void contract_object::do_actual_contract_function(account_id_type caller, string
 
             contract_base_info cbi(*this, caller,contract_id);
 
+            if (db.is_luaVM_collapsed())
+                db.recover_luaVM();
+
             lua_scheduler &context = db.get_luaVM();
             register_scheduler scheduler(db, caller, *this, this->trx_state, result, context, sigkeys, apply_result, account_data);
-            context.new_sandbox(name, baseENV.lua_code_b.data(), baseENV.lua_code_b.size()); //sandbox
+            const auto &base_code = db.get_contract_code(baseENV);
+            context.new_sandbox(name, base_code.data(), base_code.size()); //sandbox
             context.load_script_to_sandbox(name, lua_code_b.data(), lua_code_b.size());
             context.writeVariable("current_contract", name);
             register_function(context, &scheduler, &cbi);
-            context.writeVariable(name, "_G", "protected");
-            context.writeVariable(name, "private_data", lua_scheduler::EmptyArray /*,account_data*/);
-            context.writeVariable(name, "public_data", lua_scheduler::EmptyArray /*,contract_data*/);
-            context.writeVariable(name, "read_list", "private_data", lua_scheduler::EmptyArray);
-            context.writeVariable(name, "read_list", "public_data", lua_scheduler::EmptyArray);
-            context.writeVariable(name, "write_list", "private_data", lua_scheduler::EmptyArray);
-            context.writeVariable(name, "write_list", "public_data", lua_scheduler::EmptyArray);
+            context.reset_sandbox_data(name);
+            contract_profiler::scoped_call profile(db.get_contract_profiler(), name, function_name);
             context.get_function(name, function_name);
             push_function_actual_parameters(context.mState, value_list);
-            int err = lua_pcall(context.mState, value_list.size(), 0, 0);
+            // the memory cap is local policy, it never applies while replaying blocks that already contain the call
+            size_t memory_cap = trx_state->run_mode == transaction_apply_mode::apply_block_mode ? 0 : db.get_contract_memory_cap();
+            int err;
+            {
+                lua_memory_pool::scoped_call memory_guard(db.get_lua_memory_pool(), memory_cap);
+                err = lua_pcall(context.mState, value_list.size(), 0, 0);
+            }
+            context.set_registry_pointer("chainhelper", nullptr);
             lua_types error_message;
             try
             {
@@ -292,7 +298,9 @@ void contract_object::do_actual_contract_function(account_id_type caller, string
                 error_message = lua_string(" Unexpected errors ");
             }
             lua_pop(context.mState, -1);
+            auto gc_start = fc::time_point::now();
             context.close_sandbox(name);
+            profile.record_gc(fc::time_point::now() - gc_start);
             if (err)
                 FC_THROW("Try the contract resolution execution failure,${message}", ("message", error_message));
             if (this->result.existed_pv)
@@ -305,7 +313,7 @@ void contract_object::do_actual_contract_function(account_id_type caller, string
         }
         catch (VMcollapseErrorException e)
         {
-            db.initialize_luaVM();
+            db.recover_luaVM();
             throw e;
         }
     }
@@ -398,7 +406,12 @@ void contract_object::compiling_contract(lua_State *bL, string lua_code, bool is
     Proto *f = getproto(bL->top - 1);
     lua_lock(bL);
     lua_code_b.clear();
-    luaU_dump(bL, f, compiling_contract_writer, &lua_code_b, 0);
+    // without the chunk name, contracts compiled from the same source get the same bytecode and can share it;
+    // they are always loaded under their own name, which puts it back
+    if (is_baseENV)
+        luaU_dump(bL, f, compiling_contract_writer, &lua_code_b, 0);
+    else
+        luaU_dump_unnamed(bL, f, compiling_contract_writer, &lua_code_b);
     lua_unlock(bL);
     if (!is_baseENV)
     {
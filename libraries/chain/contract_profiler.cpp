@@ -0,0 +1,151 @@
+#include <graphene/chain/contract_profiler.hpp>
+#include <fc/io/json.hpp>
+#include <fc/log/logger.hpp>
+
+namespace graphene
+{
+namespace chain
+{
+
+contract_profiler::scoped_call::scoped_call(contract_profiler &profiler, const string &contract_name, const string &function_name)
+    : profiler(profiler)
+{
+    if (!profiler.enabled())
+        return;
+    entry = &profiler._report.contracts[contract_name][function_name];
+    entry->calls++;
+    profiler._call_stack.push_back(entry);
+    binding_depth = profiler._binding_stack.size();
+    start = fc::time_point::now();
+}
+
+contract_profiler::scoped_call::~scoped_call()
+{
+    if (!entry)
+        return;
+    uint64_t elapsed = (fc::time_point::now() - start).count();
+    entry->total_time += elapsed;
+    entry->max_time = std::max(entry->max_time, elapsed);
+    if (!profiler._call_stack.empty())
+        profiler._call_stack.pop_back();
+    // a binding that raised a lua error never reports its return event
+    if (profiler._binding_stack.size() > binding_depth)
+        profiler._binding_stack.resize(binding_depth);
+}
+
+void contract_profiler::scoped_call::record_gc(const fc::microseconds &elapsed)
+{
+    if (entry)
+        entry->gc_time += elapsed.count();
+}
+
+void contract_profiler::enable(lua_State *L)
+{
+    if (_enabled)
+        return;
+    _enabled = true;
+    _report.since = fc::time_point::now();
+    attach(L);
+}
+
+void contract_profiler::attach(lua_State *L)
+{
+    if (!_enabled || L == nullptr)
+        return;
+    void *ud = nullptr;
+    auto current_alloc = lua_getallocf(L, &ud);
+    if (current_alloc != &contract_profiler::alloc)
+    {
+        _original_alloc = current_alloc;
+        _original_alloc_ud = ud;
+        lua_setallocf(L, &contract_profiler::alloc, this);
+    }
+    lua_sethook(L, &contract_profiler::hook, LUA_MASKCOUNT | LUA_MASKCALL | LUA_MASKRET, instruction_step);
+}
+
+void contract_profiler::disable(lua_State *L)
+{
+    if (!_enabled)
+        return;
+    _enabled = false;
+    if (L != nullptr)
+    {
+        lua_sethook(L, nullptr, 0, 0);
+        void *ud = nullptr;
+        if (lua_getallocf(L, &ud) == &contract_profiler::alloc)
+            lua_setallocf(L, _original_alloc, _original_alloc_ud);
+    }
+    _call_stack.clear();
+    _binding_stack.clear();
+}
+
+void contract_profiler::reset()
+{
+    _report = contract_profile_report();
+    _report.since = fc::time_point::now();
+    _call_stack.clear();
+    _binding_stack.clear();
+}
+
+void contract_profiler::on_applied_block(uint32_t block_num)
+{
+    if (!_enabled || _log_interval == 0 || block_num % _log_interval != 0)
+        return;
+    ilog("contract profile at block ${n}: ${report}", ("n", block_num)("report", fc::json::to_string(_report)));
+}
+
+void *contract_profiler::alloc(void *ud, void *ptr, size_t osize, size_t nsize)
+{
+    auto profiler = static_cast<contract_profiler *>(ud);
+    if (nsize > 0 && !profiler->_call_stack.empty())
+    {
+        // when ptr is null, osize encodes the object type rather than a size
+        size_t grown = ptr == nullptr ? nsize : (nsize > osize ? nsize - osize : 0);
+        profiler->_call_stack.back()->alloc_bytes += grown;
+    }
+    return profiler->_original_alloc(profiler->_original_alloc_ud, ptr, osize, nsize);
+}
+
+void contract_profiler::hook(lua_State *L, lua_Debug *ar)
+{
+    void *ud = nullptr;
+    if (lua_getallocf(L, &ud) != &contract_profiler::alloc)
+        return;
+    auto profiler = static_cast<contract_profiler *>(ud);
+    switch (ar->event)
+    {
+    case LUA_HOOKCOUNT:
+    {
+        if (!profiler->_call_stack.empty())
+            profiler->_call_stack.back()->instructions += instruction_step;
+        break;
+    }
+    case LUA_HOOKCALL:
+    {
+        lua_getinfo(L, "Sn", ar);
+        if (ar->what != nullptr && ar->what[0] == 'C')
+            profiler->_binding_stack.push_back({ar->name != nullptr ? string(ar->name) : string("?"), fc::time_point::now()});
+        break;
+    }
+    case LUA_HOOKRET:
+    {
+        lua_getinfo(L, "S", ar);
+        if (ar->what != nullptr && ar->what[0] == 'C' && !profiler->_binding_stack.empty())
+        {
+            auto &frame = profiler->_binding_stack.back();
+            uint64_t elapsed = (fc::time_point::now() - frame.start).count();
+            auto &binding = profiler->_report.bindings[frame.name];
+            binding.calls++;
+            binding.total_time += elapsed;
+            binding.max_time = std::max(binding.max_time, elapsed);
+            profiler->_binding_stack.pop_back();
+        }
+        break;
+    }
+    default:
+        break;
+    }
+}
+
+} // namespace chain
+} // namespace graphene
@@ -82,6 +82,36 @@ memo_data register_scheduler::make_memo(string receiver_id_or_name, string key,
     }
 }
 void register_scheduler::invoke_contract_function(string contract_id_or_name, string function_name, string value_list_json)
+{
+    do_invoke_contract_function(contract_id_or_name, function_name, [&value_list_json]() {
+        return fc::json::from_string(value_list_json).as<vector<lua_types>>();
+    });
+}
+
+void register_scheduler::invoke_contract_function_by_table(string contract_id_or_name, string function_name, lua_table value_list)
+{
+    try
+    {
+        // nodes before this binding existed fail the call on a nil method, so fail it the same way until the hardfork
+        FC_ASSERT(db.head_block_time() > CONTRACT_INVOKE_BY_TABLE_TIMEPOINT, "invoke_contract_function_by_table is not enabled before ${time}", ("time", CONTRACT_INVOKE_BY_TABLE_TIMEPOINT));
+        // the argument table is read straight off the lua stack as a sequence {arg1, arg2, ...}
+        vector<lua_types> values;
+        values.reserve(value_list.v.size());
+        for (int64_t index = 1; index <= int64_t(value_list.v.size()); index++)
+        {
+            auto itr = value_list.v.find(lua_types(lua_int(index)));
+            FC_ASSERT(itr != value_list.v.end(), "invoke_contract_function_by_table expects a sequence of arguments, missing index ${index}", ("index", index));
+            values.emplace_back(itr->second);
+        }
+        do_invoke_contract_function(contract_id_or_name, function_name, [&values]() { return std::move(values); });
+    }
+    catch (fc::exception e)
+    {
+        LUA_C_ERR_THROW(this->context.mState, e.to_string());
+    }
+}
+
+void register_scheduler::do_invoke_contract_function(string contract_id_or_name, string function_name, const std::function<vector<lua_types>()> &get_value_list)
 {
     auto &contract_obj = get_contract(contract_id_or_name);
     auto contract_id = contract_obj.id;
@@ -96,12 +126,20 @@ void register_scheduler::invoke_contract_function(string contract_id_or_name, st
         }
 
         FC_ASSERT(contract_id != this->contract.id, " You can't use it to make recursive calls. ");
-        auto value_list = fc::json::from_string(value_list_json).as<vector<lua_types>>();
+        auto value_list = get_value_list();
         call_contract_function_evaluator evaluator;
-        auto state = *trx_state;
-        state.sigkeys = sigkeys;
-        evaluator.trx_state = &state;
-        evaluator.evaluate_contract_authority(contract_id, state.sigkeys);
+        // since the hardfork the callee shares the caller's evaluation state unless the signing keys differ,
+        // before it every nested call ran on a private copy as it always did
+        optional<transaction_evaluation_state> state;
+        if (trx_state->sigkeys == sigkeys && db.head_block_time() > CONTRACT_INVOKE_BY_TABLE_TIMEPOINT)
+            evaluator.trx_state = trx_state;
+        else
+        {
+            state = *trx_state;
+            state->sigkeys = sigkeys;
+            evaluator.trx_state = &(*state);
+        }
+        evaluator.evaluate_contract_authority(contract_id, evaluator.trx_state->sigkeys);
         //optional<contract_result> _contract_result;
         contract_result _contract_result;
         if (trx_state->run_mode == transaction_apply_mode::apply_block_mode)
@@ -124,6 +162,7 @@ void register_scheduler::invoke_contract_function(string contract_id_or_name, st
         auto ocr = optional<contract_result>(_contract_result);
         auto ret = evaluator.apply(caller, this->contract.id,function_name, value_list, ocr, sigkeys);
         context.writeVariable("current_contract", current_contract_name);
+        context.set_registry_pointer("chainhelper", this);
         if (ret.existed_pv)
             result.existed_pv = true;
         result.contract_affecteds.push_back(ret);
@@ -135,6 +174,12 @@ void register_scheduler::invoke_contract_function(string contract_id_or_name, st
         LUA_C_ERR_THROW(this->context.mState, e.to_string());
     }
 }
+register_scheduler *register_scheduler::current(lua_State *L)
+{
+    auto chainhelper = static_cast<register_scheduler *>(lua_scheduler::get_registry_pointer(L, "chainhelper"));
+    FC_ASSERT(chainhelper, "chainhelper is not bound to the current contract call");
+    return chainhelper;
+}
 void register_scheduler::log(string message)
 {
     try
@@ -289,12 +334,10 @@ static int get_account_contract_data(lua_State *L)
 {
     try
     {
-        lua_scheduler context(L);
         FC_ASSERT(lua_isstring(L, -2) && lua_istable(L, -1));
         auto name_or_id = lua_scheduler::readTopAndPop<string>(L, -2);
         auto read_list = lua_scheduler::readTopAndPop<lua_table>(L, -1);
-        auto current_contract_name = context.readVariable<string>("current_contract");
-        auto chainhelper = context.readVariable<register_scheduler *>(current_contract_name, "chainhelper");
+        auto chainhelper = register_scheduler::current(L);
         auto &temp_account = chainhelper->get_account(name_or_id);
         auto &contract_udata_index = chainhelper->db.get_index_type<account_contract_data_index>().indices().get<by_account_contract>();
         auto old_account_contract_data_itr = contract_udata_index.find(boost::make_tuple(temp_account.get_id(), chainhelper->contract.get_id()));
@@ -335,14 +378,15 @@ static int import_contract(lua_State *L)
         FC_ASSERT(lua_isstring(L, -1));
         auto name_or_id = lua_scheduler::readTopAndPop<string>(L, -1);
         auto current_contract_name = context.readVariable<string>("current_contract");
-        auto chainhelper = context.readVariable<register_scheduler *>(current_contract_name, "chainhelper");
+        auto chainhelper = register_scheduler::current(L);
         //auto &temp_contract = chainhelper->get_contract(name_or_id);
         temp_contract = &chainhelper->get_contract(name_or_id);
         auto &temp_contract_code=temp_contract->lua_code_b_id(chainhelper->db);
         auto cbi=context.readVariable<contract_base_info *>(current_contract_name, "contract_base_info");
-        auto &baseENV = contract_bin_code_id_type(0)(chainhelper->db);
+        auto &baseENV = contract_id_type()(chainhelper->db).lua_code_b_id(chainhelper->db);
         //FC_ASSERT(lua_getglobal(context.mState, temp_contract->name.c_str())==LUA_TNIL);
-        context.new_sandbox(temp_contract->name,baseENV.lua_code_b.data(),baseENV.lua_code_b.size());
+        const auto &base_code = chainhelper->db.get_contract_code(baseENV);
+        context.new_sandbox(temp_contract->name,base_code.data(),base_code.size());
         temp_contract->register_function(context,chainhelper, cbi);
         FC_ASSERT(lua_getglobal(context.mState, current_contract_name.c_str()) == LUA_TTABLE);
         if (lua_getfield(context.mState, -1, temp_contract->name.c_str()) == LUA_TTABLE)
@@ -352,7 +396,8 @@ static int import_contract(lua_State *L)
         lua_setfield(context.mState, -2, temp_contract->name.c_str());
         lua_pushnil(context.mState);
         lua_setglobal(context.mState,temp_contract->name.c_str());
-        luaL_loadbuffer(context.mState, temp_contract_code.lua_code_b.data(), temp_contract_code.lua_code_b.size(), temp_contract->name.data()); //  lua加载脚本之后会返回一个函数(即此时栈顶的chunk块)，lua_pcall将默认调用此块
+        const auto &code = chainhelper->db.get_contract_code(temp_contract_code);
+        luaL_loadbuffer(context.mState, code.data(), code.size(), temp_contract->name.data()); //  lua加载脚本之后会返回一个函数(即此时栈顶的chunk块)，lua_pcall将默认调用此块
         lua_getglobal(context.mState, current_contract_name.c_str());
         lua_getfield(context.mState, -1, temp_contract->name.c_str()); //想要使用的_ENV备用空间
         lua_setupvalue(context.mState, -3, 1);                        //将栈顶变量赋值给栈顶第二个函数的第一个upvalue(当前第二个函数为load返回的函数，第一个upvalue为_ENV),注：upvalue:函数的外部引用变量
@@ -444,6 +489,7 @@ void lua_scheduler::chain_function_bind()
     registerFunction("set_permissions_flag", &register_scheduler::set_permissions_flag);
     registerFunction("set_invoke_share_percent", &register_scheduler::set_invoke_share_percent);
     registerFunction("invoke_contract_function", &register_scheduler::invoke_contract_function);
+    registerFunction("invoke_contract_function_by_table", &register_scheduler::invoke_contract_function_by_table);
     registerFunction("change_contract_authority", &register_scheduler::change_contract_authority);
     registerFunction("update_collateral_for_gas", &register_scheduler::update_collateral_for_gas);
     registerFunction("get_contract_public_data", &register_scheduler::get_contract_public_data);
@@ -558,8 +604,13 @@ void contract_object::register_function(lua_scheduler &context, register_schedul
     try
     {
         //context.writeVariable(name,"contract", this);
-        context.writeVariable(name, "chainhelper", fc_register);
-        context.writeVariable(name, "contract_base_info", base_info);
+        FC_ASSERT(lua_getglobal(context.mState, name.c_str()) == LUA_TTABLE);
+        lua_scheduler::Pusher<register_scheduler *>::push(context.mState, fc_register).release();
+        lua_setfield(context.mState, -2, "chainhelper");
+        lua_scheduler::Pusher<contract_base_info *>::push(context.mState, base_info).release();
+        lua_setfield(context.mState, -2, "contract_base_info");
+        lua_pop(context.mState, 1);
+        context.set_registry_pointer("chainhelper", fc_register);
     }
     FC_CAPTURE_AND_RETHROW()
 }
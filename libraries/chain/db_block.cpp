@@ -92,6 +92,27 @@ optional<signed_block> database::fetch_block_by_number(uint32_t num) const
   return optional<signed_block>();
 }
 
+optional<block_header_info> database::fetch_block_header_by_number(uint32_t num) const
+{
+  auto results = _fork_db.fetch_block_by_number(num);
+  if (results.size() != 1)
+    return _block_id_to_block.fetch_header_by_number(num);
+  block_header_info result;
+  result.header = results[0]->data;
+  result.id = results[0]->id;
+  result.transaction_count = results[0]->data.transactions.size();
+  result.block_size = results[0]->packed().size();
+  return result;
+}
+
+optional<vector<char>> database::fetch_packed_block_by_number(uint32_t num) const
+{
+  auto results = _fork_db.fetch_block_by_number(num);
+  if (results.size() == 1)
+    return results[0]->packed();
+  return _block_id_to_block.fetch_packed_by_number(num);
+}
+
 const signed_transaction &database::get_recent_transaction(const string &trx_id) const
 {
   //wdump((trx_id));
@@ -143,6 +164,11 @@ std::vector<block_id_type> database::get_block_ids_on_fork(block_id_type head_of
  * @return true if we switched forks as a result of this push.
  */
 bool database::push_block(const signed_block &new_block, uint32_t skip)
+{
+  return push_block(std::make_shared<const signed_block>(new_block), skip);
+}
+
+bool database::push_block(const signed_block_ptr &new_block, uint32_t skip)
 {
   bool result;
   detail::with_skip_flags(*this, skip, [&]() {
@@ -154,8 +180,9 @@ bool database::push_block(const signed_block &new_block, uint32_t skip)
   return result;
 }
 
-bool database::_push_block(const signed_block &new_block)
+bool database::_push_block(const signed_block_ptr &new_block_ptr)
 {
+  const signed_block &new_block = *new_block_ptr;
   try
   {
     FC_ASSERT(new_block.block_id == new_block.make_id());
@@ -165,10 +192,24 @@ bool database::_push_block(const signed_block &new_block)
       /// TODO: if the block is greater than the head block and before the next maitenance interval
       // verify that the block signer is in the current set of active witnesses.
 
-      shared_ptr<fork_item> new_head = _fork_db.push_block(new_block);
+      shared_ptr<fork_item> new_head = _fork_db.push_block(new_block_ptr);
       //If the head block from the longest chain does not build off of the current head, we need to switch forks.
       if (new_head->data.previous != head_block_id()) //  判定区块是否是自己所在网络生产的，如果不是则进入,不分叉不执行
       {
+        // new_block may have closed a gap in front of blocks the fork database was holding back,
+        // in which case the new head extends our chain and the linked blocks are applied in order
+        if (new_head->data.block_num() > head_block_num() + 1)
+        {
+          vector<item_ptr> linked;
+          for (auto item = new_head; item && item->num > head_block_num(); item = item->prev.lock())
+            linked.push_back(item);
+          if (!linked.empty() && linked.back()->data.previous == head_block_id())
+          {
+            _apply_linked_blocks(linked, new_block.block_id, skip);
+            return false;
+          }
+        }
+
         //If the newly pushed block is the same height as head, we get head back in new_head
         //Only switch forks if new_head is actually higher than head
         if (new_head->data.block_num() > head_block_num()) // 判定生产区块的链的长度是否大于自己所在网络，如果大于则说明自身所处网络为分叉网络
@@ -189,7 +230,7 @@ bool database::_push_block(const signed_block &new_block)
             {
               undo_database::session session = _undo_db.start_undo_session();
               apply_block((*ritr)->data, skip); // 应用区块
-              _block_id_to_block.store((*ritr)->id, (*ritr)->data);
+              _block_id_to_block.store((*ritr)->id, (*ritr)->packed());
               session.commit();
             }
             catch (const fc::exception &e)
@@ -216,7 +257,7 @@ bool database::_push_block(const signed_block &new_block)
               {
                 auto session = _undo_db.start_undo_session();
                 apply_block((*ritr)->data, skip);
-                _block_id_to_block.store(new_block.block_id, (*ritr)->data);
+                _block_id_to_block.store((*ritr)->id, (*ritr)->packed());
                 session.commit();
               }
               throw *except;
@@ -248,6 +289,44 @@ bool database::_push_block(const signed_block &new_block)
   FC_CAPTURE_AND_RETHROW((new_block))
 }
 
+/**
+ * Applies blocks that extend the head block, given newest first.  A failure of the block that was
+ * pushed is rethrown; a failure of one of the buffered blocks behind it only drops that block and
+ * its descendants from the fork database.
+ */
+void database::_apply_linked_blocks(const vector<item_ptr> &linked, const block_id_type &pushed_block_id, uint32_t skip)
+{
+  for (auto ritr = linked.rbegin(); ritr != linked.rend(); ++ritr)
+  {
+    optional<fc::exception> except;
+    try
+    {
+      auto session = _undo_db.start_undo_session();
+      apply_block((*ritr)->data, skip);
+      _block_id_to_block.store((*ritr)->id, (*ritr)->packed());
+      session.commit();
+    }
+    catch (const fc::exception &e)
+    {
+      except = e;
+    }
+    if (except)
+    {
+      const bool pushed_block_failed = (*ritr)->id == pushed_block_id;
+      _fork_db.set_head((*ritr)->prev.lock());
+      for (auto itr = ritr; itr != linked.rend(); ++itr)
+        _fork_db.remove((*itr)->id);
+      if (pushed_block_failed)
+      {
+        elog("Failed to push new block:\n${e}", ("e", except->to_detail_string()));
+        throw *except;
+      }
+      wlog("Dropping buffered block ${n} ${id}: ${e}", ("n", (*ritr)->num)("id", (*ritr)->id)("e", except->to_detail_string()));
+      return;
+    }
+  }
+}
+
 /**
  * Attempts to push the transaction into the pending queue
  *
@@ -257,20 +336,25 @@ bool database::_push_block(const signed_block &new_block)
  * queues full as well, it will be kept in the queue to be propagated later when a new block flushes out the pending
  * queues.
  */
-processed_transaction database::push_transaction(const signed_transaction &trx, uint32_t skip, transaction_push_state push_state)
+processed_transaction database::push_transaction(const signed_transaction &trx, uint32_t skip, transaction_push_state push_state,
+                                                 const prepared_transaction *prepared)
 {
   try
   {
     processed_transaction result;
     detail::with_skip_flags(*this, skip, [&]() {
-      result = _push_transaction(trx, push_state);
+      result = _push_transaction(trx, push_state, prepared);
     });
     return result;
   }
   FC_CAPTURE_AND_RETHROW((trx))
 }
-processed_transaction database::_push_transaction(const signed_transaction &trx, transaction_push_state push_state)
+processed_transaction database::_push_transaction(const signed_transaction &trx, transaction_push_state push_state, const prepared_transaction *prepared)
 {
+  // the prevalidated results are only good for the object they were worked out for
+  if (prepared && prepared->trx != &trx)
+    prepared = nullptr;
+
   // If this is the first transaction pushed after applying a block, start a new undo session.
   // This allows us to quickly rewind to the clean state of the head block, in case a new block arrives.
   if (!_pending_tx_session.valid())
@@ -299,6 +383,7 @@ processed_transaction database::_push_transaction(const signed_transaction &trx,
     else
     {
       mode = transaction_apply_mode::validate_transaction_mode;
+      _next_prepared_transaction = prepared;
       processed_trx = _apply_transaction(trx, mode, !deduce_in_verification_mode);
     }
   }
@@ -339,6 +424,8 @@ processed_transaction database::_push_transaction(const signed_transaction &trx,
          transaction.trx = processed_trx; });
   }
   temp_session.merge();
+  if (prepared)
+    _transaction_prevalidator.on_pushed(*prepared);
 
   // notify anyone listening to pending transactions
   on_pending_transaction(processed_trx);
@@ -611,9 +698,33 @@ void database::_apply_block(const signed_block &next_block)
     uint32_t next_block_num = next_block.block_num();
     uint32_t skip = get_node_properties().skip_flags;
     _applied_ops.clear();
-
-    FC_ASSERT((skip & skip_merkle_check) || next_block.transaction_merkle_root == next_block.calculate_merkle_root() /*checking_transactions_hash()*/, "",
-              ("next_block.transaction_merkle_root", next_block.transaction_merkle_root)("calc", next_block.calculate_merkle_root() /*checking_transactions_hash()*/)("next_block", next_block)("id", next_block.block_id));
+    // the prepared work points into next_block, drop it however this block ends
+    struct prepared_transactions_reset
+    {
+      database &db;
+      ~prepared_transactions_reset()
+      {
+        db._next_prepared_transaction = nullptr;
+        db._prepared_transactions.clear();
+      }
+    } reset_prepared_transactions{*this};
+    _block_profiler.begin_block(next_block_num, next_block.transactions.size());
+    auto timed = [&](block_phase_profiler::phase p, auto &&f) {
+      block_phase_profiler::scoped_phase timer(_block_profiler, p);
+      f();
+    };
+
+    timed(block_phase_profiler::prepare, [&]() { prepare_block_transactions(next_block, skip); });
+    auto prepared_merkle_root = [&]() {
+      vector<digest_type> ids(_prepared_transactions.size());
+      for (size_t i = 0; i < ids.size(); i++)
+        ids[i] = _prepared_transactions[i].merkle_digest;
+      return signed_block::calculate_merkle_root(std::move(ids));
+    };
+    timed(block_phase_profiler::merkle, [&]() {
+      FC_ASSERT((skip & skip_merkle_check) || next_block.transaction_merkle_root == prepared_merkle_root() /*checking_transactions_hash()*/, "",
+                ("next_block.transaction_merkle_root", next_block.transaction_merkle_root)("calc", next_block.calculate_merkle_root() /*checking_transactions_hash()*/)("next_block", next_block)("id", next_block.block_id));
+    });
     const witness_object &signing_witness = validate_block_header(skip, next_block);
     const auto &global_props = get_global_properties();
     const auto &dynamic_global_props = get<dynamic_global_property_object>(dynamic_global_property_id_type());
@@ -631,6 +742,7 @@ void database::_apply_block(const signed_block &next_block)
        * when building a block.
        */
       FC_ASSERT(trx.second.operation_results.size() > 0, "trx_hash:${trx_hash}", ("trx_hash", trx.second.hash()));
+      _next_prepared_transaction = &_prepared_transactions[_current_trx_in_block];
       apply_transaction(trx.second, skip | skip_authority_check, transaction_apply_mode::apply_block_mode); // 应用交易transaction , 在应用区块的时候，跳过tx签名再次核验
       ++_current_trx_in_block;
     }
@@ -639,16 +751,16 @@ void database::_apply_block(const signed_block &next_block)
     update_last_irreversible_block();
     // Are we at the maintenance interval?
     if (maint_needed)
-      perform_chain_maintenance(next_block, global_props);
+      timed(block_phase_profiler::maintenance, [&]() { perform_chain_maintenance(next_block, global_props); });
 
     create_block_summary(next_block);
-    clear_expired_transactions(); // hash数据表受保护，只能由database线程修改
-    clear_expired_nh_asset_orders();
-    clear_expired_proposals();
-    clear_expired_orders();
-    clear_expired_timed_task();
-    update_expired_feeds();
-    clear_expired_active();
+    timed(block_phase_profiler::clear_expired_transactions, [&]() { clear_expired_transactions(); }); // hash数据表受保护，只能由database线程修改
+    timed(block_phase_profiler::clear_expired_nh_asset_orders, [&]() { clear_expired_nh_asset_orders(); });
+    timed(block_phase_profiler::clear_expired_proposals, [&]() { clear_expired_proposals(); });
+    timed(block_phase_profiler::clear_expired_orders, [&]() { clear_expired_orders(); });
+    timed(block_phase_profiler::clear_expired_timed_task, [&]() { clear_expired_timed_task(); });
+    timed(block_phase_profiler::update_expired_feeds, [&]() { update_expired_feeds(); });
+    timed(block_phase_profiler::clear_expired_active, [&]() { clear_expired_active(); });
 
     // n.b., update_maintenance_flag() happens this late
     // because get_slot_time() / get_slot_at_time() is needed above
@@ -661,13 +773,76 @@ void database::_apply_block(const signed_block &next_block)
       apply_debug_updates();
 
     // notify observers that the block has been applied
-    applied_block(next_block); // applied_block信号通知
+    timed(block_phase_profiler::applied_block, [&]() { applied_block(next_block); }); // applied_block信号通知
     _applied_ops.clear();
-    notify_changed_objects(); // 消息通知对象改变
+    timed(block_phase_profiler::notify_changed_objects, [&]() { notify_changed_objects(); }); // 消息通知对象改变
+    _contract_profiler.on_applied_block(next_block_num);
+    _operation_stats.on_applied_block(next_block_num);
+
+    transaction_prevalidator::chain_snapshot snapshot;
+    snapshot.chain_id = get_chain_id();
+    snapshot.head_block_num = next_block_num;
+    snapshot.head_block_id = next_block.block_id;
+    snapshot.head_block_time = head_block_time();
+    snapshot.maximum_time_until_expiration = get_global_properties().parameters.maximum_time_until_expiration;
+    snapshot.maximum_transaction_size = max_transaction_size();
+    _transaction_prevalidator.on_applied_block(snapshot);
+    // only when whole slabs are free, fragmented slabs would make trim scan the pool every block for nothing
+    if (_lua_memory_pool->reclaimable_bytes() >= GRAPHENE_LUA_POOL_TRIM_THRESHOLD)
+      _lua_memory_pool->trim();
+    _block_profiler.end_block();
   }
   FC_CAPTURE_AND_RETHROW((next_block.block_num()))
 }
 
+uint32_t database::max_transaction_size() const
+{
+  int op_maxsize_proportion_percent = 1; //default
+
+  if (_options && _options->count("op_maxsize_proportion_percent"))
+  {
+    auto percent = _options->at("op_maxsize_proportion_percent").as<uint32_t>(); 
+
+    if(percent>=0 && percent<=100) //if percent out of range,just do nothing
+      op_maxsize_proportion_percent = percent;
+  }
+  return get_global_properties().parameters.maximum_block_size*op_maxsize_proportion_percent/GRAPHENE_FULL_PROPOTION;
+}
+
+void database::prepare_block_transactions(const signed_block &next_block, uint32_t skip)
+{
+  // packing, hashing and validate() only read the transaction itself, so they can run on the worker
+  // pool; anything that reads or writes chain state still happens in block order in _apply_transaction
+  const bool validate = !(skip & skip_validate);
+  const bool merkle = !(skip & skip_merkle_check);
+  _prepared_transactions.clear();
+  _prepared_transactions.resize(next_block.transactions.size());
+  _worker_pool.for_each(next_block.transactions.size(), [&](size_t i) {
+    const processed_transaction &trx = next_block.transactions[i].second;
+    prepared_transaction &prepared = _prepared_transactions[i];
+    prepared.trx = &trx;
+    if (merkle)
+      prepared.merkle_digest = trx.merkle_digest();
+    prepared.hash = trx.hash();
+    prepared.packed_size = fc::raw::pack_size(static_cast<const signed_transaction &>(trx));
+    if (!validate)
+      return;
+    try
+    {
+      trx.validate();
+      prepared.validated = true;
+    }
+    catch (const fc::exception &e)
+    {
+      prepared.validate_error = e.dynamic_copy_exception();
+    }
+    catch (...)
+    {
+      // left for _apply_transaction to validate again and report
+    }
+  }, GRAPHENE_MIN_TRANSACTIONS_PER_PREPARATION_TASK);
+}
+
 processed_transaction database::apply_transaction(const signed_transaction &trx, uint32_t skip, transaction_apply_mode run_mode)
 {
   processed_transaction result;
@@ -683,6 +858,11 @@ processed_transaction database::_apply_transaction(const signed_transaction &trx
   try
   { 
     uint32_t skip = get_node_properties().skip_flags;
+    // work done ahead of time by prepare_block_transactions, if this is the transaction it was prepared for
+    const prepared_transaction *prepared = _next_prepared_transaction;
+    _next_prepared_transaction = nullptr;
+    if (prepared && prepared->trx != &trx)
+      prepared = nullptr;
 
     auto share_flag = database::skip_transaction_signatures|database::skip_tapos_check;
     if((trx.operations[0].which() == operation::tag<contract_share_fee_operation>::value)&&(skip!=share_flag))
@@ -691,23 +871,19 @@ processed_transaction database::_apply_transaction(const signed_transaction &trx
     }
     auto &chain_parameters = get_global_properties().parameters;
 
-    int op_maxsize_proportion_percent = 1; //default
-
-    if (_options->count("op_maxsize_proportion_percent"))
+    uint32_t size = max_transaction_size();
+    FC_ASSERT((prepared ? prepared->packed_size : fc::raw::pack_size(trx)) < size);//交易尺寸验证，单笔交易最大尺寸不能超过区块最大尺寸的百分比
+    if (!(skip & skip_validate))                                                    /* issue #505 explains why this skip_flag is disabled */
     {
-      auto percent = _options->at("op_maxsize_proportion_percent").as<uint32_t>(); 
-
-      if(percent>=0 && percent<=100) //if percent out of range,just do nothing
-        op_maxsize_proportion_percent = percent;
+      if (prepared && prepared->validate_error)
+        prepared->validate_error->dynamic_rethrow_exception();
+      if (!(prepared && prepared->validated))
+        trx.validate();
     }
-    int size = chain_parameters.maximum_block_size*op_maxsize_proportion_percent/GRAPHENE_FULL_PROPOTION;
-    FC_ASSERT(fc::raw::pack_size(trx) < size);//交易尺寸验证，单笔交易最大尺寸不能超过区块最大尺寸的百分比
-    if (!(skip & skip_validate))                                                    /* issue #505 explains why this skip_flag is disabled */
-      trx.validate();
     auto &trx_idx = get_mutable_index_type<transaction_index>();
     const chain_id_type &chain_id = get_chain_id();
     fc::time_point_sec now = head_block_time();
-    auto trx_hash = trx.hash();
+    auto trx_hash = prepared ? prepared->hash : trx.hash();
     auto trx_id = trx.id(trx_hash);
     if(trx.operations[0].which() != operation::tag<contract_share_fee_operation>::value)
       FC_ASSERT((skip & skip_transaction_dupe_check) || trx_idx.indices().get<by_trx_id>().find(trx_id) == trx_idx.indices().get<by_trx_id>().end());
@@ -751,16 +927,17 @@ processed_transaction database::_apply_transaction(const signed_transaction &trx
       }
       else
       {
-        authority active;
-        auto get_active = [&](account_id_type id) -> const authority * { 
-                  active=id(*this).active;
-                  /*************************nico 添加临时授权验证******************/
-                  flat_map<public_key_type,weight_type>  temporary;
-                  auto &index = this->get_index_type<temporary_active_index>().indices().get<by_account_id_type>(); 
-                  auto itr = index.find(id);if(itr!=index.end())temporary=itr->temporary_active;
-                  for(auto itr=temporary.begin();itr!=temporary.end();itr++)active.key_auths.insert(*itr);return &active; };
-        auto get_owner = [&](account_id_type id) -> const authority * { return &id(*this).owner; };
-        trx.verify_authority(chain_id, get_active, get_owner, eval_state.sigkeys, get_global_properties().parameters.max_authority_depth);
+        // 临时授权已合并在缓存的active权限中
+        auto get_active = [&](account_id_type id) { return _authority_cache.get_active(id); };
+        auto get_owner = [&](account_id_type id) { return _authority_cache.get_owner(id); };
+        if (prepared && prepared->signature_keys)
+        {
+          // the keys were already recovered from these signatures off the main thread
+          eval_state.sigkeys = *prepared->signature_keys;
+          graphene::chain::verify_authority(trx.operations, eval_state.sigkeys, get_active, get_owner, get_global_properties().parameters.max_authority_depth);
+        }
+        else
+          trx.verify_authority(chain_id, get_active, get_owner, eval_state.sigkeys, get_global_properties().parameters.max_authority_depth);
         // 应用_apply_transaction 验证交易权限
       }
     }
@@ -924,6 +1101,8 @@ operation_result database::apply_operation(transaction_evaluation_state &eval_st
     bool _undo_db_state = _undo_db.enabled();
     _undo_db.enable();
     fc::microseconds start = fc::time_point::now().time_since_epoch();
+    bool failed = false;
+    uint64_t undo_objects = 0;
     {
       auto op_session = _undo_db.start_undo_session();
       try
@@ -937,10 +1116,12 @@ operation_result database::apply_operation(transaction_evaluation_state &eval_st
         unique_ptr<op_evaluator> &eval = _operation_evaluators[u_which]; //  选择对应验证合约的状态机
         if (!eval)
           assert("No registered evaluator for this operation" && false);
+        block_phase_profiler::scoped_operation timer(_block_profiler, op);
         result = eval->evaluate(eval_state, op, true);
       }
       catch (fc::exception &e)
       {
+        failed = true;
         if (is_agreed_task)
         {
           auto error_re = error_result(e.code(), e.to_string());
@@ -949,12 +1130,22 @@ operation_result database::apply_operation(transaction_evaluation_state &eval_st
           op_session.undo();
         }
         else
+        {
+          _operation_stats.record(op, fc::time_point::now().time_since_epoch().count() - start.count(), true, 0);
           throw e;
+        }
+      }
+      if (!failed)
+      {
+        // the session holds nothing but what this operation changed
+        const auto &changes = _undo_db.head();
+        undo_objects = changes.old_values.size() + changes.new_ids.size() + changes.removed.size();
       }
       auto op_id = push_applied_operation(op);
       set_applied_operation_result(op_id, result);
       op_session.merge();
     }
+    _operation_stats.record(op, fc::time_point::now().time_since_epoch().count() - start.count(), failed, undo_objects);
     _undo_db_state ? _undo_db.enable() : _undo_db.disable();
     return result;
   }
@@ -231,7 +231,8 @@ void database::initialize_indexes()
 #ifdef INCREASE_CONTRACT
     add_index<primary_index<contract_index>>();              // 合约对象数据表
     add_index<primary_index<account_contract_data_index>>(); // 用户合约数据表
-    add_index<primary_index<temporary_active_index>>();      // 用户临时权限表
+    auto temporary_active_idx = add_index<primary_index<temporary_active_index>>(); // 用户临时权限表
+    _authority_cache.observe(*acnt_index, *temporary_active_idx);
     add_index<primary_index<transaction_in_block_index>>();  // 交易事物应用表：存储交易事物的区块高度与交易事物在块中的数字索引
     add_index<primary_index<nh_asset_creator_index>>();
     add_index<primary_index<world_view_index>>();
@@ -245,7 +246,8 @@ void database::initialize_indexes()
 #endif
     //Implementation object indexes
     add_index<primary_index<transaction_index>>();
-    add_index<primary_index<account_balance_index>>();
+    auto bal_index = add_index<primary_index<account_balance_index>>();
+    bal_index->add_secondary_index<asset_holder_index>();
     add_index<primary_index<asset_bitasset_data_index>>();
     add_index<primary_index<simple_index<global_property_object>>>();
     add_index<primary_index<simple_index<dynamic_global_property_object>>>();
@@ -693,15 +695,72 @@ void database::initialize_baseENV()
     if (lua_isnil(luaVM.mState, -1))
     {
             lua_pop(luaVM.mState, 1);
-            luaL_loadbuffer(luaVM.mState, contract_base_code.lua_code_b.data(), contract_base_code.lua_code_b.size(), contract_base.name.data());
+            const auto &code = get_contract_code(contract_base_code);
+            luaL_loadbuffer(luaVM.mState, code.data(), code.size(), contract_base.name.data());
             lua_setglobal(luaVM.mState, "baseENV");
     }
 }
 
 void database::initialize_luaVM()
 {
-    luaVM = graphene::chain::lua_scheduler(true);
+    luaVM = graphene::chain::lua_scheduler(true, &lua_memory_pool::alloc, _lua_memory_pool.get());
     initialize_baseENV();
+    _contract_profiler.attach(luaVM.mState);
+    _luaVM_collapsed = false;
+    prepare_standby_luaVM();
+}
+
+void database::set_contract_standby_vm(bool enable)
+{
+    _contract_standby_vm = enable;
+    if (!enable)
+        _lua_vm_standby.clear();
+}
+
+void database::prepare_standby_luaVM()
+{
+    if (!_contract_standby_vm)
+        return;
+    auto &contract_base = contract_id_type()(*this);
+    _lua_vm_standby.prepare(get_contract_code(contract_base.lua_code_b_id(*this)), contract_base.name);
+}
+
+void database::recover_luaVM()
+{
+    _luaVM_collapsed = true;
+    // an outer contract call is still running on the collapsed state, the next call recovers it
+    if (_lua_memory_pool->in_call())
+        return;
+    // a standby VM still being built is kept for the next collapse, this one rebuilds synchronously
+    auto standby = _lua_vm_standby.take();
+    if (!standby)
+    {
+        initialize_luaVM();
+        return;
+    }
+    // the collapsed state is closed on the standby thread, it must free through its own pool without the profiler hooks
+    lua_sethook(luaVM.mState, nullptr, 0, 0);
+    lua_setallocf(luaVM.mState, &lua_memory_pool::alloc, _lua_memory_pool.get());
+    luaVM = std::move(*standby->vm);
+    std::swap(_lua_memory_pool, standby->pool);
+    if (standby->base_code != get_contract_code(contract_id_type()(*this).lua_code_b_id(*this)))
+    {
+        lua_pushnil(luaVM.mState);
+        lua_setglobal(luaVM.mState, "baseENV");
+        initialize_baseENV();
+    }
+    _lua_vm_standby.retire(std::move(standby));
+    _contract_profiler.attach(luaVM.mState);
+    _luaVM_collapsed = false;
+    prepare_standby_luaVM();
+}
+
+void database::enable_contract_profiling(bool enable)
+{
+    if (enable)
+        _contract_profiler.enable(luaVM.mState);
+    else
+        _contract_profiler.disable(luaVM.mState);
 }
 
 void database::init_global_property_extensions()
@@ -75,7 +75,9 @@ void database::reindex(fc::path data_dir)
 
         ilog("reindexing blockchain");
         auto start = fc::time_point::now();
-        const auto last_block_num = last_block->block_num();
+        auto last_block_num = last_block->block_num();
+        if (_block_profiler.enabled())
+            last_block_num = std::min(last_block_num, _block_profiler.last_block());
         uint32_t undo_point = last_block_num < 50 ? 0 : last_block_num - 50;
 
         ilog("Replaying blocks, starting at ${next}...", ("next", head_block_num() + 1));
@@ -133,7 +135,7 @@ void database::reindex(fc::path data_dir)
             else
             {
                 _undo_db.enable();
-                push_block(*block, skip_witness_signature |
+                push_block(std::make_shared<const signed_block>(std::move(*block)), skip_witness_signature |
                                        skip_transaction_signatures |
                                        skip_transaction_dupe_check |
                                        skip_tapos_check |
@@ -177,6 +179,8 @@ void database::reindex(fc::path data_dir,int roll_back_at_height)
                 _block_id_to_block.remove(*last_id);
             }
         }
+        if (_block_profiler.enabled())
+            last_block_num = std::min(last_block_num, _block_profiler.last_block());
 
         uint32_t undo_point = last_block_num < 50 ? 0 : last_block_num - 50;
 
@@ -235,7 +239,7 @@ void database::reindex(fc::path data_dir,int roll_back_at_height)
             else
             {
                 _undo_db.enable();
-                push_block(*block, skip_witness_signature |
+                push_block(std::make_shared<const signed_block>(std::move(*block)), skip_witness_signature |
                                        skip_transaction_signatures |
                                        skip_transaction_dupe_check |
                                        skip_tapos_check |
@@ -34,6 +34,8 @@ void fork_database::reset()
 {
    _head.reset();
    _index.clear();
+   _unlinked_index.clear();
+   _unlinked_bytes = 0;
 }
 
 void fork_database::pop_block()
@@ -44,7 +46,19 @@ void fork_database::pop_block()
     _head = prev;
 }
 
+const vector<char>& fork_item::packed()const
+{
+   if( !_packed )
+      _packed = fc::raw::pack( data );
+   return *_packed;
+}
+
 void     fork_database::start_block(signed_block b)
+{
+   start_block( std::make_shared<const signed_block>(std::move(b)) );
+}
+
+void     fork_database::start_block(signed_block_ptr b)
 {
    auto item = std::make_shared<fork_item>(std::move(b));
    _index.insert(item);
@@ -56,21 +70,82 @@ void     fork_database::start_block(signed_block b)
  *
  */
 shared_ptr<fork_item>  fork_database::push_block(const signed_block& b)
+{
+   return push_block( std::make_shared<const signed_block>(b) );
+}
+
+shared_ptr<fork_item>  fork_database::push_block(const signed_block_ptr& b)
 {
    auto item = std::make_shared<fork_item>(b);
    try {
       _push_block(item);
+      _push_next(item);
    }
    catch ( const unlinkable_block_exception& e )
    {
-      wlog( "Pushing block to fork database that failed to link: ${id}, ${num}", ("id",b.block_id)("num",b.block_num()) );
+      if( _buffer_unlinked( item ) )
+      {
+         dlog( "Buffering block ${num} (${id}) until its parent arrives, ${n} blocks waiting",
+               ("id",b->block_id)("num",b->block_num())("n",_unlinked_index.size()) );
+         FC_THROW_EXCEPTION( unlinkable_block_buffered_exception, "block ${num} (${id}) is kept until its parent arrives",
+                             ("id",b->block_id)("num",b->block_num()) );
+      }
+      wlog( "Pushing block to fork database that failed to link: ${id}, ${num}", ("id",b->block_id)("num",b->block_num()) );
       wlog( "Head: ${num}, ${id}", ("num",_head->data.block_num())("id",_head->data.block_id) );
       throw;
-      _unlinked_index.insert( item );
    }
    return _head;
 }
 
+/**
+ * Keeps a block that does not link yet, as long as it is ahead of the head by no more than
+ * MAX_BLOCK_REORDERING and fits into the memory budget.  When the budget is exhausted the
+ * blocks that have waited longest make room: blocks that only passed these cheap checks may
+ * never link, and refusing new blocks instead would let them turn buffering off for good.
+ * An evicted block is no longer a known block, so the node fetches it again once a peer
+ * offers it or sync resumes from our head.
+ */
+bool fork_database::_buffer_unlinked(const item_ptr& item)
+{
+   if( !_head || item->num <= _head->num || item->num > _head->num + MAX_BLOCK_REORDERING )
+      return false;
+   if( _unlinked_index.get<block_id>().count( item->id ) )
+      return true;
+
+   const size_t size = fc::raw::pack_size( item->data );
+   if( size > _max_unlinked_bytes )
+      return false;
+   _shrink_unlinked( _max_unlinked_bytes - size );
+
+   _unlinked_index.insert( item );
+   _unlinked_bytes += size;
+   return true;
+}
+
+void fork_database::_shrink_unlinked(size_t max_bytes)
+{
+   auto& arrival_idx = _unlinked_index.get<by_arrival>();
+   while( _unlinked_bytes > max_bytes && !arrival_idx.empty() )
+   {
+      const item_ptr& oldest = arrival_idx.front();
+      dlog( "Dropping buffered block ${num} (${id}) to make room", ("num",oldest->num)("id",oldest->id) );
+      _erase_unlinked( _unlinked_index.project<block_num>( arrival_idx.begin() ) );
+   }
+}
+
+void fork_database::_erase_unlinked(unlinked_num_iterator itr)
+{
+   _unlinked_bytes -= fc::raw::pack_size( (*itr)->data );
+   _unlinked_index.get<block_num>().erase( itr );
+}
+
+void fork_database::_prune_unlinked(uint32_t min_num)
+{
+   auto& num_idx = _unlinked_index.get<block_num>();
+   while( !num_idx.empty() && (*num_idx.begin())->num < min_num )
+      _erase_unlinked( num_idx.begin() );
+}
+
 void  fork_database::_push_block(const item_ptr& item)
 {
    if( _head ) // make sure the block is within the range that we are caching
@@ -98,30 +173,46 @@ void  fork_database::_push_block(const item_ptr& item)
       auto& num_idx = _index.get<block_num>();
       while( num_idx.size() && (*num_idx.begin())->num < min_num )
          num_idx.erase( num_idx.begin() );
-      
-      _unlinked_index.get<block_num>().erase(_head->num - _max_size);// _unlinked_index 意图用于存放未被正常链接的区块，但未启用
+
+      _prune_unlinked( min_num );
    }
-   //_push_next( item );
 }
 
 /**
  *  Iterate through the unlinked cache and insert anything that
- *  links to the newly inserted item.  This will start a recursive
- *  set of calls performing a depth-first insertion of pending blocks as
- *  _push_next(..) calls _push_block(...) which will in turn call _push_next
+ *  links to the newly inserted item.  Every block linked this way
+ *  may in turn be the parent of other buffered blocks, so this
+ *  performs a depth-first insertion of pending blocks.  It keeps an
+ *  explicit stack rather than recursing, a closed gap can release up
+ *  to MAX_BLOCK_REORDERING blocks at once.
  */
 void fork_database::_push_next( const item_ptr& new_item )
 {
     auto& prev_idx = _unlinked_index.get<by_previous>();
 
-    auto itr = prev_idx.find( new_item->id );
-    while( itr != prev_idx.end() )
+    vector<item_ptr> linked{ new_item };
+    while( !linked.empty() )
     {
-       auto tmp = *itr;
-       prev_idx.erase( itr );
-       _push_block( tmp );
+       auto parent = linked.back();
+       linked.pop_back();
+
+       auto itr = prev_idx.find( parent->id );
+       while( itr != prev_idx.end() )
+       {
+          auto tmp = *itr;
+          _erase_unlinked( _unlinked_index.project<block_num>( itr ) );
+          try
+          {
+             _push_block( tmp );
+             linked.push_back( tmp );
+          }
+          catch( const fc::exception& e )
+          {
+             wlog( "Dropping buffered block ${num} (${id}): ${e}", ("num",tmp->num)("id",tmp->id)("e",e.to_string()) );
+          }
 
-       itr = prev_idx.find( new_item->id );
+          itr = prev_idx.find( parent->id );
+       }
     }
 }
 
@@ -142,18 +233,13 @@ void fork_database::set_max_size( uint32_t s )
          itr = by_num_idx.begin();
       }
    }
-   { /// unlinked_index
-      auto& by_num_idx = _unlinked_index.get<block_num>();
-      auto itr = by_num_idx.begin();
-      while( itr != by_num_idx.end() )
-      {
-         if( (*itr)->num < std::max(int64_t(0),int64_t(_head->num) - _max_size) )
-            by_num_idx.erase(itr);
-         else
-            break;
-         itr = by_num_idx.begin();
-      }
-   }
+   _prune_unlinked( std::max(int64_t(0),int64_t(_head->num) - _max_size) );
+}
+
+void fork_database::set_max_unlinked_bytes( size_t s )
+{
+   _max_unlinked_bytes = s;
+   _shrink_unlinked( _max_unlinked_bytes );
 }
 
 bool fork_database::is_known_block(const block_id_type& id)const
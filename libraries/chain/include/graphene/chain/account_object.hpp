@@ -25,6 +25,7 @@
 #include <graphene/chain/protocol/operations.hpp>
 #include <graphene/db/generic_index.hpp>
 #include <boost/multi_index/composite_key.hpp>
+#include <boost/multi_index/ranked_index.hpp>
 
 namespace graphene
 {
@@ -289,6 +290,52 @@ typedef multi_index_container<
     */
 typedef generic_index<account_balance_object, account_balance_object_multi_index_type> account_balance_index;
 
+/**
+    *  @brief This secondary index ranks the non-zero balances of each asset by amount, so holders can be
+    *  counted and paged through in O(log n) instead of walking every balance object of the asset.
+    */
+class asset_holder_index : public secondary_index
+{
+ public:
+   struct holder
+   {
+      asset_id_type asset_type;
+      share_type balance;
+      account_id_type owner;
+   };
+
+   virtual void object_inserted(const object &obj) override;
+   virtual void object_removed(const object &obj) override;
+   virtual void about_to_modify(const object &before) override;
+   virtual void object_modified(const object &after) override;
+
+   /** number of accounts holding a non-zero balance of the asset */
+   uint32_t holder_count(asset_id_type asset) const;
+   /** holders from the start-th largest balance on, largest first */
+   vector<holder> get_holders(asset_id_type asset, uint32_t start, uint32_t limit) const;
+
+ private:
+   typedef multi_index_container<
+       holder,
+       indexed_by<
+           ranked_unique<
+               composite_key<
+                   holder,
+                   member<holder, asset_id_type, &holder::asset_type>,
+                   member<holder, share_type, &holder::balance>,
+                   member<holder, account_id_type, &holder::owner>>,
+               composite_key_compare<
+                   std::less<asset_id_type>,
+                   std::greater<share_type>,
+                   std::less<account_id_type>>>>>
+       holder_set;
+
+   void insert(const account_balance_object &b);
+   void remove(const account_balance_object &b);
+
+   holder_set holders;
+};
+
 struct by_name
 {
 };
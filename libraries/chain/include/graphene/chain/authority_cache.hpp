@@ -0,0 +1,39 @@
+#pragma once
+#include <graphene/chain/protocol/authority.hpp>
+#include <graphene/db/index.hpp>
+#include <map>
+
+namespace graphene
+{
+namespace chain
+{
+
+class database;
+
+/**
+ * Active authorities as verify_authority sees them, with the account's temporary keys merged in.
+ *
+ * Entries are built on first use and dropped by index observers whenever the account or its
+ * temporary_active_object is added, modified or removed, including by undo. Pointers handed out stay
+ * valid until the entry is dropped, which never happens while a transaction's authority is checked.
+ */
+class authority_cache
+{
+  public:
+    explicit authority_cache(const database &db) : _db(db) {}
+
+    const authority *get_active(account_id_type id);
+    const authority *get_owner(account_id_type id) const;
+
+    /// start over and follow the given indexes; called whenever the indexes are (re)created
+    void observe(graphene::db::index &accounts, graphene::db::index &temporary_actives);
+    void invalidate(account_id_type id) { _active.erase(id); }
+    size_t size() const { return _active.size(); }
+
+  private:
+    const database &_db;
+    std::map<account_id_type, authority> _active;
+};
+
+} // namespace chain
+} // namespace graphene
@@ -27,6 +27,16 @@
 
 namespace graphene { namespace chain {
    class index_entry;
+   class header_entry;
+
+   /// what explorers and light clients need about a block, read without decoding its transactions
+   struct block_header_info
+   {
+      signed_block_header header;
+      block_id_type       id;
+      uint32_t            transaction_count = 0;
+      uint32_t            block_size = 0; ///< packed size of the whole block in bytes
+   };
 
    class block_database 
    {
@@ -37,18 +47,28 @@ namespace graphene { namespace chain {
          void close();
 
          void store( const block_id_type& id, const signed_block& b );
+         /// store a block that is already packed, @p packed must be fc::raw::pack of the block with @p id
+         void store( const block_id_type& id, const vector<char>& packed );
          void remove( const block_id_type& id );
 
          bool                   contains( const block_id_type& id )const;
          block_id_type          fetch_block_id( uint32_t block_num )const;
          optional<signed_block> fetch_optional( const block_id_type& id )const;
          optional<signed_block> fetch_by_number( uint32_t block_num )const;
+         /// the block as it is stored, fc::raw::pack of the signed_block, without decoding it
+         optional<vector<char>> fetch_packed_by_number( uint32_t block_num )const;
+         optional<block_header_info> fetch_header_by_number( uint32_t block_num )const;
          optional<signed_block> last()const;
          optional<block_id_type> last_id()const;
       private:
          optional<index_entry> last_index_entry()const;
+         void store_header( uint32_t block_num, const header_entry& h )const;
          fc::path _index_filename;
          mutable std::fstream _blocks;
          mutable std::fstream _block_num_to_pos;
+         /// fixed size header records, one per block number like the index
+         mutable std::fstream _block_num_to_header;
    };
 } }
+
+FC_REFLECT( graphene::chain::block_header_info, (header)(id)(transaction_count)(block_size) )
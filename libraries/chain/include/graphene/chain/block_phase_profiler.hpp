@@ -0,0 +1,119 @@
+#pragma once
+#include <graphene/chain/protocol/operations.hpp>
+#include <fc/filesystem.hpp>
+#include <fc/time.hpp>
+
+#include <fstream>
+
+namespace graphene
+{
+namespace chain
+{
+
+struct operation_phase_profile
+{
+    uint64_t count = 0;
+    uint64_t total_time = 0; // microseconds, including nested operations
+    uint64_t max_time = 0;   // microseconds
+};
+
+/**
+ * Per block phase timing for replay benchmarks.
+ *
+ * Once enabled, every block applied within [first_block, last_block] gets one CSV row with the
+ * microseconds spent in each phase of _apply_block, and the evaluators are timed by operation type.
+ * Operations that run inside another operation (proposals, crontabs, contracts) count towards their
+ * own type but only the outermost one counts towards the block's evaluate or contract phase.
+ */
+class block_phase_profiler
+{
+  public:
+    enum phase
+    {
+        prepare,                 // hashing and validate() of the transactions on the worker pool
+        merkle,
+        evaluate,                // evaluators of everything but contract calls
+        contract,                // call_contract_function evaluators
+        maintenance,
+        clear_expired_transactions,
+        clear_expired_nh_asset_orders,
+        clear_expired_proposals,
+        clear_expired_orders,
+        clear_expired_timed_task,
+        update_expired_feeds,
+        clear_expired_active,
+        applied_block,           // plugin handlers of the applied_block signal
+        notify_changed_objects,
+        phase_count
+    };
+    static const char *phase_name(phase p);
+
+    class scoped_phase
+    {
+      public:
+        scoped_phase(block_phase_profiler &profiler, phase p);
+        ~scoped_phase();
+
+      private:
+        block_phase_profiler &profiler;
+        phase p;
+        bool recording;
+        fc::time_point start;
+    };
+
+    class scoped_operation
+    {
+      public:
+        scoped_operation(block_phase_profiler &profiler, const operation &op);
+        ~scoped_operation();
+
+      private:
+        block_phase_profiler &profiler;
+        const operation &op;
+        bool recording;
+        fc::time_point start;
+    };
+
+    /// start writing one row per block in range to csv_file
+    void enable(const fc::path &csv_file, uint32_t first_block, uint32_t last_block);
+    bool enabled() const { return _enabled; }
+    uint32_t last_block() const { return _last_block; }
+
+    void begin_block(uint32_t block_num, uint32_t transactions);
+    void end_block();
+    void flush();
+
+    /// totals per phase and per operation type as a text table
+    string summary() const;
+
+  private:
+    struct block_record
+    {
+        uint32_t block_num = 0;
+        uint32_t transactions = 0;
+        uint32_t operations = 0;
+        fc::time_point start;
+        uint64_t phases[phase_count] = {};
+    };
+
+    bool _enabled = false;
+    bool _recording = false;
+    uint32_t _first_block = 0;
+    uint32_t _last_block = 0;
+    uint32_t _operation_depth = 0;
+    std::ofstream _csv;
+    block_record _current;
+
+    uint64_t _blocks = 0;
+    uint64_t _transactions = 0;
+    uint64_t _total_time = 0;
+    uint64_t _phase_totals[phase_count] = {};
+    uint64_t _phase_max[phase_count] = {};
+    // operation tag -> statistics
+    map<int, operation_phase_profile> _operations;
+};
+
+} // namespace chain
+} // namespace graphene
+
+FC_REFLECT(graphene::chain::operation_phase_profile, (count)(total_time)(max_time))
@@ -53,6 +53,7 @@
 
 #define GRAPHENE_MIN_UNDO_HISTORY 10
 #define GRAPHENE_MAX_UNDO_HISTORY 10000
+#define GRAPHENE_DEFAULT_MAX_UNLINKED_BLOCK_BYTES (64*1024*1024) ///< memory the fork database may spend on blocks that arrived before their parent
 
 #define GRAPHENE_MIN_BLOCK_SIZE_LIMIT (GRAPHENE_MIN_TRANSACTION_SIZE_LIMIT*5) // 5 transactions per block
 #define GRAPHENE_MIN_TRANSACTION_EXPIRATION_LIMIT (GRAPHENE_MAX_BLOCK_INTERVAL * 5) // 5 transactions per block
@@ -151,10 +152,21 @@
 #define GRAPHENE_RECENTLY_MISSED_COUNT_INCREMENT             4
 #define GRAPHENE_RECENTLY_MISSED_COUNT_DECREMENT             3
 
-#define GRAPHENE_CURRENT_DB_VERSION                          "COCOS2.30"
+#define GRAPHENE_CURRENT_DB_VERSION                          "COCOS2.31"
 
 #define GRAPHENE_IRREVERSIBLE_THRESHOLD                      (70 * GRAPHENE_1_PERCENT)//石墨烯不可逆转区块阀值，默认为:7 ,最大为10
 
+/// release idle contract VM pool slabs once the slabs without a live block add up to this many bytes
+#define GRAPHENE_LUA_POOL_TRIM_THRESHOLD                     (16 * 1024 * 1024)
+
+#define GRAPHENE_DEFAULT_BLOCK_PREPARATION_THREADS           2
+/// blocks with fewer transactions than this per thread are prepared on fewer threads
+#define GRAPHENE_MIN_TRANSACTIONS_PER_PREPARATION_TASK       16
+/// transactions from the network remembered for duplicate checks and prepared results until they expire
+#define GRAPHENE_MAX_PREVALIDATED_TRANSACTIONS               100000
+/// public keys whose address forms are remembered for address authorities before the cache starts over
+#define GRAPHENE_MAX_CACHED_KEY_ADDRESSES                    100000
+
 /**
  *  Reserved Account IDs with special meaning
  */
@@ -0,0 +1,53 @@
+#pragma once
+#include <graphene/chain/protocol/types.hpp>
+
+#include <list>
+#include <map>
+
+namespace graphene
+{
+namespace chain
+{
+
+/**
+ * Storage side of contract bytecode: whether new code is compressed, and the inflated copies of
+ * compressed code.
+ *
+ * Compressed code is inflated the first time a contract running it is called and kept, least
+ * recently used first out, until the cache holds more than its capacity. Entries are keyed by the
+ * hash of the uncompressed code, so they never go stale and undo does not have to touch them.
+ */
+class contract_code_cache
+{
+  public:
+    /// code larger than this is stored compressed, 0 stores all code as is
+    void set_compression_threshold(uint32_t bytes) { _compression_threshold = bytes; }
+    uint32_t compression_threshold() const { return _compression_threshold; }
+    void set_capacity(size_t bytes) { _capacity = bytes; }
+
+    /// fill in the code fields of a new contract_bin_code_object
+    void store(contract_bin_code_object &obj, const fc::sha256 &hash, vector<char> &&code) const;
+
+    /// the uncompressed code of obj, valid until the next call
+    const vector<char> &get(const contract_bin_code_object &obj);
+
+    size_t size() const { return _entries.size(); }
+    size_t bytes() const { return _bytes; }
+
+  private:
+    struct entry
+    {
+        vector<char> code;
+        std::list<fc::sha256>::iterator lru;
+    };
+
+    uint32_t _compression_threshold = 0;
+    size_t _capacity = 64 * 1024 * 1024;
+    size_t _bytes = 0;
+    std::map<fc::sha256, entry> _entries;
+    // most recently used first
+    std::list<fc::sha256> _lru;
+};
+
+} // namespace chain
+} // namespace graphene
@@ -16,17 +16,19 @@ struct register_scheduler
     account_id_type caller;
     contract_result &result;
     struct process_variable& _process_value;
-    const transaction_evaluation_state * trx_state;
+    transaction_evaluation_state * trx_state;
     lua_scheduler &context;
     const flat_set<public_key_type>& sigkeys;
     contract_result& apply_result;
     map<lua_key,lua_types>& account_conntract_data;
-    register_scheduler(database &db,account_id_type caller ,contract_object &contract,const transaction_evaluation_state * mode, 
+    register_scheduler(database &db,account_id_type caller ,contract_object &contract,transaction_evaluation_state * mode, 
         contract_result &result,lua_scheduler &context,const flat_set<public_key_type>& sigkeys, contract_result& apply_result,map<lua_key,lua_types>& account_data)
         : db(db),contract(contract),caller(caller), result(result),_process_value(contract.get_process_variable()),trx_state(mode),context(context),sigkeys(sigkeys),
         apply_result(apply_result),account_conntract_data(account_data){
           result.contract_id= contract.id;
         }
+    // the scheduler of the innermost running contract call, kept as light userdata in the lua registry
+    static register_scheduler *current(lua_State *L);
     bool is_owner();
     void log(string message);
     int contract_random();
@@ -59,6 +61,10 @@ struct register_scheduler
     void change_contract_authority(string authority);
     memo_data make_memo(string receiver_id_or_name, string key, string value, uint64_t ss,bool enable_logger=false);
     void invoke_contract_function(string contract_id_or_name,string function_name,string value_list_json);
+    // same as invoke_contract_function, but takes the arguments as a lua sequence instead of a json string
+    void invoke_contract_function_by_table(string contract_id_or_name,string function_name,lua_table value_list);
+    // get_value_list is called once the call passed the recursion checks, that is where the json path always parsed its arguments
+    void do_invoke_contract_function(string contract_id_or_name,string function_name,const std::function<vector<lua_types>()>& get_value_list);
     const contract_object& get_contract(string name_or_id);
     void make_release();
 	// transfer of non homogeneous asset's use rights
@@ -57,7 +57,7 @@ class contract_object : public graphene::db::abstract_object<contract_object>
     void do_actual_contract_function(account_id_type caller, string function_name, vector<lua_types> value_list,
                               lua_map &account_data, graphene::chain::database &db, const flat_set<public_key_type> &sigkeys, contract_result &apply_result,contract_id_type contract_id);
    
-    void set_mode(const transaction_evaluation_state * tx_mode) { trx_state = tx_mode; }
+    void set_mode(transaction_evaluation_state * tx_mode) { trx_state = tx_mode; }
     contract_result get_result() { return this->result; }
     struct process_variable &get_process_variable() { return _process_value; }
     void set_process_value(vector<char> process_value);
@@ -69,13 +69,13 @@ class contract_object : public graphene::db::abstract_object<contract_object>
     void push_global_parameters(lua_scheduler &context, lua_map &global_variable_list, string tablename = "");
     void push_table_parameters(lua_scheduler &context, lua_map &table_variable, string tablename);
     void push_function_actual_parameters(lua_State *L, vector<lua_types> &value_list);
-    void get_code(vector<char>&target){target=lua_code_b;lua_code_b.clear();}
-    void set_code(vector<char>source){FC_ASSERT(source.size()>0); lua_code_b=source;}
+    void get_code(vector<char>&target){target.swap(lua_code_b);lua_code_b.clear();}
+    void set_code(const vector<char>&source){FC_ASSERT(source.size()>0); lua_code_b=source;}
   private:
     process_encryption_helper encryption_helper; 
     vector<char> lua_code_b;
     contract_result result;
-    const transaction_evaluation_state * trx_state;
+    transaction_evaluation_state * trx_state;
     struct process_variable _process_value;
 };
 
@@ -172,22 +172,37 @@ typedef multi_index_container<
 typedef generic_index<account_contract_data, account_contract_data_multi_index_type> account_contract_data_index;
 
 
+/**
+ * Contract bytecode, stored once per distinct code and shared by every contract whose current
+ * version it is. The bytecode leaves out the chunk name, contracts load it under their own name.
+ *
+ * Code above the node's compression threshold is kept as a zlib stream; read it through
+ * database::get_contract_code, never through lua_code_b directly. The database API hands the
+ * object out uncompressed, so the stored form stays a local detail of each node.
+ */
 class contract_bin_code_object: public graphene::db::abstract_object<contract_bin_code_object>
 {
     public:
     static const uint8_t space_id = implementation_ids;
     static const uint8_t type_id = impl_contract_bin_code_type;
-    contract_id_type contract_id;
-    vector<char> lua_code_b;
+    contract_id_type contract_id;   // the contract that first deployed this code
+    vector<char> lua_code_b;        // zlib stream when compressed is set
+    fc::sha256 code_hash;           // of the uncompressed bytecode
+    uint32_t code_size = 0;         // uncompressed
+    uint32_t ref_count = 1;         // contracts currently running this code
+    bool compressed = false;
 };
 struct by_contract_id{};
+struct by_code_hash{};
 typedef multi_index_container<
     contract_bin_code_object,
     indexed_by<
         ordered_unique<
             tag<by_id>, member<object, object_id_type, &object::id>>,
+        ordered_non_unique<
+            tag<by_contract_id>,member<contract_bin_code_object,contract_id_type,&contract_bin_code_object::contract_id>>,
         ordered_unique<
-            tag<by_contract_id>,member<contract_bin_code_object,contract_id_type,&contract_bin_code_object::contract_id>>
+            tag<by_code_hash>,member<contract_bin_code_object,fc::sha256,&contract_bin_code_object::code_hash>>
             >
         >
     contract_bin_code_multi_index_type;
@@ -203,4 +218,4 @@ FC_REFLECT_DERIVED(graphene::chain::contract_object,
 FC_REFLECT_DERIVED(graphene::chain::account_contract_data,
                    (graphene::db::object),
                    (owner)(contract_id)(contract_data))
-FC_REFLECT_DERIVED(graphene::chain::contract_bin_code_object,(graphene::db::object),(contract_id)(lua_code_b))
+FC_REFLECT_DERIVED(graphene::chain::contract_bin_code_object,(graphene::db::object),(contract_id)(lua_code_b)(code_hash)(code_size)(ref_count)(compressed))
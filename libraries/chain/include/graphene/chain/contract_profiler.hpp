@@ -0,0 +1,99 @@
+#pragma once
+#include <graphene/chain/protocol/types.hpp>
+#include <lua_extern.hpp>
+#include <fc/time.hpp>
+
+namespace graphene
+{
+namespace chain
+{
+
+struct contract_function_profile
+{
+    uint64_t calls = 0;
+    uint64_t instructions = 0; // approximate, counted in steps of contract_profiler::instruction_step
+    uint64_t total_time = 0;   // microseconds, including nested contract calls
+    uint64_t max_time = 0;     // microseconds
+    uint64_t alloc_bytes = 0;
+    uint64_t gc_time = 0;      // microseconds spent collecting the sandbox after the call
+};
+
+struct contract_binding_profile
+{
+    uint64_t calls = 0;
+    uint64_t total_time = 0; // microseconds
+    uint64_t max_time = 0;   // microseconds
+};
+
+struct contract_profile_report
+{
+    fc::time_point_sec since;
+    // contract name -> function name -> statistics
+    map<string, map<string, contract_function_profile>> contracts;
+    // chain binding (C function) name -> statistics
+    map<string, contract_binding_profile> bindings;
+};
+
+/**
+ * Opt-in profiler for the shared contract VM.
+ *
+ * When enabled it installs lua_sethook count/call/return hooks and wraps the VM allocator,
+ * attributing instructions, allocations and time to the contract function currently running,
+ * and the time spent in C bindings (chainhelper methods, import_contract, ...) to the binding.
+ */
+class contract_profiler
+{
+  public:
+    static const int instruction_step = 1000;
+
+    class scoped_call
+    {
+      public:
+        scoped_call(contract_profiler &profiler, const string &contract_name, const string &function_name);
+        ~scoped_call();
+        void record_gc(const fc::microseconds &elapsed);
+
+      private:
+        contract_profiler &profiler;
+        contract_function_profile *entry = nullptr;
+        size_t binding_depth = 0;
+        fc::time_point start;
+    };
+
+    bool enabled() const { return _enabled; }
+    void enable(lua_State *L);
+    void disable(lua_State *L);
+    /// re-attach hooks after the VM has been rebuilt by database::initialize_luaVM
+    void attach(lua_State *L);
+
+    void set_log_interval(uint32_t blocks) { _log_interval = blocks; }
+    void on_applied_block(uint32_t block_num);
+
+    contract_profile_report get_report() const { return _report; }
+    void reset();
+
+  private:
+    static void hook(lua_State *L, lua_Debug *ar);
+    static void *alloc(void *ud, void *ptr, size_t osize, size_t nsize);
+
+    struct binding_frame
+    {
+        string name;
+        fc::time_point start;
+    };
+
+    bool _enabled = false;
+    uint32_t _log_interval = 0;
+    lua_Alloc _original_alloc = nullptr;
+    void *_original_alloc_ud = nullptr;
+    contract_profile_report _report;
+    vector<contract_function_profile *> _call_stack;
+    vector<binding_frame> _binding_stack;
+};
+
+} // namespace chain
+} // namespace graphene
+
+FC_REFLECT(graphene::chain::contract_function_profile, (calls)(instructions)(total_time)(max_time)(alloc_bytes)(gc_time))
+FC_REFLECT(graphene::chain::contract_binding_profile, (calls)(total_time)(max_time))
+FC_REFLECT(graphene::chain::contract_profile_report, (since)(contracts)(bindings))
@@ -44,6 +44,15 @@
 #include <map>
 #include <lua_extern.hpp>
 #include <graphene/chain/protocol/lua_scheduler.hpp>
+#include <graphene/chain/contract_profiler.hpp>
+#include <graphene/chain/block_phase_profiler.hpp>
+#include <graphene/chain/operation_stats.hpp>
+#include <graphene/chain/lua_memory_pool.hpp>
+#include <graphene/chain/lua_vm_standby.hpp>
+#include <graphene/chain/worker_pool.hpp>
+#include <graphene/chain/transaction_prevalidator.hpp>
+#include <graphene/chain/authority_cache.hpp>
+#include <graphene/chain/contract_code_cache.hpp>
 #include <boost/program_options.hpp>
 // #include <graphene/chain/protocol/block.hpp>
 
@@ -139,6 +148,10 @@ class database : public db::object_database
     block_id_type get_block_id_for_num(uint32_t block_num) const;
     optional<signed_block> fetch_block_by_id(const block_id_type &id) const;
     optional<signed_block> fetch_block_by_number(uint32_t num) const;
+    /// like fetch_block_by_number, but without decoding the transactions of blocks already on disk
+    optional<block_header_info> fetch_block_header_by_number(uint32_t num) const;
+    /// the block packed as in the block database, for passing it on without decoding it
+    optional<vector<char>> fetch_packed_block_by_number(uint32_t num) const;
     const signed_transaction &get_recent_transaction(const string &trx_id) const;
     std::vector<block_id_type> get_block_ids_on_fork(block_id_type head_of_fork) const;
 
@@ -153,9 +166,14 @@ class database : public db::object_database
     bool before_last_checkpoint() const;
 
     bool push_block(const signed_block &b, uint32_t skip = skip_nothing);
-    processed_transaction push_transaction(const signed_transaction &trx, uint32_t skip = skip_nothing, transaction_push_state push_state = transaction_push_state::from_me);
-    bool _push_block(const signed_block &b);
-    processed_transaction _push_transaction(const signed_transaction &trx, transaction_push_state push_state);
+    /// push a block without copying it, the fork database keeps sharing @p b
+    bool push_block(const signed_block_ptr &b, uint32_t skip = skip_nothing);
+    /// @p prepared is what prevalidate_transaction returned for this very trx object, if it was called
+    processed_transaction push_transaction(const signed_transaction &trx, uint32_t skip = skip_nothing, transaction_push_state push_state = transaction_push_state::from_me,
+                                           const prepared_transaction *prepared = nullptr);
+    bool _push_block(const signed_block_ptr &b);
+    void _apply_linked_blocks(const vector<item_ptr> &linked, const block_id_type &pushed_block_id, uint32_t skip);
+    processed_transaction _push_transaction(const signed_transaction &trx, transaction_push_state push_state, const prepared_transaction *prepared = nullptr);
 
     bool validate_block(signed_block &b, const fc::ecc::private_key &block_signing_private_key, uint32_t skip = skip_authority_check); //nico 在验证区块的时候，跳过对tx签名的检查(tx签名验证在push模式已经查验过了)
     bool _validate_block(signed_block &b, const fc::ecc::private_key &block_signing_private_key);
@@ -241,8 +259,34 @@ class database : public db::object_database
     void _try_apply_block(signed_block &next_block);
     optional<file_object> lookup_file(const string &file_name_or_ids) const;
     graphene::chain::lua_scheduler &get_luaVM() { return luaVM; };
+    contract_profiler &get_contract_profiler() { return _contract_profiler; }
+    /// when enabled, reindex stops after its last block
+    block_phase_profiler &get_block_profiler() { return _block_profiler; }
+    operation_stats &get_operation_stats() { return _operation_stats; }
+    lua_memory_pool &get_lua_memory_pool() { return *_lua_memory_pool; }
+    /// cap on how much one contract call may grow the VM heap outside of block application, 0 disables it
+    void set_contract_memory_cap(size_t cap) { _contract_memory_cap = cap; }
+    size_t get_contract_memory_cap() const { return _contract_memory_cap; }
+    void enable_contract_profiling(bool enable);
     void initialize_luaVM();
     void initialize_baseENV();
+    /// keep a pre-initialized VM ready so a VM collapse does not rebuild the interpreter during block application
+    void set_contract_standby_vm(bool enable);
+    void prepare_standby_luaVM();
+    /// replace the collapsed VM, deferred until the outermost contract call has unwound
+    void recover_luaVM();
+    bool is_luaVM_collapsed() const { return _luaVM_collapsed; }
+    /// threads that pack, hash and validate the transactions of a block before it is applied, 0 does it inline
+    void set_block_preparation_threads(uint32_t thread_count) { _worker_pool.set_thread_count(thread_count); }
+    /// stateless checks for a transaction from the network before it is pushed, on the p2p thread: the wait for
+    /// the worker pool yields to other fc tasks; the results are good for push_transaction of the same trx object
+    std::shared_ptr<const prepared_transaction> prevalidate_transaction(const signed_transaction &trx) { return _transaction_prevalidator.prevalidate(trx); }
+    const transaction_prevalidator &get_transaction_prevalidator() const { return _transaction_prevalidator; }
+    /// active authorities with temporary keys merged in, for verify_authority and get_required_signatures
+    authority_cache &get_authority_cache() { return _authority_cache; }
+    contract_code_cache &get_contract_code_cache() { return _contract_code_cache; }
+    /// uncompressed bytecode of code, valid until the next call
+    const vector<char> &get_contract_code(const contract_bin_code_object &code) { return _contract_code_cache.get(code); }
     void init_global_property_extensions();
     
     /*******************************************************nico end****************************************************/
@@ -502,6 +546,8 @@ class database : public db::object_database
 
   private:
     void _apply_block(const signed_block &next_block);
+    void prepare_block_transactions(const signed_block &next_block, uint32_t skip);
+    uint32_t max_transaction_size() const;
     processed_transaction _apply_transaction(const signed_transaction &trx, transaction_apply_mode &run_mode,bool only_try_permissions=false);
     void _cancel_bids_and_revive_mpa(const asset_object &bitasset, const asset_bitasset_data_object &bad);
 
@@ -576,7 +622,25 @@ class database : public db::object_database
     /*******************************nico add 线程锁*****************************/
     boost::recursive_mutex _db_lock;
 
-    graphene::chain::lua_scheduler luaVM;
+    // declared before luaVM so the pool outlives every state allocated from it
+    std::unique_ptr<lua_memory_pool> _lua_memory_pool{new lua_memory_pool()};
+    size_t _contract_memory_cap = 0;
+    graphene::chain::lua_scheduler luaVM{true, &lua_memory_pool::alloc, _lua_memory_pool.get()};
+    lua_vm_standby _lua_vm_standby;
+    bool _contract_standby_vm = true;
+    bool _luaVM_collapsed = false;
+    contract_profiler _contract_profiler;
+    block_phase_profiler _block_profiler;
+    operation_stats _operation_stats;
+
+    worker_pool _worker_pool;
+    transaction_prevalidator _transaction_prevalidator{_worker_pool};
+    /// stateless per transaction results computed on the worker pool before a block is applied
+    vector<prepared_transaction> _prepared_transactions;
+    /// picked up (and cleared) by the next _apply_transaction call
+    const prepared_transaction *_next_prepared_transaction = nullptr;
+    authority_cache _authority_cache{*this};
+    contract_code_cache _contract_code_cache;
     public:
      const asset_object *core=nullptr;
      const asset_object *GAS=nullptr;
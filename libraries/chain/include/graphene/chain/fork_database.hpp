@@ -23,12 +23,14 @@
  */
 #pragma once
 #include <graphene/chain/protocol/block.hpp>
+#include <graphene/chain/config.hpp>
 
 #include <boost/multi_index_container.hpp>
 #include <boost/multi_index/member.hpp>
 #include <boost/multi_index/ordered_index.hpp>
 #include <boost/multi_index/hashed_index.hpp>
 #include <boost/multi_index/mem_fun.hpp>
+#include <boost/multi_index/sequenced_index.hpp>
 
 
 namespace graphene { namespace chain {
@@ -37,15 +39,22 @@ namespace graphene { namespace chain {
 
    struct fork_item
    {
-      fork_item( signed_block d )
-      :num(d.block_num()),id(d.block_id),data( std::move(d) ){}
+      fork_item( signed_block_ptr d )
+      :num(d->block_num()),id(d->block_id),block( std::move(d) ),data( *block ){}
 
       block_id_type previous_id()const { return data.previous; }
+      /// the block serialized for the block database, packed on first use so a block that is re-applied
+      /// by repeated fork switches is only packed once
+      const vector<char>& packed()const;
 
       weak_ptr< fork_item > prev;
       uint32_t              num;    // initialized in ctor
       block_id_type         id;
-      signed_block          data;
+      signed_block_ptr      block;
+      const signed_block&   data;
+
+   private:
+      mutable optional<vector<char>> _packed;
    };
    typedef shared_ptr<fork_item> item_ptr;
 
@@ -57,6 +66,15 @@ namespace graphene { namespace chain {
     *  have a maximum depth of 1024 blocks after which
     *  the database will start lopping off forks.
     *
+    *  Blocks that arrive ahead of their parent (up to
+    *  MAX_BLOCK_REORDERING blocks past the head) are buffered
+    *  in the unlinked index and linked as soon as the gap
+    *  before them is filled.  When the index outgrows its
+    *  memory budget the blocks that have waited longest are
+    *  dropped, so blocks that never link can't hold it for
+    *  good; a dropped block is no longer known and is fetched
+    *  again like any other missing block.
+    *
     *  Every time a block is pushed into the fork DB the
     *  block with the highest block_num will be returned.
     */
@@ -71,6 +89,7 @@ namespace graphene { namespace chain {
          void reset();
 
          void                             start_block(signed_block b);
+         void                             start_block(signed_block_ptr b);
          void                             remove(block_id_type b);
          void                             set_head(shared_ptr<fork_item> h);
          bool                             is_known_block(const block_id_type& id)const;
@@ -79,8 +98,13 @@ namespace graphene { namespace chain {
 
          /**
           *  @return the new head block ( the longest fork )
+          *  @throws unlinkable_block_buffered_exception if the block does not link yet and is kept
+          *          in the unlinked index until its parent arrives
+          *  @throws unlinkable_block_exception if the block does not link and was not kept, because
+          *          it is too far ahead of the head or larger than the unlinked index budget
           */
          shared_ptr<fork_item>            push_block(const signed_block& b);
+         shared_ptr<fork_item>            push_block(const signed_block_ptr& b);
          shared_ptr<fork_item>            head()const { return _head; }
          void                             pop_block();
 
@@ -103,16 +127,39 @@ namespace graphene { namespace chain {
             >
          > fork_multi_index_type;    //  区块数据表
 
+         struct by_arrival;
+         typedef multi_index_container<
+            item_ptr,
+            indexed_by<
+               hashed_unique<tag<block_id>, member<fork_item, block_id_type, &fork_item::id>, std::hash<fc::ripemd160>>,
+               hashed_non_unique<tag<by_previous>, const_mem_fun<fork_item, block_id_type, &fork_item::previous_id>, std::hash<fc::ripemd160>>,
+               ordered_non_unique<tag<block_num>, member<fork_item,uint32_t,&fork_item::num>>,
+               sequenced<tag<by_arrival>>
+            >
+         > unlinked_multi_index_type;
+
          void set_max_size( uint32_t s );
+         /// limit the memory held by blocks waiting for their parent, 0 disables buffering
+         void set_max_unlinked_bytes( size_t s );
+         size_t unlinked_blocks()const { return _unlinked_index.size(); }
+         size_t unlinked_bytes()const { return _unlinked_bytes; }
 
       private:
          /** @return a pointer to the newly pushed item */
          void _push_block(const item_ptr& b );
          void _push_next(const item_ptr& newly_inserted);
+         bool _buffer_unlinked(const item_ptr& item);
+         void _prune_unlinked(uint32_t min_num);
+         typedef unlinked_multi_index_type::index<block_num>::type::iterator unlinked_num_iterator;
+         void _erase_unlinked(unlinked_num_iterator itr);
+         /// drop the blocks that have waited longest until the index holds no more than max_bytes
+         void _shrink_unlinked(size_t max_bytes);
 
          uint32_t                 _max_size = 1024;
+         size_t                   _max_unlinked_bytes = GRAPHENE_DEFAULT_MAX_UNLINKED_BLOCK_BYTES;
+         size_t                   _unlinked_bytes = 0;
 
-         fork_multi_index_type    _unlinked_index;
+         unlinked_multi_index_type _unlinked_index;
          fork_multi_index_type    _index;
          shared_ptr<fork_item>    _head;
    };
@@ -0,0 +1,90 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace graphene
+{
+namespace chain
+{
+
+/**
+ * Size-class pool allocator used as the lua_Alloc of the shared contract VM.
+ *
+ * Small blocks (up to max_pooled_size) are carved out of aligned slabs and recycled through per-class
+ * free lists; larger blocks go straight to the system allocator. The pool keeps live/peak accounting and
+ * can enforce a cap on how much a single contract call may grow the live heap.
+ */
+class lua_memory_pool
+{
+  public:
+    static const size_t size_class_step = 16;
+    static const size_t max_pooled_size = 512;
+    static const size_t slab_size = 64 * 1024;
+
+    lua_memory_pool() = default;
+    ~lua_memory_pool();
+    lua_memory_pool(const lua_memory_pool &) = delete;
+    lua_memory_pool &operator=(const lua_memory_pool &) = delete;
+
+    /// lua_Alloc compatible entry point, ud must point to a lua_memory_pool
+    static void *alloc(void *ud, void *ptr, size_t osize, size_t nsize);
+
+    size_t live_bytes() const { return _live_bytes; }
+    size_t peak_bytes() const { return _peak_bytes; }
+    size_t reserved_bytes() const { return _slabs.size() * slab_size; }
+    void reset_peak() { _peak_bytes = _live_bytes; }
+
+    /// limit how much the live heap may grow until end_call(), 0 means unlimited
+    void begin_call(size_t cap);
+    void end_call();
+    bool in_call() const { return _call_depth != 0; }
+
+    class scoped_call
+    {
+      public:
+        scoped_call(lua_memory_pool &pool, size_t cap) : pool(pool) { pool.begin_call(cap); }
+        ~scoped_call() { pool.end_call(); }
+
+      private:
+        lua_memory_pool &pool;
+    };
+
+    /// bytes held by slabs without a live block, what trim() would give back
+    size_t reclaimable_bytes() const { return _empty_slabs * slab_size; }
+    /// give slabs that no longer hold live blocks back to the system
+    void trim();
+
+  private:
+    struct free_block
+    {
+        free_block *next;
+    };
+    struct slab_header
+    {
+        uint32_t used_blocks;
+        uint32_t size_class;
+    };
+    static const size_t size_class_count = max_pooled_size / size_class_step;
+    static_assert((slab_size & (slab_size - 1)) == 0, "slabs are located by masking block addresses");
+
+    static size_t size_class_of(size_t size) { return (size + size_class_step - 1) / size_class_step - 1; }
+    static slab_header *slab_of(void *ptr);
+
+    void *allocate(size_t size);
+    void deallocate(void *ptr, size_t size);
+    bool refill(size_t size_class);
+
+    free_block *_free_lists[size_class_count] = {};
+    std::vector<slab_header *> _slabs;
+    // slabs whose used_blocks is 0, kept up to date so callers can tell whether a trim would free anything
+    size_t _empty_slabs = 0;
+    size_t _live_bytes = 0;
+    size_t _peak_bytes = 0;
+    size_t _call_cap = 0;
+    size_t _call_base = 0;
+    uint32_t _call_depth = 0;
+};
+
+} // namespace chain
+} // namespace graphene
@@ -0,0 +1,53 @@
+#pragma once
+#include <graphene/chain/lua_memory_pool.hpp>
+#include <graphene/chain/protocol/lua_scheduler.hpp>
+#include <fc/thread/thread.hpp>
+#include <memory>
+
+namespace graphene
+{
+namespace chain
+{
+
+/**
+ * Pre-initialized replacement for the shared contract VM.
+ *
+ * A VM is built (luaL_openlibs, chain_function_bind and the baseENV load) on a background thread into a
+ * state with a memory pool of its own, so recovering from a VM collapse only has to swap it in.
+ */
+class lua_vm_standby
+{
+  public:
+    struct prepared_vm
+    {
+        // declared before vm so the pool outlives the state allocated from it
+        std::unique_ptr<lua_memory_pool> pool;
+        std::unique_ptr<lua_scheduler> vm;
+        vector<char> base_code;
+    };
+
+    ~lua_vm_standby();
+
+    /// start building a standby VM with the given baseENV bytecode, unless one is already prepared
+    void prepare(const vector<char> &base_code, const string &base_name);
+    bool prepared() const { return _pending.valid(); }
+    bool ready() const { return _pending.valid() && _pending.ready(); }
+    /**
+     * hand over the prepared VM if its build has finished, null otherwise. Never waits: a wait would yield the
+     * chain thread to other tasks in the middle of a block, so a build still running is left for the next call.
+     */
+    std::shared_ptr<prepared_vm> take();
+    /// close a retired VM on the background thread
+    void retire(std::shared_ptr<prepared_vm> retired);
+    /// drop the prepared VM, if any, without waiting for a running build
+    void clear();
+
+  private:
+    fc::thread &thread();
+
+    std::unique_ptr<fc::thread> _thread;
+    fc::future<std::shared_ptr<prepared_vm>> _pending;
+};
+
+} // namespace chain
+} // namespace graphene
@@ -0,0 +1,88 @@
+#pragma once
+#include <graphene/chain/protocol/operations.hpp>
+
+#include <atomic>
+#include <memory>
+
+namespace graphene
+{
+namespace chain
+{
+
+/// unqualified name of the operation type with the given tag, e.g. "transfer_operation"
+string operation_type_name(int which);
+
+struct operation_type_stats
+{
+    int32_t which = 0;
+    string name;
+    uint64_t count = 0;
+    uint64_t total_time = 0;   // microseconds, including nested operations
+    uint64_t max_time = 0;     // microseconds
+    uint64_t failures = 0;
+    uint64_t undo_objects = 0; // objects created, modified or removed
+};
+
+struct contract_call_stats
+{
+    contract_id_type contract_id;
+    uint64_t count = 0;
+    uint64_t total_time = 0; // microseconds
+    uint64_t max_time = 0;   // microseconds
+    uint64_t failures = 0;
+    uint64_t undo_objects = 0;
+};
+
+/**
+ * Always-on counters of database::apply_operation, by operation type and by called contract.
+ *
+ * Operations are only applied on the chain thread, so the slots belong to that one writer: it
+ * updates a counter with a plain relaxed load and store, no locked read-modify-write, and API
+ * threads read the counters without taking a lock. Slots never move once created; contract slots
+ * are allocated by the writer in chunks indexed by contract instance the first time a contract is
+ * called, and published to readers with a release store.
+ */
+class operation_stats
+{
+  public:
+    static const uint32_t contract_chunk_size = 1024;
+    static const uint32_t contract_chunks = 4096;
+
+    operation_stats();
+    ~operation_stats();
+
+    /// must only be called from the thread applying operations
+    void record(const operation &op, uint64_t elapsed, bool failed, uint64_t undo_objects);
+
+    /// operation types that were applied at least once
+    vector<operation_type_stats> get_operation_stats() const;
+    /// the contracts with the most call time first
+    vector<contract_call_stats> get_contract_stats(uint32_t limit) const;
+
+    void set_log_interval(uint32_t blocks) { _log_interval = blocks; }
+    void on_applied_block(uint32_t block_num);
+
+  private:
+    struct slot
+    {
+        std::atomic<uint64_t> count{0};
+        std::atomic<uint64_t> total_time{0};
+        std::atomic<uint64_t> max_time{0};
+        std::atomic<uint64_t> failures{0};
+        std::atomic<uint64_t> undo_objects{0};
+
+        void record(uint64_t elapsed, bool failed, uint64_t undo_objects);
+    };
+
+    slot *contract_slot(uint64_t instance);
+
+    std::unique_ptr<slot[]> _operations;
+    std::atomic<slot *> _contracts[contract_chunks];
+    uint32_t _log_interval = 0;
+};
+
+} // namespace chain
+} // namespace graphene
+
+FC_REFLECT(graphene::chain::operation_type_stats, (which)(name)(count)(total_time)(max_time)(failures)(undo_objects))
+FC_REFLECT(graphene::chain::contract_call_stats, (contract_id)(count)(total_time)(max_time)(failures)(undo_objects))
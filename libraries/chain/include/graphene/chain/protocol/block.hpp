@@ -51,11 +51,16 @@ namespace graphene { namespace chain {
    struct signed_block : public signed_block_header
    {
       checksum_type calculate_merkle_root()const;
+      /// merkle root over already computed processed_transaction::merkle_digest() values
+      static checksum_type calculate_merkle_root(vector<digest_type> ids);
       checksum_type checking_transactions_hash()const;
       block_id_type                 block_id;
       vector<std::pair<tx_hash_type,processed_transaction>> transactions;
    };
 
+   /// blocks are immutable once received, so they are passed around by shared pointer instead of being copied
+   typedef std::shared_ptr<const signed_block> signed_block_ptr;
+
 } } // graphene::chain
 
 FC_REFLECT( graphene::chain::block_header, (previous)(timestamp)(witness)(transaction_merkle_root)(extensions) )
@@ -109,11 +109,12 @@ public:
     bool ismthread = false;
     /**
      * @param openDefaultLibs True if luaL_openlibs should be called
+     * @param alloc Allocator for the new state, the default luaL_newstate allocator is used when null
      */
-    explicit lua_scheduler(bool openDefaultLibs = true)
+    explicit lua_scheduler(bool openDefaultLibs = true, lua_Alloc alloc = nullptr, void *alloc_ud = nullptr)
     {
         // luaL_newstate can return null if allocation failed
-        mState = luaL_newstate();
+        mState = alloc ? lua_newstate(alloc, alloc_ud) : luaL_newstate();
 
         if (mState == nullptr)
             FC_THROW("bad alloc");
@@ -144,6 +145,9 @@ public:
     bool close_sandbox(string spacename);
     bool get_function(string spacename, string func);
     bool load_script_to_sandbox(string spacename, const char *script, size_t script_size);
+    bool reset_sandbox_data(string spacename);
+    void set_registry_pointer(const char *key, void *pointer);
+    static void *get_registry_pointer(lua_State *L, const char *key);
     /**
      * Move constructor
      */
@@ -0,0 +1,116 @@
+#pragma once
+#include <graphene/chain/protocol/transaction.hpp>
+#include <graphene/chain/worker_pool.hpp>
+#include <fc/variant_object.hpp>
+
+#include <boost/multi_index_container.hpp>
+#include <boost/multi_index/hashed_index.hpp>
+#include <boost/multi_index/member.hpp>
+#include <boost/multi_index/ordered_index.hpp>
+
+#include <array>
+#include <atomic>
+#include <mutex>
+
+namespace graphene
+{
+namespace chain
+{
+
+/// stateless per transaction results worked out off the main thread, picked up by _apply_transaction
+struct prepared_transaction
+{
+    const signed_transaction *trx = nullptr;
+    digest_type merkle_digest;
+    tx_hash_type hash;
+    size_t packed_size = 0;
+    bool validated = false;
+    fc::exception_ptr validate_error;
+    /// keys recovered from the signatures, when they were checked ahead of time
+    fc::optional<flat_set<public_key_type>> signature_keys;
+};
+
+/**
+ * Speculative checks for transactions arriving from the network, run on the worker pool before the
+ * transaction is queued for the main thread.
+ *
+ * Only checks that need no locked chain state are made: size, validate(), signature recovery, expiration,
+ * TaPoS and duplicates, against a snapshot the main thread publishes after every block. A rejected
+ * transaction never reaches the main thread; an accepted one hands its hash, size and signature keys
+ * to the caller, who passes them on to push_transaction, where _apply_transaction still makes every
+ * check that depends on chain state. Only transactions that were pushed successfully count as duplicates.
+ */
+class transaction_prevalidator
+{
+  public:
+    enum reject_reason
+    {
+        oversized,
+        invalid,
+        bad_signature,
+        tapos_mismatch,
+        expired,
+        duplicate,
+        reject_reason_count
+    };
+
+    /// what the main thread knows after applying a block
+    struct chain_snapshot
+    {
+        chain_id_type chain_id;
+        uint32_t head_block_num = 0;
+        block_id_type head_block_id;
+        fc::time_point_sec head_block_time;
+        uint32_t maximum_time_until_expiration = 0;
+        uint32_t maximum_transaction_size = 0;
+    };
+
+    explicit transaction_prevalidator(worker_pool &pool) : _pool(pool) {}
+
+    /// run the checks on the worker pool and return the results for this very trx object, throws if the
+    /// transaction is rejected; yields to the calling thread's other fc tasks while it waits, so not for the
+    /// main thread
+    std::shared_ptr<const prepared_transaction> prevalidate(const signed_transaction &trx);
+    /// remember a prevalidated transaction that was pushed, so copies of it are dropped as duplicates; main thread
+    void on_pushed(const prepared_transaction &prepared);
+    /// publish the state after a block has been applied and forget transactions that have expired; main thread
+    void on_applied_block(const chain_snapshot &snapshot);
+
+    fc::variant_object get_statistics() const;
+
+  private:
+    struct recent_transaction
+    {
+        tx_hash_type hash;
+        fc::time_point_sec expiration;
+    };
+    struct by_hash;
+    struct by_expiration;
+    typedef boost::multi_index_container<
+        recent_transaction,
+        boost::multi_index::indexed_by<
+            boost::multi_index::hashed_unique<boost::multi_index::tag<by_hash>,
+                                              boost::multi_index::member<recent_transaction, tx_hash_type, &recent_transaction::hash>,
+                                              std::hash<tx_hash_type>>,
+            boost::multi_index::ordered_non_unique<boost::multi_index::tag<by_expiration>,
+                                                   boost::multi_index::member<recent_transaction, fc::time_point_sec, &recent_transaction::expiration>>>>
+        recent_transaction_set;
+
+    void check(const signed_transaction &trx, prepared_transaction &prepared);
+
+    worker_pool &_pool;
+    mutable std::mutex _mutex; ///< guards everything below except the counters
+    chain_snapshot _snapshot;
+    bool _have_snapshot = false;
+    /// block_id._hash[1] of the last block applied at each ref_block_num, 0 when unknown
+    vector<uint32_t> _tapos_prefixes = vector<uint32_t>(0x10000, 0);
+    recent_transaction_set _recent;
+
+    std::atomic<uint64_t> _accepted{0};
+    std::array<std::atomic<uint64_t>, reject_reason_count> _rejected{};
+};
+
+} // namespace chain
+} // namespace graphene
+
+FC_REFLECT_ENUM(graphene::chain::transaction_prevalidator::reject_reason, (oversized)(invalid)(bad_signature)(tapos_mismatch)(expired)(duplicate)(reject_reason_count))
@@ -0,0 +1,39 @@
+#pragma once
+#include <fc/thread/thread.hpp>
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <vector>
+
+namespace graphene
+{
+namespace chain
+{
+
+/**
+ * Small pool of fc threads for work that does not touch chain state, such as packing, hashing and
+ * validating transactions. With no threads everything runs on the calling thread.
+ */
+class worker_pool
+{
+  public:
+    ~worker_pool();
+
+    void set_thread_count(uint32_t thread_count);
+    uint32_t get_thread_count() const { return _threads.size(); }
+
+    /// call work(i) for every i in [0, count), split in contiguous chunks of at least min_chunk over the pool and
+    /// the calling thread; blocks the calling thread without running its other fc tasks until all calls are done,
+    /// work must not throw
+    void for_each(size_t count, const std::function<void(size_t)> &work, size_t min_chunk = 1);
+    /// queue work on the next pool thread; waiting on the future yields to the caller's other fc tasks and passes
+    /// on exceptions thrown by work, which may outlive the caller and so must own what it uses; needs threads
+    fc::future<void> schedule(std::function<void()> work);
+
+  private:
+    std::vector<std::unique_ptr<fc::thread>> _threads;
+    std::atomic<uint32_t> _next_thread{0};
+};
+
+} // namespace chain
+} // namespace graphene
@@ -0,0 +1,151 @@
+#include <graphene/chain/lua_memory_pool.hpp>
+#include <boost/align/aligned_alloc.hpp>
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+
+namespace graphene
+{
+namespace chain
+{
+
+lua_memory_pool::~lua_memory_pool()
+{
+    for (auto slab : _slabs)
+        boost::alignment::aligned_free(slab);
+}
+
+lua_memory_pool::slab_header *lua_memory_pool::slab_of(void *ptr)
+{
+    return reinterpret_cast<slab_header *>(reinterpret_cast<uintptr_t>(ptr) & ~uintptr_t(slab_size - 1));
+}
+
+bool lua_memory_pool::refill(size_t size_class)
+{
+    auto slab = static_cast<slab_header *>(boost::alignment::aligned_alloc(slab_size, slab_size));
+    if (slab == nullptr)
+        return false;
+    slab->used_blocks = 0;
+    slab->size_class = size_class;
+    _slabs.push_back(slab);
+    _empty_slabs++;
+
+    // the first step of the slab holds the header, blocks follow at size_class_step alignment
+    const size_t block_size = (size_class + 1) * size_class_step;
+    char *base = reinterpret_cast<char *>(slab);
+    for (size_t offset = size_class_step; offset + block_size <= slab_size; offset += block_size)
+    {
+        auto block = reinterpret_cast<free_block *>(base + offset);
+        block->next = _free_lists[size_class];
+        _free_lists[size_class] = block;
+    }
+    return true;
+}
+
+void *lua_memory_pool::allocate(size_t size)
+{
+    if (size > max_pooled_size)
+        return std::malloc(size);
+    auto size_class = size_class_of(size);
+    if (_free_lists[size_class] == nullptr && !refill(size_class))
+        return nullptr;
+    auto block = _free_lists[size_class];
+    _free_lists[size_class] = block->next;
+    if (slab_of(block)->used_blocks++ == 0)
+        _empty_slabs--;
+    return block;
+}
+
+void lua_memory_pool::deallocate(void *ptr, size_t size)
+{
+    if (size > max_pooled_size)
+    {
+        std::free(ptr);
+        return;
+    }
+    auto size_class = size_class_of(size);
+    auto block = static_cast<free_block *>(ptr);
+    block->next = _free_lists[size_class];
+    _free_lists[size_class] = block;
+    if (--slab_of(block)->used_blocks == 0)
+        _empty_slabs++;
+}
+
+void *lua_memory_pool::alloc(void *ud, void *ptr, size_t osize, size_t nsize)
+{
+    auto pool = static_cast<lua_memory_pool *>(ud);
+    // when ptr is null, osize encodes the object type rather than a size
+    const size_t old_size = ptr ? osize : 0;
+    if (nsize == 0)
+    {
+        if (ptr)
+            pool->deallocate(ptr, old_size);
+        pool->_live_bytes -= old_size;
+        return nullptr;
+    }
+    if (nsize > old_size && pool->_call_cap != 0 && pool->_live_bytes + (nsize - old_size) > pool->_call_base + pool->_call_cap)
+        return nullptr; // lua collects garbage, retries once and then raises LUA_ERRMEM inside the contract call
+
+    void *block = nullptr;
+    if (ptr == nullptr)
+        block = pool->allocate(nsize);
+    else if (old_size > max_pooled_size && nsize > max_pooled_size)
+        block = std::realloc(ptr, nsize);
+    else if (old_size <= max_pooled_size && nsize <= max_pooled_size && size_class_of(old_size) == size_class_of(nsize))
+        block = ptr;
+    else
+    {
+        block = pool->allocate(nsize);
+        if (block != nullptr)
+        {
+            std::memcpy(block, ptr, std::min(old_size, nsize));
+            pool->deallocate(ptr, old_size);
+        }
+    }
+    if (block == nullptr)
+        return nullptr; // the original block is left untouched
+    pool->_live_bytes += nsize;
+    pool->_live_bytes -= old_size;
+    pool->_peak_bytes = std::max(pool->_peak_bytes, pool->_live_bytes);
+    return block;
+}
+
+void lua_memory_pool::begin_call(size_t cap)
+{
+    // nested contract calls share the budget of the outermost call
+    if (_call_depth++ != 0)
+        return;
+    _call_cap = cap;
+    _call_base = _live_bytes;
+}
+
+void lua_memory_pool::end_call()
+{
+    if (_call_depth == 0 || --_call_depth != 0)
+        return;
+    _call_cap = 0;
+    _call_base = 0;
+}
+
+void lua_memory_pool::trim()
+{
+    for (size_t size_class = 0; size_class < size_class_count; size_class++)
+    {
+        free_block **link = &_free_lists[size_class];
+        while (*link != nullptr)
+        {
+            if (slab_of(*link)->used_blocks == 0)
+                *link = (*link)->next;
+            else
+                link = &(*link)->next;
+        }
+    }
+    auto empty_begin = std::partition(_slabs.begin(), _slabs.end(), [](slab_header *slab) { return slab->used_blocks != 0; });
+    for (auto itr = empty_begin; itr != _slabs.end(); itr++)
+        boost::alignment::aligned_free(*itr);
+    _slabs.erase(empty_begin, _slabs.end());
+    _empty_slabs = 0;
+}
+
+} // namespace chain
+} // namespace graphene
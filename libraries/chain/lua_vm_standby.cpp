@@ -0,0 +1,71 @@
+#include <graphene/chain/lua_vm_standby.hpp>
+#include <fc/log/logger.hpp>
+
+namespace graphene
+{
+namespace chain
+{
+
+lua_vm_standby::~lua_vm_standby()
+{
+    clear();
+    if (_thread)
+        _thread->quit();
+}
+
+fc::thread &lua_vm_standby::thread()
+{
+    if (!_thread)
+        _thread.reset(new fc::thread("lua_vm_standby"));
+    return *_thread;
+}
+
+void lua_vm_standby::prepare(const vector<char> &base_code, const string &base_name)
+{
+    if (_pending.valid())
+        return;
+    _pending = thread().async([base_code, base_name]() {
+        auto result = std::make_shared<prepared_vm>();
+        result->pool.reset(new lua_memory_pool());
+        result->vm.reset(new lua_scheduler(true, &lua_memory_pool::alloc, result->pool.get()));
+        luaL_loadbuffer(result->vm->mState, base_code.data(), base_code.size(), base_name.data());
+        lua_setglobal(result->vm->mState, "baseENV");
+        result->base_code = base_code;
+        return result;
+    }, "prepare_lua_vm");
+}
+
+std::shared_ptr<lua_vm_standby::prepared_vm> lua_vm_standby::take()
+{
+    if (!ready())
+        return nullptr;
+    auto pending = _pending;
+    _pending = fc::future<std::shared_ptr<prepared_vm>>();
+    try
+    {
+        return pending.wait(); // already complete, returns without yielding
+    }
+    catch (const fc::exception &e)
+    {
+        elog("failed to prepare the standby lua VM: ${e}", ("e", e.to_detail_string()));
+    }
+    return nullptr;
+}
+
+void lua_vm_standby::retire(std::shared_ptr<prepared_vm> retired)
+{
+    if (!retired)
+        return;
+    thread().async([retired = std::move(retired)]() mutable { retired.reset(); }, "retire_lua_vm");
+}
+
+void lua_vm_standby::clear()
+{
+    if (ready())
+        retire(take());
+    else // a running build finishes on the standby thread and its VM is closed there
+        _pending = fc::future<std::shared_ptr<prepared_vm>>();
+}
+
+} // namespace chain
+} // namespace graphene
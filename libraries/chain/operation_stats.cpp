@@ -0,0 +1,153 @@
+#include <graphene/chain/operation_stats.hpp>
+#include <fc/io/json.hpp>
+#include <fc/log/logger.hpp>
+
+#include <algorithm>
+
+namespace graphene
+{
+namespace chain
+{
+
+namespace
+{
+struct operation_name_visitor
+{
+    typedef string result_type;
+    template <typename T>
+    string operator()(const T &) const
+    {
+        string name = fc::get_typename<T>::name();
+        auto colon = name.rfind(':');
+        return colon == string::npos ? name : name.substr(colon + 1);
+    }
+};
+
+template <typename Stats, typename Slot>
+void fill(Stats &stats, const Slot &slot)
+{
+    stats.count = slot.count.load(std::memory_order_relaxed);
+    stats.total_time = slot.total_time.load(std::memory_order_relaxed);
+    stats.max_time = slot.max_time.load(std::memory_order_relaxed);
+    stats.failures = slot.failures.load(std::memory_order_relaxed);
+    stats.undo_objects = slot.undo_objects.load(std::memory_order_relaxed);
+}
+} // namespace
+
+string operation_type_name(int which)
+{
+    operation op;
+    op.set_which(which);
+    return op.visit(operation_name_visitor());
+}
+
+const uint32_t operation_stats::contract_chunk_size;
+const uint32_t operation_stats::contract_chunks;
+
+namespace
+{
+// only the writer thread modifies a counter, so it doesn't need an atomic read-modify-write
+void add(std::atomic<uint64_t> &counter, uint64_t value)
+{
+    counter.store(counter.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+}
+} // namespace
+
+void operation_stats::slot::record(uint64_t elapsed, bool failed, uint64_t undo)
+{
+    add(count, 1);
+    add(total_time, elapsed);
+    if (failed)
+        add(failures, 1);
+    add(undo_objects, undo);
+    if (elapsed > max_time.load(std::memory_order_relaxed))
+        max_time.store(elapsed, std::memory_order_relaxed);
+}
+
+operation_stats::operation_stats() : _operations(new slot[operation::count()])
+{
+    for (auto &chunk : _contracts)
+        chunk.store(nullptr, std::memory_order_relaxed);
+}
+
+operation_stats::~operation_stats()
+{
+    for (auto &chunk : _contracts)
+        delete[] chunk.load(std::memory_order_relaxed);
+}
+
+operation_stats::slot *operation_stats::contract_slot(uint64_t instance)
+{
+    if (instance >= uint64_t(contract_chunk_size) * contract_chunks)
+        return nullptr;
+    auto &chunk = _contracts[instance / contract_chunk_size];
+    slot *slots = chunk.load(std::memory_order_relaxed);
+    if (slots == nullptr)
+    {
+        slots = new slot[contract_chunk_size];
+        chunk.store(slots, std::memory_order_release);
+    }
+    return &slots[instance % contract_chunk_size];
+}
+
+void operation_stats::record(const operation &op, uint64_t elapsed, bool failed, uint64_t undo_objects)
+{
+    _operations[op.which()].record(elapsed, failed, undo_objects);
+    if (op.which() != operation::tag<call_contract_function_operation>::value)
+        return;
+    if (slot *contract = contract_slot(op.get<call_contract_function_operation>().contract_id.instance))
+        contract->record(elapsed, failed, undo_objects);
+}
+
+vector<operation_type_stats> operation_stats::get_operation_stats() const
+{
+    vector<operation_type_stats> result;
+    for (int which = 0; which < operation::count(); which++)
+    {
+        if (_operations[which].count.load(std::memory_order_relaxed) == 0)
+            continue;
+        operation_type_stats stats;
+        stats.which = which;
+        stats.name = operation_type_name(which);
+        fill(stats, _operations[which]);
+        result.push_back(stats);
+    }
+    return result;
+}
+
+vector<contract_call_stats> operation_stats::get_contract_stats(uint32_t limit) const
+{
+    vector<contract_call_stats> result;
+    for (uint32_t c = 0; c < contract_chunks; c++)
+    {
+        const slot *slots = _contracts[c].load(std::memory_order_acquire);
+        if (slots == nullptr)
+            continue;
+        for (uint32_t i = 0; i < contract_chunk_size; i++)
+        {
+            if (slots[i].count.load(std::memory_order_relaxed) == 0)
+                continue;
+            contract_call_stats stats;
+            stats.contract_id = contract_id_type(uint64_t(c) * contract_chunk_size + i);
+            fill(stats, slots[i]);
+            result.push_back(stats);
+        }
+    }
+    std::sort(result.begin(), result.end(), [](const contract_call_stats &a, const contract_call_stats &b) { return a.total_time > b.total_time; });
+    if (result.size() > limit)
+        result.resize(limit);
+    return result;
+}
+
+void operation_stats::on_applied_block(uint32_t block_num)
+{
+    if (_log_interval == 0 || block_num % _log_interval != 0)
+        return;
+    auto operations = get_operation_stats();
+    std::sort(operations.begin(), operations.end(), [](const operation_type_stats &a, const operation_type_stats &b) { return a.total_time > b.total_time; });
+    ilog("operation stats at block ${n}: ${operations}, top contracts: ${contracts}",
+         ("n", block_num)("operations", fc::json::to_string(operations))("contracts", fc::json::to_string(get_contract_stats(10))));
+}
+
+} // namespace chain
+} // namespace graphene
@@ -83,6 +83,50 @@ bool lua_scheduler::load_script_to_sandbox(string spacename, const char *script,
 	return sta ? false : true;
 }
 
+//reset_sandbox_data:一次性为沙盒写入固定的数据表布局(_G保护标记、private_data/public_data及read_list/write_list)
+//代替逐个writeVariable，避免每次调用都经过通用的模板写入路径
+bool lua_scheduler::reset_sandbox_data(string spacename)
+{
+	lua_getglobal(mState, spacename.data());
+	if (!lua_istable(mState, -1))
+	{
+		lua_pop(mState, 1);
+		return false;
+	}
+	lua_pushstring(mState, "protected");
+	lua_setfield(mState, -2, "_G");
+	lua_createtable(mState, 0, 0);
+	lua_setfield(mState, -2, "private_data");
+	lua_createtable(mState, 0, 0);
+	lua_setfield(mState, -2, "public_data");
+	static const char *list_names[] = {"read_list", "write_list"};
+	for (auto list_name : list_names)
+	{
+		lua_createtable(mState, 0, 2);
+		lua_createtable(mState, 0, 0);
+		lua_setfield(mState, -2, "private_data");
+		lua_createtable(mState, 0, 0);
+		lua_setfield(mState, -2, "public_data");
+		lua_setfield(mState, -2, list_name);
+	}
+	lua_pop(mState, 1);
+	return true;
+}
+
+void lua_scheduler::set_registry_pointer(const char *key, void *pointer)
+{
+	lua_pushlightuserdata(mState, pointer);
+	lua_setfield(mState, LUA_REGISTRYINDEX, key);
+}
+
+void *lua_scheduler::get_registry_pointer(lua_State *L, const char *key)
+{
+	lua_getfield(L, LUA_REGISTRYINDEX, key);
+	void *pointer = lua_touserdata(L, -1);
+	lua_pop(L, 1);
+	return pointer;
+}
+
 bool lua_scheduler::get_function(string spacename, string func)
 {
 	lua_getglobal(mState, spacename.data());
@@ -27,6 +27,8 @@
 #include <fc/bitutil.hpp>
 #include <fc/smart_ref_impl.hpp>
 #include <algorithm>
+#include <array>
+#include <mutex>
 #include <graphene/chain/database.hpp>
 
 namespace graphene
@@ -120,6 +122,30 @@ void transaction::get_required_authorities(flat_set<account_id_type> &active, fl
             operation_get_required_authorities(op, active, owner, other);
 }
 
+/**
+ * The addresses an address authority may name a key by. They only depend on the key, so they are
+ * remembered across transactions instead of hashed again for every sign_state.
+ */
+static std::array<address, 5> get_key_addresses(const public_key_type &key)
+{
+      static std::mutex cache_mutex;
+      static std::map<public_key_type, std::array<address, 5>> cache;
+      {
+            std::lock_guard<std::mutex> lock(cache_mutex);
+            auto itr = cache.find(key);
+            if (itr != cache.end())
+                  return itr->second;
+      }
+      std::array<address, 5> addresses = {{address(pts_address(key, false, 56)), address(pts_address(key, true, 56)),
+                                           address(pts_address(key, false, 0)), address(pts_address(key, true, 0)),
+                                           address(key)}};
+      std::lock_guard<std::mutex> lock(cache_mutex);
+      if (cache.size() >= GRAPHENE_MAX_CACHED_KEY_ADDRESSES)
+            cache.clear();
+      cache.emplace(key, addresses);
+      return addresses;
+}
+
 struct sign_state
 {
       /** returns true if we have a signature for this key or can 
@@ -152,21 +178,11 @@ struct sign_state
                   available_address_sigs = std::map<address, public_key_type>();
                   provided_address_sigs = std::map<address, public_key_type>();
                   for (auto &item : available_keys)
-                  {
-                        (*available_address_sigs)[address(pts_address(item, false, 56))] = item;
-                        (*available_address_sigs)[address(pts_address(item, true, 56))] = item;
-                        (*available_address_sigs)[address(pts_address(item, false, 0))] = item;
-                        (*available_address_sigs)[address(pts_address(item, true, 0))] = item;
-                        (*available_address_sigs)[address(item)] = item;
-                  }
+                        for (const auto &addr : get_key_addresses(item))
+                              (*available_address_sigs)[addr] = item;
                   for (auto &item : provided_signatures)
-                  {
-                        (*provided_address_sigs)[address(pts_address(item.first, false, 56))] = item.first;
-                        (*provided_address_sigs)[address(pts_address(item.first, true, 56))] = item.first;
-                        (*provided_address_sigs)[address(pts_address(item.first, false, 0))] = item.first;
-                        (*provided_address_sigs)[address(pts_address(item.first, true, 0))] = item.first;
-                        (*provided_address_sigs)[address(item.first)] = item.first;
-                  }
+                        for (const auto &addr : get_key_addresses(item.first))
+                              (*provided_address_sigs)[addr] = item.first;
             }
             auto itr = provided_address_sigs->find(a);
             if (itr == provided_address_sigs->end())
@@ -179,6 +195,7 @@ struct sign_state
                               return provided_signatures[aitr->second] = true;
                         return false;
                   }
+                  return false;
             }
             return provided_signatures[itr->second] = true;
       }
@@ -0,0 +1,124 @@
+#include <graphene/chain/transaction_prevalidator.hpp>
+#include <graphene/chain/config.hpp>
+#include <graphene/chain/protocol/protocol.hpp>
+
+namespace graphene
+{
+namespace chain
+{
+
+template <typename Check>
+static void check_or_count(std::atomic<uint64_t> &rejected, Check &&check)
+{
+    try
+    {
+        check();
+    }
+    catch (const fc::exception &)
+    {
+        ++rejected;
+        throw;
+    }
+}
+
+std::shared_ptr<const prepared_transaction> transaction_prevalidator::prevalidate(const signed_transaction &trx)
+{
+    auto prepared = std::make_shared<prepared_transaction>();
+    if (_pool.get_thread_count() == 0)
+        check(trx, *prepared);
+    else
+    {
+        // waiting yields, so the p2p thread goes on serving other peers and their transactions are checked on
+        // the pool at the same time; the task owns a copy in case this wait is canceled before it finishes
+        auto copy = std::make_shared<signed_transaction>(trx);
+        _pool.schedule([this, copy, prepared]() { check(*copy, *prepared); }).wait();
+    }
+    prepared->trx = &trx;
+    ++_accepted;
+    return prepared;
+}
+
+void transaction_prevalidator::check(const signed_transaction &trx, prepared_transaction &prepared)
+{
+    prepared.hash = trx.hash();
+    prepared.packed_size = fc::raw::pack_size(trx);
+
+    chain_snapshot snapshot;
+    bool have_snapshot;
+    uint32_t tapos_prefix;
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        check_or_count(_rejected[duplicate], [&]() {
+            FC_ASSERT(_recent.get<by_hash>().find(prepared.hash) == _recent.get<by_hash>().end(), "duplicate transaction");
+        });
+        snapshot = _snapshot;
+        have_snapshot = _have_snapshot;
+        tapos_prefix = _tapos_prefixes[trx.ref_block_num];
+    }
+
+    check_or_count(_rejected[invalid], [&]() { trx.validate(); });
+    prepared.validated = true;
+
+    // the same exemptions _apply_transaction makes
+    const bool share_fee = trx.operations[0].which() == operation::tag<contract_share_fee_operation>::value;
+    const bool agreed_task = trx.agreed_task.valid();
+    if (!have_snapshot)
+        return;
+
+    check_or_count(_rejected[oversized], [&]() {
+        FC_ASSERT(prepared.packed_size < snapshot.maximum_transaction_size, "transaction too large",
+                  ("size", prepared.packed_size)("max", snapshot.maximum_transaction_size));
+    });
+    if (!share_fee && !agreed_task)
+        check_or_count(_rejected[bad_signature], [&]() { prepared.signature_keys = trx.get_signature_keys(snapshot.chain_id); });
+    if (snapshot.head_block_num > 0 && !agreed_task)
+    {
+        check_or_count(_rejected[expired], [&]() {
+            FC_ASSERT(trx.expiration <= snapshot.head_block_time + snapshot.maximum_time_until_expiration, "",
+                      ("trx.expiration", trx.expiration)("now", snapshot.head_block_time)("max_til_exp", snapshot.maximum_time_until_expiration));
+            FC_ASSERT(snapshot.head_block_time <= trx.expiration, "", ("now", snapshot.head_block_time)("trx.exp", trx.expiration));
+        });
+        // a zero prefix means we have not applied a block at that number since startup
+        if (!share_fee && tapos_prefix != 0)
+            check_or_count(_rejected[tapos_mismatch], [&]() { FC_ASSERT(trx.ref_block_prefix == tapos_prefix, "TaPoS mismatch"); });
+    }
+}
+
+void transaction_prevalidator::on_pushed(const prepared_transaction &prepared)
+{
+    // _apply_transaction does not treat contract fee sharing transactions as duplicates either
+    if (prepared.trx->operations[0].which() == operation::tag<contract_share_fee_operation>::value)
+        return;
+    std::lock_guard<std::mutex> lock(_mutex);
+    _recent.insert(recent_transaction{prepared.hash, prepared.trx->expiration});
+    auto &by_expiration_idx = _recent.get<by_expiration>();
+    while (_recent.size() > GRAPHENE_MAX_PREVALIDATED_TRANSACTIONS)
+        by_expiration_idx.erase(by_expiration_idx.begin());
+}
+
+void transaction_prevalidator::on_applied_block(const chain_snapshot &snapshot)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    _snapshot = snapshot;
+    _have_snapshot = true;
+    _tapos_prefixes[snapshot.head_block_num & 0xffff] = snapshot.head_block_id._hash[1];
+    auto &by_expiration_idx = _recent.get<by_expiration>();
+    by_expiration_idx.erase(by_expiration_idx.begin(), by_expiration_idx.lower_bound(snapshot.head_block_time));
+}
+
+fc::variant_object transaction_prevalidator::get_statistics() const
+{
+    fc::mutable_variant_object rejected;
+    for (int reason = 0; reason < reject_reason_count; reason++)
+        rejected[fc::reflector<reject_reason>::to_string(reason)] = _rejected[reason].load();
+
+    fc::mutable_variant_object result;
+    result["accepted"] = _accepted.load();
+    result["rejected"] = rejected;
+    std::lock_guard<std::mutex> lock(_mutex);
+    result["recent_transactions"] = _recent.size();
+    return result;
+}
+
+} // namespace chain
+} // namespace graphene
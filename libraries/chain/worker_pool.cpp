@@ -0,0 +1,64 @@
+#include <graphene/chain/worker_pool.hpp>
+#include <algorithm>
+#include <condition_variable>
+#include <mutex>
+
+namespace graphene
+{
+namespace chain
+{
+
+worker_pool::~worker_pool()
+{
+    set_thread_count(0);
+}
+
+void worker_pool::set_thread_count(uint32_t thread_count)
+{
+    while (_threads.size() > thread_count)
+    {
+        _threads.back()->quit();
+        _threads.pop_back();
+    }
+    while (_threads.size() < thread_count)
+        _threads.emplace_back(new fc::thread("chain_worker_" + std::to_string(_threads.size())));
+}
+
+void worker_pool::for_each(size_t count, const std::function<void(size_t)> &work, size_t min_chunk)
+{
+    const size_t chunks = std::min<size_t>(_threads.size() + 1, std::max<size_t>(count / std::max<size_t>(min_chunk, 1), 1));
+    const size_t chunk_size = (count + chunks - 1) / std::max<size_t>(chunks, 1);
+
+    // chunk 0 runs here while the others run on the pool. The wait below blocks the calling thread instead
+    // of yielding to its other fc tasks, callers may be in the middle of applying a block
+    std::mutex mutex;
+    std::condition_variable finished;
+    size_t pending = 0;
+    for (size_t chunk = 1; chunk < chunks; chunk++)
+    {
+        const size_t begin = chunk * chunk_size, end = std::min(count, begin + chunk_size);
+        if (begin >= end)
+            break;
+        ++pending;
+        _threads[chunk - 1]->async([&work, &mutex, &finished, &pending, begin, end]() {
+            for (size_t i = begin; i < end; i++)
+                work(i);
+            std::lock_guard<std::mutex> lock(mutex);
+            if (--pending == 0)
+                finished.notify_one();
+        }, "worker_pool_chunk");
+    }
+    for (size_t i = 0; i < std::min(count, chunk_size); i++)
+        work(i);
+    std::unique_lock<std::mutex> lock(mutex);
+    finished.wait(lock, [&pending]() { return pending == 0; });
+}
+
+fc::future<void> worker_pool::schedule(std::function<void()> work)
+{
+    FC_ASSERT(!_threads.empty(), "the worker pool has no threads");
+    return _threads[_next_thread++ % _threads.size()]->async(std::move(work), "worker_pool_schedule");
+}
+
+} // namespace chain
+} // namespace graphene
@@ -268,6 +268,16 @@ namespace graphene { namespace db {
          }
 
 
+         /** used by undo to restore removed objects, which observers must see just like new ones */
+         virtual const object&  insert( object&& obj )override
+         {
+            const auto& result = DerivedIndex::insert( std::move(obj) );
+            for( const auto& item : _sindex )
+               item->object_inserted( result );
+            on_add( result );
+            return result;
+         }
+
          virtual const object&  create(const std::function<void(object&)>& constructor )override
          {
             const auto& result = DerivedIndex::create( constructor );   //调用对应类型的create 函数
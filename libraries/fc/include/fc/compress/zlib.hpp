@@ -6,5 +6,7 @@ namespace fc
 {
 
   string zlib_compress(const string& in);
+  /// throws if the stream is corrupt or truncated
+  string zlib_decompress(const string& in);
 
 } // namespace fc
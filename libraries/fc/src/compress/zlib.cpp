@@ -1,4 +1,7 @@
 #include <fc/compress/zlib.hpp>
+#include <fc/exception/exception.hpp>
+
+#include <vector>
 
 #include "miniz.c"
 
@@ -12,4 +15,26 @@ namespace fc
     free(compressed_message);
     return result;
   }
+
+  string zlib_decompress(const string& in)
+  {
+    tinfl_decompressor decompressor;
+    tinfl_init(&decompressor);
+    std::vector<mz_uint8> dict(TINFL_LZ_DICT_SIZE);
+    string result;
+    size_t in_ofs = 0, dict_ofs = 0;
+    for (;;)
+    {
+      size_t in_size = in.size() - in_ofs, out_size = TINFL_LZ_DICT_SIZE - dict_ofs;
+      // claiming there is more input makes a truncated stream fail instead of being padded with zeros
+      tinfl_status status = tinfl_decompress(&decompressor, (const mz_uint8*)in.data() + in_ofs, &in_size, dict.data(), dict.data() + dict_ofs, &out_size,
+                                             TINFL_FLAG_PARSE_ZLIB_HEADER | TINFL_FLAG_HAS_MORE_INPUT);
+      in_ofs += in_size;
+      result.append((const char*)dict.data() + dict_ofs, out_size);
+      dict_ofs = (dict_ofs + out_size) & (TINFL_LZ_DICT_SIZE - 1);
+      if (status == TINFL_STATUS_DONE)
+        return result;
+      FC_ASSERT(status == TINFL_STATUS_HAS_MORE_OUTPUT, "corrupt zlib stream", ("status", (int)status)("size", in.size()));
+    }
+  }
 }
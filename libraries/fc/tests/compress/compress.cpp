@@ -39,29 +39,6 @@ BOOST_AUTO_TEST_CASE(smaz_test)
 }
 
 
-extern "C" {
-
-enum
-{
-  TINFL_FLAG_PARSE_ZLIB_HEADER = 1,
-  TINFL_FLAG_HAS_MORE_INPUT = 2,
-  TINFL_FLAG_USING_NON_WRAPPING_OUTPUT_BUF = 4,
-  TINFL_FLAG_COMPUTE_ADLER32 = 8
-};
-
-extern char* tinfl_decompress_mem_to_heap(const void *pSrc_buf, size_t src_buf_len, size_t *pOut_len, int flags);
-
-}
-
-static std::string zlib_decompress( const std::string compressed )
-{
-    size_t decomp_len;
-    char* decomp = tinfl_decompress_mem_to_heap( compressed.c_str(), compressed.length(), &decomp_len, TINFL_FLAG_PARSE_ZLIB_HEADER );
-    std::string result( decomp, decomp_len );
-    free( decomp );
-    return result;
-}
-
 BOOST_AUTO_TEST_CASE(zlib_test)
 {
     std::ifstream testfile;
@@ -74,7 +51,7 @@ BOOST_AUTO_TEST_CASE(zlib_test)
     {
         buffer << line << "\n";
         std::string compressed = fc::zlib_compress( line );
-        std::string decomp = zlib_decompress( compressed );
+        std::string decomp = fc::zlib_decompress( compressed );
         BOOST_CHECK_EQUAL( decomp, line );
 
         std::getline( testfile, line );
@@ -82,8 +59,16 @@ BOOST_AUTO_TEST_CASE(zlib_test)
 
     line = buffer.str();
     std::string compressed = fc::zlib_compress( line );
-    std::string decomp = zlib_decompress( compressed );
+    std::string decomp = fc::zlib_decompress( compressed );
     BOOST_CHECK_EQUAL( decomp, line );
+
+    // an empty string round trips, while a damaged or truncated stream is reported
+    BOOST_CHECK_EQUAL( fc::zlib_decompress( fc::zlib_compress( std::string() ) ), std::string() );
+    std::string damaged = compressed;
+    damaged[damaged.size() / 2] ^= 0x55;
+    BOOST_CHECK_THROW( fc::zlib_decompress( damaged ), fc::exception );
+    BOOST_CHECK_THROW( fc::zlib_decompress( compressed.substr( 0, compressed.size() / 2 ) ), fc::exception );
+    BOOST_CHECK_THROW( fc::zlib_decompress( std::string() ), fc::exception );
 }
 
 BOOST_AUTO_TEST_SUITE_END()
@@ -28,5 +28,8 @@ LUAI_FUNC LClosure* luaU_undump (lua_State* L, ZIO* Z, const char* name);
 /* dump one chunk; from ldump.c */
 LUAI_FUNC int luaU_dump (lua_State* L, const Proto* f, lua_Writer w,
                          void* data, int strip);
+/* dump one chunk without the source of its main function; from ldump.c */
+LUAI_FUNC int luaU_dump_unnamed (lua_State* L, const Proto* f, lua_Writer w,
+                                 void* data);
 
 #endif
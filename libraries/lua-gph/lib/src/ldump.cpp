@@ -196,11 +196,8 @@ static void DumpHeader (DumpState *D) {
 }
 
 
-/*
-** dump Lua function as precompiled chunk
-*/
-int luaU_dump(lua_State *L, const Proto *f, lua_Writer w, void *data,
-              int strip) {
+static int DumpChunk (lua_State *L, const Proto *f, lua_Writer w, void *data,
+                      int strip, TString *psource) {
   DumpState D;
   D.L = L;
   D.writer = w;
@@ -209,7 +206,25 @@ int luaU_dump(lua_State *L, const Proto *f, lua_Writer w, void *data,
   D.status = 0;
   DumpHeader(&D);
   DumpByte(f->sizeupvalues, &D);
-  DumpFunction(f, NULL, &D);
+  DumpFunction(f, psource, &D);
   return D.status;
 }
 
+
+/*
+** dump Lua function as precompiled chunk
+*/
+int luaU_dump(lua_State *L, const Proto *f, lua_Writer w, void *data,
+              int strip) {
+  return DumpChunk(L, f, w, data, strip, NULL);
+}
+
+
+/*
+** dump Lua function as precompiled chunk with all debug information but
+** the source of the main function, which loading takes from the chunk name
+*/
+int luaU_dump_unnamed(lua_State *L, const Proto *f, lua_Writer w, void *data) {
+  return DumpChunk(L, f, w, data, 0, f->source);
+}
+
@@ -271,7 +271,10 @@ LClosure *luaU_undump(lua_State *L, ZIO *Z, const char *name) {
   setclLvalue(L, L->top, cl);
   luaD_inctop(L);
   cl->p = luaF_newproto(L);
-  LoadFunction(&S, cl->p, NULL);
+  /* a main function dumped without its source takes the chunk name; the
+     proto keeps the name alive until LoadFunction sets the source */
+  cl->p->source = luaS_new(L, name);
+  LoadFunction(&S, cl->p, cl->p->source);
   lua_assert(cl->nupvalues == cl->p->sizeupvalues);
   luai_verifycode(L, buff, cl->p);
   return cl;
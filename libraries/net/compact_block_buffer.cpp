@@ -0,0 +1,69 @@
+#include <graphene/net/compact_block_buffer.hpp>
+
+namespace graphene { namespace net {
+
+  compact_block_buffer::compact_block_buffer(size_t max_blocks_per_peer, size_t max_blocks) :
+    _max_blocks_per_peer(max_blocks_per_peer),
+    _max_blocks(max_blocks)
+  {}
+
+  void compact_block_buffer::insert(incomplete_compact_block&& block)
+  {
+    _blocks.erase(block.block_message.block_id);
+    if (count_for_peer(block.peer_node_id) >= _max_blocks_per_peer)
+      erase_oldest(&block.peer_node_id);
+    if (_blocks.size() >= _max_blocks)
+      erase_oldest(nullptr);
+    block_id_type block_id = block.block_message.block_id;
+    _blocks.emplace(block_id, std::move(block));
+  }
+
+  fc::optional<incomplete_compact_block> compact_block_buffer::take(const block_id_type& block_id, const node_id_t& peer_node_id)
+  {
+    auto iter = _blocks.find(block_id);
+    if (iter == _blocks.end() || iter->second.peer_node_id != peer_node_id)
+      return fc::optional<incomplete_compact_block>();
+    fc::optional<incomplete_compact_block> block(std::move(iter->second));
+    _blocks.erase(iter);
+    return block;
+  }
+
+  void compact_block_buffer::expire(const fc::time_point& oldest_time)
+  {
+    for (auto iter = _blocks.begin(); iter != _blocks.end();)
+      if (iter->second.received_time < oldest_time)
+        iter = _blocks.erase(iter);
+      else
+        ++iter;
+  }
+
+  void compact_block_buffer::remove_peer(const node_id_t& peer_node_id)
+  {
+    for (auto iter = _blocks.begin(); iter != _blocks.end();)
+      if (iter->second.peer_node_id == peer_node_id)
+        iter = _blocks.erase(iter);
+      else
+        ++iter;
+  }
+
+  size_t compact_block_buffer::count_for_peer(const node_id_t& peer_node_id) const
+  {
+    size_t count = 0;
+    for (const auto& item : _blocks)
+      if (item.second.peer_node_id == peer_node_id)
+        ++count;
+    return count;
+  }
+
+  void compact_block_buffer::erase_oldest(const node_id_t* peer_node_id)
+  {
+    auto oldest = _blocks.end();
+    for (auto iter = _blocks.begin(); iter != _blocks.end(); ++iter)
+      if ((!peer_node_id || iter->second.peer_node_id == *peer_node_id) &&
+          (oldest == _blocks.end() || iter->second.received_time < oldest->second.received_time))
+        oldest = iter;
+    if (oldest != _blocks.end())
+      _blocks.erase(oldest);
+  }
+
+} } // graphene::net
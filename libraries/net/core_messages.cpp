@@ -46,6 +46,19 @@ namespace graphene { namespace net {
   const core_message_type_enum check_firewall_reply_message::type            = core_message_type_enum::check_firewall_reply_message_type;
   const core_message_type_enum get_current_connections_request_message::type = core_message_type_enum::get_current_connections_request_message_type;
   const core_message_type_enum get_current_connections_reply_message::type   = core_message_type_enum::get_current_connections_reply_message_type;
+  const core_message_type_enum compact_block_message::type                   = core_message_type_enum::compact_block_message_type;
+  const core_message_type_enum fetch_compact_block_transactions_message::type = core_message_type_enum::fetch_compact_block_transactions_message_type;
+  const core_message_type_enum compact_block_transactions_message::type      = core_message_type_enum::compact_block_transactions_message_type;
+
+  compact_block_message::compact_block_message(const signed_block& blk, const item_hash_t& message_hash) :
+    header(blk),
+    block_id(blk.block_id),
+    message_hash(message_hash)
+  {
+    transactions.reserve(blk.transactions.size());
+    for (const auto& trx : blk.transactions)
+      transactions.push_back(compact_block_transaction{trx.second.id(trx.first), trx.second.operation_results});
+  }
 
 } } // graphene::net
 
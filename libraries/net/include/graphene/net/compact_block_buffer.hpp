@@ -0,0 +1,52 @@
+#pragma once
+#include <graphene/net/core_messages.hpp>
+#include <fc/optional.hpp>
+#include <fc/time.hpp>
+
+#include <unordered_map>
+#include <vector>
+
+namespace graphene { namespace net {
+
+  /// a compact block waiting for the transactions we didn't have in the message cache
+  struct incomplete_compact_block
+  {
+    node_id_t                    peer_node_id;
+    graphene::net::block_message block_message;
+    std::vector<uint32_t>        missing_indexes;
+    bool                         requested_all_transactions = false;
+    fc::time_point               received_time;
+  };
+
+  /**
+   * The compact blocks a node is completing, bounded per peer and overall so a peer can't make it
+   * grow without limit.  When a bound is reached the oldest block (of the peer, or of all peers)
+   * makes room; the block itself is then fetched again like any timed out item.
+   */
+  class compact_block_buffer
+  {
+  public:
+    compact_block_buffer(size_t max_blocks_per_peer, size_t max_blocks);
+
+    /// replaces a block with the same id
+    void insert(incomplete_compact_block&& block);
+    /// remove and return the block, if it is waiting for transactions from the given peer
+    fc::optional<incomplete_compact_block> take(const block_id_type& block_id, const node_id_t& peer_node_id);
+    /// drop blocks received before oldest_time
+    void expire(const fc::time_point& oldest_time);
+    void remove_peer(const node_id_t& peer_node_id);
+
+    size_t size() const { return _blocks.size(); }
+    size_t count_for_peer(const node_id_t& peer_node_id) const;
+
+  private:
+    typedef std::unordered_map<block_id_type, incomplete_compact_block> block_map;
+    /// the oldest block of the given peer, or of all peers when null
+    void erase_oldest(const node_id_t* peer_node_id);
+
+    size_t    _max_blocks_per_peer;
+    size_t    _max_blocks;
+    block_map _blocks;
+  };
+
+} } // graphene::net
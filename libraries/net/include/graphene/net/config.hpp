@@ -39,6 +39,12 @@
 #define MAX_MESSAGE_SIZE                                     1024*1024*2
 #define GRAPHENE_NET_DEFAULT_PEER_CONNECTION_RETRY_TIME      30 // seconds
 
+/**
+ * Number of potential peers remembered in the peer database, the least
+ * preferred ones are dropped beyond that
+ */
+#define GRAPHENE_NET_MAXIMUM_PEERDB_SIZE                     1000
+
 /**
  * AFter trying all peers, how long to wait before we check to
  * see if there are peers we can try again.
@@ -84,6 +90,23 @@
 
 #define GRAPHENE_NET_MAX_BLOCKS_PER_PEER_DURING_SYNCING      200
 
+/**
+ * During sync, each peer is handed a contiguous range of blocks sized so that,
+ * at the throughput we measured for that peer, it takes about
+ * GRAPHENE_NET_SYNC_RANGE_TARGET_SECONDS to deliver.  Ranges never drop below
+ * GRAPHENE_NET_MIN_BLOCKS_PER_PEER_DURING_SYNCING (also used for peers we have
+ * not measured yet) nor exceed the maximum above.
+ */
+#define GRAPHENE_NET_MIN_BLOCKS_PER_PEER_DURING_SYNCING      20
+#define GRAPHENE_NET_SYNC_RANGE_TARGET_SECONDS               2
+
+/**
+ * If a peer delivers nothing from its sync range for this long, the rest of
+ * the range is handed to other peers.  A peer that still makes no progress
+ * after ten times as long is disconnected.
+ */
+#define GRAPHENE_NET_SYNC_RANGE_STALL_TIMEOUT_MS             2000
+
 /**
  * During normal operation, how many items will be fetched from each
  * peer at a time.  This will only come into play when the network
@@ -95,7 +118,21 @@
  * parameter, so consider increasing or decreasing it if performance
  * during flooding is lacking.
  */
-#define GRAPHENE_NET_MAX_ITEMS_PER_PEER_DURING_NORMAL_OPERATION  1 
+#define GRAPHENE_NET_MAX_ITEMS_PER_PEER_DURING_NORMAL_OPERATION  100
+
+/**
+ * When only transactions are waiting to be advertised, the inventory loop waits
+ * this long so a burst of transactions goes out as one inventory message per
+ * peer.  Blocks are advertised immediately.
+ */
+#define GRAPHENE_NET_INVENTORY_BATCH_INTERVAL_MS             50
+
+/**
+ * Number of items each of the two generations of a peer's known item filter
+ * holds, and the false positive rate it is sized for
+ */
+#define GRAPHENE_NET_KNOWN_ITEM_FILTER_SIZE                  20000
+#define GRAPHENE_NET_KNOWN_ITEM_FILTER_FALSE_POSITIVE_RATE   0.00001
 
 /**
  * Instead of fetching all item IDs from a peer, then fetching all blocks
@@ -106,3 +143,23 @@
 #define GRAPHENE_NET_MIN_BLOCK_IDS_TO_PREFETCH               10000
 
 #define GRAPHENE_NET_MAX_TRX_PER_SECOND                      1000
+
+/**
+ * Number of threads that read, decrypt and reassemble messages for peer
+ * connections (and encrypt outgoing ones), taking that work off the p2p
+ * thread.  0 does all connection I/O on the p2p thread
+ */
+#define GRAPHENE_NET_DEFAULT_IO_THREADS                      2
+
+/**
+ * How long we wait for the missing transactions of a compact block before
+ * dropping it; the block is then fetched again like any timed out item
+ */
+#define GRAPHENE_NET_COMPACT_BLOCK_TIMEOUT_SECONDS           30
+
+/**
+ * How many compact blocks may wait for their missing transactions, from one
+ * peer and from all peers together; the oldest one makes room for a new one
+ */
+#define GRAPHENE_NET_MAX_INCOMPLETE_COMPACT_BLOCKS_PER_PEER  4
+#define GRAPHENE_NET_MAX_INCOMPLETE_COMPACT_BLOCKS           64
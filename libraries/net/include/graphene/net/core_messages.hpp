@@ -37,14 +37,19 @@
 #include <fc/io/enum_type.hpp>
 
 
+#include <memory>
 #include <vector>
 #include <fc/log/logger.hpp>   //nico add
 
+namespace graphene { namespace chain { struct prepared_transaction; } }
+
 namespace graphene { namespace net {
   using graphene::chain::signed_transaction;
   using graphene::chain::block_id_type;
   using graphene::chain::transaction_id_type;
   using graphene::chain::signed_block;
+  using graphene::chain::signed_block_header;
+  using graphene::chain::operation_result;
 
   typedef fc::ecc::public_key_data node_id_t;
   typedef fc::ripemd160 item_hash_t;
@@ -88,6 +93,9 @@ namespace graphene { namespace net {
     check_firewall_reply_message_type            = 5015,
     get_current_connections_request_message_type = 5016,
     get_current_connections_reply_message_type   = 5017,
+    compact_block_message_type                   = 5018,
+    fetch_compact_block_transactions_message_type = 5019,
+    compact_block_transactions_message_type      = 5020,
     core_message_type_last                       = 5099
   };
 
@@ -98,6 +106,8 @@ namespace graphene { namespace net {
       static const core_message_type_enum type;
 
       signed_transaction trx;
+      /// what node_delegate::prevalidate_transaction worked out for trx, handed on to handle_transaction; never sent
+      mutable std::shared_ptr<const graphene::chain::prepared_transaction> prevalidated;
       trx_message() {}
       trx_message(signed_transaction transaction) :
         trx(std::move(transaction))
@@ -130,6 +140,55 @@ namespace graphene { namespace net {
 
    };
 
+   /**
+    * A block with its transactions replaced by their ids (the first 160 bits of the transaction hash),
+    * sent in reply to a block fetch to peers that announced compact block support in their hello.
+    * Operation results are produced by the block's witness and can't be recomputed by the receiver,
+    * so they travel with the block.
+    */
+   struct compact_block_transaction
+   {
+      transaction_id_type            short_id;
+      std::vector<operation_result>  operation_results;
+   };
+
+   struct compact_block_message
+   {
+      static const core_message_type_enum type;
+
+      compact_block_message(){}
+      compact_block_message(const signed_block& blk, const item_hash_t& message_hash);
+
+      signed_block_header                     header;
+      block_id_type                           block_id;
+      item_hash_t                             message_hash; ///< of the full block message, the item the receiver asked for
+      std::vector<compact_block_transaction>  transactions;
+   };
+
+   /// request for the transactions of a compact block that the receiver couldn't find locally
+   struct fetch_compact_block_transactions_message
+   {
+      static const core_message_type_enum type;
+
+      block_id_type          block_id;
+      std::vector<uint32_t>  indexes;
+
+      fetch_compact_block_transactions_message(){}
+      fetch_compact_block_transactions_message(const block_id_type& block_id, const std::vector<uint32_t>& indexes) :
+        block_id(block_id),
+        indexes(indexes)
+      {}
+   };
+
+   struct compact_block_transactions_message
+   {
+      static const core_message_type_enum type;
+
+      block_id_type                    block_id;
+      std::vector<uint32_t>            indexes;
+      std::vector<signed_transaction>  transactions;
+   };
+
   struct item_ids_inventory_message
   {
     static const core_message_type_enum type;
@@ -443,11 +502,18 @@ FC_REFLECT_ENUM( graphene::net::core_message_type_enum,
                  (check_firewall_reply_message_type)
                  (get_current_connections_request_message_type)
                  (get_current_connections_reply_message_type)
+                 (compact_block_message_type)
+                 (fetch_compact_block_transactions_message_type)
+                 (compact_block_transactions_message_type)
                  (core_message_type_last) )
 
 FC_REFLECT( graphene::net::trx_message, (trx) )
 FC_REFLECT( graphene::net::my_test_message, (test_data) )
 FC_REFLECT( graphene::net::block_message, (block)(block_id) )
+FC_REFLECT( graphene::net::compact_block_transaction, (short_id)(operation_results) )
+FC_REFLECT( graphene::net::compact_block_message, (header)(block_id)(message_hash)(transactions) )
+FC_REFLECT( graphene::net::fetch_compact_block_transactions_message, (block_id)(indexes) )
+FC_REFLECT( graphene::net::compact_block_transactions_message, (block_id)(indexes)(transactions) )
 
 FC_REFLECT( graphene::net::item_id, (item_type)
                                (item_hash) )
@@ -0,0 +1,42 @@
+#pragma once
+#include <fc/thread/thread.hpp>
+
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace graphene { namespace net {
+
+  /**
+   * Threads that run the socket side of connections: reads, stcp decryption and encryption, and
+   * message reassembly.  A node owns its pool and each connection it opens is pinned to one of the
+   * threads, keeping the pool alive until the connection is destroyed; the threads are joined once
+   * the node and all of its connections are gone.
+   */
+  class io_thread_pool
+  {
+  public:
+    explicit io_thread_pool(uint32_t thread_count);
+    ~io_thread_pool();
+
+    /// connections opened from now on spread over thread_count threads, 0 keeps their I/O on the owning thread
+    void set_thread_count(uint32_t thread_count);
+    uint32_t get_thread_count() const;
+
+    /// the thread for a new connection, null when it should do its I/O on the thread that owns it
+    fc::thread* acquire_thread();
+    /// a connection given a thread by acquire_thread() is gone
+    void release_thread();
+    /// connections currently doing their I/O on one of our threads
+    uint32_t get_connection_count() const;
+
+  private:
+    mutable std::mutex _mutex;
+    std::vector<std::unique_ptr<fc::thread>> _threads;
+    uint32_t _thread_count = 0;
+    uint32_t _next_thread = 0;
+    uint32_t _connection_count = 0;
+  };
+  typedef std::shared_ptr<io_thread_pool> io_thread_pool_ptr;
+
+} } // graphene::net
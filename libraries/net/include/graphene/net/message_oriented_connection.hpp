@@ -24,6 +24,7 @@
 #pragma once
 #include <fc/network/tcp_socket.hpp>
 #include <graphene/net/message.hpp>
+#include <graphene/net/io_thread_pool.hpp>
 
 namespace graphene { namespace net {
 
@@ -43,7 +44,9 @@ namespace graphene { namespace net {
   class message_oriented_connection
   {
      public:
-       message_oriented_connection(message_oriented_connection_delegate* delegate = nullptr);
+       /// with an io_threads pool the socket I/O runs on one of its threads, otherwise on the thread creating the connection
+       message_oriented_connection(message_oriented_connection_delegate* delegate = nullptr,
+                                   const io_thread_pool_ptr& io_threads = io_thread_pool_ptr());
        ~message_oriented_connection();
        fc::tcp_socket& get_socket();
 
@@ -60,6 +63,10 @@ namespace graphene { namespace net {
        fc::time_point get_last_message_sent_time() const;
        fc::time_point get_last_message_received_time() const;
        fc::time_point get_connection_time() const;
+       /// time it took to read and decrypt the message currently being delivered, after its header arrived
+       fc::microseconds get_last_message_decode_time() const;
+       /// time the message currently being delivered waited between being decoded and being delivered
+       fc::microseconds get_last_message_queue_wait() const;
        fc::sha512     get_shared_secret() const;
      private:
        std::unique_ptr<detail::message_oriented_connection_impl> my;
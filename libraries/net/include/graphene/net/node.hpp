@@ -88,6 +88,15 @@ namespace graphene { namespace net {
           */
          virtual void handle_transaction( const graphene::net::trx_message& trx_msg ) = 0;
 
+         /**
+          *  @brief Called on the p2p thread before handle_transaction, for checks that do not
+          *         need the thread handle_transaction runs on; results may be left in
+          *         trx_msg.prevalidated for the handle_transaction call on the same message
+          *
+          *  @throws exception to reject the transaction without passing it to handle_transaction
+          */
+         virtual void prevalidate_transaction( const graphene::net::trx_message& trx_msg ) {}
+
          /**
           *  @brief Called when a new message comes in from the network other than a
           *         block or a transaction.  Currently there are no other possible 
@@ -284,6 +293,11 @@ namespace graphene { namespace net {
          */
         void clear_peer_database();
 
+        /**
+         * Limits the bandwidth used by all connections together.  Limited connections do their I/O on the
+         * p2p thread, so a limit can't be set while connections use the I/O threads (see the io_threads
+         * advanced node parameter); setting one stops new connections from using them.
+         */
         void set_total_bandwidth_limit(uint32_t upload_bytes_per_second, uint32_t download_bytes_per_second);
 
         fc::variant_object network_get_info() const;
@@ -293,6 +307,12 @@ namespace graphene { namespace net {
 
         void disable_peer_advertising();
         fc::variant_object get_call_statistics() const;
+        /**
+         * Histograms of per-message-type and per-peer decode, queue and handling times, sizes and fetch
+         * round trips.  Times are in microseconds and sizes in bytes; percentiles are the upper bound of
+         * the power-of-two bucket they fall in.
+         */
+        fc::variant_object get_p2p_telemetry() const;
         //nico add
         void record_rpc_information(fc::ip::endpoint rpc_endpoint)const;
         uint64_t get_message_cache_size()const;
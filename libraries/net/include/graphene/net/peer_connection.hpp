@@ -28,6 +28,7 @@
 #include <graphene/net/message_oriented_connection.hpp>
 #include <graphene/net/stcp_socket.hpp>
 #include <graphene/net/config.hpp>
+#include <graphene/net/telemetry.hpp>
 
 #include <boost/tuple/tuple.hpp>
 
@@ -43,6 +44,7 @@
 #include <queue>
 #include <boost/container/deque.hpp>
 #include <fc/thread/future.hpp>
+#include <fc/bloom_filter.hpp>
 
 namespace graphene { namespace net
   {
@@ -69,6 +71,25 @@ namespace graphene { namespace net
                               const message& received_message) = 0;
       virtual void on_connection_closed(peer_connection* originating_peer) = 0;
       virtual message get_message_for_item(const item_id& item) = 0;
+      virtual void on_message_sent(peer_connection* destination_peer, const message& sent_message) = 0;
+    };
+
+    /**
+     * Rolling set of items a peer is known to have, kept as two generations of bloom filters
+     * so it can remember far more items than the exact inventory sets for a fraction of the memory.
+     * When the current generation fills up it becomes the previous one and a fresh one is started.
+     * A false positive only means we skip advertising an item the peer will get from someone else.
+     */
+    class known_item_filter
+    {
+    public:
+      known_item_filter();
+      void insert(const item_id& item);
+      bool contains(const item_id& item) const;
+
+    private:
+      fc::bloom_filter _current;
+      fc::bloom_filter _previous;
     };
 
     class peer_connection;
@@ -209,6 +230,7 @@ namespace graphene { namespace net
       fc::optional<fc::time_point_sec> fc_git_revision_unix_timestamp;
       fc::optional<std::string> platform;
       fc::optional<uint32_t> bitness;
+      bool supports_compact_blocks; /// peer announced compact_blocks in its hello user_data
 
       // for inbound connections, these fields record what the peer sent us in
       // its hello message.  For outbound, they record what we sent the peer
@@ -230,6 +252,10 @@ namespace graphene { namespace net
       fc::optional<boost::tuple<std::vector<item_hash_t>, fc::time_point> > item_ids_requested_from_peer; /// we check this to detect a timed-out request and in busy()
       fc::time_point last_sync_item_received_time; /// the time we received the last sync item or the time we sent the last batch of sync item requests to this peer
       std::set<item_hash_t> sync_items_requested_from_peer; /// ids of blocks we've requested from this peer during sync.  fetch from another peer if this peer disconnects
+      fc::time_point sync_range_requested_time; /// when we requested the range of sync blocks in sync_items_requested_from_peer
+      uint32_t sync_range_size; /// number of blocks in that range
+      double sync_blocks_per_second; /// sync throughput we measured for this peer, 0 until it completes a range
+      bool sync_range_stalled; /// the rest of the range was handed to other peers because this peer stopped delivering
       item_hash_t last_block_delegate_has_seen; /// the hash of the last block  this peer has told us about that the peer knows
       fc::time_point_sec last_block_time_delegate_has_seen;
       bool inhibit_fetching_sync_blocks;
@@ -254,6 +280,8 @@ namespace graphene { namespace net
                                                                                                                  boost::multi_index::member<timestamped_item_id, fc::time_point_sec, &timestamped_item_id::timestamp> > > > timestamped_items_set_type;
       timestamped_items_set_type inventory_peer_advertised_to_us;
       timestamped_items_set_type inventory_advertised_to_peer;
+      known_item_filter known_items; /// items the peer has sent, advertised, fetched from us or been offered by us
+      message_telemetry telemetry; /// timing and size of the messages exchanged with this peer
 
       item_to_time_map_type items_requested_from_peer;  /// items we've requested from this peer during normal operation.  fetch from another peer if this peer disconnects
       /// @}
@@ -274,10 +302,11 @@ namespace graphene { namespace net
 #endif
       bool _currently_handling_message; // true while we're in the middle of handling a message from the remote system
     private:
-      peer_connection(peer_connection_delegate* delegate);
+      peer_connection(peer_connection_delegate* delegate, const io_thread_pool_ptr& io_threads);
       void destroy();
     public:
-      static peer_connection_ptr make_shared(peer_connection_delegate* delegate); // use this instead of the constructor
+      static peer_connection_ptr make_shared(peer_connection_delegate* delegate,
+                                             const io_thread_pool_ptr& io_threads = io_thread_pool_ptr()); // use this instead of the constructor
       virtual ~peer_connection();
 
       fc::tcp_socket& get_socket();
@@ -298,6 +327,8 @@ namespace graphene { namespace net
 
       fc::time_point get_last_message_sent_time() const;
       fc::time_point get_last_message_received_time() const;
+      fc::microseconds get_last_message_decode_time() const;
+      fc::microseconds get_last_message_queue_wait() const;
 
       fc::optional<fc::ip::endpoint> get_remote_endpoint();
       fc::ip::endpoint get_local_endpoint();
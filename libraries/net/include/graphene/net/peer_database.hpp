@@ -32,6 +32,9 @@
 #include <fc/exception/exception.hpp>
 #include <fc/io/raw.hpp>
 
+#include <limits>
+#include <tuple>
+
 namespace graphene { namespace net {
 
   enum potential_peer_last_connection_disposition
@@ -52,10 +55,14 @@ namespace graphene { namespace net {
     uint32_t                          number_of_successful_connection_attempts;
     uint32_t                          number_of_failed_connection_attempts;
     fc::optional<fc::exception>       last_error;
+    uint32_t                          latency_ms; ///< last measured round trip delay, 0 if never measured
+    uint32_t                          bytes_per_second_received; ///< average receive rate of the last connection, 0 if unknown
 
     potential_peer_record() :
       number_of_successful_connection_attempts(0),
-    number_of_failed_connection_attempts(0){}
+    number_of_failed_connection_attempts(0),
+    latency_ms(0),
+    bytes_per_second_received(0){}
 
     potential_peer_record(fc::ip::endpoint endpoint,
                           fc::time_point_sec last_seen_time = fc::time_point_sec(),
@@ -64,15 +71,33 @@ namespace graphene { namespace net {
       last_seen_time(last_seen_time),
       last_connection_disposition(last_connection_disposition),
       number_of_successful_connection_attempts(0),
-      number_of_failed_connection_attempts(0)
-    {}  
+      number_of_failed_connection_attempts(0),
+      latency_ms(0),
+      bytes_per_second_received(0)
+    {}
+
+    /// sort key for picking peers to connect to: peers that worked last time first, then the fastest
+    std::tuple<bool, uint32_t, uint32_t, uint32_t> connection_preference() const
+    {
+      return std::make_tuple(last_connection_disposition != last_connection_succeeded,
+                             latency_ms ? latency_ms : std::numeric_limits<uint32_t>::max(),
+                             std::numeric_limits<uint32_t>::max() - bytes_per_second_received,
+                             number_of_failed_connection_attempts);
+    }
   };
 
   namespace detail
   {
     class peer_database_impl;
 
-    class peer_database_iterator_impl;
+    class peer_database_iterator_impl
+    {
+    public:
+      virtual ~peer_database_iterator_impl() {}
+      virtual void increment() = 0;
+      virtual bool equal(const peer_database_iterator_impl& other) const = 0;
+      virtual const potential_peer_record& dereference() const = 0;
+    };
     class peer_database_iterator : public boost::iterator_facade<peer_database_iterator, const potential_peer_record, boost::forward_traversal_tag>
     {
     public:
@@ -92,13 +117,22 @@ namespace graphene { namespace net {
   }
 
 
+  /**
+   * Known peers, kept in memory with indexes on endpoint, last seen time and connection preference.
+   *
+   * The database file is an append-only log of packed records: every update appends the new record
+   * (or an erase marker), and the log is rewritten compactly once it grows to several times the
+   * number of live records.  Opening it replays the log, there is no large file to parse or rewrite
+   * on startup or shutdown.
+   */
   class peer_database
   {
   public:
     peer_database();
     ~peer_database();
 
-    void open(const fc::path& databaseFilename);
+    /// @param legacy_json_filename  peer list in the old JSON format, imported when @p databaseFilename does not exist yet
+    void open(const fc::path& databaseFilename, const fc::path& legacy_json_filename = fc::path());
     void close();
     void clear();
 
@@ -109,8 +143,12 @@ namespace graphene { namespace net {
     fc::optional<potential_peer_record> lookup_entry_for_endpoint(const fc::ip::endpoint& endpointToLookup);
 
     typedef detail::peer_database_iterator iterator;
+    /// iterate in order of last seen time
     iterator begin() const;
     iterator end() const;
+    /// iterate the peers we would most like to connect to first
+    iterator begin_by_preference() const;
+    iterator end_by_preference() const;
     size_t size() const;
   private:
     std::unique_ptr<detail::peer_database_impl> my;
@@ -119,4 +157,4 @@ namespace graphene { namespace net {
 } } // end namespace graphene::net
 
 FC_REFLECT_ENUM(graphene::net::potential_peer_last_connection_disposition, (never_attempted_to_connect)(last_connection_failed)(last_connection_rejected)(last_connection_handshaking_failed)(last_connection_succeeded))
-FC_REFLECT(graphene::net::potential_peer_record, (endpoint)(last_seen_time)(last_connection_disposition)(last_connection_attempt_time)(number_of_successful_connection_attempts)(number_of_failed_connection_attempts)(last_error) )
+FC_REFLECT(graphene::net::potential_peer_record, (endpoint)(last_seen_time)(last_connection_disposition)(last_connection_attempt_time)(number_of_successful_connection_attempts)(number_of_failed_connection_attempts)(last_error)(latency_ms)(bytes_per_second_received) )
@@ -0,0 +1,82 @@
+#pragma once
+#include <graphene/net/core_messages.hpp>
+#include <fc/optional.hpp>
+#include <fc/time.hpp>
+
+#include <boost/circular_buffer.hpp>
+#include <boost/container/deque.hpp>
+#include <boost/multi_index_container.hpp>
+#include <boost/multi_index/hashed_index.hpp>
+#include <boost/multi_index/member.hpp>
+#include <boost/multi_index/ordered_index.hpp>
+#include <boost/multi_index/tag.hpp>
+
+#include <functional>
+#include <set>
+#include <vector>
+
+namespace graphene { namespace net {
+
+  /**
+   * How many blocks to request from a sync peer that has delivered blocks_per_second so far (0 if we
+   * haven't measured it yet): about GRAPHENE_NET_SYNC_RANGE_TARGET_SECONDS worth, no less than
+   * GRAPHENE_NET_MIN_BLOCKS_PER_PEER_DURING_SYNCING and no more than maximum_blocks_per_peer
+   */
+  uint32_t sync_range_size(double blocks_per_second, uint32_t maximum_blocks_per_peer);
+
+  /// a peer's throughput estimate after it delivered a whole range of range_size blocks in elapsed
+  double sync_throughput_after_range(double blocks_per_second, uint32_t range_size, const fc::microseconds& elapsed);
+
+  /**
+   * The first contiguous run of up to range_size ids from a peer's list that are still available, i.e.
+   * neither received nor requested from anyone.  The range ends where another peer's range begins.
+   */
+  std::vector<item_hash_t> select_sync_range(const boost::container::deque<item_hash_t>& ids_of_items_to_get, uint32_t range_size,
+                                             const std::function<bool(const item_hash_t&)>& is_available);
+
+  /**
+   * Reorder buffer for sync blocks that arrived before the blocks preceding them, indexed by block
+   * number so blocks are handed out lowest number first.  A block can arrive twice when a stalled
+   * range was requested again from another peer; a second copy is dropped while the first is still
+   * here, and so is a copy of a block we already handed out for processing.
+   */
+  class sync_block_buffer
+  {
+  public:
+    /// @param processed_ids_to_remember how many handed out blocks are recognized when they arrive again
+    explicit sync_block_buffer(size_t processed_ids_to_remember);
+
+    /// @return false if the block was dropped as a duplicate
+    bool insert(const graphene::net::block_message& block);
+    bool contains(const item_hash_t& block_id) const;
+    /// remove a block to hand it out for processing
+    fc::optional<graphene::net::block_message> take(const item_hash_t& block_id);
+    /// remove the buffered block with the lowest number among next_ids, the blocks that can be processed now
+    fc::optional<graphene::net::block_message> take_next(const std::set<item_hash_t>& next_ids);
+
+    size_t size() const { return _blocks.size(); }
+    uint32_t last_processed_block_num() const { return _last_processed_block_num; }
+
+  private:
+    struct buffered_block
+    {
+      item_hash_t                               block_id;
+      uint32_t                                  block_num;
+      mutable graphene::net::block_message      block;
+    };
+    struct by_block_id;
+    struct by_block_num;
+    typedef boost::multi_index_container<buffered_block,
+              boost::multi_index::indexed_by<
+                boost::multi_index::hashed_unique<boost::multi_index::tag<by_block_id>,
+                                                  boost::multi_index::member<buffered_block, item_hash_t, &buffered_block::block_id>,
+                                                  std::hash<item_hash_t> >,
+                boost::multi_index::ordered_non_unique<boost::multi_index::tag<by_block_num>,
+                                                       boost::multi_index::member<buffered_block, uint32_t, &buffered_block::block_num> > > > buffered_block_index;
+
+    buffered_block_index                  _blocks;
+    uint32_t                              _last_processed_block_num = 0;
+    boost::circular_buffer<item_hash_t>   _processed_ids;
+  };
+
+} } // graphene::net
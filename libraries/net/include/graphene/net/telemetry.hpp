@@ -0,0 +1,67 @@
+#pragma once
+#include <fc/time.hpp>
+#include <fc/variant_object.hpp>
+
+#include <array>
+#include <cstdint>
+#include <map>
+
+namespace graphene { namespace net {
+
+  /**
+   * Histogram with power-of-two buckets, cheap enough to update for every message.
+   * Bucket i counts the values in [2^(i-1), 2^i), bucket 0 counts zeros; percentiles are
+   * reported as the upper bound of the bucket they fall in.
+   */
+  class telemetry_histogram
+  {
+  public:
+    static const unsigned bucket_count = 40;
+
+    void record(uint64_t value);
+    void record(const fc::microseconds& duration) { record(duration.count() > 0 ? (uint64_t)duration.count() : 0); }
+
+    uint64_t count() const { return _count; }
+    uint64_t sum() const { return _sum; }
+    /// upper bound of the bucket holding the given fraction (0..1] of the recorded values
+    uint64_t percentile(double fraction) const;
+
+    fc::variant_object to_variant() const;
+
+  private:
+    std::array<uint64_t, bucket_count> _buckets = {};
+    uint64_t _count = 0;
+    uint64_t _sum = 0;
+    uint64_t _min = 0;
+    uint64_t _max = 0;
+  };
+
+  /// what we measure for each type of message, both per peer and across all peers
+  struct message_type_telemetry
+  {
+    telemetry_histogram decode_time; ///< us from the header arriving until the message was read and decrypted
+    telemetry_histogram queue_wait;  ///< us from the message being decoded until the p2p thread started handling it
+    telemetry_histogram handle_time; ///< us spent in node_impl::on_message, including delegate calls
+    telemetry_histogram bytes_in;
+    telemetry_histogram bytes_out;
+
+    fc::variant_object to_variant() const;
+  };
+
+  class message_telemetry
+  {
+  public:
+    void record_received(uint32_t msg_type, uint32_t size, const fc::microseconds& decode_time,
+                         const fc::microseconds& queue_wait, const fc::microseconds& handle_time);
+    void record_sent(uint32_t msg_type, uint32_t size);
+    /// us between requesting an item and receiving it
+    void record_fetch_round_trip(const fc::microseconds& round_trip) { _fetch_round_trip.record(round_trip); }
+
+    fc::variant_object to_variant() const;
+
+  private:
+    std::map<uint32_t, message_type_telemetry> _by_message_type;
+    telemetry_histogram _fetch_round_trip;
+  };
+
+} } // graphene::net
@@ -0,0 +1,54 @@
+#include <graphene/net/io_thread_pool.hpp>
+
+#include <string>
+
+namespace graphene { namespace net {
+
+  io_thread_pool::io_thread_pool(uint32_t thread_count)
+  {
+    set_thread_count(thread_count);
+  }
+
+  io_thread_pool::~io_thread_pool()
+  {
+    // fc::thread's destructor quits the thread and joins it
+    _threads.clear();
+  }
+
+  void io_thread_pool::set_thread_count(uint32_t thread_count)
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    // threads are only added, connections already pinned to one keep using it
+    _thread_count = thread_count;
+    while (_threads.size() < _thread_count)
+      _threads.emplace_back(new fc::thread("p2p_io_" + std::to_string(_threads.size())));
+  }
+
+  uint32_t io_thread_pool::get_thread_count() const
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _thread_count;
+  }
+
+  fc::thread* io_thread_pool::acquire_thread()
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    if (_thread_count == 0)
+      return nullptr;
+    ++_connection_count;
+    return _threads[_next_thread++ % _thread_count].get();
+  }
+
+  void io_thread_pool::release_thread()
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    --_connection_count;
+  }
+
+  uint32_t io_thread_pool::get_connection_count() const
+  {
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _connection_count;
+  }
+
+} } // graphene::net
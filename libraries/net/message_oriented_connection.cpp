@@ -32,6 +32,8 @@
 #include <graphene/net/stcp_socket.hpp>
 #include <graphene/net/config.hpp>
 
+#include <atomic>
+
 
 #ifdef DEFAULT_LOGGER
 # undef DEFAULT_LOGGER
@@ -50,25 +52,41 @@ namespace graphene { namespace net {
     class message_oriented_connection_impl
     {
     private:
+      /// shared with message deliveries queued on the owning thread, which may run after the connection is gone
+      struct delivery_state
+      {
+        message_oriented_connection_impl* connection;
+        bool closed;
+      };
+
       message_oriented_connection* _self;
       message_oriented_connection_delegate *_delegate;
       stcp_socket _sock;
       fc::future<void> _read_loop_done;
-      uint64_t _bytes_received;
-      uint64_t _bytes_sent;
+      fc::future<void> _write_done;
+      std::atomic<uint64_t> _bytes_received; // updated by the read loop on the I/O thread
+      std::atomic<uint64_t> _bytes_sent;
+      fc::optional<fc::ip::endpoint> _remote_endpoint; // cached once connected, the I/O thread owns the socket after that
 
       fc::time_point _connected_time;
       fc::time_point _last_message_received_time;
       fc::time_point _last_message_sent_time;
+      fc::microseconds _last_message_decode_time;
+      fc::microseconds _last_message_queue_wait;
 
       bool _send_message_in_progress;
 
-#ifndef NDEBUG
-      fc::thread* _thread;
-#endif
+      fc::thread* _thread; // the thread that owns this connection and receives its messages
+      io_thread_pool_ptr _io_thread_pool; // null when all I/O happens on _thread
+      fc::thread* _io_thread; // the thread doing socket I/O, null if it's _thread
+      std::shared_ptr<delivery_state> _delivery_state;
 
       void read_loop();
       void start_read_loop();
+      void deliver_message(const message& received_message, const fc::time_point& header_received_time,
+                           const fc::time_point& decoded_time);
+      template <typename Functor>
+      void run_on_io_thread(Functor&& f, const char* desc);
     public:
       fc::tcp_socket& get_socket();
       void accept();
@@ -76,7 +94,8 @@ namespace graphene { namespace net {
       void bind(const fc::ip::endpoint& local_endpoint);
 
       message_oriented_connection_impl(message_oriented_connection* self,
-                                       message_oriented_connection_delegate* delegate = nullptr);
+                                       message_oriented_connection_delegate* delegate,
+                                       const io_thread_pool_ptr& io_threads);
       ~message_oriented_connection_impl();
 
       void send_message(const message& message_to_send);
@@ -89,25 +108,31 @@ namespace graphene { namespace net {
       fc::time_point get_last_message_sent_time() const;
       fc::time_point get_last_message_received_time() const;
       fc::time_point get_connection_time() const { return _connected_time; }
+      fc::microseconds get_last_message_decode_time() const { return _last_message_decode_time; }
+      fc::microseconds get_last_message_queue_wait() const { return _last_message_queue_wait; }
       fc::sha512 get_shared_secret() const;
     };
 
     message_oriented_connection_impl::message_oriented_connection_impl(message_oriented_connection* self,
-                                                                       message_oriented_connection_delegate* delegate)
+                                                                       message_oriented_connection_delegate* delegate,
+                                                                       const io_thread_pool_ptr& io_threads)
     : _self(self),
       _delegate(delegate),
       _bytes_received(0),
       _bytes_sent(0),
-      _send_message_in_progress(false)
-#ifndef NDEBUG
-      ,_thread(&fc::thread::current())
-#endif
+      _send_message_in_progress(false),
+      _thread(&fc::thread::current()),
+      _io_thread_pool(io_threads),
+      _io_thread(nullptr),
+      _delivery_state(std::make_shared<delivery_state>(delivery_state{this, false}))
     {
     }
     message_oriented_connection_impl::~message_oriented_connection_impl()
     {
       VERIFY_CORRECT_THREAD();
       destroy_connection();
+      if (_io_thread)
+        _io_thread_pool->release_thread();
     }
 
     fc::tcp_socket& message_oriented_connection_impl::get_socket()
@@ -116,20 +141,71 @@ namespace graphene { namespace net {
       return _sock.get_socket();
     }
 
+    template <typename Functor>
+    void message_oriented_connection_impl::run_on_io_thread(Functor&& f, const char* desc)
+    {
+      if (_io_thread == nullptr || _io_thread->is_current())
+        f();
+      else
+        _io_thread->async(std::forward<Functor>(f), desc).wait();
+    }
+
     void message_oriented_connection_impl::accept()
     {
       VERIFY_CORRECT_THREAD();
-      _sock.accept();
-      assert(!_read_loop_done.valid()); // check to be sure we never launch two read loops
-      _read_loop_done = fc::async([=](){ read_loop(); }, "message read_loop");
+      assert(!_io_thread);
+      if (_io_thread_pool)
+        _io_thread = _io_thread_pool->acquire_thread();
+      run_on_io_thread([this](){
+        _sock.accept();
+        _remote_endpoint = _sock.get_socket().remote_endpoint();
+      }, "stcp accept");
+      start_read_loop();
     }
 
     void message_oriented_connection_impl::connect_to(const fc::ip::endpoint& remote_endpoint)
     {
       VERIFY_CORRECT_THREAD();
-      _sock.connect_to(remote_endpoint);
+      assert(!_io_thread);
+      if (_io_thread_pool)
+        _io_thread = _io_thread_pool->acquire_thread();
+      run_on_io_thread([this, remote_endpoint](){ _sock.connect_to(remote_endpoint); }, "stcp connect_to");
+      _remote_endpoint = remote_endpoint;
+      start_read_loop();
+    }
+
+    void message_oriented_connection_impl::start_read_loop()
+    {
+      VERIFY_CORRECT_THREAD();
       assert(!_read_loop_done.valid()); // check to be sure we never launch two read loops
-      _read_loop_done = fc::async([=](){ read_loop(); }, "message read_loop");
+      _connected_time = fc::time_point::now();
+      if (_io_thread)
+        _read_loop_done = _io_thread->async([=](){ read_loop(); }, "message read_loop");
+      else
+        _read_loop_done = fc::async([=](){ read_loop(); }, "message read_loop");
+    }
+
+    void message_oriented_connection_impl::deliver_message(const message& received_message, const fc::time_point& header_received_time,
+                                                           const fc::time_point& decoded_time)
+    {
+      VERIFY_CORRECT_THREAD();
+      _last_message_received_time = fc::time_point::now();
+      _last_message_decode_time = decoded_time - header_received_time;
+      _last_message_queue_wait = _last_message_received_time - decoded_time;
+      try
+      {
+        // message handling errors are warnings...
+        _delegate->on_message(_self, received_message);    // 回调 peer_connection::on_message
+      }
+      /// Dedicated catches needed to distinguish from general fc::exception
+      catch ( const fc::canceled_exception& e ) { throw; }
+      catch ( const fc::eof_exception& e ) { throw; }
+      catch ( const fc::exception& e)
+      {
+        /// Here loop should be continued so exception should be just caught locally.
+        wlog( "message transmission failed ${er}", ("er", e.to_detail_string() ) );
+        throw;
+      }
     }
 
     void message_oriented_connection_impl::bind(const fc::ip::endpoint& local_endpoint)
@@ -141,15 +217,16 @@ namespace graphene { namespace net {
 
     void message_oriented_connection_impl::read_loop()    //nico p2p 消息入口
     {
-      VERIFY_CORRECT_THREAD();
       const int BUFFER_SIZE = 16;
       const int LEFTOVER = BUFFER_SIZE - sizeof(message_header);
       static_assert(BUFFER_SIZE >= sizeof(message_header), "insufficient buffer");
 
-      _connected_time = fc::time_point::now();
-
       fc::oexception exception_to_rethrow;
       bool call_on_connection_closed = false;
+      // while the owning thread handles one message we already read and decrypt the next one, but a message
+      // is only handed over once the previous one has been handled, so the delegate still sees them in order
+      fc::future<void> previous_delivery;
+      std::shared_ptr<delivery_state> state = _delivery_state;
 
       try
       {
@@ -158,7 +235,8 @@ namespace graphene { namespace net {
         {
           char buffer[BUFFER_SIZE];
           _sock.read(buffer, BUFFER_SIZE);          // nico socket :read loop
-          _bytes_received += BUFFER_SIZE;
+          _bytes_received.fetch_add(BUFFER_SIZE, std::memory_order_relaxed);
+          fc::time_point header_received_time = fc::time_point::now();
           memcpy((char*)&m, buffer, sizeof(message_header));
 
           FC_ASSERT( m.size <= MAX_MESSAGE_SIZE, "", ("m.size",m.size)("MAX_MESSAGE_SIZE",MAX_MESSAGE_SIZE) );
@@ -169,26 +247,22 @@ namespace graphene { namespace net {
           if (remaining_bytes_with_padding)
           {
             _sock.read(&m.data[LEFTOVER], remaining_bytes_with_padding);
-            _bytes_received += remaining_bytes_with_padding;
+            _bytes_received.fetch_add(remaining_bytes_with_padding, std::memory_order_relaxed);
           }
           m.data.resize(m.size); // truncate off the padding bytes
+          fc::time_point decoded_time = fc::time_point::now();
 
-          _last_message_received_time = fc::time_point::now();
-
-          try
-          {
-            // message handling errors are warnings...
-            _delegate->on_message(_self, m);    // 回调 peer_connection::on_message
-          }
-          /// Dedicated catches needed to distinguish from general fc::exception
-          catch ( const fc::canceled_exception& e ) { throw; }
-          catch ( const fc::eof_exception& e ) { throw; }
-          catch ( const fc::exception& e)
+          if (_io_thread == nullptr)
           {
-            /// Here loop should be continued so exception should be just caught locally.
-            wlog( "message transmission failed ${er}", ("er", e.to_detail_string() ) );
-            throw;
+            deliver_message(m, header_received_time, decoded_time);
+            continue;
           }
+          if (previous_delivery.valid())
+            previous_delivery.wait();
+          previous_delivery = _thread->async([state, m, header_received_time, decoded_time](){
+            if (!state->closed)
+              state->connection->deliver_message(m, header_received_time, decoded_time);
+          }, "deliver p2p message");
         }
       }
       catch ( const fc::canceled_exception& e )
@@ -200,6 +274,16 @@ namespace graphene { namespace net {
       {
         wlog( "disconnected ${e}", ("e", e.to_detail_string() ) );
         call_on_connection_closed = true;
+        // the last message read before the socket closed is still delivered
+        if (previous_delivery.valid() && !previous_delivery.ready())
+        {
+          try
+          {
+            previous_delivery.wait();
+          }
+          catch ( const fc::canceled_exception& ) { throw; }
+          catch ( ... ) {}
+        }
       }
       catch ( const fc::exception& e )
       {
@@ -221,7 +305,15 @@ namespace graphene { namespace net {
       }
 
       if (call_on_connection_closed)
-        _delegate->on_connection_closed(_self);
+      {
+        if (_io_thread == nullptr)
+          _delegate->on_connection_closed(_self);
+        else
+          _thread->async([state](){
+            if (!state->closed)
+              state->connection->_delegate->on_connection_closed(state->connection->_self);
+          }, "p2p connection closed");
+      }
 
       if (exception_to_rethrow)
         throw *exception_to_rethrow;
@@ -261,12 +353,24 @@ namespace graphene { namespace net {
            elog("Trying to send a message larger than MAX_MESSAGE_SIZE. This probably won't work...");
         //pad the message we send to a multiple of 16 bytes
         size_t size_with_padding = 16 * ((size_of_message_and_header + 15) / 16);
-        std::unique_ptr<char[]> padded_message(new char[size_with_padding]);
+        std::shared_ptr<char> padded_message(new char[size_with_padding], std::default_delete<char[]>());
         memcpy(padded_message.get(), (char*)&message_to_send, sizeof(message_header));
         memcpy(padded_message.get() + sizeof(message_header), message_to_send.data.data(), message_to_send.size );
-        _sock.write(padded_message.get(), size_with_padding);
-        _sock.flush();
-        _bytes_sent += size_with_padding;
+        if (_io_thread == nullptr)
+        {
+          _sock.write(padded_message.get(), size_with_padding);
+          _sock.flush();
+        }
+        else
+        {
+          // encrypt and write on the I/O thread; the task owns the buffer in case our wait gets canceled
+          _write_done = _io_thread->async([this, padded_message, size_with_padding](){
+            _sock.write(padded_message.get(), size_with_padding);
+            _sock.flush();
+          }, "stcp write");
+          _write_done.wait();
+        }
+        _bytes_sent.fetch_add(size_with_padding, std::memory_order_relaxed);
         _last_message_sent_time = fc::time_point::now();
       } FC_RETHROW_EXCEPTIONS( warn, "unable to send message" );
     }
@@ -274,23 +378,32 @@ namespace graphene { namespace net {
     void message_oriented_connection_impl::close_connection()
     {
       VERIFY_CORRECT_THREAD();
-      _sock.close();
+      run_on_io_thread([this](){ _sock.close(); }, "stcp close");
     }
 
     void message_oriented_connection_impl::destroy_connection()
     {
       VERIFY_CORRECT_THREAD();
 
-      fc::optional<fc::ip::endpoint> remote_endpoint;
-      if (_sock.get_socket().is_open())
-        remote_endpoint = _sock.get_socket().remote_endpoint();
-      ilog( "in destroy_connection() for ${endpoint}", ("endpoint", remote_endpoint) );
+      ilog( "in destroy_connection() for ${endpoint}", ("endpoint", _remote_endpoint) );
 
       if (_send_message_in_progress)
         elog("Error: message_oriented_connection is being destroyed while a send_message is in progress.  "
              "The task calling send_message() should have been canceled already");
       assert(!_send_message_in_progress);
 
+      // messages already queued for delivery are dropped from here on
+      _delivery_state->closed = true;
+      try
+      {
+        if (_write_done.valid() && !_write_done.ready())
+          _write_done.wait();
+      }
+      catch (...)
+      {
+        wlog( "Exception thrown while finishing message_oriented_connection's last write, ignoring" );
+      }
+
       try
       {
         _read_loop_done.cancel_and_wait(__FUNCTION__);
@@ -308,13 +421,13 @@ namespace graphene { namespace net {
     uint64_t message_oriented_connection_impl::get_total_bytes_sent() const
     {
       VERIFY_CORRECT_THREAD();
-      return _bytes_sent;
+      return _bytes_sent.load(std::memory_order_relaxed);
     }
 
     uint64_t message_oriented_connection_impl::get_total_bytes_received() const
     {
       VERIFY_CORRECT_THREAD();
-      return _bytes_received;
+      return _bytes_received.load(std::memory_order_relaxed);
     }
 
     fc::time_point message_oriented_connection_impl::get_last_message_sent_time() const
@@ -338,8 +451,9 @@ namespace graphene { namespace net {
   } // end namespace graphene::net::detail
 
 
-  message_oriented_connection::message_oriented_connection(message_oriented_connection_delegate* delegate) :
-    my(new detail::message_oriented_connection_impl(this, delegate))
+  message_oriented_connection::message_oriented_connection(message_oriented_connection_delegate* delegate,
+                                                           const io_thread_pool_ptr& io_threads) :
+    my(new detail::message_oriented_connection_impl(this, delegate, io_threads))
   {
   }
 
@@ -405,6 +519,14 @@ namespace graphene { namespace net {
   {
     return my->get_connection_time();
   }
+  fc::microseconds message_oriented_connection::get_last_message_decode_time() const
+  {
+    return my->get_last_message_decode_time();
+  }
+  fc::microseconds message_oriented_connection::get_last_message_queue_wait() const
+  {
+    return my->get_last_message_queue_wait();
+  }
   fc::sha512 message_oriented_connection::get_shared_secret() const
   {
     return my->get_shared_secret();
@@ -77,6 +77,8 @@
 #include <graphene/net/stcp_socket.hpp>
 #include <graphene/net/config.hpp>
 #include <graphene/net/exceptions.hpp>
+#include <graphene/net/compact_block_buffer.hpp>
+#include <graphene/net/sync_scheduler.hpp>
 
 #include <graphene/chain/config.hpp>
 #include <graphene/chain/protocol/fee_schedule.hpp>
@@ -177,6 +179,7 @@ namespace graphene { namespace net {
       void cache_message( const message& message_to_cache, const message_hash_type& hash_of_message_to_cache,
                         const message_propagation_data& propagation_data, const fc::uint160_t& message_content_hash );
       message get_message( const message_hash_type& hash_of_message_to_lookup );
+      fc::optional<message> find_message_by_contents_hash( const fc::uint160_t& hash_of_message_contents_to_lookup, uint32_t message_type ) const;
       message_propagation_data get_message_propagation_data( const fc::uint160_t& hash_of_message_contents_to_lookup ) const;
       size_t size() const { return _message_cache.size(); }
     };
@@ -213,6 +216,17 @@ namespace graphene { namespace net {
       FC_THROW_EXCEPTION(  fc::key_not_found_exception, "Requested message not in cache" );
     }
 
+    fc::optional<message> blockchain_tied_message_cache::find_message_by_contents_hash( const fc::uint160_t& hash_of_message_contents_to_lookup,
+                                                                                         uint32_t message_type ) const
+    {
+      const auto& contents_index = _message_cache.get<message_contents_hash_index>();
+      for( auto iter = contents_index.lower_bound( hash_of_message_contents_to_lookup );
+           iter != contents_index.end() && iter->message_contents_hash == hash_of_message_contents_to_lookup; ++iter )
+        if( iter->message_body.msg_type == message_type )
+          return iter->message_body;
+      return fc::optional<message>();
+    }
+
     message_propagation_data blockchain_tied_message_cache::get_message_propagation_data( const fc::uint160_t& hash_of_message_contents_to_lookup ) const
     {
       if( hash_of_message_contents_to_lookup != fc::uint160_t() )
@@ -419,7 +433,8 @@ namespace graphene { namespace net { namespace detail {
       fc::sha256           _chain_id;
 
 #define NODE_CONFIGURATION_FILENAME      "node_config.json"
-#define POTENTIAL_PEER_DATABASE_FILENAME "peers.json"
+#define POTENTIAL_PEER_DATABASE_FILENAME "peers.dat"
+#define LEGACY_POTENTIAL_PEER_DATABASE_FILENAME "peers.json"
       fc::path             _node_configuration_directory;
       node_configuration   _node_configuration;
 
@@ -453,8 +468,7 @@ namespace graphene { namespace net { namespace detail {
       typedef std::unordered_map<graphene::net::block_id_type, fc::time_point> active_sync_requests_map;
 
       active_sync_requests_map              _active_sync_requests; /// list of sync blocks we've asked for from peers but have not yet received
-      std::list<graphene::net::block_message> _new_received_sync_items; /// list of sync blocks we've just received but haven't yet tried to process
-      std::list<graphene::net::block_message> _received_sync_items; /// list of sync blocks we've received, but can't yet process because we are still missing blocks that come earlier in the chain
+      sync_block_buffer                     _received_sync_items; /// reorder buffer of sync blocks we've received, but can't yet process because we are still missing blocks that come earlier in the chain
       // @}
 
       fc::future<void> _process_backlog_of_sync_blocks_done;
@@ -483,6 +497,8 @@ namespace graphene { namespace net { namespace detail {
       fc::promise<void>::ptr        _retrigger_advertise_inventory_loop_promise;
       fc::future<void>              _advertise_inventory_loop_done;
       std::unordered_set<item_id>   _new_inventory; /// list of items we have received but not yet advertised to our peers
+      bool                          _block_inventory_pending; /// _new_inventory holds a block, advertise without waiting for more items
+      bool                          _advertise_inventory_batching; /// the loop is waiting for more transactions to batch
       // @}
 
       fc::future<void>     _terminate_inactive_connections_loop_done;
@@ -516,6 +532,9 @@ namespace graphene { namespace net { namespace detail {
       fc::tcp_server       _tcp_server;
       fc::future<void>     _accept_loop_complete;
 
+      /// socket I/O threads of our connections, declared before them so they're joined after the last connection is gone
+      io_thread_pool_ptr   _io_thread_pool;
+
       /** Stores all connections which have not yet finished key exchange or are still sending initial handshaking messages
        * back and forth (not yet ready to initiate syncing) */
       std::unordered_set<peer_connection_ptr>                     _handshaking_connections;
@@ -534,6 +553,8 @@ namespace graphene { namespace net { namespace detail {
 
       blockchain_tied_message_cache _message_cache; /// cache message we have received and might be required to provide to other peers via inventory requests
 
+      compact_block_buffer _incomplete_compact_blocks; /// compact blocks waiting for transactions we didn't have in _message_cache
+
       fc::rate_limiting_group _rate_limiter;
 
       uint32_t _last_reported_number_of_connections; // number of connections last reported to the client (to avoid sending duplicate messages)
@@ -556,6 +577,9 @@ namespace graphene { namespace net { namespace detail {
 
       fc::future<void> _dump_node_status_task_done;
 
+      message_telemetry _telemetry; /// timing and size of the messages exchanged with all peers
+      telemetry_histogram _block_propagation_delay; /// us from a block's timestamp until we accepted it outside of sync
+
       /* We have two alternate paths through the schedule_peer_for_deletion code -- one that
        * uses a mutex to prevent one fiber from adding items to the queue while another is deleting
        * items from it, and one that doesn't.  The one that doesn't is simpler and more efficient
@@ -594,6 +618,8 @@ namespace graphene { namespace net { namespace detail {
       bool have_already_received_sync_item( const item_hash_t& item_hash );
       void request_sync_item_from_peer( const peer_connection_ptr& peer, const item_hash_t& item_to_request );
       void request_sync_items_from_peer( const peer_connection_ptr& peer, const std::vector<item_hash_t>& items_to_request );
+      void record_sync_range_progress( peer_connection* peer );
+      bool release_stalled_sync_ranges();
       void fetch_sync_items_loop();
       void trigger_fetch_sync_items_loop();
 
@@ -628,6 +654,11 @@ namespace graphene { namespace net { namespace detail {
 
       void on_message( peer_connection* originating_peer,
                        const message& received_message ) override;
+      void on_message_sent( peer_connection* destination_peer,
+                            const message& sent_message ) override;
+      void record_received_message_telemetry( peer_connection* originating_peer, const message& received_message,
+                                              const fc::time_point& handling_start_time );
+      void record_fetch_round_trip( peer_connection* originating_peer, const fc::time_point& request_time );
 
       void on_hello_message( peer_connection* originating_peer,
                              const hello_message& hello_message_received );
@@ -682,6 +713,17 @@ namespace graphene { namespace net { namespace detail {
       void on_get_current_connections_reply_message(peer_connection* originating_peer,
                                                     const get_current_connections_reply_message& get_current_connections_reply_message_received);
 
+      void on_compact_block_message(peer_connection* originating_peer,
+                                    const compact_block_message& compact_block_message_received);
+
+      void on_fetch_compact_block_transactions_message(peer_connection* originating_peer,
+                                                       const fetch_compact_block_transactions_message& fetch_compact_block_transactions_message_received);
+
+      void on_compact_block_transactions_message(peer_connection* originating_peer,
+                                                 const compact_block_transactions_message& compact_block_transactions_message_received);
+
+      void process_completed_compact_block(peer_connection* originating_peer, incomplete_compact_block& compact_block);
+
       void on_connection_closed(peer_connection* originating_peer) override;
 
       void send_sync_block_to_node_delegate(const graphene::net::block_message& block_message_to_send);
@@ -755,6 +797,7 @@ namespace graphene { namespace net { namespace detail {
       void                       set_total_bandwidth_limit( uint32_t upload_bytes_per_second, uint32_t download_bytes_per_second );
       void                       disable_peer_advertising();
       fc::variant_object         get_call_statistics() const;
+      fc::variant_object         get_p2p_telemetry() const;
       message                    get_message_for_item(const item_id& item) override;
 
       fc::variant_object         network_get_info() const;
@@ -807,17 +850,22 @@ namespace graphene { namespace net { namespace detail {
       _is_firewalled(firewalled_state::unknown),
       _potential_peer_database_updated(false),
       _sync_items_to_fetch_updated(false),
+      _received_sync_items(MAXIMUM_NUMBER_OF_BLOCKS_TO_PREFETCH),
       _suspend_fetching_sync_blocks(false),
       _items_to_fetch_updated(false),
       _items_to_fetch_sequence_counter(0),
+      _block_inventory_pending(false),
+      _advertise_inventory_batching(false),
       _recent_block_interval_in_seconds(GRAPHENE_MAX_BLOCK_INTERVAL),
       _user_agent_string(user_agent),
       _desired_number_of_connections(GRAPHENE_NET_DEFAULT_DESIRED_CONNECTIONS),
       _maximum_number_of_connections(GRAPHENE_NET_DEFAULT_MAX_CONNECTIONS),
       _peer_connection_retry_timeout(GRAPHENE_NET_DEFAULT_PEER_CONNECTION_RETRY_TIME),
       _peer_inactivity_timeout(GRAPHENE_NET_PEER_HANDSHAKE_INACTIVITY_TIMEOUT),
+      _io_thread_pool(std::make_shared<io_thread_pool>(GRAPHENE_NET_DEFAULT_IO_THREADS)),
       _most_recent_blocks_accepted(_maximum_number_of_connections),
       _total_number_of_unfetched_items(0),
+      _incomplete_compact_blocks(GRAPHENE_NET_MAX_INCOMPLETE_COMPACT_BLOCKS_PER_PEER, GRAPHENE_NET_MAX_INCOMPLETE_COMPACT_BLOCKS),
       _rate_limiter(0, 0),
       _last_reported_number_of_connections(0),
       _peer_advertising_disabled(false),
@@ -928,8 +976,8 @@ namespace graphene { namespace net { namespace detail {
             bool initiated_connection_this_pass = false;
             _potential_peer_database_updated = false;
 
-            for (peer_database::iterator iter = _potential_peer_db.begin();
-                 iter != _potential_peer_db.end() && is_wanting_new_connections();
+            for (peer_database::iterator iter = _potential_peer_db.begin_by_preference();
+                 iter != _potential_peer_db.end_by_preference() && is_wanting_new_connections();
                  ++iter)
             {
               fc::microseconds delay_until_retry = fc::seconds((iter->number_of_failed_connection_attempts + 1) * _peer_connection_retry_timeout);
@@ -998,10 +1046,7 @@ namespace graphene { namespace net { namespace detail {
     bool node_impl::have_already_received_sync_item( const item_hash_t& item_hash )
     {
       VERIFY_CORRECT_THREAD();
-      return std::find_if(_received_sync_items.begin(), _received_sync_items.end(),
-                          [&item_hash]( const graphene::net::block_message& message ) { return message.block_id == item_hash; } ) != _received_sync_items.end() ||
-             std::find_if(_new_received_sync_items.begin(), _new_received_sync_items.end(),
-                          [&item_hash]( const graphene::net::block_message& message ) { return message.block_id == item_hash; } ) != _new_received_sync_items.end();                          ;
+      return _received_sync_items.contains( item_hash );
     }
 
     void node_impl::request_sync_item_from_peer( const peer_connection_ptr& peer, const item_hash_t& item_to_request )
@@ -1026,9 +1071,48 @@ namespace graphene { namespace net { namespace detail {
         peer->last_sync_item_received_time = fc::time_point::now();
         peer->sync_items_requested_from_peer.insert(item_to_request);
       }
+      peer->sync_range_requested_time = fc::time_point::now();
+      peer->sync_range_size = items_to_request.size();
+      peer->sync_range_stalled = false;
       peer->send_message(fetch_items_message(graphene::net::block_message_type, items_to_request));
     }
 
+    // called whenever a sync block arrives from the peer; once its range is complete, fold the
+    // range's throughput into the peer's estimate
+    void node_impl::record_sync_range_progress( peer_connection* peer )
+    {
+      VERIFY_CORRECT_THREAD();
+      if( !peer->sync_items_requested_from_peer.empty() || peer->sync_range_size == 0 || peer->sync_range_stalled )
+        return;
+      peer->sync_blocks_per_second = sync_throughput_after_range( peer->sync_blocks_per_second, peer->sync_range_size,
+                                                                  fc::time_point::now() - peer->sync_range_requested_time );
+      peer->sync_range_size = 0;
+    }
+
+    // hand the undelivered part of ranges that stopped making progress back to the scheduler so
+    // other peers can fetch them.  The stalled peer keeps its requests open and may still deliver.
+    // Returns true if anything was released.
+    bool node_impl::release_stalled_sync_ranges()
+    {
+      VERIFY_CORRECT_THREAD();
+      bool released = false;
+      fc::time_point stall_threshold = fc::time_point::now() - fc::milliseconds(GRAPHENE_NET_SYNC_RANGE_STALL_TIMEOUT_MS);
+      for( const peer_connection_ptr& peer : _active_connections )
+      {
+        if( peer->sync_items_requested_from_peer.empty() || peer->sync_range_stalled ||
+            peer->last_sync_item_received_time >= stall_threshold )
+          continue;
+        wlog( "Sync range from peer ${peer} stalled with ${count} blocks outstanding, requesting them elsewhere",
+              ("peer", peer->get_remote_endpoint())("count", peer->sync_items_requested_from_peer.size()) );
+        for( const item_hash_t& item : peer->sync_items_requested_from_peer )
+          _active_sync_requests.erase( item );
+        peer->sync_range_stalled = true;
+        peer->sync_blocks_per_second /= 2;
+        released = true;
+      }
+      return released;
+    }
+
     void node_impl::fetch_sync_items_loop()
     {
       VERIFY_CORRECT_THREAD();
@@ -1037,6 +1121,8 @@ namespace graphene { namespace net { namespace detail {
         _sync_items_to_fetch_updated = false;
         dlog( "beginning another iteration of the sync items loop" );
 
+        release_stalled_sync_ranges();
+
         if (!_suspend_fetching_sync_blocks)
         {
           std::map<peer_connection_ptr, std::vector<item_hash_t> > sync_item_requests_to_send;
@@ -1045,32 +1131,31 @@ namespace graphene { namespace net { namespace detail {
             ASSERT_TASK_NOT_PREEMPTED();
             std::set<item_hash_t> sync_items_to_request;
 
-            // for each idle peer that we're syncing with
+            // for each idle peer that we're syncing with, fastest first so they get the ranges that are needed soonest
+            std::vector<peer_connection_ptr> idle_sync_peers;
             for( const peer_connection_ptr& peer : _active_connections )
+              if( peer->we_need_sync_items_from_peer && !peer->inhibit_fetching_sync_blocks && peer->idle() )
+                idle_sync_peers.push_back( peer );
+            std::stable_sort( idle_sync_peers.begin(), idle_sync_peers.end(),
+                              []( const peer_connection_ptr& a, const peer_connection_ptr& b ) { return a->sync_blocks_per_second > b->sync_blocks_per_second; } );
+
+            for( const peer_connection_ptr& peer : idle_sync_peers )
             {
-              if( peer->we_need_sync_items_from_peer &&
-                  sync_item_requests_to_send.find(peer) == sync_item_requests_to_send.end() && // if we've already scheduled a request for this peer, don't consider scheduling another
-                  peer->idle() )
+              // hand the peer the first contiguous range of items it has that we don't yet have on our
+              // blockchain, sized by how fast this peer has delivered so far
+              std::vector<item_hash_t> range = select_sync_range( peer->ids_of_items_to_get,
+                                                                  sync_range_size( peer->sync_blocks_per_second, _maximum_blocks_per_peer_during_syncing ),
+                                                                  [&]( const item_hash_t& item_to_potentially_request ) {
+                // if we don't already have this item in our temporary storage and we haven't requested from another syncing peer
+                return !have_already_received_sync_item(item_to_potentially_request) && // already got it, but for some reson it's still in our list of items to fetch
+                       sync_items_to_request.find(item_to_potentially_request) == sync_items_to_request.end() &&  // we have already decided to request it from another peer during this iteration
+                       _active_sync_requests.find(item_to_potentially_request) == _active_sync_requests.end(); // we've requested it in a previous iteration and we're still waiting for it to arrive
+              } );
+              if( !range.empty() )
               {
-                if (!peer->inhibit_fetching_sync_blocks)
-                {
-                  // loop through the items it has that we don't yet have on our blockchain
-                  for( unsigned i = 0; i < peer->ids_of_items_to_get.size(); ++i )
-                  {
-                    item_hash_t item_to_potentially_request = peer->ids_of_items_to_get[i];
-                    // if we don't already have this item in our temporary storage and we haven't requested from another syncing peer
-                    if( !have_already_received_sync_item(item_to_potentially_request) && // already got it, but for some reson it's still in our list of items to fetch
-                        sync_items_to_request.find(item_to_potentially_request) == sync_items_to_request.end() &&  // we have already decided to request it from another peer during this iteration
-                        _active_sync_requests.find(item_to_potentially_request) == _active_sync_requests.end() ) // we've requested it in a previous iteration and we're still waiting for it to arrive
-                    {
-                      // then schedule a request from this peer
-                      sync_item_requests_to_send[peer].push_back(item_to_potentially_request);
-                      sync_items_to_request.insert( item_to_potentially_request );
-                      if (sync_item_requests_to_send[peer].size() >= _maximum_blocks_per_peer_during_syncing)
-                        break;
-                    }
-                  }
-                }
+                // then schedule a request from this peer
+                sync_items_to_request.insert( range.begin(), range.end() );
+                sync_item_requests_to_send[peer] = std::move( range );
               }
             }
           } // end non-preemptable section
@@ -1087,7 +1172,17 @@ namespace graphene { namespace net { namespace detail {
         {
           dlog( "no sync items to fetch right now, going to sleep" );
           _retrigger_fetch_sync_items_loop_promise = fc::promise<void>::ptr( new fc::promise<void>("graphene::net::retrigger_fetch_sync_items_loop") );
-          _retrigger_fetch_sync_items_loop_promise->wait();
+          try
+          {
+            // while sync requests are outstanding, wake up periodically to notice stalled ranges
+            if( _active_sync_requests.empty() )
+              _retrigger_fetch_sync_items_loop_promise->wait();
+            else
+              _retrigger_fetch_sync_items_loop_promise->wait( fc::milliseconds(GRAPHENE_NET_SYNC_RANGE_STALL_TIMEOUT_MS / 2) );
+          }
+          catch( const fc::timeout_exception& )
+          {
+          }
           _retrigger_fetch_sync_items_loop_promise.reset();
         }
       } // while( !canceled )
@@ -1248,6 +1343,7 @@ namespace graphene { namespace net { namespace detail {
         // swap inventory into local variable, clearing the node's copy
         std::unordered_set<item_id> inventory_to_advertise;
         inventory_to_advertise.swap(_new_inventory);
+        _block_inventory_pending = false;
 
         // process all inventory to advertise and construct the inventory messages we'll send
         // first, then send them all in a batch (to avoid any fiber interruption points while
@@ -1257,27 +1353,23 @@ namespace graphene { namespace net { namespace detail {
         for (const peer_connection_ptr& peer : _active_connections)
         {
           // only advertise to peers who are in sync with us
-           wdump((peer->peer_needs_sync_items_from_us));
           if( !peer->peer_needs_sync_items_from_us )
           {
             std::map<uint32_t, std::vector<item_hash_t> > items_to_advertise_by_type;
             // don't send the peer anything we've already advertised to it
-            // or anything it has advertised to us
+            // or anything it is known to have (this also catches pending transactions
+            // that are re-broadcast after every block long after the exact sets expired)
             // group the items we need to send by type, because we'll need to send one inventory message per type
             unsigned total_items_to_send_to_this_peer = 0;
-            wdump((inventory_to_advertise));
             for (const item_id& item_to_advertise : inventory_to_advertise)
             {
-              if (peer->inventory_advertised_to_peer.find(item_to_advertise) != peer->inventory_advertised_to_peer.end() )
-                 wdump((*peer->inventory_advertised_to_peer.find(item_to_advertise)));
-              if (peer->inventory_peer_advertised_to_us.find(item_to_advertise) != peer->inventory_peer_advertised_to_us.end() )
-                 wdump((*peer->inventory_peer_advertised_to_us.find(item_to_advertise)));
-
               if (peer->inventory_advertised_to_peer.find(item_to_advertise) == peer->inventory_advertised_to_peer.end() &&
-                  peer->inventory_peer_advertised_to_us.find(item_to_advertise) == peer->inventory_peer_advertised_to_us.end())
+                  peer->inventory_peer_advertised_to_us.find(item_to_advertise) == peer->inventory_peer_advertised_to_us.end() &&
+                  !peer->known_items.contains(item_to_advertise))
               {
                 items_to_advertise_by_type[item_to_advertise.item_type].push_back(item_to_advertise.item_hash);
                 peer->inventory_advertised_to_peer.insert(peer_connection::timestamped_item_id(item_to_advertise, fc::time_point::now()));
+                peer->known_items.insert(item_to_advertise);
                 ++total_items_to_send_to_this_peer;
                 if (item_to_advertise.item_type == trx_message_type)
                   testnetlog("advertising transaction ${id} to peer ${endpoint}", ("id", item_to_advertise.item_hash)("endpoint", peer->get_remote_endpoint()));
@@ -1304,13 +1396,29 @@ namespace graphene { namespace net { namespace detail {
           _retrigger_advertise_inventory_loop_promise->wait();
           _retrigger_advertise_inventory_loop_promise.reset();
         }
+        // let a burst of transactions accumulate so it goes out in one inventory message per peer,
+        // a block arriving in the meantime cuts the wait short
+        if (!_block_inventory_pending && !_advertise_inventory_loop_done.canceled())
+        {
+          _advertise_inventory_batching = true;
+          _retrigger_advertise_inventory_loop_promise = fc::promise<void>::ptr(new fc::promise<void>("graphene::net::retrigger_advertise_inventory_loop"));
+          try
+          {
+            _retrigger_advertise_inventory_loop_promise->wait(fc::milliseconds(GRAPHENE_NET_INVENTORY_BATCH_INTERVAL_MS));
+          }
+          catch (const fc::timeout_exception&)
+          {
+          }
+          _retrigger_advertise_inventory_loop_promise.reset();
+          _advertise_inventory_batching = false;
+        }
       } // while(!canceled)
     }
 
     void node_impl::trigger_advertise_inventory_loop()
     {
       VERIFY_CORRECT_THREAD();
-      if( _retrigger_advertise_inventory_loop_promise )
+      if( _retrigger_advertise_inventory_loop_promise && (!_advertise_inventory_batching || _block_inventory_pending) )
         _retrigger_advertise_inventory_loop_promise->set_value();
     }
 
@@ -1324,6 +1432,10 @@ namespace graphene { namespace net { namespace detail {
 
       _recent_block_interval_in_seconds = _delegate->get_current_block_interval_in_seconds();
 
+      // forget compact blocks whose missing transactions never arrived, the block itself will be re-requested
+      // through the usual item timeout
+      _incomplete_compact_blocks.expire(fc::time_point::now() - fc::seconds(GRAPHENE_NET_COMPACT_BLOCK_TIMEOUT_SECONDS));
+
       // Disconnect peers that haven't sent us any data recently
       // These numbers are just guesses and we need to think through how this works better.
       // If we and our peers get disconnected from the rest of the network, we will not
@@ -1378,6 +1490,7 @@ namespace graphene { namespace net { namespace detail {
         fc::time_point active_disconnect_threshold = fc::time_point::now() - fc::seconds(active_disconnect_timeout);
         fc::time_point active_send_keepalive_threshold = fc::time_point::now() - fc::seconds(active_send_keepalive_timeout);
         fc::time_point active_ignored_request_threshold = fc::time_point::now() - active_ignored_request_timeout;
+        fc::time_point sync_stalled_disconnect_threshold = fc::time_point::now() - fc::milliseconds(GRAPHENE_NET_SYNC_RANGE_STALL_TIMEOUT_MS * 10);
         for( const peer_connection_ptr& active_peer : _active_connections )
         {
           if( active_peer->connection_initiation_time < active_disconnect_threshold &&
@@ -1390,13 +1503,14 @@ namespace graphene { namespace net { namespace detail {
           else
           {
             bool disconnect_due_to_request_timeout = false;
+            // a slow sync range is handed to other peers by the fetch loop first, the peer is only dropped
+            // when it keeps making no progress after that
             if (!active_peer->sync_items_requested_from_peer.empty() &&
-                active_peer->last_sync_item_received_time < active_ignored_request_threshold)
+                active_peer->last_sync_item_received_time < sync_stalled_disconnect_threshold)
             {
               wlog("Disconnecting peer ${peer} because they haven't made any progress on my remaining ${count} sync item requests",
                    ("peer", active_peer->get_remote_endpoint())("count", active_peer->sync_items_requested_from_peer.size()));
               disconnect_due_to_request_timeout = true;
-              break;
             }
             if (!disconnect_due_to_request_timeout &&
                 active_peer->item_ids_requested_from_peer &&
@@ -1772,6 +1886,17 @@ namespace graphene { namespace net { namespace detail {
            ("type", graphene::net::core_message_type_enum(received_message.msg_type))("hash", message_hash)
            ("size", received_message.size)
            ("endpoint", originating_peer->get_remote_endpoint()));
+
+      // record how long the handler took however it leaves
+      struct telemetry_recorder
+      {
+        node_impl& node;
+        peer_connection* originating_peer;
+        const message& received_message;
+        fc::time_point handling_start_time;
+        ~telemetry_recorder() { node.record_received_message_telemetry(originating_peer, received_message, handling_start_time); }
+      } record_telemetry{*this, originating_peer, received_message, fc::time_point::now()};
+
       switch ( received_message.msg_type )
       {
       case core_message_type_enum::hello_message_type:
@@ -1828,6 +1953,15 @@ namespace graphene { namespace net { namespace detail {
       case core_message_type_enum::get_current_connections_reply_message_type:
         on_get_current_connections_reply_message(originating_peer, received_message.as<get_current_connections_reply_message>());
         break;
+      case core_message_type_enum::compact_block_message_type:
+        on_compact_block_message(originating_peer, received_message.as<compact_block_message>());
+        break;
+      case core_message_type_enum::fetch_compact_block_transactions_message_type:
+        on_fetch_compact_block_transactions_message(originating_peer, received_message.as<fetch_compact_block_transactions_message>());
+        break;
+      case core_message_type_enum::compact_block_transactions_message_type:
+        on_compact_block_transactions_message(originating_peer, received_message.as<compact_block_transactions_message>());
+        break;
       /*  
       case core_message_type_enum::my_test_message_type:
         {
@@ -1847,6 +1981,32 @@ namespace graphene { namespace net { namespace detail {
       }
     }
 
+    void node_impl::on_message_sent( peer_connection* destination_peer, const message& sent_message )
+    {
+      VERIFY_CORRECT_THREAD();
+      destination_peer->telemetry.record_sent(sent_message.msg_type, sent_message.size);
+      _telemetry.record_sent(sent_message.msg_type, sent_message.size);
+    }
+
+    void node_impl::record_received_message_telemetry( peer_connection* originating_peer, const message& received_message,
+                                                       const fc::time_point& handling_start_time )
+    {
+      VERIFY_CORRECT_THREAD();
+      fc::microseconds decode_time = originating_peer->get_last_message_decode_time();
+      fc::microseconds queue_wait = originating_peer->get_last_message_queue_wait();
+      fc::microseconds handle_time = fc::time_point::now() - handling_start_time;
+      originating_peer->telemetry.record_received(received_message.msg_type, received_message.size, decode_time, queue_wait, handle_time);
+      _telemetry.record_received(received_message.msg_type, received_message.size, decode_time, queue_wait, handle_time);
+    }
+
+    void node_impl::record_fetch_round_trip( peer_connection* originating_peer, const fc::time_point& request_time )
+    {
+      VERIFY_CORRECT_THREAD();
+      fc::microseconds round_trip = fc::time_point::now() - request_time;
+      originating_peer->telemetry.record_fetch_round_trip(round_trip);
+      _telemetry.record_fetch_round_trip(round_trip);
+    }
+
 
     fc::variant_object node_impl::generate_hello_user_data()
     {
@@ -1879,6 +2039,8 @@ namespace graphene { namespace net { namespace detail {
       if (!_hard_fork_block_numbers.empty())
         user_data["last_known_fork_block_number"] = _hard_fork_block_numbers.back();
 
+      user_data["compact_blocks"] = true;
+
       return user_data;
     }
     void node_impl::parse_hello_user_data_for_peer(peer_connection* originating_peer, const fc::variant_object& user_data)
@@ -1897,6 +2059,8 @@ namespace graphene { namespace net { namespace detail {
         originating_peer->platform = user_data["platform"].as_string();
       if (user_data.contains("bitness"))
         originating_peer->bitness = user_data["bitness"].as<uint32_t>();
+      if (user_data.contains("compact_blocks"))
+        originating_peer->supports_compact_blocks = user_data["compact_blocks"].as<bool>();
       if (user_data.contains("node_id"))
         originating_peer->node_id = user_data["node_id"].as<node_id_t>();
       if (user_data.contains("last_known_fork_block_number"))
@@ -2782,15 +2946,24 @@ namespace graphene { namespace net { namespace detail {
       std::list<message> reply_messages;
       for (const item_hash_t& item_hash : fetch_items_message_received.items_to_fetch)
       {
+        originating_peer->known_items.insert(item_id(fetch_items_message_received.item_type, item_hash));
         try
         {
           message requested_message = _message_cache.get_message(item_hash);
           dlog("received item request for item ${id} from peer ${endpoint}, returning the item from my message cache",
                ("endpoint", originating_peer->get_remote_endpoint())
                ("id", requested_message.id()));
-          reply_messages.push_back(requested_message);
           if (fetch_items_message_received.item_type == block_message_type)
+          {
             last_block_message_sent = requested_message;
+            // blocks still in the message cache are recent, the peer most likely has their transactions already
+            if (originating_peer->supports_compact_blocks && requested_message.msg_type == block_message_type)
+            {
+              reply_messages.push_back(compact_block_message(requested_message.as<graphene::net::block_message>().block, item_hash));
+              continue;
+            }
+          }
+          reply_messages.push_back(requested_message);
           continue;
         }
         catch (fc::key_not_found_exception&)
@@ -2883,6 +3056,7 @@ namespace graphene { namespace net { namespace detail {
       for( const item_hash_t& item_hash : item_ids_inventory_message_received.item_hashes_available )
       {
         item_id advertised_item_id(item_ids_inventory_message_received.item_type, item_hash);
+        originating_peer->known_items.insert(advertised_item_id);
         bool we_advertised_this_item_to_a_peer = false;
         bool we_requested_this_item_from_a_peer = false;
         for (const peer_connection_ptr peer : _active_connections)
@@ -2989,6 +3163,7 @@ namespace graphene { namespace net { namespace detail {
         }
       }
 
+      _incomplete_compact_blocks.remove_peer(originating_peer->node_id);
       _closing_connections.erase(originating_peer_ptr);
       _handshaking_connections.erase(originating_peer_ptr);
       _terminating_connections.erase(originating_peer_ptr);
@@ -3002,6 +3177,11 @@ namespace graphene { namespace net { namespace detail {
           if (updated_peer_record)
           {
             updated_peer_record->last_seen_time = fc::time_point::now();
+            // remember how fast this peer fed us, connections that lasted under a minute say too little to count
+            fc::microseconds connection_duration = fc::time_point::now() - originating_peer->connection_initiation_time;
+            if (connection_duration > fc::minutes(1))
+              updated_peer_record->bytes_per_second_received = (uint32_t)std::min<uint64_t>(originating_peer->get_total_bytes_received() / connection_duration.to_seconds(),
+                                                                                             std::numeric_limits<uint32_t>::max());
             _potential_peer_db.update_entry(*updated_peer_record);
           }
         }
@@ -3077,6 +3257,15 @@ namespace graphene { namespace net { namespace detail {
 
         client_accepted_block = true;
       }
+      catch (const unlinkable_block_buffered_exception& e)
+      {
+        // the chain keeps this block until the gap before it is filled, so this is not the peer's fault;
+        // account for it like an accepted block.  Blocks it refused to keep are rejected below
+        dlog("Sync block ${num} (id:${id}) is waiting for its parent in the fork database",
+             ("num", block_message_to_send.block.block_num())
+             ("id", block_message_to_send.block_id));
+        client_accepted_block = true;
+      }
       catch (const block_older_than_undo_history& e)
       {
         wlog("Failed to push sync block ${num} (id:${id}): block is on a fork older than our undo history would "
@@ -3273,84 +3462,82 @@ namespace graphene { namespace net { namespace detail {
 
       do
       {
-        std::copy(std::make_move_iterator(_new_received_sync_items.begin()),     // 拷贝临时缓冲区的异步区块到主缓冲区 4
-                  std::make_move_iterator(_new_received_sync_items.end()),
-                  std::front_inserter(_received_sync_items));                    //_received_sync_items 主缓冲区
-        _new_received_sync_items.clear();
         dlog("currently ${count} sync items to consider", ("count", _received_sync_items.size()));
 
         block_processed_this_iteration = false;
-        for (auto received_block_iter = _received_sync_items.begin();
-             received_block_iter != _received_sync_items.end();   // 遍历主缓冲区异步接受的区块 5
-             ++received_block_iter)
+
+        // the next block on the active chain or one of the forks is at the front of some peer's list
+        // of items to get; of those the reorder buffer hands out the one with the lowest block number
+        std::set<item_hash_t> next_block_ids;
+        for (const peer_connection_ptr& peer : _active_connections)
         {
+          ASSERT_TASK_NOT_PREEMPTED(); // don't yield while iterating over _active_connections
+          if (!peer->ids_of_items_to_get.empty())
+            next_block_ids.insert(peer->ids_of_items_to_get.front());
+        }
+        fc::optional<graphene::net::block_message> received_block = _received_sync_items.take_next(next_block_ids);
 
-          // find out if this block is the next block on the active chain or one of the forks
-          bool potential_first_block = false;
+        // if there is one, process it, remove it from all sync peers lists
+        if (received_block)
+        {
+          const item_hash_t block_id = received_block->block_id;
           for (const peer_connection_ptr& peer : _active_connections)
           {
             ASSERT_TASK_NOT_PREEMPTED(); // don't yield while iterating over _active_connections
             if (!peer->ids_of_items_to_get.empty() &&
-                peer->ids_of_items_to_get.front() == received_block_iter->block_id)
+                peer->ids_of_items_to_get.front() == block_id)
             {
-              potential_first_block = true;
               peer->ids_of_items_to_get.pop_front();
-              peer->ids_of_items_being_processed.insert(received_block_iter->block_id);
+              peer->ids_of_items_being_processed.insert(block_id);
             }
           }
 
-          // if it is, process it, remove it from all sync peers lists
-          if (potential_first_block)
+          // we can get into an interesting situation near the end of synchronization.  We can be in
+          // sync with one peer who is sending us the last block on the chain via a regular inventory
+          // message, while at the same time still be synchronizing with a peer who is sending us the
+          // block through the sync mechanism.  Further, we must request both blocks because
+          // we don't know they're the same (for the peer in normal operation, it has only told us the
+          // message id, for the peer in the sync case we only known the block_id).
+          if (std::find(_most_recent_blocks_accepted.begin(), _most_recent_blocks_accepted.end(),
+                        block_id) == _most_recent_blocks_accepted.end())
           {
-            // we can get into an interesting situation near the end of synchronization.  We can be in
-            // sync with one peer who is sending us the last block on the chain via a regular inventory
-            // message, while at the same time still be synchronizing with a peer who is sending us the
-            // block through the sync mechanism.  Further, we must request both blocks because
-            // we don't know they're the same (for the peer in normal operation, it has only told us the
-            // message id, for the peer in the sync case we only known the block_id).
-            if (std::find(_most_recent_blocks_accepted.begin(), _most_recent_blocks_accepted.end(),
-                          received_block_iter->block_id) == _most_recent_blocks_accepted.end())
-            {
-              graphene::net::block_message block_message_to_process = *received_block_iter;
-              _received_sync_items.erase(received_block_iter);
-              _handle_message_calls_in_progress.emplace_back(fc::async([this, block_message_to_process](){
-                send_sync_block_to_node_delegate(block_message_to_process); //  异步处理区块 6 形成调用循环
-              }, "send_sync_block_to_node_delegate"));
-              ++blocks_processed;
-              block_processed_this_iteration = true;
-            }
-            else
+            graphene::net::block_message block_message_to_process = std::move(*received_block);
+            _handle_message_calls_in_progress.emplace_back(fc::async([this, block_message_to_process](){
+              send_sync_block_to_node_delegate(block_message_to_process); //  异步处理区块 6 形成调用循环
+            }, "send_sync_block_to_node_delegate"));
+            ++blocks_processed;
+            block_processed_this_iteration = true;
+          }
+          else
+          {
+            dlog("Already received and accepted this block (presumably through normal inventory mechanism), treating it as accepted");
+            block_processed_this_iteration = true;
+            std::vector< peer_connection_ptr > peers_needing_next_batch;
+            for (const peer_connection_ptr& peer : _active_connections)
             {
-              dlog("Already received and accepted this block (presumably through normal inventory mechanism), treating it as accepted");
-              std::vector< peer_connection_ptr > peers_needing_next_batch;
-              for (const peer_connection_ptr& peer : _active_connections)
+              auto items_being_processed_iter = peer->ids_of_items_being_processed.find(block_id);
+              if (items_being_processed_iter != peer->ids_of_items_being_processed.end())
               {
-                auto items_being_processed_iter = peer->ids_of_items_being_processed.find(received_block_iter->block_id);
-                if (items_being_processed_iter != peer->ids_of_items_being_processed.end())
+                peer->ids_of_items_being_processed.erase(items_being_processed_iter);
+                dlog("Removed item from ${endpoint}'s list of items being processed, still processing ${len} blocks",
+                     ("endpoint", peer->get_remote_endpoint())("len", peer->ids_of_items_being_processed.size()));
+
+                // if we just processed the last item in our list from this peer, we will want to
+                // send another request to find out if we are now in sync (this is normally handled in
+                // send_sync_block_to_node_delegate)
+                if (peer->ids_of_items_to_get.empty() &&
+                    peer->number_of_unfetched_item_ids == 0 &&
+                    peer->ids_of_items_being_processed.empty())
                 {
-                  peer->ids_of_items_being_processed.erase(items_being_processed_iter);
-                  dlog("Removed item from ${endpoint}'s list of items being processed, still processing ${len} blocks",
-                       ("endpoint", peer->get_remote_endpoint())("len", peer->ids_of_items_being_processed.size()));
-
-                  // if we just processed the last item in our list from this peer, we will want to
-                  // send another request to find out if we are now in sync (this is normally handled in
-                  // send_sync_block_to_node_delegate)
-                  if (peer->ids_of_items_to_get.empty() &&
-                      peer->number_of_unfetched_item_ids == 0 &&
-                      peer->ids_of_items_being_processed.empty())
-                  {
-                    dlog("We received last item in our list for peer ${endpoint}, setup to do a sync check", ("endpoint", peer->get_remote_endpoint()));
-                    peers_needing_next_batch.push_back( peer );
-                  }
+                  dlog("We received last item in our list for peer ${endpoint}, setup to do a sync check", ("endpoint", peer->get_remote_endpoint()));
+                  peers_needing_next_batch.push_back( peer );
                 }
               }
-              for( const peer_connection_ptr& peer : peers_needing_next_batch )
-                fetch_next_batch_of_item_ids_from_peer(peer.get());
             }
-
-            break; // start iterating _received_sync_items from the beginning
-          } // end if potential_first_block
-        } // end for each block in _received_sync_items
+            for( const peer_connection_ptr& peer : peers_needing_next_batch )
+              fetch_next_batch_of_item_ids_from_peer(peer.get());
+          }
+        }
 
         if (_handle_message_calls_in_progress.size() >= _maximum_number_of_blocks_to_handle_at_one_time)
         {
@@ -3383,9 +3570,14 @@ namespace graphene { namespace net { namespace detail {
       VERIFY_CORRECT_THREAD();
       dlog( "received a sync block from peer ${endpoint}", ("endpoint", originating_peer->get_remote_endpoint() ) );
 
-      // add it to the front of _received_sync_items, then process _received_sync_items to try to
-      // pass as many messages as possible to the client.
-      _new_received_sync_items.push_front( block_message_to_process ); //nico:异步区块放入临时缓冲区 2
+      // add it to the reorder buffer, then process _received_sync_items to try to
+      // pass as many messages as possible to the client.  A block can arrive twice when a stalled
+      // range was re-requested from another peer; keep the first copy
+      if (!_received_sync_items.insert(block_message_to_process)) //nico:异步区块放入缓冲区 2
+      {
+        dlog("dropping sync block ${num} (${id}), we already have it", ("num", block_message_to_process.block.block_num())("id", block_message_to_process.block_id));
+        return;
+      }
       trigger_process_backlog_of_sync_blocks();
     }
 
@@ -3415,6 +3607,7 @@ namespace graphene { namespace net { namespace detail {
           std::vector<fc::uint160_t> contained_transaction_message_ids;
           _delegate->handle_block(block_message_to_process, false, contained_transaction_message_ids);//处理同步广播的区块
           message_validated_time = fc::time_point::now();
+          _block_propagation_delay.record(message_validated_time - fc::time_point(block_message_to_process.block.timestamp));
           ilog("Successfully pushed block ${num} (id:${id})",
                 ("num", block_message_to_process.block.block_num())
                 ("id", block_message_to_process.block_id));
@@ -3548,6 +3741,7 @@ namespace graphene { namespace net { namespace detail {
       auto item_iter = originating_peer->items_requested_from_peer.find(item_id(graphene::net::block_message_type, message_hash));
       if (item_iter != originating_peer->items_requested_from_peer.end())
       {
+        record_fetch_round_trip(originating_peer, item_iter->second);
         originating_peer->items_requested_from_peer.erase(item_iter);
         process_block_during_normal_operation(originating_peer, block_message_to_process, message_hash); //正常的区块处理入口
         if (originating_peer->idle())
@@ -3561,6 +3755,7 @@ namespace graphene { namespace net { namespace detail {
         if (sync_item_iter != originating_peer->sync_items_requested_from_peer.end())
         {
           originating_peer->sync_items_requested_from_peer.erase(sync_item_iter);
+          record_sync_range_progress(originating_peer);
           // if exceptions are throw here after removing the sync item from the list (above),
           // it could leave our sync in a stalled state.  Wrap a try/catch around the rest
           // of the function so we can log if this ever happens.
@@ -3634,6 +3829,17 @@ namespace graphene { namespace net { namespace detail {
                                                          (current_time_reply_message_received.reply_transmitted_time - reply_received_time)).count() / 2);
       originating_peer->round_trip_delay = (reply_received_time - current_time_reply_message_received.request_sent_time) -
                                            (current_time_reply_message_received.reply_transmitted_time - current_time_reply_message_received.request_received_time);
+
+      fc::optional<fc::ip::endpoint> endpoint_for_connecting = originating_peer->get_endpoint_for_connecting();
+      if (endpoint_for_connecting)
+      {
+        fc::optional<potential_peer_record> updated_peer_record = _potential_peer_db.lookup_entry_for_endpoint(*endpoint_for_connecting);
+        if (updated_peer_record)
+        {
+          updated_peer_record->latency_ms = (uint32_t)std::max<int64_t>(originating_peer->round_trip_delay.count() / 1000, 1);
+          _potential_peer_db.update_entry(*updated_peer_record);
+        }
+      }
     }
 
     void node_impl::forward_firewall_check_to_next_available_peer(firewall_check_state_data* firewall_check_state)
@@ -3714,7 +3920,7 @@ namespace graphene { namespace net { namespace detail {
         {
           // we're not connected to them, so we need to set up a connection to them
           // to test.
-          peer_connection_ptr peer_for_testing(peer_connection::make_shared(this));
+          peer_connection_ptr peer_for_testing(peer_connection::make_shared(this, _io_thread_pool));
           peer_for_testing->firewall_check_state = new firewall_check_state_data;
           peer_for_testing->firewall_check_state->endpoint_to_test = check_firewall_message_received.endpoint_to_check;
           peer_for_testing->firewall_check_state->expected_node_id = check_firewall_message_received.node_id;
@@ -3873,6 +4079,167 @@ namespace graphene { namespace net { namespace detail {
       VERIFY_CORRECT_THREAD();
     }
 
+    void node_impl::on_compact_block_message(peer_connection* originating_peer,
+                                             const compact_block_message& compact_block_message_received)
+    {
+      VERIFY_CORRECT_THREAD();
+      // compact blocks are only sent in reply to our fetch_items_message, during sync the request is keyed by
+      // block id, otherwise by the message hash of the full block.  The peer tells us that hash, if it doesn't
+      // match the rebuilt block, process_block_message treats the block as one we didn't ask for
+      bool block_was_requested =
+        originating_peer->sync_items_requested_from_peer.find(compact_block_message_received.block_id) !=
+          originating_peer->sync_items_requested_from_peer.end() ||
+        originating_peer->items_requested_from_peer.find(item_id(graphene::net::block_message_type, compact_block_message_received.message_hash)) !=
+          originating_peer->items_requested_from_peer.end();
+      if (!block_was_requested)
+      {
+        wlog("received a compact block ${id} I didn't ask for from peer ${endpoint}, disconnecting from peer",
+             ("id", compact_block_message_received.block_id)("endpoint", originating_peer->get_remote_endpoint()));
+        fc::exception detailed_error(FC_LOG_MESSAGE(error, "You sent me a compact block that I didn't ask for, block_id: ${id}",
+                                                    ("id", compact_block_message_received.block_id)));
+        disconnect_from_peer(originating_peer, "You sent me a compact block that I didn't ask for", true, detailed_error);
+        return;
+      }
+
+      incomplete_compact_block compact_block;
+      compact_block.peer_node_id = originating_peer->node_id;
+      compact_block.received_time = fc::time_point::now();
+      signed_block& block = compact_block.block_message.block;
+      static_cast<signed_block_header&>(block) = compact_block_message_received.header;
+      block.block_id = compact_block_message_received.block_id;
+      compact_block.block_message.block_id = compact_block_message_received.block_id;
+
+      block.transactions.resize(compact_block_message_received.transactions.size());
+      for (uint32_t i = 0; i < compact_block_message_received.transactions.size(); ++i)
+      {
+        const compact_block_transaction& short_transaction = compact_block_message_received.transactions[i];
+        graphene::chain::processed_transaction& transaction = block.transactions[i].second;
+        fc::optional<message> cached_message = _message_cache.find_message_by_contents_hash(short_transaction.short_id, trx_message_type);
+        if (cached_message)
+        {
+          transaction = graphene::chain::processed_transaction(cached_message->as<trx_message>().trx);
+          block.transactions[i].first = transaction.hash();
+        }
+        else
+          compact_block.missing_indexes.push_back(i);
+        transaction.operation_results = short_transaction.operation_results;
+      }
+      dlog("received compact block ${id} from peer ${endpoint}, ${missing} of ${count} transactions missing",
+           ("id", compact_block_message_received.block_id)
+           ("endpoint", originating_peer->get_remote_endpoint())
+           ("missing", compact_block.missing_indexes.size())
+           ("count", compact_block_message_received.transactions.size()));
+
+      if (compact_block.missing_indexes.empty())
+      {
+        process_completed_compact_block(originating_peer, compact_block);
+        return;
+      }
+      originating_peer->send_message(fetch_compact_block_transactions_message(compact_block_message_received.block_id,
+                                                                              compact_block.missing_indexes));
+      _incomplete_compact_blocks.insert(std::move(compact_block));
+    }
+
+    void node_impl::on_fetch_compact_block_transactions_message(peer_connection* originating_peer,
+                                                                const fetch_compact_block_transactions_message& fetch_compact_block_transactions_message_received)
+    {
+      VERIFY_CORRECT_THREAD();
+      item_id block_item(block_message_type, fetch_compact_block_transactions_message_received.block_id);
+      fc::optional<message> block_message_to_send = _message_cache.find_message_by_contents_hash(block_item.item_hash, block_message_type);
+      if (!block_message_to_send)
+      {
+        message requested_message = get_message_for_item(block_item);
+        if (requested_message.msg_type != block_message_type)
+        {
+          originating_peer->send_message(item_not_available_message(block_item));
+          return;
+        }
+        block_message_to_send = requested_message;
+      }
+
+      const signed_block& block = block_message_to_send->as<graphene::net::block_message>().block;
+      compact_block_transactions_message reply;
+      reply.block_id = fetch_compact_block_transactions_message_received.block_id;
+      for (uint32_t index : fetch_compact_block_transactions_message_received.indexes)
+        if (index < block.transactions.size())
+        {
+          reply.indexes.push_back(index);
+          reply.transactions.push_back(block.transactions[index].second);
+        }
+      originating_peer->send_message(reply);
+    }
+
+    void node_impl::on_compact_block_transactions_message(peer_connection* originating_peer,
+                                                          const compact_block_transactions_message& compact_block_transactions_message_received)
+    {
+      VERIFY_CORRECT_THREAD();
+      fc::optional<incomplete_compact_block> waiting_block = _incomplete_compact_blocks.take(compact_block_transactions_message_received.block_id,
+                                                                                             originating_peer->node_id);
+      if (!waiting_block)
+      {
+        dlog("received transactions for compact block ${id} that I'm not waiting for", ("id", compact_block_transactions_message_received.block_id));
+        return;
+      }
+      incomplete_compact_block& compact_block = *waiting_block;
+
+      std::vector<std::pair<graphene::chain::tx_hash_type, graphene::chain::processed_transaction>>& transactions = compact_block.block_message.block.transactions;
+      const auto& received_transactions = compact_block_transactions_message_received.transactions;
+      const auto& received_indexes = compact_block_transactions_message_received.indexes;
+      if (received_indexes.size() != received_transactions.size() ||
+          received_indexes.size() != compact_block.missing_indexes.size())
+      {
+        disconnect_from_peer(originating_peer, "You sent me an incomplete reply to a compact block transaction request");
+        return;
+      }
+      for (uint32_t i = 0; i < received_indexes.size(); ++i)
+      {
+        if (received_indexes[i] != compact_block.missing_indexes[i])
+        {
+          disconnect_from_peer(originating_peer, "You sent me transactions I didn't ask for");
+          return;
+        }
+        graphene::chain::processed_transaction& transaction = transactions[received_indexes[i]].second;
+        std::vector<graphene::chain::operation_result> operation_results = std::move(transaction.operation_results);
+        transaction = graphene::chain::processed_transaction(received_transactions[i]);
+        transaction.operation_results = std::move(operation_results);
+        transactions[received_indexes[i]].first = transaction.hash();
+      }
+      compact_block.missing_indexes.clear();
+      process_completed_compact_block(originating_peer, compact_block);
+    }
+
+    void node_impl::process_completed_compact_block(peer_connection* originating_peer, incomplete_compact_block& compact_block)
+    {
+      VERIFY_CORRECT_THREAD();
+      signed_block& block = compact_block.block_message.block;
+      if (block.calculate_merkle_root() != block.transaction_merkle_root)
+      {
+        // transaction ids don't cover signatures, so a transaction we had cached may carry different
+        // signatures than the one in the block.  Ask for all of them once before blaming the peer
+        if (!compact_block.requested_all_transactions)
+        {
+          compact_block.requested_all_transactions = true;
+          compact_block.received_time = fc::time_point::now();
+          compact_block.missing_indexes.resize(block.transactions.size());
+          for (uint32_t i = 0; i < block.transactions.size(); ++i)
+            compact_block.missing_indexes[i] = i;
+          originating_peer->send_message(fetch_compact_block_transactions_message(compact_block.block_message.block_id,
+                                                                                  compact_block.missing_indexes));
+          _incomplete_compact_blocks.insert(std::move(compact_block));
+          return;
+        }
+        wlog("compact block ${id} from peer ${endpoint} doesn't match its merkle root",
+             ("id", compact_block.block_message.block_id)("endpoint", originating_peer->get_remote_endpoint()));
+        disconnect_from_peer(originating_peer, "You sent me a compact block that doesn't match its merkle root", true,
+                             fc::exception(FC_LOG_MESSAGE(error, "compact block ${id} doesn't match its merkle root",
+                                                          ("id", compact_block.block_message.block_id))));
+        return;
+      }
+      // from here on it's the block the peer would have sent in full, including its message hash
+      message block_message_to_process(compact_block.block_message);
+      process_block_message(originating_peer, block_message_to_process, block_message_to_process.id());
+    }
+
 
     // this handles any message we get that doesn't require any special processing.
     // currently, this is any message other than block messages and p2p-specific
@@ -3899,7 +4266,9 @@ namespace graphene { namespace net { namespace detail {
       }
       else
       {
+        record_fetch_round_trip( originating_peer, iter->second );
         originating_peer->items_requested_from_peer.erase( iter );
+        originating_peer->known_items.insert( item_id(message_to_process.msg_type, message_hash) );
         if (originating_peer->idle())
           trigger_fetch_items_loop();
 
@@ -4271,7 +4640,7 @@ namespace graphene { namespace net { namespace detail {
       VERIFY_CORRECT_THREAD();
       while ( !_accept_loop_complete.canceled() )
       {
-        peer_connection_ptr new_peer(peer_connection::make_shared(this));
+        peer_connection_ptr new_peer(peer_connection::make_shared(this, _io_thread_pool));
 
         try
         {
@@ -4513,7 +4882,8 @@ namespace graphene { namespace net { namespace detail {
       fc::path potential_peer_database_file_name(_node_configuration_directory / POTENTIAL_PEER_DATABASE_FILENAME);
       try
       {
-        _potential_peer_db.open(potential_peer_database_file_name);
+        _potential_peer_db.open(potential_peer_database_file_name,
+                                _node_configuration_directory / LEGACY_POTENTIAL_PEER_DATABASE_FILENAME);
 
         // push back the time on all peers loaded from the database so we will be able to retry them immediately
         for (peer_database::iterator itr = _potential_peer_db.begin(); itr != _potential_peer_db.end(); ++itr)
@@ -4701,7 +5071,7 @@ namespace graphene { namespace net { namespace detail {
                            ("endpoint", remote_endpoint));
 
       dlog("node_impl::connect_to_endpoint(${endpoint})", ("endpoint", remote_endpoint));
-      peer_connection_ptr new_peer(peer_connection::make_shared(this));
+      peer_connection_ptr new_peer(peer_connection::make_shared(this, _io_thread_pool));
       new_peer->set_remote_endpoint(remote_endpoint);
       initiate_connect_to(new_peer);
     }
@@ -4784,7 +5154,6 @@ namespace graphene { namespace net { namespace detail {
       ilog( "--------- MEMORY USAGE ------------" );
       ilog( "node._active_sync_requests size: ${size}", ("size", _active_sync_requests.size() ) );
       ilog( "node._received_sync_items size: ${size}", ("size", _received_sync_items.size() ) );
-      ilog( "node._new_received_sync_items size: ${size}", ("size", _new_received_sync_items.size() ) );
       ilog( "node._items_to_fetch size: ${size}", ("size", _items_to_fetch.size() ) );
       ilog( "node._new_inventory size: ${size}", ("size", _new_inventory.size() ) );
       ilog( "node._message_cache size: ${size}", ("size", _message_cache.size() ) );
@@ -4798,6 +5167,8 @@ namespace graphene { namespace net { namespace detail {
         ilog( "    peer.sync_items_requested_from_peer size: ${size}", ("size", peer->sync_items_requested_from_peer.size() ) );
       }
       ilog( "--------- END MEMORY USAGE ------------" );
+      // one line of JSON so it can be picked out of the log and graphed
+      ilog( "p2p telemetry: ${telemetry}", ("telemetry", fc::json::to_string(get_p2p_telemetry())) );
     }
 
     void node_impl::disconnect_from_peer( peer_connection* peer_to_disconnect,
@@ -4967,9 +5338,12 @@ namespace graphene { namespace net { namespace detail {
       transaction_id_type hash_of_message_contents;
       if( item_to_broadcast.msg_type == graphene::net::block_message_type )
       {
-        graphene::net::block_message block_message_to_broadcast = item_to_broadcast.as<graphene::net::block_message>();
-        hash_of_message_contents = block_message_to_broadcast.block_id; // for debugging
-        _most_recent_blocks_accepted.push_back( block_message_to_broadcast.block_id );
+        // block_id is the last field of a packed block_message, read it instead of unpacking the whole block
+        block_id_type block_id;
+        FC_ASSERT( item_to_broadcast.data.size() >= sizeof(block_id) );
+        memcpy( block_id.data(), item_to_broadcast.data.data() + item_to_broadcast.data.size() - sizeof(block_id), sizeof(block_id) );
+        hash_of_message_contents = block_id; // for debugging
+        _most_recent_blocks_accepted.push_back( block_id );
       }
       else if( item_to_broadcast.msg_type == graphene::net::trx_message_type )
       {
@@ -4981,6 +5355,8 @@ namespace graphene { namespace net { namespace detail {
 
       _message_cache.cache_message( item_to_broadcast, hash_of_item_to_broadcast, propagation_data, hash_of_message_contents );
       _new_inventory.insert( item_id(item_to_broadcast.msg_type, hash_of_item_to_broadcast ) );
+      if( item_to_broadcast.msg_type == graphene::net::block_message_type )
+        _block_inventory_pending = true;
       trigger_advertise_inventory_loop();
     }
 
@@ -5024,6 +5400,9 @@ namespace graphene { namespace net { namespace detail {
     void node_impl::set_advanced_node_parameters(const fc::variant_object& params)
     {
       VERIFY_CORRECT_THREAD();
+      FC_ASSERT(!params.contains("io_threads") || params["io_threads"].as<uint32_t>() == 0 ||
+                (_rate_limiter.get_upload_limit() == 0 && _rate_limiter.get_download_limit() == 0),
+                "I/O threads can't be used while a total bandwidth limit is set");
       if (params.contains("peer_connection_retry_timeout"))
         _peer_connection_retry_timeout = params["peer_connection_retry_timeout"].as<uint32_t>();
       if (params.contains("desired_number_of_connections"))
@@ -5036,6 +5415,8 @@ namespace graphene { namespace net { namespace detail {
         _maximum_number_of_sync_blocks_to_prefetch = params["maximum_number_of_sync_blocks_to_prefetch"].as<uint32_t>();
       if (params.contains("maximum_blocks_per_peer_during_syncing"))
         _maximum_blocks_per_peer_during_syncing = params["maximum_blocks_per_peer_during_syncing"].as<uint32_t>();
+      if (params.contains("io_threads"))
+        _io_thread_pool->set_thread_count(params["io_threads"].as<uint32_t>());
 
       _desired_number_of_connections = std::min(_desired_number_of_connections, _maximum_number_of_connections);
 
@@ -5055,6 +5436,7 @@ namespace graphene { namespace net { namespace detail {
       result["maximum_number_of_blocks_to_handle_at_one_time"] = _maximum_number_of_blocks_to_handle_at_one_time;
       result["maximum_number_of_sync_blocks_to_prefetch"] = _maximum_number_of_sync_blocks_to_prefetch;
       result["maximum_blocks_per_peer_during_syncing"] = _maximum_blocks_per_peer_during_syncing;
+      result["io_threads"] = _io_thread_pool->get_thread_count();
       return result;
     }
 
@@ -5099,6 +5481,19 @@ namespace graphene { namespace net { namespace detail {
     void node_impl::set_total_bandwidth_limit( uint32_t upload_bytes_per_second, uint32_t download_bytes_per_second )
     {
       VERIFY_CORRECT_THREAD();
+      // the rate limiter queues limited reads and writes on this thread and isn't safe to call from the I/O threads,
+      // connections can't be moved off them once open
+      if (upload_bytes_per_second || download_bytes_per_second)
+      {
+        FC_ASSERT(_io_thread_pool->get_connection_count() == 0,
+                  "Can't limit bandwidth while ${count} connections do their I/O on I/O threads, set io_threads to 0 before connecting",
+                  ("count", _io_thread_pool->get_connection_count()));
+        if (_io_thread_pool->get_thread_count())
+        {
+          wlog("bandwidth limits are set, connections will do their I/O on the p2p thread");
+          _io_thread_pool->set_thread_count(0);
+        }
+      }
       _rate_limiter.set_upload_limit( upload_bytes_per_second );
       _rate_limiter.set_download_limit( download_bytes_per_second );
     }
@@ -5115,6 +5510,24 @@ namespace graphene { namespace net { namespace detail {
       return _delegate->get_call_statistics();
     }
 
+    fc::variant_object node_impl::get_p2p_telemetry() const
+    {
+      VERIFY_CORRECT_THREAD();
+      fc::mutable_variant_object telemetry(_telemetry.to_variant());
+      telemetry["block_propagation_delay"] = _block_propagation_delay.to_variant();
+      telemetry["delegate_calls"] = _delegate->get_call_statistics();
+
+      fc::mutable_variant_object peers;
+      for (const peer_connection_ptr& peer : _active_connections)
+      {
+        fc::optional<fc::ip::endpoint> endpoint = peer->get_remote_endpoint();
+        if (endpoint)
+          peers[(std::string)*endpoint] = peer->telemetry.to_variant();
+      }
+      telemetry["peers"] = peers;
+      return telemetry;
+    }
+
     fc::variant_object node_impl::network_get_info() const
     {
       VERIFY_CORRECT_THREAD();
@@ -5323,6 +5736,11 @@ namespace graphene { namespace net { namespace detail {
     INVOKE_IN_IMPL(get_call_statistics);
   }
 
+  fc::variant_object node::get_p2p_telemetry() const
+  {
+    INVOKE_IN_IMPL(get_p2p_telemetry);
+  }
+
   fc::variant_object node::network_get_info() const
   {
     INVOKE_IN_IMPL(network_get_info);
@@ -5525,6 +5943,8 @@ namespace graphene { namespace net { namespace detail {
 
     void statistics_gathering_node_delegate_wrapper::handle_transaction( const graphene::net::trx_message& transaction_message )
     {
+      // called here rather than on the delegate thread, so transactions failing the cheap checks never queue up there
+      _node_delegate->prevalidate_transaction(transaction_message);
       INVOKE_AND_COLLECT_STATISTICS(handle_transaction, transaction_message);
     }
 
@@ -71,9 +71,43 @@ namespace graphene { namespace net
       return sizeof(item_id);
     }
 
-    peer_connection::peer_connection(peer_connection_delegate* delegate) :
+    static const fc::bloom_parameters& known_item_filter_parameters()
+    {
+      static const fc::bloom_parameters parameters = []() {
+        fc::bloom_parameters result;
+        result.projected_element_count = GRAPHENE_NET_KNOWN_ITEM_FILTER_SIZE;
+        result.false_positive_probability = GRAPHENE_NET_KNOWN_ITEM_FILTER_FALSE_POSITIVE_RATE;
+        result.compute_optimal_parameters();
+        return result;
+      }();
+      return parameters;
+    }
+
+    known_item_filter::known_item_filter() :
+      _current(known_item_filter_parameters()),
+      _previous(known_item_filter_parameters())
+    {
+    }
+
+    void known_item_filter::insert(const item_id& item)
+    {
+      if (_current.element_count() >= GRAPHENE_NET_KNOWN_ITEM_FILTER_SIZE)
+      {
+        _previous = _current;
+        _current.clear();
+      }
+      _current.insert(item.item_hash.data(), item.item_hash.data_size());
+    }
+
+    bool known_item_filter::contains(const item_id& item) const
+    {
+      return _current.contains(item.item_hash.data(), item.item_hash.data_size()) ||
+             _previous.contains(item.item_hash.data(), item.item_hash.data_size());
+    }
+
+    peer_connection::peer_connection(peer_connection_delegate* delegate, const io_thread_pool_ptr& io_threads) :
       _node(delegate),
-      _message_connection(this),
+      _message_connection(this, io_threads),
       _total_queued_messages_size(0),
       direction(peer_connection_direction::unknown),
       is_firewalled(firewalled_state::unknown),
@@ -82,9 +116,13 @@ namespace graphene { namespace net
       their_state(their_connection_state::disconnected),
       we_have_requested_close(false),
       negotiation_status(connection_negotiation_status::disconnected),
+      supports_compact_blocks(false),
       number_of_unfetched_item_ids(0),
       peer_needs_sync_items_from_us(true),
       we_need_sync_items_from_peer(true),
+      sync_range_size(0),
+      sync_blocks_per_second(0),
+      sync_range_stalled(false),
       inhibit_fetching_sync_blocks(false),
       transaction_fetching_inhibited_until(fc::time_point::min()),
       last_known_fork_block_number(0),
@@ -97,7 +135,7 @@ namespace graphene { namespace net
     {
     }
 
-    peer_connection_ptr peer_connection::make_shared(peer_connection_delegate* delegate)
+    peer_connection_ptr peer_connection::make_shared(peer_connection_delegate* delegate, const io_thread_pool_ptr& io_threads)
     {
       // The lifetime of peer_connection objects is managed by shared_ptrs in node.  The peer_connection
       // is responsible for notifying the node when it should be deleted, and the process of deleting it
@@ -107,7 +145,7 @@ namespace graphene { namespace net
       // current task yields.  In the (not uncommon) case where it is the task executing
       // connect_to or read_loop, this allows the task to finish before the destructor is forced
       // to cancel it.
-      return peer_connection_ptr(new peer_connection(delegate));
+      return peer_connection_ptr(new peer_connection(delegate, io_threads));
       //, [](peer_connection* peer_to_delete){ fc::async([peer_to_delete](){delete peer_to_delete;}); });
     }
 
@@ -302,6 +340,7 @@ namespace graphene { namespace net
           //    "to send message of type ${type} for peer ${endpoint}",
           //    ("type", message_to_send.msg_type)("endpoint", get_remote_endpoint()));
           _message_connection.send_message(message_to_send);
+          _node->on_message_sent(this, message_to_send);
           //dlog("peer_connection::send_queued_messages_task()'s call to message_oriented_connection::send_message() completed normally for peer ${endpoint}",
           //    ("endpoint", get_remote_endpoint()));
         }
@@ -429,6 +468,18 @@ namespace graphene { namespace net
       return _message_connection.get_last_message_received_time();
     }
 
+    fc::microseconds peer_connection::get_last_message_decode_time() const
+    {
+      VERIFY_CORRECT_THREAD();
+      return _message_connection.get_last_message_decode_time();
+    }
+
+    fc::microseconds peer_connection::get_last_message_queue_wait() const
+    {
+      VERIFY_CORRECT_THREAD();
+      return _message_connection.get_last_message_queue_wait();
+    }
+
     fc::optional<fc::ip::endpoint> peer_connection::get_remote_endpoint()
     {
       VERIFY_CORRECT_THREAD();
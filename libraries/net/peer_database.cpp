@@ -32,8 +32,12 @@
 #include <fc/io/raw_variant.hpp>
 #include <fc/log/logger.hpp>
 #include <fc/io/json.hpp>
+#include <fc/filesystem.hpp>
+
+#include <fstream>
 
 #include <graphene/net/peer_database.hpp>
+#include <graphene/net/config.hpp>
 
 
 
@@ -47,6 +51,7 @@ namespace graphene { namespace net {
     public:
       struct last_seen_time_index {};
       struct endpoint_index {};
+      struct preference_index {};
       typedef boost::multi_index_container<potential_peer_record, 
                                            indexed_by<ordered_non_unique<tag<last_seen_time_index>, 
                                                                          member<potential_peer_record, 
@@ -56,14 +61,32 @@ namespace graphene { namespace net {
                                                                     member<potential_peer_record, 
                                                                            fc::ip::endpoint, 
                                                                            &potential_peer_record::endpoint>, 
-                                                                    std::hash<fc::ip::endpoint> > > > potential_peer_set;
+                                                                    std::hash<fc::ip::endpoint> >,
+                                                      ordered_non_unique<tag<preference_index>,
+                                                                         const_mem_fun<potential_peer_record,
+                                                                                       std::tuple<bool, uint32_t, uint32_t, uint32_t>,
+                                                                                       &potential_peer_record::connection_preference> > > > potential_peer_set;
 
     private:
+      enum log_entry_type : uint8_t
+      {
+        log_update,
+        log_erase
+      };
+
       potential_peer_set     _potential_peer_set;
       fc::path _peer_database_filename;
+      std::ofstream _log;
+      size_t _log_entries = 0;
+
+      void replay_log();
+      void import_json(const fc::path& json_filename);
+      void prune();
+      void append_to_log(log_entry_type type, const std::vector<char>& data);
+      void rewrite_log();
 
     public:
-      void open(const fc::path& databaseFilename);
+      void open(const fc::path& databaseFilename, const fc::path& legacy_json_filename);
       void close();
       void clear();
       void erase(const fc::ip::endpoint& endpointToErase);
@@ -73,78 +96,190 @@ namespace graphene { namespace net {
 
       peer_database::iterator begin() const;
       peer_database::iterator end() const;
+      peer_database::iterator begin_by_preference() const;
+      peer_database::iterator end_by_preference() const;
       size_t size() const;
     };
 
-    class peer_database_iterator_impl
+    template<typename Iterator>
+    class peer_database_index_iterator_impl : public peer_database_iterator_impl
     {
     public:
-      typedef peer_database_impl::potential_peer_set::index<peer_database_impl::last_seen_time_index>::type::iterator last_seen_time_index_iterator;
-      last_seen_time_index_iterator _iterator;
-      peer_database_iterator_impl(const last_seen_time_index_iterator& iterator) :
+      Iterator _iterator;
+      peer_database_index_iterator_impl(const Iterator& iterator) :
         _iterator(iterator)
       {}
+      virtual void increment() override { ++_iterator; }
+      virtual bool equal(const peer_database_iterator_impl& other) const override
+      {
+        return _iterator == static_cast<const peer_database_index_iterator_impl&>(other)._iterator;
+      }
+      virtual const potential_peer_record& dereference() const override { return *_iterator; }
     };
+    typedef peer_database_index_iterator_impl<peer_database_impl::potential_peer_set::index<peer_database_impl::last_seen_time_index>::type::iterator> last_seen_time_iterator_impl;
+    typedef peer_database_index_iterator_impl<peer_database_impl::potential_peer_set::index<peer_database_impl::preference_index>::type::iterator> preference_iterator_impl;
+
     peer_database_iterator::peer_database_iterator( const peer_database_iterator& c ) :
       boost::iterator_facade<peer_database_iterator, const potential_peer_record, boost::forward_traversal_tag>(c){}
 
-    void peer_database_impl::open(const fc::path& peer_database_filename)
+#define PEERDB_LOG_MAGIC 0x42445047 // "GPDB"
+
+    void peer_database_impl::open(const fc::path& peer_database_filename, const fc::path& legacy_json_filename)
     {
       _peer_database_filename = peer_database_filename;
       if (fc::exists(_peer_database_filename))
+        replay_log();
+      else if (!legacy_json_filename.string().empty() && fc::exists(legacy_json_filename))
+        import_json(legacy_json_filename);
+      prune();
+
+      // start from a compact log, this also drops a torn entry left at the end by a crash
+      rewrite_log();
+    }
+
+    void peer_database_impl::replay_log()
+    {
+      try
       {
-        try
+        std::ifstream log(_peer_database_filename.generic_string().c_str(), std::ios::binary);
+        uint32_t magic = 0;
+        log.read((char*)&magic, sizeof(magic));
+        FC_ASSERT(log && magic == PEERDB_LOG_MAGIC, "not a peer database");
+        while (true)
         {
-          std::vector<potential_peer_record> peer_records = fc::json::from_file(_peer_database_filename).as<std::vector<potential_peer_record> >();
-          std::copy(peer_records.begin(), peer_records.end(), std::inserter(_potential_peer_set, _potential_peer_set.end()));
-#define MAXIMUM_PEERDB_SIZE 1000
-          if (_potential_peer_set.size() > MAXIMUM_PEERDB_SIZE)
+          uint8_t type;
+          uint32_t size;
+          log.read((char*)&type, sizeof(type));
+          log.read((char*)&size, sizeof(size));
+          if (!log)
+            break;
+          std::vector<char> data(size);
+          log.read(data.data(), size);
+          if (!log)
           {
-            // prune database to a reasonable size
-            auto iter = _potential_peer_set.begin();
-            std::advance(iter, MAXIMUM_PEERDB_SIZE);
-            _potential_peer_set.erase(iter, _potential_peer_set.end());
+            wlog("ignoring an incomplete entry at the end of peer database ${file}", ("file", _peer_database_filename));
+            break;
           }
+          if (type == log_update)
+          {
+            potential_peer_record record = fc::raw::unpack<potential_peer_record>(data);
+            auto iter = _potential_peer_set.get<endpoint_index>().find(record.endpoint);
+            if (iter != _potential_peer_set.get<endpoint_index>().end())
+              _potential_peer_set.get<endpoint_index>().replace(iter, record);
+            else
+              _potential_peer_set.insert(record);
+          }
+          else if (type == log_erase)
+            _potential_peer_set.get<endpoint_index>().erase(fc::raw::unpack<fc::ip::endpoint>(data));
         }
-        catch (const fc::exception& e)
-        {
-          elog("error opening peer database file ${peer_database_filename}, starting with a clean database", 
-               ("peer_database_filename", _peer_database_filename));
-        }
+      }
+      catch (const fc::exception& e)
+      {
+        elog("error opening peer database file ${peer_database_filename}, starting with a clean database: ${e}",
+             ("peer_database_filename", _peer_database_filename)("e", e.to_detail_string()));
+        _potential_peer_set.clear();
       }
     }
 
-    void peer_database_impl::close()
+    void peer_database_impl::import_json(const fc::path& json_filename)
     {
-      std::vector<potential_peer_record> peer_records;
-      peer_records.reserve(_potential_peer_set.size());
-      std::copy(_potential_peer_set.begin(), _potential_peer_set.end(), std::back_inserter(peer_records));
+      try
+      {
+        std::vector<potential_peer_record> peer_records = fc::json::from_file(json_filename).as<std::vector<potential_peer_record> >();
+        std::copy(peer_records.begin(), peer_records.end(), std::inserter(_potential_peer_set, _potential_peer_set.end()));
+        ilog("imported ${count} peers from ${file}", ("count", _potential_peer_set.size())("file", json_filename));
+      }
+      catch (const fc::exception& e)
+      {
+        elog("error importing peer database file ${json_filename}, starting with a clean database",
+             ("json_filename", json_filename));
+      }
+    }
+
+    void peer_database_impl::prune()
+    {
+      // prune database to a reasonable size, keeping the peers we prefer
+      auto& preference_idx = _potential_peer_set.get<preference_index>();
+      while (_potential_peer_set.size() > GRAPHENE_NET_MAXIMUM_PEERDB_SIZE)
+        preference_idx.erase(std::prev(preference_idx.end()));
+    }
 
+    void peer_database_impl::rewrite_log()
+    {
+      if (_peer_database_filename.string().empty())
+        return;
       try
       {
+        if (_log.is_open())
+          _log.close();
         fc::path peer_database_filename_dir = _peer_database_filename.parent_path();
         if (!fc::exists(peer_database_filename_dir))
           fc::create_directories(peer_database_filename_dir);
-        fc::json::save_to_file(peer_records, _peer_database_filename);
+
+        fc::path temporary_filename = _peer_database_filename.generic_string() + ".tmp";
+        {
+          std::ofstream out(temporary_filename.generic_string().c_str(), std::ios::binary | std::ios::trunc);
+          const uint32_t magic = PEERDB_LOG_MAGIC;
+          out.write((const char*)&magic, sizeof(magic));
+          for (const potential_peer_record& record : _potential_peer_set)
+          {
+            std::vector<char> data = fc::raw::pack(record);
+            const uint8_t type = log_update;
+            const uint32_t size = data.size();
+            out.write((const char*)&type, sizeof(type));
+            out.write((const char*)&size, sizeof(size));
+            out.write(data.data(), data.size());
+          }
+          out.flush();
+          FC_ASSERT(out, "unable to write ${file}", ("file", temporary_filename));
+        }
+        fc::rename(temporary_filename, _peer_database_filename);
+        _log_entries = _potential_peer_set.size();
+        _log.open(_peer_database_filename.generic_string().c_str(), std::ios::binary | std::ios::app);
       }
       catch (const fc::exception& e)
       {
-        elog("error saving peer database to file ${peer_database_filename}", 
-             ("peer_database_filename", _peer_database_filename));
+        elog("error saving peer database to file ${peer_database_filename}: ${e}",
+             ("peer_database_filename", _peer_database_filename)("e", e.to_detail_string()));
       }
+    }
+
+    void peer_database_impl::append_to_log(log_entry_type type, const std::vector<char>& data)
+    {
+      if (!_log.is_open())
+        return;
+      const uint8_t entry_type = type;
+      const uint32_t size = data.size();
+      _log.write((const char*)&entry_type, sizeof(entry_type));
+      _log.write((const char*)&size, sizeof(size));
+      _log.write(data.data(), data.size());
+      _log.flush();
+      if (++_log_entries > 4 * _potential_peer_set.size() + GRAPHENE_NET_MAXIMUM_PEERDB_SIZE)
+        rewrite_log();
+    }
+
+    void peer_database_impl::close()
+    {
+      if (_log.is_open())
+        _log.close();
       _potential_peer_set.clear();
+      _log_entries = 0;
     }
 
     void peer_database_impl::clear()
     {
       _potential_peer_set.clear();
+      rewrite_log();
     }
 
     void peer_database_impl::erase(const fc::ip::endpoint& endpointToErase)
     {
       auto iter = _potential_peer_set.get<endpoint_index>().find(endpointToErase);
       if (iter != _potential_peer_set.get<endpoint_index>().end())
+      {
         _potential_peer_set.get<endpoint_index>().erase(iter);
+        append_to_log(log_erase, fc::raw::pack(endpointToErase));
+      }
     }
 
     void peer_database_impl::update_entry(const potential_peer_record& updatedRecord)
@@ -153,7 +288,21 @@ namespace graphene { namespace net {
       if (iter != _potential_peer_set.get<endpoint_index>().end())
         _potential_peer_set.get<endpoint_index>().modify(iter, [&updatedRecord](potential_peer_record& record) { record = updatedRecord; });
       else
+      {
         _potential_peer_set.get<endpoint_index>().insert(updatedRecord);
+        if (_potential_peer_set.size() > GRAPHENE_NET_MAXIMUM_PEERDB_SIZE)
+        {
+          auto& preference_idx = _potential_peer_set.get<preference_index>();
+          auto least_preferred = std::prev(preference_idx.end());
+          if (least_preferred->endpoint != updatedRecord.endpoint)
+            append_to_log(log_erase, fc::raw::pack(least_preferred->endpoint));
+          preference_idx.erase(least_preferred);
+        }
+        // the new record may have been the one evicted, logging it would bring it back on the next open
+        if (_potential_peer_set.get<endpoint_index>().find(updatedRecord.endpoint) == _potential_peer_set.get<endpoint_index>().end())
+          return;
+      }
+      append_to_log(log_update, fc::raw::pack(updatedRecord));
     }
 
     potential_peer_record peer_database_impl::lookup_or_create_entry_for_endpoint(const fc::ip::endpoint& endpointToLookup)
@@ -174,12 +323,22 @@ namespace graphene { namespace net {
 
     peer_database::iterator peer_database_impl::begin() const
     {
-      return peer_database::iterator(new peer_database_iterator_impl(_potential_peer_set.get<last_seen_time_index>().begin()));
+      return peer_database::iterator(new last_seen_time_iterator_impl(_potential_peer_set.get<last_seen_time_index>().begin()));
     }
 
     peer_database::iterator peer_database_impl::end() const
     {
-      return peer_database::iterator(new peer_database_iterator_impl(_potential_peer_set.get<last_seen_time_index>().end()));
+      return peer_database::iterator(new last_seen_time_iterator_impl(_potential_peer_set.get<last_seen_time_index>().end()));
+    }
+
+    peer_database::iterator peer_database_impl::begin_by_preference() const
+    {
+      return peer_database::iterator(new preference_iterator_impl(_potential_peer_set.get<preference_index>().begin()));
+    }
+
+    peer_database::iterator peer_database_impl::end_by_preference() const
+    {
+      return peer_database::iterator(new preference_iterator_impl(_potential_peer_set.get<preference_index>().end()));
     }
 
     size_t peer_database_impl::size() const
@@ -202,17 +361,17 @@ namespace graphene { namespace net {
 
     void peer_database_iterator::increment()
     {
-      ++my->_iterator;
+      my->increment();
     }
 
     bool peer_database_iterator::equal(const peer_database_iterator& other) const
     {
-      return my->_iterator == other.my->_iterator;
+      return my->equal(*other.my);
     }
 
     const potential_peer_record& peer_database_iterator::dereference() const
     {
-      return *my->_iterator;
+      return my->dereference();
     }
 
   } // end namespace detail
@@ -225,9 +384,9 @@ namespace graphene { namespace net {
   peer_database::~peer_database()
   {}
 
-  void peer_database::open(const fc::path& databaseFilename)
+  void peer_database::open(const fc::path& databaseFilename, const fc::path& legacy_json_filename)
   {
-    my->open(databaseFilename);
+    my->open(databaseFilename, legacy_json_filename);
   }
 
   void peer_database::close()
@@ -270,6 +429,16 @@ namespace graphene { namespace net {
     return my->end();
   }
 
+  peer_database::iterator peer_database::begin_by_preference() const
+  {
+    return my->begin_by_preference();
+  }
+
+  peer_database::iterator peer_database::end_by_preference() const
+  {
+    return my->end_by_preference();
+  }
+
   size_t peer_database::size() const
   {
     return my->size();
@@ -0,0 +1,85 @@
+#include <graphene/net/sync_scheduler.hpp>
+#include <graphene/net/config.hpp>
+
+#include <algorithm>
+
+namespace graphene { namespace net {
+
+  uint32_t sync_range_size(double blocks_per_second, uint32_t maximum_blocks_per_peer)
+  {
+    uint32_t min_range = std::min<uint32_t>(GRAPHENE_NET_MIN_BLOCKS_PER_PEER_DURING_SYNCING, maximum_blocks_per_peer);
+    if (blocks_per_second <= 0)
+      return min_range;
+    double range = blocks_per_second * GRAPHENE_NET_SYNC_RANGE_TARGET_SECONDS;
+    return std::max<uint32_t>(min_range, (uint32_t)std::min<double>(range, maximum_blocks_per_peer));
+  }
+
+  double sync_throughput_after_range(double blocks_per_second, uint32_t range_size, const fc::microseconds& elapsed)
+  {
+    fc::microseconds range_time = std::max(elapsed, fc::milliseconds(1));
+    double range_blocks_per_second = range_size * 1000000.0 / range_time.count();
+    return blocks_per_second <= 0 ? range_blocks_per_second : (blocks_per_second + range_blocks_per_second) / 2;
+  }
+
+  std::vector<item_hash_t> select_sync_range(const boost::container::deque<item_hash_t>& ids_of_items_to_get, uint32_t range_size,
+                                             const std::function<bool(const item_hash_t&)>& is_available)
+  {
+    std::vector<item_hash_t> range;
+    for (auto iter = ids_of_items_to_get.begin(); iter != ids_of_items_to_get.end() && range.size() < range_size; ++iter)
+    {
+      if (is_available(*iter))
+        range.push_back(*iter);
+      else if (!range.empty())
+        break;
+    }
+    return range;
+  }
+
+  sync_block_buffer::sync_block_buffer(size_t processed_ids_to_remember) :
+    _processed_ids(processed_ids_to_remember)
+  {}
+
+  bool sync_block_buffer::insert(const graphene::net::block_message& block)
+  {
+    if (block.block.block_num() <= _last_processed_block_num &&
+        std::find(_processed_ids.begin(), _processed_ids.end(), block.block_id) != _processed_ids.end())
+      return false;
+    return _blocks.insert(buffered_block{block.block_id, block.block.block_num(), block}).second;
+  }
+
+  bool sync_block_buffer::contains(const item_hash_t& block_id) const
+  {
+    return _blocks.get<by_block_id>().find(block_id) != _blocks.get<by_block_id>().end();
+  }
+
+  fc::optional<graphene::net::block_message> sync_block_buffer::take(const item_hash_t& block_id)
+  {
+    auto& id_index = _blocks.get<by_block_id>();
+    auto iter = id_index.find(block_id);
+    if (iter == id_index.end())
+      return fc::optional<graphene::net::block_message>();
+    fc::optional<graphene::net::block_message> block(std::move(iter->block));
+    id_index.erase(iter);
+    _last_processed_block_num = std::max(_last_processed_block_num, block->block.block_num());
+    _processed_ids.push_back(block_id);
+    return block;
+  }
+
+  fc::optional<graphene::net::block_message> sync_block_buffer::take_next(const std::set<item_hash_t>& next_ids)
+  {
+    // block ids carry the block number, so only blocks up to the highest of them need a look
+    uint32_t highest_next_num = 0;
+    for (const item_hash_t& id : next_ids)
+      highest_next_num = std::max(highest_next_num, graphene::chain::block_header::num_from_id(id));
+
+    const auto& num_index = _blocks.get<by_block_num>();
+    for (auto iter = num_index.begin(); iter != num_index.end() && iter->block_num <= highest_next_num; ++iter)
+      if (next_ids.count(iter->block_id))
+      {
+        const item_hash_t block_id = iter->block_id; // take() erases the entry iter points to
+        return take(block_id);
+      }
+    return fc::optional<graphene::net::block_message>();
+  }
+
+} } // graphene::net
@@ -0,0 +1,88 @@
+#include <graphene/net/telemetry.hpp>
+#include <graphene/net/core_messages.hpp>
+
+#include <algorithm>
+
+namespace graphene { namespace net {
+
+  void telemetry_histogram::record(uint64_t value)
+  {
+    unsigned bucket = 0;
+    for (uint64_t remaining = value; remaining != 0 && bucket < bucket_count - 1; remaining >>= 1)
+      ++bucket;
+    ++_buckets[bucket];
+    _min = _count ? std::min(_min, value) : value;
+    _max = std::max(_max, value);
+    ++_count;
+    _sum += value;
+  }
+
+  uint64_t telemetry_histogram::percentile(double fraction) const
+  {
+    const uint64_t rank = std::max<uint64_t>((uint64_t)(fraction * _count + 0.5), 1);
+    uint64_t seen = 0;
+    for (unsigned bucket = 0; bucket < bucket_count; ++bucket)
+    {
+      seen += _buckets[bucket];
+      if (seen >= rank)
+        return bucket == 0 ? 0 : std::min<uint64_t>(_max, (uint64_t(1) << bucket) - 1);
+    }
+    return _max;
+  }
+
+  fc::variant_object telemetry_histogram::to_variant() const
+  {
+    fc::mutable_variant_object result;
+    result["count"] = _count;
+    result["sum"] = _sum;
+    if (_count)
+    {
+      result["min"] = _min;
+      result["mean"] = _sum / _count;
+      result["p50"] = percentile(0.5);
+      result["p90"] = percentile(0.9);
+      result["p99"] = percentile(0.99);
+      result["max"] = _max;
+    }
+    return result;
+  }
+
+  fc::variant_object message_type_telemetry::to_variant() const
+  {
+    fc::mutable_variant_object result;
+    result["decode_time"] = decode_time.to_variant();
+    result["queue_wait"] = queue_wait.to_variant();
+    result["handle_time"] = handle_time.to_variant();
+    result["bytes_in"] = bytes_in.to_variant();
+    result["bytes_out"] = bytes_out.to_variant();
+    return result;
+  }
+
+  void message_telemetry::record_received(uint32_t msg_type, uint32_t size, const fc::microseconds& decode_time,
+                                          const fc::microseconds& queue_wait, const fc::microseconds& handle_time)
+  {
+    message_type_telemetry& telemetry = _by_message_type[msg_type];
+    telemetry.decode_time.record(decode_time);
+    telemetry.queue_wait.record(queue_wait);
+    telemetry.handle_time.record(handle_time);
+    telemetry.bytes_in.record(size);
+  }
+
+  void message_telemetry::record_sent(uint32_t msg_type, uint32_t size)
+  {
+    _by_message_type[msg_type].bytes_out.record(size);
+  }
+
+  fc::variant_object message_telemetry::to_variant() const
+  {
+    fc::mutable_variant_object by_message_type;
+    for (const auto& type_and_telemetry : _by_message_type)
+      by_message_type[fc::reflector<core_message_type_enum>::to_fc_string(type_and_telemetry.first)] = type_and_telemetry.second.to_variant();
+
+    fc::mutable_variant_object result;
+    result["messages"] = by_message_type;
+    result["fetch_round_trip"] = _fetch_round_trip.to_variant();
+    return result;
+  }
+
+} } // graphene::net
@@ -68,9 +68,12 @@ class account_history_plugin_impl
       bool _partial_operations = false;
       primary_index< operation_history_index >* _oho_index;
       uint32_t _max_ops_per_account = -1;
+      std::unique_ptr<account_history_store> _history_store;
    private:
       /** add one history record, then check and remove the earliest history record */
       void add_account_history( const account_id_type account_id, const operation_history_id_type op_id );
+      /** record the block's operations in _history_store instead of in chain objects */
+      void update_history_store( const signed_block& b );
 
 };
 
@@ -79,9 +82,61 @@ account_history_plugin_impl::~account_history_plugin_impl()
    return;
 }
 
+static flat_set<account_id_type> get_impacted_accounts( const operation_history_object& op )
+{
+   flat_set<account_id_type> impacted;
+   vector<authority> other;
+   operation_get_required_authorities( op.op, impacted, impacted, other ); // fee_payer is added here
+
+   if( op.op.which() == operation::tag< account_create_operation >::value )
+      impacted.insert( op.result.get<object_id_result>().result );
+   else
+      {  
+         graphene::chain::operation_get_impacted_accounts( op.op, impacted );
+         graphene::chain::get_impacted_accounts_from_operation_reslut(op.result,impacted);
+      }
+   for( auto& a : other )
+      for( auto& item : a.account_auths )
+         impacted.insert( item.first );
+   return impacted;
+}
+
+void account_history_plugin_impl::update_history_store( const signed_block& b )
+{
+   graphene::chain::database& db = database();
+   // blocks replayed after a crash or --replay-blockchain are already on disk
+   if( b.block_num() <= _history_store->last_flushed_block() )
+      return;
+   // a block number seen again means the blocks from it on were popped by a fork switch
+   _history_store->discard_from( b.block_num() );
+
+   for( const optional< operation_history_object >& o_op : db.get_applied_operations() )
+   {
+      if( !o_op.valid() )
+         continue;
+      flat_set<account_id_type> impacted = get_impacted_accounts( *o_op );
+      if( _tracked_accounts.size() > 0 )
+      {
+         flat_set<account_id_type> tracked;
+         for( const auto& account_id : impacted )
+            if( _tracked_accounts.find( account_id ) != _tracked_accounts.end() )
+               tracked.insert( account_id );
+         impacted = std::move( tracked );
+      }
+      if( !impacted.empty() )
+         _history_store->add( *o_op, impacted );
+   }
+   _history_store->flush( db.get_dynamic_global_properties().last_irreversible_block_num );
+}
+
 void account_history_plugin_impl::update_account_histories( const signed_block& b )
 {
    graphene::chain::database& db = database();
+   if( _history_store )
+   {
+      update_history_store( b );
+      return;
+   }
    const vector<optional< operation_history_object > >& hist = db.get_applied_operations();  // 获取历史交易信息
    for( const optional< operation_history_object >& o_op : hist )
    {
@@ -116,20 +171,7 @@ void account_history_plugin_impl::update_account_histories( const signed_block&
       const operation_history_object& op = *o_op;
 
       // get the set of accounts this operation applies to
-      flat_set<account_id_type> impacted;
-      vector<authority> other;
-      operation_get_required_authorities( op.op, impacted, impacted, other ); // fee_payer is added here
-
-      if( op.op.which() == operation::tag< account_create_operation >::value )
-         impacted.insert( op.result.get<object_id_result>().result );
-      else
-         {  
-            graphene::chain::operation_get_impacted_accounts( op.op, impacted );
-            graphene::chain::get_impacted_accounts_from_operation_reslut(op.result,impacted);
-         }
-      for( auto& a : other )
-         for( auto& item : a.account_auths )
-            impacted.insert( item.first );
+      flat_set<account_id_type> impacted = get_impacted_accounts( op );
 
       // be here, either _max_ops_per_account > 0, or _partial_operations == false, or both
       // if _partial_operations == false, oho should have been created above
@@ -279,6 +321,7 @@ void account_history_plugin::plugin_set_program_options(
          ("track-account", boost::program_options::value<std::vector<std::string>>()->composing()->multitoken(), "Account ID to track history for (may specify multiple times)")
          ("partial-operations", boost::program_options::value<bool>(), "Keep only those operations in memory that are related to account history tracking")
          ("max-ops-per-account", boost::program_options::value<uint32_t>(), "Maximum number of operations per account will be kept in memory")
+         ("history-on-disk", boost::program_options::value<bool>()->default_value(false), "Keep the full account history in append-only files under the blockchain directory instead of in memory; partial-operations and max-ops-per-account do not apply")
          ;
    cfg.add(cli);
 }
@@ -297,15 +340,32 @@ void account_history_plugin::plugin_initialize(const boost::program_options::var
    if (options.count("max-ops-per-account")) {
        my->_max_ops_per_account = options["max-ops-per-account"].as<uint32_t>();
    }
+   if (options.count("history-on-disk") && options["history-on-disk"].as<bool>()) {
+       my->_history_store.reset( new account_history_store );
+       my->_history_store->open( database().get_data_dir() / "account_history" );
+   }
 }
 
 void account_history_plugin::plugin_startup()
 {
 }
 
+void account_history_plugin::plugin_shutdown()
+{
+   // the tail is not written: closing the database rewinds to the last irreversible block, and the
+   // blocks after it are applied again on the next start
+   if( my->_history_store )
+      my->_history_store->close();
+}
+
 flat_set<account_id_type> account_history_plugin::tracked_accounts() const
 {
    return my->_tracked_accounts;
 }
 
+const account_history_store* account_history_plugin::history_store() const
+{
+   return my->_history_store.get();
+}
+
 } }
@@ -0,0 +1,357 @@
+#include <graphene/account_history/account_history_store.hpp>
+
+#include <graphene/chain/protocol/fee_schedule.hpp>
+
+#include <fc/io/raw.hpp>
+#include <fc/smart_ref_impl.hpp>
+
+#include <limits>
+
+namespace graphene { namespace account_history {
+
+namespace
+{
+
+struct operation_index_entry
+{
+   uint64_t pos = 0;
+   uint32_t size = 0; ///< 0 for ids that were never written
+};
+
+struct history_page_entry
+{
+   uint64_t operation = 0;
+   uint32_t block_num = 0;
+};
+
+struct history_page_header
+{
+   uint64_t account = 0;
+   uint32_t page_number = 0;
+   uint32_t count = 0;
+};
+
+struct history_page
+{
+   history_page_header header;
+   history_page_entry  entries[account_history_store::page_entries];
+};
+
+struct directory_entry
+{
+   uint64_t account = 0;
+   uint32_t page_number = 0;
+   uint64_t page_pos = 0;
+};
+
+struct head_record
+{
+   uint32_t last_flushed_block = 0;
+   uint64_t next_operation = 0;
+};
+
+void open_file( std::fstream& file, const fc::path& filename )
+{
+   file.exceptions( std::ios_base::failbit | std::ios_base::badbit );
+   if( !fc::exists( filename ) )
+      file.open( filename.generic_string().c_str(), std::fstream::binary | std::fstream::in | std::fstream::out | std::fstream::trunc );
+   else
+      file.open( filename.generic_string().c_str(), std::fstream::binary | std::fstream::in | std::fstream::out );
+}
+
+int64_t file_size( std::fstream& file )
+{
+   file.seekg( 0, file.end );
+   return file.tellg();
+}
+
+} // namespace
+
+const uint32_t account_history_store::page_entries;
+
+void account_history_store::open( const fc::path& dir )
+{ try {
+   std::lock_guard<std::mutex> lock( _mutex );
+   fc::create_directories( dir );
+   open_file( _operations, dir / "operations.log" );
+   open_file( _operation_index, dir / "operations.index" );
+   open_file( _pages, dir / "accounts.pages" );
+   open_file( _directory, dir / "accounts.directory" );
+
+   _head_filename = dir / "head";
+   if( fc::exists( _head_filename ) )
+   {
+      std::ifstream head( _head_filename.generic_string().c_str(), std::ifstream::binary );
+      head_record h;
+      head.read( (char*)&h, sizeof(h) );
+      if( head.gcount() == sizeof(h) )
+      {
+         _last_flushed_block = h.last_flushed_block;
+         _next_operation = h.next_operation;
+      }
+   }
+
+   // a crash may leave a partly written record at the end, and pages allocated after the last flush
+   // are harmless: their entries are newer than the head and get overwritten
+   const int64_t directory_size = file_size( _directory ) / sizeof(directory_entry) * sizeof(directory_entry);
+   const int64_t pages_size = file_size( _pages );
+   _directory.seekg( 0 );
+   for( int64_t pos = 0; pos < directory_size; pos += sizeof(directory_entry) )
+   {
+      directory_entry e;
+      _directory.read( (char*)&e, sizeof(e) );
+      if( int64_t(e.page_pos + sizeof(history_page)) > pages_size )
+         continue;
+      auto& pages = _accounts[e.account].pages;
+      if( pages.size() <= e.page_number )
+         pages.resize( e.page_number + 1 );
+      pages[e.page_number] = e.page_pos;
+   }
+   if( directory_size != file_size( _directory ) )
+      fc::resize_file( dir / "accounts.directory", directory_size );
+} FC_CAPTURE_AND_RETHROW( (dir) ) }
+
+void account_history_store::close()
+{
+   std::lock_guard<std::mutex> lock( _mutex );
+   _operations.close();
+   _operation_index.close();
+   _pages.close();
+   _directory.close();
+   _accounts.clear();
+   _tail_operations.clear();
+   _tail_history.clear();
+}
+
+bool account_history_store::is_open()const
+{
+   return _operations.is_open();
+}
+
+uint32_t account_history_store::last_flushed_block()const
+{
+   std::lock_guard<std::mutex> lock( _mutex );
+   return _last_flushed_block;
+}
+
+void account_history_store::discard_from( uint32_t block_num )
+{
+   std::lock_guard<std::mutex> lock( _mutex );
+   // operation ids grow with the block number, so the operations to drop are at the end
+   auto first = _tail_operations.end();
+   while( first != _tail_operations.begin() && std::prev( first )->second.block_num >= block_num )
+      --first;
+   if( first == _tail_operations.end() )
+      return;
+   _next_operation = first->first;
+   _tail_operations.erase( first, _tail_operations.end() );
+   for( auto itr = _tail_history.begin(); itr != _tail_history.end(); )
+   {
+      if( itr->second >= _next_operation )
+         itr = _tail_history.erase( itr );
+      else
+         ++itr;
+   }
+}
+
+operation_history_id_type account_history_store::add( operation_history_object op, const flat_set<account_id_type>& accounts )
+{
+   std::lock_guard<std::mutex> lock( _mutex );
+   const uint64_t instance = _next_operation++;
+   op.id = operation_history_id_type( instance );
+   for( const auto& account : accounts )
+      _tail_history[std::make_pair( account.instance, total_ops_locked( account ) + 1 )] = instance;
+   _tail_operations.emplace( instance, std::move( op ) );
+   return operation_history_id_type( instance );
+}
+
+void account_history_store::flush( uint32_t last_irreversible_block )
+{ try {
+   std::lock_guard<std::mutex> lock( _mutex );
+   if( last_irreversible_block <= _last_flushed_block )
+      return;
+
+   auto end = _tail_operations.begin();
+   while( end != _tail_operations.end() && end->second.block_num <= last_irreversible_block )
+   {
+      const auto packed = fc::raw::pack( end->second );
+      operation_index_entry e;
+      _operations.seekp( 0, _operations.end );
+      e.pos = _operations.tellp();
+      e.size = packed.size();
+      _operations.write( packed.data(), packed.size() );
+      _operation_index.seekp( sizeof(e) * int64_t(end->first) );
+      _operation_index.write( (char*)&e, sizeof(e) );
+      ++end;
+   }
+   const uint64_t first_kept = end == _tail_operations.end() ? _next_operation : end->first;
+
+   // the tail is ordered by account then sequence, and within an account the flushed operations come first
+   for( auto itr = _tail_history.begin(); itr != _tail_history.end(); )
+   {
+      if( itr->second >= first_kept )
+      {
+         ++itr;
+         continue;
+      }
+      append_to_account( itr->first.first, itr->second, _tail_operations.at( itr->second ).block_num );
+      itr = _tail_history.erase( itr );
+   }
+   _tail_operations.erase( _tail_operations.begin(), end );
+
+   _operations.flush();
+   _operation_index.flush();
+   _pages.flush();
+   _directory.flush();
+   _last_flushed_block = last_irreversible_block;
+   write_head();
+} FC_CAPTURE_AND_RETHROW( (last_irreversible_block) ) }
+
+void account_history_store::write_head()
+{
+   // written last, what it does not cover is ignored or overwritten after a crash
+   head_record h;
+   h.last_flushed_block = _last_flushed_block;
+   h.next_operation = _tail_operations.empty() ? _next_operation : _tail_operations.begin()->first;
+   const fc::path tmp = _head_filename.generic_string() + ".tmp";
+   {
+      std::ofstream head( tmp.generic_string().c_str(), std::ofstream::binary | std::ofstream::trunc );
+      head.write( (const char*)&h, sizeof(h) );
+   }
+   fc::rename( tmp, _head_filename );
+}
+
+account_history_store::account_pages& account_history_store::load_account( uint64_t account )const
+{
+   auto& result = _accounts[account];
+   if( result.count )
+      return result;
+
+   // only the last pages can hold entries past the head, left there by a crash before it was written
+   uint32_t count = 0;
+   for( size_t page_number = result.pages.size(); page_number > 0 && count == 0; --page_number )
+   {
+      history_page page;
+      _pages.seekg( result.pages[page_number - 1] );
+      _pages.read( (char*)&page, sizeof(page) );
+      uint32_t valid = std::min( page.header.count, page_entries );
+      while( valid > 0 && page.entries[valid - 1].block_num > _last_flushed_block )
+         --valid;
+      if( valid > 0 )
+         count = ( page_number - 1 ) * page_entries + valid;
+   }
+   result.count = count;
+   return result;
+}
+
+void account_history_store::append_to_account( uint64_t account, uint64_t operation, uint32_t block_num )
+{
+   auto& pages = load_account( account );
+   const uint32_t slot = *pages.count % page_entries;
+   const uint32_t page_number = *pages.count / page_entries;
+   if( page_number == pages.pages.size() )
+   {
+      history_page_header header;
+      header.account = account;
+      header.page_number = page_number;
+      _pages.seekp( 0, _pages.end );
+      directory_entry d;
+      d.account = account;
+      d.page_number = page_number;
+      d.page_pos = _pages.tellp();
+      history_page page;
+      page.header = header;
+      _pages.write( (const char*)&page, sizeof(page) );
+      _directory.seekp( 0, _directory.end );
+      _directory.write( (const char*)&d, sizeof(d) );
+      pages.pages.push_back( d.page_pos );
+   }
+
+   const uint64_t page_pos = pages.pages[page_number];
+   history_page_entry entry;
+   entry.operation = operation;
+   entry.block_num = block_num;
+   _pages.seekp( page_pos + sizeof(history_page_header) + slot * sizeof(history_page_entry) );
+   _pages.write( (const char*)&entry, sizeof(entry) );
+   history_page_header header;
+   header.account = account;
+   header.page_number = page_number;
+   header.count = slot + 1;
+   _pages.seekp( page_pos );
+   _pages.write( (const char*)&header, sizeof(header) );
+   pages.count = *pages.count + 1;
+}
+
+uint32_t account_history_store::total_ops_locked( account_id_type account )const
+{
+   auto itr = _tail_history.upper_bound( std::make_pair( account.instance, std::numeric_limits<uint32_t>::max() ) );
+   if( itr != _tail_history.begin() && std::prev( itr )->first.first == account.instance )
+      return std::prev( itr )->first.second;
+   return *load_account( account.instance ).count;
+}
+
+uint32_t account_history_store::total_ops( account_id_type account )const
+{
+   std::lock_guard<std::mutex> lock( _mutex );
+   return total_ops_locked( account );
+}
+
+uint64_t account_history_store::get_operation_id_locked( account_id_type account, uint32_t sequence )const
+{
+   auto tail = _tail_history.find( std::make_pair( account.instance, sequence ) );
+   if( tail != _tail_history.end() )
+      return tail->second;
+
+   const auto& pages = load_account( account.instance );
+   FC_ASSERT( sequence > 0 && sequence <= *pages.count, "No operation ${s} in the history of ${a}", ("s", sequence)("a", account) );
+   history_page_entry entry;
+   _pages.seekg( pages.pages[(sequence - 1) / page_entries] + sizeof(history_page_header)
+                 + ( (sequence - 1) % page_entries ) * sizeof(history_page_entry) );
+   _pages.read( (char*)&entry, sizeof(entry) );
+   return entry.operation;
+}
+
+operation_history_id_type account_history_store::get_operation_id( account_id_type account, uint32_t sequence )const
+{
+   std::lock_guard<std::mutex> lock( _mutex );
+   return operation_history_id_type( get_operation_id_locked( account, sequence ) );
+}
+
+uint32_t account_history_store::find_sequence( account_id_type account, operation_history_id_type id )const
+{
+   std::lock_guard<std::mutex> lock( _mutex );
+   // operation ids grow with the sequence
+   uint32_t low = 0, high = total_ops_locked( account );
+   while( low < high )
+   {
+      const uint32_t mid = low + ( high - low + 1 ) / 2;
+      if( get_operation_id_locked( account, mid ) <= id.instance )
+         low = mid;
+      else
+         high = mid - 1;
+   }
+   return low;
+}
+
+optional<operation_history_object> account_history_store::get_operation( operation_history_id_type id )const
+{
+   std::lock_guard<std::mutex> lock( _mutex );
+   auto tail = _tail_operations.find( id.instance );
+   if( tail != _tail_operations.end() )
+      return tail->second;
+
+   operation_index_entry e;
+   const int64_t index_pos = sizeof(e) * int64_t(id.instance);
+   if( file_size( _operation_index ) < int64_t(index_pos + sizeof(e)) )
+      return {};
+   _operation_index.seekg( index_pos );
+   _operation_index.read( (char*)&e, sizeof(e) );
+   if( e.size == 0 )
+      return {};
+   vector<char> data( e.size );
+   _operations.seekg( e.pos );
+   _operations.read( data.data(), e.size );
+   return fc::raw::unpack<operation_history_object>( data );
+}
+
+} } //graphene::account_history
@@ -27,6 +27,7 @@
 #include <graphene/chain/database.hpp>
 
 #include <graphene/chain/operation_history_object.hpp>
+#include <graphene/account_history/account_history_store.hpp>
 
 #include <fc/thread/future.hpp>
 
@@ -73,8 +74,11 @@ class account_history_plugin : public graphene::app::plugin
          boost::program_options::options_description& cfg) override;
       virtual void plugin_initialize(const boost::program_options::variables_map& options) override;
       virtual void plugin_startup() override;
+      virtual void plugin_shutdown() override;
 
       flat_set<account_id_type> tracked_accounts()const;
+      /// the on-disk history when history-on-disk is enabled, otherwise null and history is kept in chain objects
+      const account_history_store* history_store()const;
 
       friend class detail::account_history_plugin_impl;
       std::unique_ptr<detail::account_history_plugin_impl> my;
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <graphene/chain/database.hpp>
+#include <graphene/chain/operation_history_object.hpp>
+
+#include <fc/filesystem.hpp>
+
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <unordered_map>
+
+namespace graphene { namespace account_history {
+   using namespace chain;
+
+   /**
+    *  @brief Account history kept in append-only files instead of in chain objects
+    *
+    *  Operations are appended to operations.log and found by id through the fixed size records of
+    *  operations.index. The history of each account is a list of fixed size pages in accounts.pages
+    *  holding operation ids by account sequence, so a sequence number maps straight to a page and a
+    *  slot; accounts.directory logs which page belongs to which account and is read on open.
+    *
+    *  Only operations of irreversible blocks are written. Those of reversible blocks stay in an
+    *  in-memory tail that is dropped from the fork point on when a block number is applied again.
+    *  All methods may be called from any thread.
+    */
+   class account_history_store
+   {
+      public:
+         static const uint32_t page_entries = 64;
+
+         void open( const fc::path& dir );
+         void close();
+         bool is_open()const;
+
+         /** highest block whose operations are on disk, blocks up to it are not recorded again */
+         uint32_t last_flushed_block()const;
+         /** forget the tail from block_num on, called before the operations of block_num are added */
+         void discard_from( uint32_t block_num );
+         /** give the operation the next id and append it to the history of each of the accounts */
+         operation_history_id_type add( operation_history_object op, const flat_set<account_id_type>& accounts );
+         /** write out the operations of blocks up to last_irreversible_block */
+         void flush( uint32_t last_irreversible_block );
+
+         /** number of operations in the account's history, which is also the sequence of the latest one */
+         uint32_t total_ops( account_id_type account )const;
+         optional<operation_history_object> get_operation( operation_history_id_type id )const;
+         /** id of the operation at sequence (1 based) in the account's history */
+         operation_history_id_type get_operation_id( account_id_type account, uint32_t sequence )const;
+         /** largest sequence in the account's history whose operation id is at most id, 0 if there is none */
+         uint32_t find_sequence( account_id_type account, operation_history_id_type id )const;
+
+      private:
+         struct account_pages
+         {
+            vector<uint64_t>   pages; ///< page positions in accounts.pages, by page number
+            optional<uint32_t> count; ///< operations on disk, read from the last page on first use
+         };
+
+         account_pages& load_account( uint64_t account )const;
+         uint32_t total_ops_locked( account_id_type account )const;
+         uint64_t get_operation_id_locked( account_id_type account, uint32_t sequence )const;
+         void append_to_account( uint64_t account, uint64_t operation, uint32_t block_num );
+         void write_head();
+
+         fc::path                    _head_filename;
+         mutable std::fstream        _operations;
+         mutable std::fstream        _operation_index;
+         mutable std::fstream        _pages;
+         std::fstream                _directory;
+
+         mutable std::mutex          _mutex;
+         uint32_t                    _last_flushed_block = 0;
+         uint64_t                    _next_operation = 0;
+         mutable std::unordered_map<uint64_t, account_pages> _accounts;
+
+         /// operations of reversible blocks by id instance
+         std::map<uint64_t, operation_history_object> _tail_operations;
+         /// (account instance, sequence) -> operation id instance, for the same blocks
+         std::map<std::pair<uint64_t, uint32_t>, uint64_t> _tail_history;
+   };
+
+} } //graphene::account_history
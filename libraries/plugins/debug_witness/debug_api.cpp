@@ -30,6 +30,10 @@ class debug_api_impl
       //void debug_save_db( std::string db_path );
       void debug_stream_json_objects( const std::string& filename );
       void debug_stream_json_objects_flush();
+      void debug_set_contract_profiling( bool enable );
+      fc::variant debug_get_contract_profile();
+      void debug_reset_contract_profile();
+      fc::variant_object debug_get_contract_vm_memory();
       std::shared_ptr< graphene::debug_witness_plugin::debug_witness_plugin > get_plugin();
 
       graphene::app::application& app;
@@ -124,6 +128,31 @@ void debug_api_impl::debug_stream_json_objects_flush()
    get_plugin()->flush_json_object_stream();
 }
 
+void debug_api_impl::debug_set_contract_profiling( bool enable )
+{
+   app.chain_database()->enable_contract_profiling( enable );
+}
+
+fc::variant debug_api_impl::debug_get_contract_profile()
+{
+   return fc::variant( app.chain_database()->get_contract_profiler().get_report() );
+}
+
+void debug_api_impl::debug_reset_contract_profile()
+{
+   app.chain_database()->get_contract_profiler().reset();
+}
+
+fc::variant_object debug_api_impl::debug_get_contract_vm_memory()
+{
+   const auto& pool = app.chain_database()->get_lua_memory_pool();
+   fc::mutable_variant_object result;
+   result( "live_bytes", uint64_t( pool.live_bytes() ) )
+         ( "peak_bytes", uint64_t( pool.peak_bytes() ) )
+         ( "reserved_bytes", uint64_t( pool.reserved_bytes() ) );
+   return result;
+}
+
 } // detail
 
 debug_api::debug_api( graphene::app::application& app )
@@ -156,5 +185,24 @@ void debug_api::debug_stream_json_objects_flush()
    my->debug_stream_json_objects_flush();
 }
 
+void debug_api::debug_set_contract_profiling( bool enable )
+{
+   my->debug_set_contract_profiling( enable );
+}
+
+fc::variant debug_api::debug_get_contract_profile()
+{
+   return my->debug_get_contract_profile();
+}
+
+void debug_api::debug_reset_contract_profile()
+{
+   my->debug_reset_contract_profile();
+}
+
+fc::variant_object debug_api::debug_get_contract_vm_memory()
+{
+   return my->debug_get_contract_vm_memory();
+}
 
 } } // graphene::debug_witness
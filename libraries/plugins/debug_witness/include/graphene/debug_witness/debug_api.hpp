@@ -82,6 +82,26 @@ class debug_api
        */
       void debug_stream_json_objects_flush();
 
+      /**
+       * Turn the contract VM profiler on or off.
+       */
+      void debug_set_contract_profiling( bool enable );
+
+      /**
+       * Per-contract, per-function and per-binding statistics gathered since the profiler was enabled or reset.
+       */
+      fc::variant debug_get_contract_profile();
+
+      /**
+       * Discard the statistics gathered so far.
+       */
+      void debug_reset_contract_profile();
+
+      /**
+       * Live, peak and reserved bytes of the contract VM memory pool.
+       */
+      fc::variant_object debug_get_contract_vm_memory();
+
       std::shared_ptr< detail::debug_api_impl > my;
 };
 
@@ -93,4 +113,8 @@ FC_API(graphene::debug_witness::debug_api,
        (debug_update_object)
        (debug_stream_json_objects)
        (debug_stream_json_objects_flush)
+       (debug_set_contract_profiling)
+       (debug_get_contract_profile)
+       (debug_reset_contract_profile)
+       (debug_get_contract_vm_memory)
      )
@@ -30,7 +30,9 @@
 #include <fc/network/http/websocket.hpp>
 #include <fc/rpc/websocket_api.hpp>
 #include <fc/api.hpp>
+#include <fc/io/raw.hpp>
 #include <fc/smart_ref_impl.hpp>
+#include <fc/thread/thread.hpp>
 
 
 namespace graphene { namespace delayed_node {
@@ -45,6 +47,8 @@ struct delayed_node_plugin_impl {
    boost::signals2::scoped_connection client_connection_closed;
    graphene::chain::block_id_type last_received_remote_head;
    graphene::chain::block_id_type last_processed_remote_head;
+   /// unpacks a fetched range of blocks while the previous one is pushed
+   fc::thread decode_thread{ "delayed_node_decode" };
 };
 }
 
@@ -99,14 +103,47 @@ void delayed_node_plugin::sync_with_trusted_node()
          break;
       }
       pass_count++;
-      while( remote_dpo.last_irreversible_block_num > db.head_block_num() )
+      synced_blocks += push_blocks_until( remote_dpo.last_irreversible_block_num );
+   }
+}
+
+uint32_t delayed_node_plugin::push_blocks_until( uint32_t last_block_num )
+{
+   auto& db = database();
+   // fetch and decode a range while the range before it is pushed
+   auto fetch = [this, last_block_num]( uint32_t start ) {
+      return fc::async( [this, start, last_block_num]() {
+         const std::vector<std::vector<char>> packed = my->database_api->get_packed_blocks( start, std::min<uint32_t>( last_block_num - start + 1, 1000 ) );
+         return my->decode_thread.async( [&packed]() {
+            std::vector<graphene::chain::signed_block> blocks;
+            blocks.reserve( packed.size() );
+            for( const auto& data : packed )
+               blocks.push_back( fc::raw::unpack<graphene::chain::signed_block>( data ) );
+            return blocks;
+         }, "delayed_node_decode" ).wait();
+      }, "delayed_node_fetch" );
+   };
+
+   uint32_t pushed_blocks = 0;
+   auto pending = fetch( db.head_block_num() + 1 );
+   while( true )
+   {
+      const std::vector<graphene::chain::signed_block> blocks = pending.wait();
+      FC_ASSERT( !blocks.empty(), "Trusted node claims it has blocks it doesn't actually have." );
+      const uint32_t next_block_num = blocks.back().block_num() + 1;
+      if( next_block_num <= last_block_num )
+      {
+         pending = fetch( next_block_num );
+         fc::yield(); // let the request go out before the pushes take the thread
+      }
+      ilog( "Pushing blocks #${first} to #${last}", ("first", blocks.front().block_num())("last", next_block_num - 1) );
+      for( const auto& block : blocks )
       {
-         fc::optional<graphene::chain::signed_block> block = my->database_api->get_block( db.head_block_num()+1 );
-         FC_ASSERT(block, "Trusted node claims it has blocks it doesn't actually have.");
-         ilog("Pushing block #${n}", ("n", block->block_num()));
-         db.push_block(*block);
-         synced_blocks++;
+         db.push_block( block );
+         ++pushed_blocks;
       }
+      if( next_block_num > last_block_num )
+         return pushed_blocks;
    }
 }
 
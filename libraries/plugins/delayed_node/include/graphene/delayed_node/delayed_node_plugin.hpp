@@ -46,6 +46,8 @@ protected:
    void connection_failed();
    void connect();
    void sync_with_trusted_node();
+   /// push the blocks after the head block up to last_block_num, returns how many were pushed
+   uint32_t push_blocks_until( uint32_t last_block_num );
 };
 
 } } //graphene::account_history
@@ -219,6 +219,8 @@ namespace detail
     class market_history_plugin_impl;
 }
 
+class market_history_store;
+
 /**
  *  The market history plugin can be configured to track any number of intervals via its configuration.  Once per block it
  *  will scan the virtual operations and look for fill_order_operations and then adjust the appropriate bucket objects for
@@ -237,11 +239,14 @@ class market_history_plugin : public graphene::app::plugin
       virtual void plugin_initialize(
          const boost::program_options::variables_map& options) override;
       virtual void plugin_startup() override;
+      virtual void plugin_shutdown() override;
 
       uint32_t                    max_history()const;
       const flat_set<uint32_t>&   tracked_buckets()const;
       uint32_t                    max_order_his_records_per_market()const;
       uint32_t                    max_order_his_seconds_per_market()const;
+      /// order history and buckets when market-history-store is enabled, otherwise null and they are chain objects
+      const market_history_store* history_store()const;
 
    private:
       friend class detail::market_history_plugin_impl;
@@ -0,0 +1,136 @@
+#pragma once
+
+#include <graphene/market_history/market_history_plugin.hpp>
+
+#include <fc/filesystem.hpp>
+
+#include <deque>
+#include <map>
+#include <mutex>
+
+namespace graphene { namespace market_history {
+
+   /** set up a new bucket from its first fill */
+   void init_bucket( bucket_object& b, const price& trade_price, const price& fill_price );
+   /** add a fill to an existing bucket */
+   void update_bucket( bucket_object& b, const price& trade_price, const price& fill_price );
+
+   typedef std::pair<asset_id_type, asset_id_type> market_type;
+
+   /// fills of one market, oldest first, one column per field
+   struct market_fill_series
+   {
+      std::deque<uint64_t>              id;        ///< store wide fill id instance
+      std::deque<int64_t>               sequence;  ///< goes down by one with every fill, as in history_key
+      std::deque<uint32_t>              block_num;
+      std::deque<fc::time_point_sec>    time;
+      std::deque<fill_order_operation>  op;
+   };
+
+   /// buckets of one market and bucket size, ordered by open time, one column per field
+   struct market_bucket_series
+   {
+      std::deque<uint32_t>              block_num;         ///< block that opened the bucket
+      std::deque<uint32_t>              updated_block_num; ///< block that last changed the bucket
+      std::deque<fc::time_point_sec>    open;
+      std::deque<share_type>            high_base;
+      std::deque<share_type>            high_quote;
+      std::deque<share_type>            low_base;
+      std::deque<share_type>            low_quote;
+      std::deque<share_type>            open_base;
+      std::deque<share_type>            open_quote;
+      std::deque<share_type>            close_base;
+      std::deque<share_type>            close_quote;
+      std::deque<share_type>            base_volume;
+      std::deque<share_type>            quote_volume;
+
+      size_t size()const { return open.size(); }
+      bucket_object get( const bucket_key& series, size_t i )const;
+      void set( size_t i, const bucket_object& b );
+      void push_back( uint32_t block, const bucket_object& b );
+      void pop_back();
+      void pop_front();
+   };
+
+   /**
+    *  @brief Fill history and market buckets kept outside of the undo database
+    *
+    *  Every market has its fills appended to a market_fill_series, and every market and bucket size
+    *  has its buckets in a market_bucket_series. Fills are only ever appended; a bucket is appended
+    *  when it opens and changed in place while it is the newest of its series, with the previous
+    *  values kept in an undo log while the change is reversible.
+    *
+    *  The store is fed once per block after the block has been applied. When a block number is
+    *  applied again, everything recorded from that block on is dropped first. Old fills and buckets
+    *  are only dropped once they are irreversible. All methods may be called from any thread.
+    */
+   class market_history_store
+   {
+      public:
+         market_history_store( const flat_set<uint32_t>& bucket_sizes, uint32_t max_buckets,
+                               uint32_t max_fill_records, uint32_t max_fill_seconds );
+
+         /** read what save() wrote, nothing happens if the file does not exist */
+         void load( const fc::path& filename );
+         /** write the irreversible part of the store */
+         void save( const fc::path& filename, uint32_t last_irreversible_block );
+
+         /** start recording block_num, forgetting what was recorded from it on */
+         void begin_block( uint32_t block_num, uint32_t last_irreversible_block );
+         /** record a fill of the current block, returns its id */
+         object_id_type add_fill( fc::time_point_sec time, const fill_order_operation& op );
+         /** add a maker fill to the buckets of the market, base < quote */
+         void add_to_buckets( const market_type& market, fc::time_point_sec time,
+                              const price& trade_price, const price& fill_price );
+
+         /** fills of the market, newest first */
+         vector<order_history_object> get_fill_order_history( asset_id_type a, asset_id_type b, uint32_t limit )const;
+         /** buckets of the market opened between start and end */
+         vector<bucket_object> get_market_history( asset_id_type a, asset_id_type b, uint32_t bucket_seconds,
+                                                   fc::time_point_sec start, fc::time_point_sec end, uint32_t limit )const;
+         /** first fill still kept whose id is at least id */
+         optional<order_history_object> lower_bound_fill( object_id_type id )const;
+
+      private:
+         typedef std::pair<market_type, uint32_t> bucket_series_key;
+
+         struct bucket_undo
+         {
+            uint32_t          block_num = 0;
+            bucket_series_key series;
+            bucket_object     previous;
+            uint32_t          previous_updated_block_num = 0;
+         };
+
+         void discard_from( uint32_t block_num );
+         void clear();
+         order_history_object get_fill( const market_type& market, size_t i )const;
+
+         const flat_set<uint32_t>  _bucket_sizes;
+         const uint32_t            _max_buckets;
+         const uint32_t            _max_fill_records;
+         const uint32_t            _max_fill_seconds;
+
+         mutable std::mutex        _mutex;
+         uint32_t                  _block_num = 0;
+         uint32_t                  _last_irreversible_block = 0;
+         uint64_t                  _first_fill_id = 0;
+         /// market of every fill id from _first_fill_id on
+         std::deque<market_type>   _fill_markets;
+
+         std::map<market_type, market_fill_series>         _fills;
+         std::map<bucket_series_key, market_bucket_series> _buckets;
+         /// bucket values before the reversible blocks changed them, oldest first
+         std::deque<bucket_undo>   _bucket_undo;
+   };
+
+} } //graphene::market_history
+
+FC_REFLECT( graphene::market_history::market_fill_series, (id)(sequence)(block_num)(time)(op) )
+FC_REFLECT( graphene::market_history::market_bucket_series,
+            (block_num)(updated_block_num)(open)
+            (high_base)(high_quote)
+            (low_base)(low_quote)
+            (open_base)(open_quote)
+            (close_base)(close_quote)
+            (base_volume)(quote_volume) )
@@ -23,6 +23,7 @@
  */
 
 #include <graphene/market_history/market_history_plugin.hpp>
+#include <graphene/market_history/market_history_store.hpp>
 
 #include <graphene/chain/account_evaluator.hpp>
 #include <graphene/chain/account_object.hpp>
@@ -52,6 +53,9 @@ class market_history_plugin_impl
        * and will process/index all operations that were applied in the block.
        */
       void update_market_histories( const signed_block& b );
+      /** take expired fills out of the 24 hour ticker data */
+      template<typename FirstFrom>
+      void roll_out_ticker( const signed_block& b, FirstFrom first_from );
 
       graphene::chain::database& database()
       {
@@ -65,6 +69,7 @@ class market_history_plugin_impl
       uint32_t                   _max_order_his_seconds_per_market = 259200;
 
       const market_ticker_meta_object* _meta = nullptr;
+      std::unique_ptr<market_history_store> _store;
 };
 
 
@@ -73,9 +78,11 @@ struct operation_process_fill_order
    market_history_plugin&            _plugin;
    fc::time_point_sec                _now;
    const market_ticker_meta_object*& _meta;
+   market_history_store*             _store;
 
-   operation_process_fill_order( market_history_plugin& mhp, fc::time_point_sec n, const market_ticker_meta_object*& meta )
-   :_plugin(mhp),_now(n),_meta(meta) {}
+   operation_process_fill_order( market_history_plugin& mhp, fc::time_point_sec n, const market_ticker_meta_object*& meta,
+                                 market_history_store* store )
+   :_plugin(mhp),_now(n),_meta(meta),_store(store) {}
 
    typedef void result_type;
 
@@ -86,6 +93,77 @@ struct operation_process_fill_order
    void operator()( const fill_order_operation& o )const 
    {
       //ilog( "processing ${o}", ("o",o) );
+      auto& db         = _plugin.database();
+      const object_id_type order_his_id = _store ? _store->add_fill( _now, o ) : save_order_history( o );
+
+      // save a reference to market ticker meta object
+      if( _meta == nullptr )
+      {
+         const auto& meta_idx = db.get_index_type<simple_index<market_ticker_meta_object>>();
+         if( meta_idx.size() == 0 )
+            _meta = &db.create<market_ticker_meta_object>( [&]( market_ticker_meta_object& mtm ) {
+               mtm.rolling_min_order_his_id = order_his_id;
+               mtm.skip_min_order_his_id = false;
+            });
+         else
+            _meta = &( *meta_idx.begin() );
+      }
+
+      // To update ticker data and buckets data, only update for maker orders
+      if( !o.is_maker )
+         return;
+
+      bucket_key key;
+      key.base    = o.pays.asset_id;
+      key.quote   = o.receives.asset_id;
+
+      price trade_price = o.pays / o.receives;
+
+      if( key.base > key.quote )
+      {
+         std::swap( key.base, key.quote );
+         trade_price = ~trade_price;
+      }
+
+      price fill_price = o.fill_price;
+      if( fill_price.base.asset_id > fill_price.quote.asset_id )
+         fill_price = ~fill_price;
+
+      // To update ticker data
+      const auto& ticker_idx = db.get_index_type<market_ticker_index>().indices().get<by_market>();
+      auto ticker_itr = ticker_idx.find( std::make_tuple( key.base, key.quote ) );
+      if( ticker_itr == ticker_idx.end() )
+      {
+         db.create<market_ticker_object>( [&]( market_ticker_object& mt ) {
+            mt.base           = key.base;
+            mt.quote          = key.quote;
+            mt.last_day_base  = 0;
+            mt.last_day_quote = 0;
+            mt.latest_base    = fill_price.base.amount;
+            mt.latest_quote   = fill_price.quote.amount;
+            mt.base_volume    = trade_price.base.amount.value;
+            mt.quote_volume   = trade_price.quote.amount.value;
+         });
+      }
+      else
+      {
+         db.modify( *ticker_itr, [&]( market_ticker_object& mt ) {
+            mt.latest_base    = fill_price.base.amount;
+            mt.latest_quote   = fill_price.quote.amount;
+            mt.base_volume    += trade_price.base.amount.value;  // ignore overflow
+            mt.quote_volume   += trade_price.quote.amount.value; // ignore overflow
+         });
+      }
+
+      if( _store )
+         _store->add_to_buckets( market_type( key.base, key.quote ), _now, trade_price, fill_price );
+      else
+         update_buckets( key, trade_price, fill_price );
+   }
+
+   /** save the fill as an order_history_object and remove the old ones */
+   object_id_type save_order_history( const fill_order_operation& o )const
+   {
       auto& db         = _plugin.database();
       const auto& order_his_idx = db.get_index_type<history_index>().indices();
       const auto& history_idx = order_his_idx.get<by_key>();
@@ -112,19 +190,6 @@ struct operation_process_fill_order
          ho.op = o;
       });
 
-      // save a reference to market ticker meta object
-      if( _meta == nullptr )
-      {
-         const auto& meta_idx = db.get_index_type<simple_index<market_ticker_meta_object>>();
-         if( meta_idx.size() == 0 )
-            _meta = &db.create<market_ticker_meta_object>( [&]( market_ticker_meta_object& mtm ) {
-               mtm.rolling_min_order_his_id = new_order_his_obj.id;
-               mtm.skip_min_order_his_id = false;
-            });
-         else
-            _meta = &( *meta_idx.begin() );
-      }
-
       // To remove old filled order data
       const auto max_records = _plugin.max_order_his_records_per_market();
       hkey.sequence += max_records;
@@ -159,51 +224,13 @@ struct operation_process_fill_order
          }
       }
 
-      // To update ticker data and buckets data, only update for maker orders
-      if( !o.is_maker )
-         return;
-
-      bucket_key key;
-      key.base    = o.pays.asset_id;
-      key.quote   = o.receives.asset_id;
-
-      price trade_price = o.pays / o.receives;
-
-      if( key.base > key.quote )
-      {
-         std::swap( key.base, key.quote );
-         trade_price = ~trade_price;
-      }
-
-      price fill_price = o.fill_price;
-      if( fill_price.base.asset_id > fill_price.quote.asset_id )
-         fill_price = ~fill_price;
+      return new_order_his_obj.id;
+   }
 
-      // To update ticker data
-      const auto& ticker_idx = db.get_index_type<market_ticker_index>().indices().get<by_market>();
-      auto ticker_itr = ticker_idx.find( std::make_tuple( key.base, key.quote ) );
-      if( ticker_itr == ticker_idx.end() )
-      {
-         db.create<market_ticker_object>( [&]( market_ticker_object& mt ) {
-            mt.base           = key.base;
-            mt.quote          = key.quote;
-            mt.last_day_base  = 0;
-            mt.last_day_quote = 0;
-            mt.latest_base    = fill_price.base.amount;
-            mt.latest_quote   = fill_price.quote.amount;
-            mt.base_volume    = trade_price.base.amount.value;
-            mt.quote_volume   = trade_price.quote.amount.value;
-         });
-      }
-      else
-      {
-         db.modify( *ticker_itr, [&]( market_ticker_object& mt ) {
-            mt.latest_base    = fill_price.base.amount;
-            mt.latest_quote   = fill_price.quote.amount;
-            mt.base_volume    += trade_price.base.amount.value;  // ignore overflow
-            mt.quote_volume   += trade_price.quote.amount.value; // ignore overflow
-         });
-      }
+   /** add a maker fill to the bucket objects of its market */
+   void update_buckets( bucket_key key, const price& trade_price, const price& fill_price )const
+   {
+      auto& db         = _plugin.database();
 
       // To update buckets data
       const auto max_history = _plugin.max_history();
@@ -230,16 +257,7 @@ struct operation_process_fill_order
             /* const auto& obj = */
             db.create<bucket_object>( [&]( bucket_object& b ){
                  b.key = key;
-                 b.base_volume = trade_price.base.amount;
-                 b.quote_volume = trade_price.quote.amount;
-                 b.open_base = fill_price.base.amount;
-                 b.open_quote = fill_price.quote.amount;
-                 b.close_base = fill_price.base.amount;
-                 b.close_quote = fill_price.quote.amount;
-                 b.high_base = b.close_base;
-                 b.high_quote = b.close_quote;
-                 b.low_base = b.close_base;
-                 b.low_quote = b.close_quote;
+                 init_bucket( b, trade_price, fill_price );
             });
             //wlog( "    creating bucket ${b}", ("b",obj) );
           }
@@ -247,28 +265,7 @@ struct operation_process_fill_order
           { // update existing bucket
              //wlog( "    before updating bucket ${b}", ("b",*bucket_itr) );
              db.modify( *bucket_itr, [&]( bucket_object& b ){
-                  try {
-                     b.base_volume += trade_price.base.amount;
-                  } catch( fc::overflow_exception ) {
-                     b.base_volume = std::numeric_limits<int64_t>::max();
-                  }
-                  try {
-                     b.quote_volume += trade_price.quote.amount;
-                  } catch( fc::overflow_exception ) {
-                     b.quote_volume = std::numeric_limits<int64_t>::max();
-                  }
-                  b.close_base = fill_price.base.amount;
-                  b.close_quote = fill_price.quote.amount;
-                  if( b.high() < fill_price )
-                  {
-                      b.high_base = b.close_base;
-                      b.high_quote = b.close_quote;
-                  }
-                  if( b.low() > fill_price )
-                  {
-                      b.low_base = b.close_base;
-                      b.low_quote = b.close_quote;
-                  }
+                  update_bucket( b, trade_price, fill_price );
              });
              //wlog( "    after bucket bucket ${b}", ("b",*bucket_itr) );
           }
@@ -299,6 +296,8 @@ market_history_plugin_impl::~market_history_plugin_impl()
 void market_history_plugin_impl::update_market_histories( const signed_block& b )
 {
    graphene::chain::database& db = database();
+   if( _store )
+      _store->begin_block( b.block_num(), db.get_dynamic_global_properties().last_irreversible_block_num );
    const vector<optional< operation_history_object > >& hist = db.get_applied_operations();
    for( const optional< operation_history_object >& o_op : hist )
    {
@@ -306,77 +305,91 @@ void market_history_plugin_impl::update_market_histories( const signed_block& b
       {
          try
          {
-            o_op->op.visit( operation_process_fill_order( _self, b.timestamp, _meta ) );
+            o_op->op.visit( operation_process_fill_order( _self, b.timestamp, _meta, _store.get() ) );
          } FC_CAPTURE_AND_LOG( (o_op) )
       }
    }
    // roll out expired data from ticker
-   if( _meta != nullptr )
+   if( _meta == nullptr )
+      return;
+   if( _store )
+      roll_out_ticker( b, [this]( object_id_type id ) { return _store->lower_bound_fill( id ); } );
+   else
    {
-      time_point_sec last_day = b.timestamp - 86400;
-      object_id_type last_min_his_id = _meta->rolling_min_order_his_id;
-      bool skip = _meta->skip_min_order_his_id;
-
-      const auto& ticker_idx = db.get_index_type<market_ticker_index>().indices().get<by_market>();
       const auto& history_idx = db.get_index_type<history_index>().indices().get<by_id>();
-      auto history_itr = history_idx.lower_bound( _meta->rolling_min_order_his_id );
-      while( history_itr != history_idx.end() && history_itr->time < last_day )
-      {
-         const fill_order_operation& o = history_itr->op;
-         if( skip && history_itr->id == _meta->rolling_min_order_his_id )
-            skip = false;
-         else if( o.is_maker )
-         {
-            bucket_key key;
-            key.base    = o.pays.asset_id;
-            key.quote   = o.receives.asset_id;
+      roll_out_ticker( b, [&history_idx]( object_id_type id ) {
+         auto itr = history_idx.lower_bound( id );
+         return itr == history_idx.end() ? optional<order_history_object>() : optional<order_history_object>( *itr );
+      });
+   }
+}
 
-            price trade_price = o.pays / o.receives;
+template<typename FirstFrom>
+void market_history_plugin_impl::roll_out_ticker( const signed_block& b, FirstFrom first_from )
+{
+   graphene::chain::database& db = database();
+   time_point_sec last_day = b.timestamp - 86400;
+   object_id_type last_min_his_id = _meta->rolling_min_order_his_id;
+   bool skip = _meta->skip_min_order_his_id;
 
-            if( key.base > key.quote )
-            {
-               std::swap( key.base, key.quote );
-               trade_price = ~trade_price;
-            }
+   const auto& ticker_idx = db.get_index_type<market_ticker_index>().indices().get<by_market>();
+   optional<order_history_object> history_itr = first_from( _meta->rolling_min_order_his_id );
+   while( history_itr.valid() && history_itr->time < last_day )
+   {
+      const fill_order_operation& o = history_itr->op;
+      if( skip && history_itr->id == _meta->rolling_min_order_his_id )
+         skip = false;
+      else if( o.is_maker )
+      {
+         bucket_key key;
+         key.base    = o.pays.asset_id;
+         key.quote   = o.receives.asset_id;
 
-            price fill_price = o.fill_price;
-            if( fill_price.base.asset_id > fill_price.quote.asset_id )
-               fill_price = ~fill_price;
+         price trade_price = o.pays / o.receives;
 
-            auto ticker_itr = ticker_idx.find( std::make_tuple( key.base, key.quote ) );
-            if( ticker_itr != ticker_idx.end() ) // should always be true
-            {
-               db.modify( *ticker_itr, [&]( market_ticker_object& mt ) {
-                  mt.last_day_base  = fill_price.base.amount;
-                  mt.last_day_quote = fill_price.quote.amount;
-                  mt.base_volume    -= trade_price.base.amount.value;  // ignore underflow
-                  mt.quote_volume   -= trade_price.quote.amount.value; // ignore underflow
-               });
-            }
+         if( key.base > key.quote )
+         {
+            std::swap( key.base, key.quote );
+            trade_price = ~trade_price;
          }
-         last_min_his_id = history_itr->id;
-         ++history_itr;
-      }
-      // update meta
-      if( history_itr != history_idx.end() ) // if still has some data rolling
-      {
-         if( history_itr->id != _meta->rolling_min_order_his_id ) // if rolled out some
+
+         price fill_price = o.fill_price;
+         if( fill_price.base.asset_id > fill_price.quote.asset_id )
+            fill_price = ~fill_price;
+
+         auto ticker_itr = ticker_idx.find( std::make_tuple( key.base, key.quote ) );
+         if( ticker_itr != ticker_idx.end() ) // should always be true
          {
-            db.modify( *_meta, [&]( market_ticker_meta_object& mtm ) {
-               mtm.rolling_min_order_his_id = history_itr->id;
-               mtm.skip_min_order_his_id = false;
+            db.modify( *ticker_itr, [&]( market_ticker_object& mt ) {
+               mt.last_day_base  = fill_price.base.amount;
+               mt.last_day_quote = fill_price.quote.amount;
+               mt.base_volume    -= trade_price.base.amount.value;  // ignore underflow
+               mt.quote_volume   -= trade_price.quote.amount.value; // ignore underflow
             });
          }
       }
-      else // if all data are rolled out
+      last_min_his_id = history_itr->id;
+      history_itr = first_from( history_itr->id + 1 );
+   }
+   // update meta
+   if( history_itr.valid() ) // if still has some data rolling
+   {
+      if( history_itr->id != _meta->rolling_min_order_his_id ) // if rolled out some
       {
-         if( last_min_his_id != _meta->rolling_min_order_his_id ) // if rolled out some
-         {
-            db.modify( *_meta, [&]( market_ticker_meta_object& mtm ) {
-               mtm.rolling_min_order_his_id = last_min_his_id;
-               mtm.skip_min_order_his_id = true;
-            });
-         }
+         db.modify( *_meta, [&]( market_ticker_meta_object& mtm ) {
+            mtm.rolling_min_order_his_id = history_itr->id;
+            mtm.skip_min_order_his_id = false;
+         });
+      }
+   }
+   else // if all data are rolled out
+   {
+      if( last_min_his_id != _meta->rolling_min_order_his_id ) // if rolled out some
+      {
+         db.modify( *_meta, [&]( market_ticker_meta_object& mtm ) {
+            mtm.rolling_min_order_his_id = last_min_his_id;
+            mtm.skip_min_order_his_id = true;
+         });
       }
    }
 }
@@ -416,6 +429,8 @@ void market_history_plugin::plugin_set_program_options(
            "Will only store this amount of matched orders for each market in order history for querying, or those meet the other option, which has more data (default: 1000)")
          ("max-order-his-seconds-per-market", boost::program_options::value<uint32_t>()->default_value(259200),
            "Will only store matched orders in last X seconds for each market in order history for querying, or those meet the other option, which has more data (default: 259200 (3 days))")
+         ("market-history-store", boost::program_options::value<bool>()->default_value(false),
+           "Keep order history and buckets in a time-series store outside of the chain database, saved under the blockchain directory on shutdown")
          ;
    cfg.add(cli);
 }
@@ -440,12 +455,32 @@ void market_history_plugin::plugin_initialize(const boost::program_options::vari
       my->_max_order_his_records_per_market = options["max-order-his-records-per-market"].as<uint32_t>();
    if( options.count( "max-order-his-seconds-per-market" ) )
       my->_max_order_his_seconds_per_market = options["max-order-his-seconds-per-market"].as<uint32_t>();
+   if( options.count( "market-history-store" ) && options["market-history-store"].as<bool>() )
+   {
+      my->_store.reset( new market_history_store( my->_tracked_buckets, my->_maximum_history_per_bucket_size,
+                                                  my->_max_order_his_records_per_market, my->_max_order_his_seconds_per_market ) );
+      my->_store->load( database().get_data_dir() / "market_history" );
+   }
 } FC_CAPTURE_AND_RETHROW() }
 
 void market_history_plugin::plugin_startup()
 {
 }
 
+void market_history_plugin::plugin_shutdown()
+{
+   // only the irreversible part is saved: closing the database rewinds to the last irreversible block, and
+   // the blocks after it are applied again on the next start
+   if( my->_store )
+      my->_store->save( database().get_data_dir() / "market_history",
+                        database().get_dynamic_global_properties().last_irreversible_block_num );
+}
+
+const market_history_store* market_history_plugin::history_store()const
+{
+   return my->_store.get();
+}
+
 const flat_set<uint32_t>& market_history_plugin::tracked_buckets() const
 {
    return my->_tracked_buckets;
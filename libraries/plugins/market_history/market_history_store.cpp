@@ -0,0 +1,409 @@
+#include <graphene/market_history/market_history_store.hpp>
+
+#include <graphene/chain/protocol/fee_schedule.hpp>
+
+#include <fc/io/fstream.hpp>
+#include <fc/io/raw.hpp>
+#include <fc/smart_ref_impl.hpp>
+
+#include <algorithm>
+#include <fstream>
+
+namespace graphene { namespace market_history {
+
+void init_bucket( bucket_object& b, const price& trade_price, const price& fill_price )
+{
+   b.base_volume = trade_price.base.amount;
+   b.quote_volume = trade_price.quote.amount;
+   b.open_base = fill_price.base.amount;
+   b.open_quote = fill_price.quote.amount;
+   b.close_base = fill_price.base.amount;
+   b.close_quote = fill_price.quote.amount;
+   b.high_base = b.close_base;
+   b.high_quote = b.close_quote;
+   b.low_base = b.close_base;
+   b.low_quote = b.close_quote;
+}
+
+void update_bucket( bucket_object& b, const price& trade_price, const price& fill_price )
+{
+   try {
+      b.base_volume += trade_price.base.amount;
+   } catch( fc::overflow_exception ) {
+      b.base_volume = std::numeric_limits<int64_t>::max();
+   }
+   try {
+      b.quote_volume += trade_price.quote.amount;
+   } catch( fc::overflow_exception ) {
+      b.quote_volume = std::numeric_limits<int64_t>::max();
+   }
+   b.close_base = fill_price.base.amount;
+   b.close_quote = fill_price.quote.amount;
+   if( b.high() < fill_price )
+   {
+       b.high_base = b.close_base;
+       b.high_quote = b.close_quote;
+   }
+   if( b.low() > fill_price )
+   {
+       b.low_base = b.close_base;
+       b.low_quote = b.close_quote;
+   }
+}
+
+bucket_object market_bucket_series::get( const bucket_key& series, size_t i )const
+{
+   bucket_object b;
+   b.key = series;
+   b.key.open = open[i];
+   b.high_base = high_base[i];
+   b.high_quote = high_quote[i];
+   b.low_base = low_base[i];
+   b.low_quote = low_quote[i];
+   b.open_base = open_base[i];
+   b.open_quote = open_quote[i];
+   b.close_base = close_base[i];
+   b.close_quote = close_quote[i];
+   b.base_volume = base_volume[i];
+   b.quote_volume = quote_volume[i];
+   return b;
+}
+
+void market_bucket_series::set( size_t i, const bucket_object& b )
+{
+   high_base[i] = b.high_base;
+   high_quote[i] = b.high_quote;
+   low_base[i] = b.low_base;
+   low_quote[i] = b.low_quote;
+   open_base[i] = b.open_base;
+   open_quote[i] = b.open_quote;
+   close_base[i] = b.close_base;
+   close_quote[i] = b.close_quote;
+   base_volume[i] = b.base_volume;
+   quote_volume[i] = b.quote_volume;
+}
+
+void market_bucket_series::push_back( uint32_t block, const bucket_object& b )
+{
+   block_num.push_back( block );
+   updated_block_num.push_back( block );
+   open.push_back( b.key.open );
+   high_base.emplace_back();
+   high_quote.emplace_back();
+   low_base.emplace_back();
+   low_quote.emplace_back();
+   open_base.emplace_back();
+   open_quote.emplace_back();
+   close_base.emplace_back();
+   close_quote.emplace_back();
+   base_volume.emplace_back();
+   quote_volume.emplace_back();
+   set( size() - 1, b );
+}
+
+void market_bucket_series::pop_back()
+{
+   block_num.pop_back();
+   updated_block_num.pop_back();
+   open.pop_back();
+   high_base.pop_back();
+   high_quote.pop_back();
+   low_base.pop_back();
+   low_quote.pop_back();
+   open_base.pop_back();
+   open_quote.pop_back();
+   close_base.pop_back();
+   close_quote.pop_back();
+   base_volume.pop_back();
+   quote_volume.pop_back();
+}
+
+void market_bucket_series::pop_front()
+{
+   block_num.pop_front();
+   updated_block_num.pop_front();
+   open.pop_front();
+   high_base.pop_front();
+   high_quote.pop_front();
+   low_base.pop_front();
+   low_quote.pop_front();
+   open_base.pop_front();
+   open_quote.pop_front();
+   close_base.pop_front();
+   close_quote.pop_front();
+   base_volume.pop_front();
+   quote_volume.pop_front();
+}
+
+market_history_store::market_history_store( const flat_set<uint32_t>& bucket_sizes, uint32_t max_buckets,
+                                            uint32_t max_fill_records, uint32_t max_fill_seconds )
+:_bucket_sizes(bucket_sizes),_max_buckets(max_buckets),_max_fill_records(max_fill_records),_max_fill_seconds(max_fill_seconds)
+{}
+
+void market_history_store::load( const fc::path& filename )
+{ try {
+   if( !fc::exists( filename ) )
+      return;
+   std::string data;
+   fc::read_file_contents( filename, data );
+   fc::datastream<const char*> ds( data.data(), data.size() );
+
+   std::lock_guard<std::mutex> lock( _mutex );
+   clear();
+   fc::raw::unpack( ds, _last_irreversible_block );
+   fc::raw::unpack( ds, _first_fill_id );
+   fc::raw::unpack( ds, _fill_markets );
+   fc::raw::unpack( ds, _fills );
+   fc::raw::unpack( ds, _buckets );
+   _block_num = _last_irreversible_block;
+} FC_CAPTURE_AND_RETHROW( (filename) ) }
+
+void market_history_store::save( const fc::path& filename, uint32_t last_irreversible_block )
+{ try {
+   std::lock_guard<std::mutex> lock( _mutex );
+   // the reversible blocks are applied again after the database rewinds to the last irreversible block
+   if( _block_num > last_irreversible_block )
+      discard_from( last_irreversible_block + 1 );
+   _last_irreversible_block = std::min( _block_num, last_irreversible_block );
+   _bucket_undo.clear();
+
+   std::vector<char> data = fc::raw::pack( _last_irreversible_block );
+   for( const auto& packed : { fc::raw::pack( _first_fill_id ), fc::raw::pack( _fill_markets ),
+                               fc::raw::pack( _fills ), fc::raw::pack( _buckets ) } )
+      data.insert( data.end(), packed.begin(), packed.end() );
+
+   const fc::path tmp = filename.generic_string() + ".tmp";
+   {
+      std::ofstream out( tmp.generic_string().c_str(), std::ofstream::binary | std::ofstream::trunc );
+      out.write( data.data(), data.size() );
+   }
+   fc::rename( tmp, filename );
+} FC_CAPTURE_AND_RETHROW( (filename)(last_irreversible_block) ) }
+
+void market_history_store::clear()
+{
+   _block_num = 0;
+   _last_irreversible_block = 0;
+   _first_fill_id = 0;
+   _fill_markets.clear();
+   _fills.clear();
+   _buckets.clear();
+   _bucket_undo.clear();
+}
+
+void market_history_store::begin_block( uint32_t block_num, uint32_t last_irreversible_block )
+{
+   std::lock_guard<std::mutex> lock( _mutex );
+   if( block_num <= _last_irreversible_block )
+      clear(); // a replay, what was dropped as irreversible cannot be restored
+   else if( block_num <= _block_num )
+      discard_from( block_num ); // the blocks from block_num on were popped by a fork switch
+   _block_num = block_num;
+   _last_irreversible_block = std::max( _last_irreversible_block, std::min( last_irreversible_block, block_num - 1 ) );
+   while( !_bucket_undo.empty() && _bucket_undo.front().block_num <= _last_irreversible_block )
+      _bucket_undo.pop_front();
+}
+
+void market_history_store::discard_from( uint32_t block_num )
+{
+   // fills and bucket openings grow with the block number, so what is dropped is at the back
+   uint64_t next_fill_id = _first_fill_id + _fill_markets.size();
+   for( auto itr = _fills.begin(); itr != _fills.end(); )
+   {
+      auto& series = itr->second;
+      while( !series.id.empty() && series.block_num.back() >= block_num )
+      {
+         next_fill_id = std::min( next_fill_id, series.id.back() );
+         series.id.pop_back();
+         series.sequence.pop_back();
+         series.block_num.pop_back();
+         series.time.pop_back();
+         series.op.pop_back();
+      }
+      if( series.id.empty() )
+         itr = _fills.erase( itr );
+      else
+         ++itr;
+   }
+   _fill_markets.resize( std::max( next_fill_id, _first_fill_id ) - _first_fill_id );
+
+   for( auto itr = _buckets.begin(); itr != _buckets.end(); )
+   {
+      auto& series = itr->second;
+      while( series.size() > 0 && series.block_num.back() >= block_num )
+         series.pop_back();
+      if( series.size() == 0 )
+         itr = _buckets.erase( itr );
+      else
+         ++itr;
+   }
+   while( !_bucket_undo.empty() && _bucket_undo.back().block_num >= block_num )
+   {
+      const auto& undo = _bucket_undo.back();
+      auto series = _buckets.find( undo.series );
+      if( series != _buckets.end() )
+      {
+         auto& open = series->second.open;
+         auto row = std::lower_bound( open.begin(), open.end(), undo.previous.key.open );
+         if( row != open.end() && *row == undo.previous.key.open )
+         {
+            series->second.set( row - open.begin(), undo.previous );
+            series->second.updated_block_num[row - open.begin()] = undo.previous_updated_block_num;
+         }
+      }
+      _bucket_undo.pop_back();
+   }
+}
+
+object_id_type market_history_store::add_fill( fc::time_point_sec time, const fill_order_operation& o )
+{
+   market_type market( o.pays.asset_id, o.receives.asset_id );
+   if( market.first > market.second )
+      std::swap( market.first, market.second );
+
+   std::lock_guard<std::mutex> lock( _mutex );
+   const uint64_t id = _first_fill_id + _fill_markets.size();
+   _fill_markets.push_back( market );
+
+   auto& series = _fills[market];
+   series.sequence.push_back( series.sequence.empty() ? 0 : series.sequence.back() - 1 );
+   series.id.push_back( id );
+   series.block_num.push_back( _block_num );
+   series.time.push_back( time );
+   series.op.push_back( o );
+
+   // keep the last _max_fill_records fills, or those of the last _max_fill_seconds if they are more
+   fc::time_point_sec min_time;
+   if( min_time + _max_fill_seconds < time )
+      min_time = time - _max_fill_seconds;
+   while( series.id.size() > _max_fill_records && series.time.front() < min_time
+          && series.block_num.front() <= _last_irreversible_block )
+   {
+      series.id.pop_front();
+      series.sequence.pop_front();
+      series.block_num.pop_front();
+      series.time.pop_front();
+      series.op.pop_front();
+   }
+   while( !_fill_markets.empty() )
+   {
+      auto front = _fills.find( _fill_markets.front() );
+      if( front != _fills.end() && !front->second.id.empty() && front->second.id.front() <= _first_fill_id )
+         break;
+      _fill_markets.pop_front();
+      ++_first_fill_id;
+   }
+
+   return object_id_type( MARKET_HISTORY_SPACE_ID, order_history_object_type, id );
+}
+
+void market_history_store::add_to_buckets( const market_type& market, fc::time_point_sec time,
+                                           const price& trade_price, const price& fill_price )
+{
+   if( _max_buckets == 0 )
+      return;
+
+   std::lock_guard<std::mutex> lock( _mutex );
+   for( auto bucket : _bucket_sizes )
+   {
+      const auto bucket_num = time.sec_since_epoch() / bucket;
+      fc::time_point_sec cutoff;
+      if( bucket_num > _max_buckets )
+         cutoff = cutoff + ( bucket * ( bucket_num - _max_buckets ) );
+
+      const bucket_series_key series_key( market, bucket );
+      auto& series = _buckets[series_key];
+      bucket_object b;
+      b.key = bucket_key( market.first, market.second, bucket, fc::time_point_sec() + ( bucket_num * bucket ) );
+      if( series.size() == 0 || series.open.back() < b.key.open )
+      {
+         init_bucket( b, trade_price, fill_price );
+         series.push_back( _block_num, b );
+      }
+      else
+      {
+         const size_t last = series.size() - 1;
+         b = series.get( b.key, last );
+         if( series.updated_block_num[last] < _block_num )
+         {
+            bucket_undo undo;
+            undo.block_num = _block_num;
+            undo.series = series_key;
+            undo.previous = b;
+            undo.previous_updated_block_num = series.updated_block_num[last];
+            _bucket_undo.push_back( undo );
+            series.updated_block_num[last] = _block_num;
+         }
+         update_bucket( b, trade_price, fill_price );
+         series.set( last, b );
+      }
+
+      while( series.size() > 0 && series.open.front() < cutoff
+             && series.updated_block_num.front() <= _last_irreversible_block )
+         series.pop_front();
+   }
+}
+
+order_history_object market_history_store::get_fill( const market_type& market, size_t i )const
+{
+   const auto& series = _fills.at( market );
+   order_history_object o;
+   o.id = object_id_type( MARKET_HISTORY_SPACE_ID, order_history_object_type, series.id[i] );
+   o.key.base = market.first;
+   o.key.quote = market.second;
+   o.key.sequence = series.sequence[i];
+   o.time = series.time[i];
+   o.op = series.op[i];
+   return o;
+}
+
+vector<order_history_object> market_history_store::get_fill_order_history( asset_id_type a, asset_id_type b, uint32_t limit )const
+{
+   if( a > b )
+      std::swap( a, b );
+   vector<order_history_object> result;
+   std::lock_guard<std::mutex> lock( _mutex );
+   auto itr = _fills.find( market_type( a, b ) );
+   if( itr == _fills.end() )
+      return result;
+   for( size_t i = itr->second.id.size(); i > 0 && result.size() < limit; --i )
+      result.push_back( get_fill( itr->first, i - 1 ) );
+   return result;
+}
+
+vector<bucket_object> market_history_store::get_market_history( asset_id_type a, asset_id_type b, uint32_t bucket_seconds,
+                                                                fc::time_point_sec start, fc::time_point_sec end, uint32_t limit )const
+{
+   if( a > b )
+      std::swap( a, b );
+   vector<bucket_object> result;
+   std::lock_guard<std::mutex> lock( _mutex );
+   auto itr = _buckets.find( bucket_series_key( market_type( a, b ), bucket_seconds ) );
+   if( itr == _buckets.end() )
+      return result;
+   const auto& series = itr->second;
+   const bucket_key key( a, b, bucket_seconds, fc::time_point_sec() );
+   for( size_t i = std::lower_bound( series.open.begin(), series.open.end(), start ) - series.open.begin();
+        i < series.size() && series.open[i] <= end && result.size() < limit; ++i )
+      result.push_back( series.get( key, i ) );
+   return result;
+}
+
+optional<order_history_object> market_history_store::lower_bound_fill( object_id_type id )const
+{
+   std::lock_guard<std::mutex> lock( _mutex );
+   for( uint64_t i = std::max( id.instance(), _first_fill_id ); i < _first_fill_id + _fill_markets.size(); ++i )
+   {
+      const auto& market = _fill_markets[i - _first_fill_id];
+      auto series = _fills.find( market );
+      if( series == _fills.end() )
+         continue;
+      const auto& ids = series->second.id;
+      auto row = std::lower_bound( ids.begin(), ids.end(), i );
+      if( row != ids.end() && *row == i )
+         return get_fill( market, row - ids.begin() );
+   }
+   return optional<order_history_object>();
+}
+
+} } //graphene::market_history
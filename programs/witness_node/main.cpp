@@ -253,6 +253,13 @@ int main(int argc, char** argv)
       node->initialize_plugins( options );
 
       node->startup();   //节点网络初始化
+      if( options.count("replay-benchmark") )
+      {
+         node->shutdown_plugins();
+         node->shutdown();
+         delete node;
+         return 0;
+      }
       node->startup_plugins(); //插件初始化
 
       fc::promise<int>::ptr exit_promise = new fc::promise<int>("UNIX Signal Handler");
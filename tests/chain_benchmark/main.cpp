@@ -0,0 +1,475 @@
+/*
+ * Copyright (c) 2015 Cryptonomex, Inc., and contributors.
+ *
+ * The MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+/**
+ *  End to end throughput benchmark of the chain database.
+ *
+ *  A configurable mix of transfers, NFT, contract, crontab and proposal transactions is pushed
+ *  through push_transaction and generate_block, then the produced blocks are replayed into a second
+ *  database through push_block. Timings, undo usage and memory are written as JSON.
+ *
+ *  Options go after a "--" so that Boost.Test leaves them alone:
+ *
+ *     chain_benchmark -- --blocks=200 --tx-per-block=500 --mix=transfer:70,contract:30 --output=bench.json
+ */
+#define BOOST_TEST_MODULE "Chain Throughput Benchmark"
+#include <boost/test/included/unit_test.hpp>
+
+#include <boost/algorithm/string.hpp>
+#include <boost/program_options.hpp>
+
+#include <graphene/chain/database.hpp>
+#include <graphene/chain/protocol/protocol.hpp>
+#include <graphene/chain/account_object.hpp>
+#include <graphene/chain/contract_object.hpp>
+
+#include <fc/io/json.hpp>
+#include <fc/variant_object.hpp>
+
+#include "../common/database_fixture.hpp"
+
+#include <sys/resource.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <numeric>
+#include <random>
+
+using namespace graphene::chain;
+using namespace graphene::chain::test;
+namespace bpo = boost::program_options;
+
+namespace {
+
+enum traffic_kind { transfer_traffic, nft_traffic, contract_traffic, crontab_traffic, proposal_traffic, traffic_kind_count };
+const char* const traffic_names[] = { "transfer", "nft", "contract", "crontab", "proposal" };
+
+/// the first contract of a chain is the base environment every other contract runs in
+const char* const base_contract_code =
+   "return { tostring = tostring, tonumber = tonumber, type = type, pairs = pairs, ipairs = ipairs,\n"
+   "         string = string, table = table, math = math }\n";
+
+const char* const log_contract_code =
+   "function log_value(value)\n"
+   "    chainhelper:log(value)\n"
+   "end\n";
+
+const char* const counter_contract_code =
+   "function init()\n"
+   "    public_data.count = 0\n"
+   "    write_list = { public_data = { count = true } }\n"
+   "    chainhelper:write_chain()\n"
+   "end\n"
+   "function add(step)\n"
+   "    read_list = { public_data = { count = true } }\n"
+   "    chainhelper:read_chain()\n"
+   "    public_data.count = public_data.count + step\n"
+   "    write_list = { public_data = { count = true } }\n"
+   "    chainhelper:write_chain()\n"
+   "end\n";
+
+struct benchmark_options
+{
+   uint32_t blocks = 100;
+   uint32_t tx_per_block = 100;
+   uint32_t accounts = 100;
+   uint32_t seed = 1;
+   bool     skip_signatures = false;
+   string   output;
+   uint32_t weights[traffic_kind_count] = { 60, 15, 15, 5, 5 };
+};
+
+benchmark_options parse_options()
+{
+   benchmark_options result;
+   string mix;
+   bpo::options_description desc( "Chain benchmark options" );
+   desc.add_options()
+      ("blocks", bpo::value<uint32_t>(&result.blocks), "Number of blocks to produce")
+      ("tx-per-block", bpo::value<uint32_t>(&result.tx_per_block), "Transactions pushed before each block")
+      ("accounts", bpo::value<uint32_t>(&result.accounts), "Number of accounts sending traffic")
+      ("mix", bpo::value<string>(&mix), "Weights of the traffic kinds, e.g. transfer:60,nft:15,contract:15,crontab:5,proposal:5")
+      ("seed", bpo::value<uint32_t>(&result.seed), "Seed of the traffic generator")
+      ("skip-signatures", bpo::bool_switch(&result.skip_signatures), "Skip signature and authority checks")
+      ("output", bpo::value<string>(&result.output), "Also write the JSON report to this file")
+      ;
+   bpo::variables_map vm;
+   auto& suite = boost::unit_test::framework::master_test_suite();
+   bpo::store( bpo::command_line_parser( suite.argc, suite.argv ).options( desc ).allow_unregistered().run(), vm );
+   bpo::notify( vm );
+
+   if( !mix.empty() )
+   {
+      std::fill( std::begin( result.weights ), std::end( result.weights ), 0 );
+      vector<string> entries;
+      boost::split( entries, mix, boost::is_any_of( "," ) );
+      for( const auto& entry : entries )
+      {
+         auto colon = entry.find( ':' );
+         FC_ASSERT( colon != string::npos, "Mix entries look like kind:weight, got ${e}", ("e", entry) );
+         auto name = entry.substr( 0, colon );
+         auto kind = std::find( std::begin( traffic_names ), std::end( traffic_names ), name );
+         FC_ASSERT( kind != std::end( traffic_names ), "Unknown traffic kind ${k}", ("k", name) );
+         result.weights[kind - std::begin( traffic_names )] = std::stoul( entry.substr( colon + 1 ) );
+      }
+   }
+   FC_ASSERT( std::accumulate( std::begin( result.weights ), std::end( result.weights ), 0u ) > 0, "The traffic mix is empty" );
+   FC_ASSERT( result.accounts >= 2, "At least two accounts are needed" );
+   return result;
+}
+
+/// latencies in microseconds
+fc::mutable_variant_object summarize( vector<int64_t> samples )
+{
+   fc::mutable_variant_object result;
+   result["count"] = samples.size();
+   if( samples.empty() )
+      return result;
+   std::sort( samples.begin(), samples.end() );
+   auto percentile = [&]( double p ) { return samples[ std::min( samples.size() - 1, size_t( p * samples.size() ) ) ]; };
+   result["total"] = std::accumulate( samples.begin(), samples.end(), int64_t(0) );
+   result["min"] = samples.front();
+   result["p50"] = percentile( 0.50 );
+   result["p90"] = percentile( 0.90 );
+   result["p99"] = percentile( 0.99 );
+   result["max"] = samples.back();
+   return result;
+}
+
+/// bytes of the objects the newest undo state would restore, plus one id per created object
+int64_t undo_state_size( const graphene::db::undo_state& state )
+{
+   int64_t result = 0;
+   for( const auto& item : state.old_values )
+      result += item.second->pack().size();
+   for( const auto& item : state.removed )
+      result += item.second->pack().size();
+   result += ( state.new_ids.size() + state.old_index_next_ids.size() ) * sizeof(object_id_type);
+   return result;
+}
+
+fc::mutable_variant_object memory_usage()
+{
+   fc::mutable_variant_object result;
+   std::ifstream statm( "/proc/self/statm" );
+   int64_t size = 0, resident = 0;
+   if( statm >> size >> resident )
+      result["rss_bytes"] = resident * sysconf( _SC_PAGESIZE );
+   struct rusage usage;
+   if( getrusage( RUSAGE_SELF, &usage ) == 0 )
+      result["peak_rss_bytes"] = int64_t( usage.ru_maxrss ) * 1024;
+   return result;
+}
+
+} // namespace
+
+BOOST_FIXTURE_TEST_CASE( chain_throughput, database_fixture )
+{
+   try {
+      const benchmark_options options = parse_options();
+      const uint32_t skip = options.skip_signatures
+                            ? database::skip_transaction_signatures | database::skip_authority_check
+                            : database::skip_nothing;
+      std::mt19937 random( options.seed );
+      std::discrete_distribution<int> pick_kind( std::begin( options.weights ), std::end( options.weights ) );
+
+      // accounts, the NFT creator and the sample contracts
+      vector<account_id_type> accounts;
+      vector<fc::ecc::private_key> keys;
+      for( uint32_t i = 0; i < options.accounts; ++i )
+      {
+         const string name = "bench" + fc::to_string( uint64_t(i) );
+         keys.push_back( generate_private_key( name ) );
+         const auto& account = create_account( name, keys.back().get_public_key() );
+         accounts.push_back( account.id );
+         fund( account, asset( 1000000000000ll ) );
+      }
+      trx.operations.clear();
+      const account_id_type nft_creator = accounts[0];
+      const auto& creator_key = keys[0];
+      const string world_view = "benchworld";
+      {
+         register_nh_asset_creator_operation op;
+         op.fee_paying_account = nft_creator;
+         trx.operations.push_back( op );
+         PUSH_TX( db.get(), trx, ~0 );
+         trx.operations.clear();
+      }
+      {
+         create_world_view_operation op;
+         op.fee_paying_account = nft_creator;
+         op.world_view = world_view;
+         trx.operations.push_back( op );
+         PUSH_TX( db.get(), trx, ~0 );
+         trx.operations.clear();
+      }
+      auto create_contract = [&]( const string& name, const string& code ) {
+         contract_create_operation op;
+         op.owner = nft_creator;
+         op.name = name;
+         op.data = code;
+         op.contract_authority = creator_key.get_public_key();
+         trx.operations.push_back( op );
+         auto ptx = PUSH_TX( db.get(), trx, ~0 );
+         trx.operations.clear();
+         return contract_id_type( ptx.operation_results[0].get<object_id_result>().result );
+      };
+      if( db->get_index_type<contract_index>().get_next_id() == contract_id_type() )
+         create_contract( "contract.benchbase", base_contract_code );
+      const contract_id_type log_contract = create_contract( "contract.benchlog", log_contract_code );
+      const contract_id_type counter_contract = create_contract( "contract.benchcounter", counter_contract_code );
+      {
+         call_contract_function_operation op;
+         op.caller = nft_creator;
+         op.contract_id = counter_contract;
+         op.function_name = "init";
+         op.amount = 0;
+         trx.operations.push_back( op );
+         PUSH_TX( db.get(), trx, ~0 );
+         trx.operations.clear();
+      }
+      generate_block();
+      const uint32_t first_block = db->head_block_num() + 1;
+
+      // traffic
+      const auto& params = db->get_global_properties().parameters;
+      const uint32_t order_lifetime = std::min<uint32_t>( 3600, params.maximum_nh_asset_order_expiration );
+      const uint32_t proposal_lifetime = std::min<uint32_t>( 3600, params.maximum_proposal_lifetime );
+      std::deque<std::pair<nh_asset_id_type, size_t>> nfts; ///< with the index of their owner, none of them on order
+      vector<int64_t> push_latency[traffic_kind_count];
+      vector<int64_t> generate_latency, undo_bytes;
+      uint64_t counter = 0, pushed = 0, failed[traffic_kind_count] = {};
+      size_t max_undo_states = 0;
+
+      auto other_account = [&]( size_t from ) {
+         return ( from + 1 + random() % ( accounts.size() - 1 ) ) % accounts.size();
+      };
+      auto make_transfer = [&]( size_t from, size_t to ) {
+         transfer_operation op;
+         op.from = accounts[from];
+         op.to = accounts[to];
+         op.amount = asset( 1 + counter ); // keeps every transaction unique
+         return op;
+      };
+
+      for( uint32_t b = 0; b < options.blocks; ++b )
+      {
+         for( uint32_t t = 0; t < options.tx_per_block; ++t, ++counter )
+         {
+            const int kind = pick_kind( random );
+            const size_t from = random() % accounts.size();
+            const size_t to = other_account( from );
+            signed_transaction tx;
+            set_expiration( db.get(), tx );
+            const fc::ecc::private_key* key = &keys[from];
+            std::function<void( const processed_transaction& )> on_pushed;
+
+            switch( kind )
+            {
+               case transfer_traffic:
+                  tx.operations.push_back( make_transfer( from, to ) );
+                  break;
+               case nft_traffic:
+                  if( nfts.empty() || counter % 3 == 0 )
+                  {
+                     create_nh_asset_operation op;
+                     op.fee_paying_account = nft_creator;
+                     op.owner = accounts[from];
+                     op.asset_id = GRAPHENE_SYMBOL;
+                     op.world_view = world_view;
+                     op.base_describe = "{\"bench\":" + fc::to_string( counter ) + "}";
+                     tx.operations.push_back( op );
+                     key = &creator_key;
+                     on_pushed = [&nfts, from]( const processed_transaction& ptx ) {
+                        nfts.emplace_back( ptx.operation_results[0].get<object_id_result>().result, from );
+                     };
+                  }
+                  else if( counter % 3 == 1 )
+                  {
+                     const auto nft = nfts.front();
+                     nfts.pop_front();
+                     transfer_nh_asset_operation op;
+                     const size_t new_owner = other_account( nft.second );
+                     op.from = accounts[nft.second];
+                     op.to = accounts[new_owner];
+                     op.nh_asset = nft.first;
+                     tx.operations.push_back( op );
+                     key = &keys[nft.second];
+                     on_pushed = [&nfts, nft, new_owner]( const processed_transaction& ) { nfts.emplace_back( nft.first, new_owner ); };
+                  }
+                  else
+                  {
+                     const auto nft = nfts.front();
+                     nfts.pop_front();
+                     create_nh_asset_order_operation op;
+                     op.seller = accounts[nft.second];
+                     op.otcaccount = nft_creator;
+                     op.pending_orders_fee = asset( 1 );
+                     op.nh_asset = nft.first;
+                     op.price = asset( 100 );
+                     op.expiration = db->head_block_time() + order_lifetime;
+                     tx.operations.push_back( op );
+                     key = &keys[nft.second];
+                  }
+                  break;
+               case contract_traffic:
+               {
+                  call_contract_function_operation op;
+                  op.caller = accounts[from];
+                  op.amount = 0;
+                  if( counter % 2 == 0 )
+                  {
+                     op.contract_id = log_contract;
+                     op.function_name = "log_value";
+                     op.value_list.push_back( lua_string( fc::to_string( counter ) ) );
+                  }
+                  else
+                  {
+                     op.contract_id = counter_contract;
+                     op.function_name = "add";
+                     op.value_list.push_back( lua_int( counter ) );
+                  }
+                  tx.operations.push_back( op );
+                  break;
+               }
+               case crontab_traffic:
+               {
+                  crontab_create_operation op;
+                  op.crontab_creator = accounts[from];
+                  op.crontab_ops.push_back( op_wrapper( make_transfer( from, to ) ) );
+                  op.start_time = db->head_block_time() + params.block_interval * 2;
+                  op.execute_interval = params.block_interval;
+                  op.scheduled_execute_times = 3;
+                  tx.operations.push_back( op );
+                  break;
+               }
+               case proposal_traffic:
+               {
+                  proposal_create_operation op;
+                  op.fee_paying_account = accounts[from];
+                  op.proposed_ops.push_back( op_wrapper( make_transfer( from, to ) ) );
+                  op.expiration_time = db->head_block_time() + proposal_lifetime;
+                  tx.operations.push_back( op );
+                  break;
+               }
+            }
+            tx.sign( *key, db->get_chain_id() );
+
+            const auto start = fc::time_point::now();
+            try {
+               auto ptx = db->push_transaction( tx, skip );
+               push_latency[kind].push_back( ( fc::time_point::now() - start ).count() );
+               ++pushed;
+               if( on_pushed )
+                  on_pushed( ptx );
+            } catch( const fc::exception& e ) {
+               ++failed[kind];
+               wlog( "${k} transaction failed: ${e}", ("k", traffic_names[kind])("e", e.to_string()) );
+            }
+         }
+
+         const auto start = fc::time_point::now();
+         db->generate_block( db->get_slot_time( 1 ), db->get_scheduled_witness( 1 ), init_account_priv_key,
+                             skip | database::skip_undo_history_check );
+         generate_latency.push_back( ( fc::time_point::now() - start ).count() );
+         db->clear_pending();
+         undo_bytes.push_back( undo_state_size( db->_undo_db.head() ) );
+         max_undo_states = std::max( max_undo_states, db->_undo_db.size() );
+      }
+      const uint32_t last_block = db->head_block_num();
+      const auto producer_memory = memory_usage();
+
+      // replay the produced chain into a fresh database
+      vector<int64_t> push_block_latency;
+      uint32_t applied_transactions = 0;
+      {
+         fc::temp_directory replay_dir( graphene::utilities::temp_directory_path() );
+         database replay_db( replay_dir.path() );
+         replay_db.open( replay_dir.path(), [this]{ return genesis_state; }, "test" );
+         for( uint32_t num = 1; num <= last_block; ++num )
+         {
+            const auto block = db->fetch_block_by_number( num );
+            FC_ASSERT( block.valid(), "Block ${n} is missing", ("n", num) );
+            const auto start = fc::time_point::now();
+            replay_db.push_block( *block, skip | database::skip_undo_history_check );
+            if( num >= first_block )
+            {
+               push_block_latency.push_back( ( fc::time_point::now() - start ).count() );
+               applied_transactions += block->transactions.size();
+            }
+         }
+         replay_db.close();
+      }
+
+      fc::mutable_variant_object push_transaction_stats;
+      vector<int64_t> all_pushes;
+      for( int kind = 0; kind < traffic_kind_count; ++kind )
+      {
+         auto stats = summarize( push_latency[kind] );
+         stats["failed"] = failed[kind];
+         push_transaction_stats[traffic_names[kind]] = stats;
+         all_pushes.insert( all_pushes.end(), push_latency[kind].begin(), push_latency[kind].end() );
+      }
+      push_transaction_stats["all"] = summarize( all_pushes );
+
+      const int64_t produce_us = std::accumulate( all_pushes.begin(), all_pushes.end(), int64_t(0) )
+                               + std::accumulate( generate_latency.begin(), generate_latency.end(), int64_t(0) );
+      const int64_t replay_us = std::accumulate( push_block_latency.begin(), push_block_latency.end(), int64_t(0) );
+      fc::mutable_variant_object config;
+      config["blocks"] = options.blocks;
+      config["tx_per_block"] = options.tx_per_block;
+      config["accounts"] = options.accounts;
+      config["seed"] = options.seed;
+      config["skip_signatures"] = options.skip_signatures;
+      fc::mutable_variant_object mix;
+      for( int kind = 0; kind < traffic_kind_count; ++kind )
+         mix[traffic_names[kind]] = options.weights[kind];
+      config["mix"] = mix;
+
+      fc::mutable_variant_object report;
+      report["config"] = config;
+      report["transactions_pushed"] = pushed;
+      report["transactions_in_blocks"] = applied_transactions;
+      report["produce_tps"] = produce_us > 0 ? double( pushed ) * 1000000 / produce_us : 0.0;
+      report["replay_tps"] = replay_us > 0 ? double( applied_transactions ) * 1000000 / replay_us : 0.0;
+      report["push_transaction_us"] = push_transaction_stats;
+      report["generate_block_us"] = summarize( generate_latency );
+      report["push_block_us"] = summarize( push_block_latency );
+      auto undo = summarize( undo_bytes );
+      undo["max_undo_states"] = max_undo_states;
+      report["undo_bytes_per_block"] = undo;
+      report["memory_after_produce"] = producer_memory;
+      report["memory_after_replay"] = memory_usage();
+
+      const string json = fc::json::to_pretty_string( fc::variant( report ) );
+      std::cout << json << std::endl;
+      if( !options.output.empty() )
+      {
+         std::ofstream out( options.output );
+         out << json << std::endl;
+      }
+   } FC_LOG_AND_RETHROW()
+}
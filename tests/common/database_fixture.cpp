@@ -32,6 +32,7 @@
 #include <graphene/chain/account_object.hpp>
 #include <graphene/chain/asset_object.hpp>
 #include <graphene/chain/committee_member_object.hpp>
+#include <graphene/chain/contract_object.hpp>
 // #include <graphene/chain/fba_object.hpp>
 #include <graphene/chain/market_object.hpp>
 #include <graphene/chain/vesting_balance_object.hpp>
@@ -791,6 +792,47 @@ void database_fixture::transfer(
    } FC_CAPTURE_AND_RETHROW( (from.id)(to.id)(amount) )
 }
 
+contract_id_type database_fixture::create_contract( account_id_type owner, const string& name, const string& code )
+{
+   try
+   {
+      // contract 0 is the _ENV every other contract runs in
+      if( db->get_index_type<contract_index>().get_next_id() == contract_id_type() )
+         create_contract( owner, "contract.base",
+                          "return { tostring = tostring, tonumber = tonumber, type = type, pairs = pairs, ipairs = ipairs,\n"
+                          "         string = string, table = table, math = math }\n" );
+      set_expiration( db.get(), trx );
+      contract_create_operation op;
+      op.owner = owner;
+      op.name = name;
+      op.data = code;
+      op.contract_authority = generate_private_key( name ).get_public_key();
+      trx.operations.push_back( op );
+      auto ptx = db->push_transaction( trx, ~0 );
+      trx.operations.clear();
+      return contract_id_type( ptx.operation_results[0].get<object_id_result>().result );
+   } FC_CAPTURE_AND_RETHROW( (owner)(name) )
+}
+
+contract_result database_fixture::call_contract( account_id_type caller, contract_id_type contract, const string& function_name,
+                                                 const vector<lua_types>& value_list )
+{
+   try
+   {
+      set_expiration( db.get(), trx );
+      call_contract_function_operation op;
+      op.caller = caller;
+      op.contract_id = contract;
+      op.function_name = function_name;
+      op.value_list = value_list;
+      trx.operations.push_back( op );
+      trx.validate();
+      auto ptx = db->push_transaction( trx, ~0 );
+      trx.operations.clear();
+      return ptx.operation_results[0].get<contract_result>();
+   } FC_CAPTURE_AND_RETHROW( (caller)(contract)(function_name) )
+}
+
 void database_fixture::update_feed_producers( const asset_object& mia, flat_set<account_id_type> producers )
 { 
    try 
@@ -308,6 +308,12 @@ namespace graphene {
          void transfer( account_id_type from, account_id_type to, const asset& amount);
          
          void transfer( const account_object& from, const account_object& to, const asset& amount);
+
+         /// deploys code as a new contract owned by owner, creating the base environment contract first if the chain has none
+         contract_id_type create_contract( account_id_type owner, const string& name, const string& code );
+
+         contract_result call_contract( account_id_type caller, contract_id_type contract, const string& function_name,
+                                        const vector<lua_types>& value_list = vector<lua_types>() );
          
          void enable_fees();
          
@@ -1333,4 +1333,38 @@ BOOST_FIXTURE_TEST_CASE(nonminimal_sig_test, database_fixture)
     }
 }
 
+BOOST_AUTO_TEST_CASE(authority_cache_follows_account_changes)
+{
+    try
+    {
+        fc::ecc::private_key nathan_key1 = fc::ecc::private_key::regenerate(fc::digest("key1"));
+        fc::ecc::private_key nathan_key2 = fc::ecc::private_key::regenerate(fc::digest("key2"));
+        const account_object &nathan = create_account("nathan", nathan_key1.get_public_key());
+        account_id_type nathan_id = nathan.id;
+        auto &cache = db->get_authority_cache();
+        auto set_active = [&](const fc::ecc::private_key &key) {
+            db->modify(nathan_id(*db), [&](account_object &account) { account.active = authority(1, public_key_type(key.get_public_key()), 1); });
+        };
+
+        BOOST_CHECK(cache.get_active(nathan_id)->key_auths.count(nathan_key1.get_public_key()));
+        set_active(nathan_key2);
+        BOOST_CHECK(cache.get_active(nathan_id)->key_auths.count(nathan_key2.get_public_key()));
+        BOOST_CHECK(!cache.get_active(nathan_id)->key_auths.count(nathan_key1.get_public_key()));
+
+        {
+            auto session = db->_undo_db.start_undo_session();
+            set_active(nathan_key1);
+            BOOST_CHECK(cache.get_active(nathan_id)->key_auths.count(nathan_key1.get_public_key()));
+        }
+        // undoing the session is seen by the cache as well
+        BOOST_CHECK(cache.get_active(nathan_id)->key_auths.count(nathan_key2.get_public_key()));
+        BOOST_CHECK(!cache.get_active(nathan_id)->key_auths.count(nathan_key1.get_public_key()));
+    }
+    catch (fc::exception &e)
+    {
+        edump((e.to_detail_string()));
+        throw;
+    }
+}
+
 BOOST_AUTO_TEST_SUITE_END()
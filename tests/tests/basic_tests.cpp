@@ -26,6 +26,10 @@
 
 #include <graphene/chain/database.hpp>
 #include <graphene/chain/protocol/protocol.hpp>
+#include <graphene/chain/protocol/lua_scheduler.hpp>
+#include <graphene/chain/lua_memory_pool.hpp>
+#include <graphene/chain/lua_vm_standby.hpp>
+#include <graphene/chain/worker_pool.hpp>
 
 #include <graphene/chain/account_object.hpp>
 #include <graphene/chain/asset_object.hpp>
@@ -39,6 +43,7 @@
 
 #include <algorithm>
 #include <random>
+#include <thread>
 
 using namespace graphene::chain;
 using namespace graphene::db;
@@ -413,4 +418,173 @@ BOOST_AUTO_TEST_CASE( merkle_root )
    BOOST_CHECK( block.calculate_merkle_root() == c(dO) );
 }
 
+BOOST_AUTO_TEST_CASE( reset_sandbox_data )
+{
+   lua_scheduler context;
+   BOOST_CHECK( !context.reset_sandbox_data( "contract.missing" ) );
+
+   // whatever the previous call left behind is replaced, everything else in the sandbox stays
+   context.executeCode( "sandbox = { private_data = { stale = 1 }, public_data = { stale = 1 },\n"
+                        "            read_list = { public_data = { stale = true } }, write_list = 5, kept = 'yes' }\n"
+                        "previous_public_data = sandbox.public_data\n" );
+   BOOST_REQUIRE( context.reset_sandbox_data( "sandbox" ) );
+   BOOST_CHECK( context.executeCode<bool>( "return sandbox._G == 'protected'" ) );
+   BOOST_CHECK( context.executeCode<bool>( "return next(sandbox.private_data) == nil and next(sandbox.public_data) == nil" ) );
+   BOOST_CHECK( context.executeCode<bool>( "return sandbox.public_data ~= previous_public_data and previous_public_data.stale == 1" ) );
+   for( const char* list : { "read_list", "write_list" } )
+   {
+      const string check = string( "local l = sandbox." ) + list + "\n"
+                           "return type(l) == 'table' and next(l.private_data) == nil and next(l.public_data) == nil";
+      BOOST_CHECK_MESSAGE( context.executeCode<bool>( check ), list );
+   }
+   BOOST_CHECK( context.executeCode<bool>( "return sandbox.kept == 'yes'" ) );
+   BOOST_CHECK_EQUAL( lua_gettop( context.mState ), 0 );
+
+   int marker = 0;
+   context.set_registry_pointer( "chainhelper", &marker );
+   BOOST_CHECK( lua_scheduler::get_registry_pointer( context.mState, "chainhelper" ) == &marker );
+   context.set_registry_pointer( "chainhelper", nullptr );
+   BOOST_CHECK( lua_scheduler::get_registry_pointer( context.mState, "chainhelper" ) == nullptr );
+}
+
+BOOST_AUTO_TEST_CASE( lua_memory_pool_alloc_free_trim )
+{
+   lua_memory_pool pool;
+   auto alloc = [&]( void* ptr, size_t osize, size_t nsize ) { return lua_memory_pool::alloc( &pool, ptr, osize, nsize ); };
+
+   // a fresh block, osize is the lua type tag when ptr is null
+   char* block = static_cast<char*>( alloc( nullptr, LUA_TSTRING, 24 ) );
+   BOOST_REQUIRE( block != nullptr );
+   std::memset( block, 'x', 24 );
+   BOOST_CHECK_EQUAL( pool.live_bytes(), 24u );
+   BOOST_CHECK_EQUAL( pool.reserved_bytes(), lua_memory_pool::slab_size );
+   BOOST_CHECK_EQUAL( pool.reclaimable_bytes(), 0u );
+
+   // growing within the size class keeps the block, growing past the pooled sizes moves it to malloc
+   BOOST_CHECK( alloc( block, 24, 30 ) == block );
+   char* large = static_cast<char*>( alloc( block, 30, lua_memory_pool::max_pooled_size + 100 ) );
+   BOOST_REQUIRE( large != nullptr );
+   BOOST_CHECK_EQUAL( string( large, 24 ), string( 24, 'x' ) );
+   BOOST_CHECK_EQUAL( pool.live_bytes(), lua_memory_pool::max_pooled_size + 100 );
+   BOOST_CHECK_EQUAL( pool.reclaimable_bytes(), lua_memory_pool::slab_size );
+   alloc( large, lua_memory_pool::max_pooled_size + 100, 0 );
+   BOOST_CHECK_EQUAL( pool.live_bytes(), 0u );
+   BOOST_CHECK_GE( pool.peak_bytes(), lua_memory_pool::max_pooled_size + 100 );
+
+   pool.trim();
+   BOOST_CHECK_EQUAL( pool.reserved_bytes(), 0u );
+   BOOST_CHECK_EQUAL( pool.reclaimable_bytes(), 0u );
+
+   // one live block in each of two slabs keeps both, and trim has nothing to give back
+   const size_t blocks_per_slab = lua_memory_pool::slab_size / lua_memory_pool::size_class_step - 1;
+   vector<void*> blocks;
+   for( size_t i = 0; i < blocks_per_slab + 10; i++ )
+      blocks.push_back( alloc( nullptr, LUA_TTABLE, lua_memory_pool::size_class_step ) );
+   BOOST_CHECK_EQUAL( pool.reserved_bytes(), 2 * lua_memory_pool::slab_size );
+   for( size_t i = 1; i + 1 < blocks.size(); i++ )
+      alloc( blocks[i], lua_memory_pool::size_class_step, 0 );
+   BOOST_CHECK_EQUAL( pool.reclaimable_bytes(), 0u );
+   pool.trim();
+   BOOST_CHECK_EQUAL( pool.reserved_bytes(), 2 * lua_memory_pool::slab_size );
+   // the free blocks of the kept slabs are still handed out after the trim
+   void* reused = alloc( nullptr, LUA_TTABLE, lua_memory_pool::size_class_step );
+   BOOST_CHECK( reused != nullptr );
+   BOOST_CHECK_EQUAL( pool.reserved_bytes(), 2 * lua_memory_pool::slab_size );
+   alloc( reused, lua_memory_pool::size_class_step, 0 );
+
+   alloc( blocks.front(), lua_memory_pool::size_class_step, 0 );
+   BOOST_CHECK_EQUAL( pool.reclaimable_bytes(), lua_memory_pool::slab_size );
+   alloc( blocks.back(), lua_memory_pool::size_class_step, 0 );
+   BOOST_CHECK_EQUAL( pool.reclaimable_bytes(), 2 * lua_memory_pool::slab_size );
+   pool.trim();
+   BOOST_CHECK_EQUAL( pool.reserved_bytes(), 0u );
+
+   // a call cap refuses growth beyond the live heap at begin_call
+   {
+      lua_memory_pool::scoped_call call( pool, 64 );
+      void* small = alloc( nullptr, LUA_TSTRING, 48 );
+      BOOST_CHECK( small != nullptr );
+      BOOST_CHECK( alloc( nullptr, LUA_TSTRING, 48 ) == nullptr );
+      alloc( small, 48, 0 );
+   }
+   void* uncapped = alloc( nullptr, LUA_TSTRING, 1024 );
+   BOOST_CHECK( uncapped != nullptr );
+   alloc( uncapped, 1024, 0 );
+}
+
+BOOST_AUTO_TEST_CASE( lua_vm_standby_take )
+{
+   lua_vm_standby standby;
+   BOOST_CHECK( !standby.take() );
+
+   const string base_source = "return { answer = 42 }";
+   const vector<char> base_code( base_source.begin(), base_source.end() );
+   auto wait_until_ready = [&]() {
+      for( int i = 0; i < 5000 && !standby.ready(); i++ )
+         std::this_thread::sleep_for( std::chrono::milliseconds( 1 ) );
+      BOOST_REQUIRE( standby.ready() );
+   };
+
+   standby.prepare( base_code, "contract.base" );
+   // take never waits: a build that has not finished stays prepared for a later call
+   auto early = standby.take();
+   if( !early )
+      BOOST_CHECK( standby.prepared() );
+   else
+      standby.retire( std::move( early ) );
+
+   if( !standby.prepared() )
+      standby.prepare( base_code, "contract.base" );
+   wait_until_ready();
+   auto vm = standby.take();
+   BOOST_REQUIRE( vm );
+   BOOST_CHECK( !standby.prepared() );
+   BOOST_CHECK( vm->base_code == base_code );
+   BOOST_CHECK_EQUAL( lua_getglobal( vm->vm->mState, "baseENV" ), LUA_TFUNCTION );
+   lua_pop( vm->vm->mState, 1 );
+   void* ud = nullptr;
+   BOOST_CHECK( lua_getallocf( vm->vm->mState, &ud ) == &lua_memory_pool::alloc );
+   BOOST_CHECK( ud == vm->pool.get() );
+   standby.retire( std::move( vm ) );
+
+   // clearing drops a build in flight without waiting for it
+   standby.prepare( base_code, "contract.base" );
+   standby.clear();
+   BOOST_CHECK( !standby.prepared() );
+   BOOST_CHECK( !standby.take() );
+}
+
+BOOST_AUTO_TEST_CASE( worker_pool_waits_without_yielding )
+{
+   worker_pool pool;
+   pool.set_thread_count( 3 );
+
+   // a task queued on this thread must not run while the pool is being waited for, the chain
+   // thread waits on the pool in the middle of applying a block
+   bool other_task_ran = false;
+   fc::future<void> other_task = fc::async( [&]() { other_task_ran = true; } );
+
+   vector<uint32_t> results( 100 );
+   pool.for_each( results.size(), [&]( size_t i ) {
+      std::this_thread::sleep_for( std::chrono::microseconds( 100 ) );
+      results[i] = i * 2;
+   }, 10 );
+   for( size_t i = 0; i < results.size(); i++ )
+      BOOST_CHECK_EQUAL( results[i], i * 2 );
+   BOOST_CHECK( !other_task_ran );
+
+   // waiting on scheduled work does yield, callers that can take it use it to keep serving other tasks
+   auto ran = std::make_shared<bool>( false );
+   pool.schedule( [ran]() {
+      std::this_thread::sleep_for( std::chrono::milliseconds( 10 ) );
+      *ran = true;
+   } ).wait();
+   BOOST_CHECK( *ran );
+   BOOST_CHECK( other_task_ran );
+   BOOST_CHECK_THROW( pool.schedule( []() { FC_THROW( "failed on the pool" ); } ).wait(), fc::exception );
+
+   worker_pool no_threads;
+   BOOST_CHECK_THROW( no_threads.schedule( []() {} ), fc::exception );
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -36,6 +36,9 @@
 #include <graphene/utilities/tempdir.hpp>
 
 #include <fc/crypto/digest.hpp>
+#include <fc/bitutil.hpp>
+#include <boost/algorithm/string/predicate.hpp>
+#include <fstream>
 
 #include "../common/database_fixture.hpp"
 
@@ -131,6 +134,110 @@ BOOST_AUTO_TEST_CASE( block_database_test )
    }
 }
 
+BOOST_AUTO_TEST_CASE( block_database_headers )
+{
+   try {
+      fc::temp_directory data_dir( graphene::utilities::temp_directory_path() );
+      block_database bdb;
+      bdb.open( data_dir.path() );
+
+      signed_block b;
+      for( uint32_t i = 0; i < 5; ++i )
+      {
+         if( i > 0 )
+            b.previous = b.make_id();
+         b.witness = witness_id_type(i+1);
+         bdb.store( b.make_id(), b );
+      }
+
+      auto check_headers = [&]() {
+         for( uint32_t i = 1; i <= 5; ++i )
+         {
+            auto header = bdb.fetch_header_by_number( i );
+            BOOST_REQUIRE( header.valid() );
+            BOOST_CHECK( header->id == bdb.fetch_block_id( i ) );
+            BOOST_CHECK( header->header.witness == witness_id_type(i) );
+            BOOST_CHECK_EQUAL( header->transaction_count, 0 );
+            BOOST_CHECK_EQUAL( header->block_size, fc::raw::pack_size( *bdb.fetch_by_number( i ) ) );
+         }
+         BOOST_CHECK( !bdb.fetch_header_by_number( 6 ).valid() );
+      };
+      check_headers();
+
+      // a block database written before the header records existed gets them on first lookup
+      bdb.close();
+      fc::remove( data_dir.path() / "headers" );
+      bdb.open( data_dir.path() );
+      check_headers();
+      check_headers();
+
+      bdb.remove( b.make_id() );
+      BOOST_CHECK( !bdb.fetch_header_by_number( 5 ).valid() );
+   } catch (fc::exception& e) {
+      edump((e.to_detail_string()));
+      throw;
+   }
+}
+
+BOOST_AUTO_TEST_CASE( fork_database_shares_blocks )
+{
+   try {
+      signed_block genesis;
+      genesis.witness = witness_id_type(1);
+      genesis.block_id = genesis.make_id();
+      signed_block next;
+      next.previous = genesis.block_id;
+      next.witness = witness_id_type(2);
+      next.block_id = next.make_id();
+
+      fork_database fork_db;
+      signed_block_ptr genesis_ptr = std::make_shared<const signed_block>( genesis );
+      signed_block_ptr next_ptr = std::make_shared<const signed_block>( next );
+      fork_db.start_block( genesis_ptr );
+      shared_ptr<fork_item> head = fork_db.push_block( next_ptr );
+
+      // the fork database keeps the block it was given instead of a copy
+      BOOST_CHECK( head->block.get() == next_ptr.get() );
+      BOOST_CHECK( &head->data == next_ptr.get() );
+      BOOST_CHECK( fork_db.fetch_block( genesis.block_id )->block.get() == genesis_ptr.get() );
+
+      // a block pushed by value gets its own copy
+      signed_block other = next;
+      other.witness = witness_id_type(3);
+      other.block_id = other.make_id();
+      shared_ptr<fork_item> other_item = fork_db.push_block( other );
+      BOOST_REQUIRE( fork_db.fetch_block( other.block_id ) );
+      BOOST_CHECK( fork_db.fetch_block( other.block_id )->block.get() != &other );
+      BOOST_CHECK( fork_db.fetch_block( other.block_id )->data.witness == witness_id_type(3) );
+   } FC_LOG_AND_RETHROW()
+}
+
+BOOST_AUTO_TEST_CASE( fork_item_packed_cache )
+{
+   try {
+      fc::temp_directory data_dir( graphene::utilities::temp_directory_path() );
+      block_database bdb;
+      bdb.open( data_dir.path() );
+
+      signed_block b;
+      b.witness = witness_id_type(1);
+      b.block_id = b.make_id();
+      fork_item item( std::make_shared<const signed_block>( b ) );
+
+      const vector<char>& packed = item.packed();
+      BOOST_CHECK( packed == fc::raw::pack( b ) );
+      // packed only once
+      BOOST_CHECK( &item.packed() == &packed );
+
+      bdb.store( item.id, item.packed() );
+      auto fetched = bdb.fetch_optional( b.block_id );
+      BOOST_REQUIRE( fetched.valid() );
+      BOOST_CHECK( fetched->make_id() == b.block_id );
+      BOOST_CHECK( fetched->witness == b.witness );
+      BOOST_CHECK( bdb.fetch_block_id( b.block_num() ) == b.block_id );
+   } FC_LOG_AND_RETHROW()
+}
+
 BOOST_AUTO_TEST_CASE( generate_empty_blocks )
 {
    try {
@@ -294,6 +401,13 @@ BOOST_AUTO_TEST_CASE( fork_blocks )
       }
       BOOST_CHECK_EQUAL(db1.head_block_num(), 13);
       BOOST_CHECK_EQUAL(db1.head_block_id().str(), db1_tip);
+      // the blocks re-applied after the failed switch are stored under their own ids
+      for( uint32_t num = 1; num <= 13; ++num )
+      {
+         auto stored = db1.fetch_block_by_number( num );
+         BOOST_REQUIRE( stored.valid() );
+         BOOST_CHECK( stored->make_id() == db1.get_block_id_for_num( num ) );
+      }
 
       // assert that db1 switches to new fork with good block
       BOOST_CHECK_EQUAL(db2.head_block_num(), 14);
@@ -306,6 +420,196 @@ BOOST_AUTO_TEST_CASE( fork_blocks )
 }
 
 
+BOOST_AUTO_TEST_CASE( out_of_order_blocks )
+{
+   try {
+      fc::temp_directory data_dir1( graphene::utilities::temp_directory_path() );
+      fc::temp_directory data_dir2( graphene::utilities::temp_directory_path() );
+
+      database db1(data_dir1.path());
+      db1.open(data_dir1.path(), make_genesis, "TEST");
+      database db2(data_dir2.path());
+      db2.open(data_dir2.path(), make_genesis, "TEST");
+
+      auto init_account_priv_key  = fc::ecc::private_key::regenerate(fc::sha256::hash(string("null_key")) );
+      vector<signed_block> blocks;
+      for( uint32_t i = 0; i < 6; ++i )
+         blocks.push_back( db1.generate_block(db1.get_slot_time(1), db1.get_scheduled_witness(1), init_account_priv_key, database::skip_nothing) );
+
+      PUSH_BLOCK( &db2, blocks[0] );
+      // blocks ahead of their parent are kept by the fork database instead of being dropped
+      for( uint32_t i = 5; i > 1; --i )
+      {
+         GRAPHENE_CHECK_THROW(PUSH_BLOCK( &db2, blocks[i] ), unlinkable_block_buffered_exception);
+         BOOST_CHECK_EQUAL(db2.head_block_num(), 1);
+      }
+      BOOST_CHECK( db2.is_known_block(blocks[5].block_id) );
+
+      // filling the gap links and applies everything buffered behind it
+      PUSH_BLOCK( &db2, blocks[1] );
+      BOOST_CHECK_EQUAL(db2.head_block_num(), 6);
+      BOOST_CHECK_EQUAL(db2.head_block_id().str(), db1.head_block_id().str());
+      BOOST_CHECK( db2.fetch_block_by_number(4).valid() );
+   } catch (fc::exception& e) {
+      edump((e.to_detail_string()));
+      throw;
+   }
+}
+
+BOOST_AUTO_TEST_CASE( unlinked_blocks_full_buffer )
+{
+   try {
+      vector<signed_block> blocks(5);
+      for( uint32_t i = 0; i < blocks.size(); ++i )
+      {
+         if( i > 0 )
+            blocks[i].previous = blocks[i-1].block_id;
+         blocks[i].witness = witness_id_type(1);
+         blocks[i].block_id = blocks[i].make_id();
+      }
+
+      fork_database fork_db;
+      fork_db.start_block( blocks[0] );
+      // room for a single buffered block
+      fork_db.set_max_unlinked_bytes( fc::raw::pack_size( blocks[3] ) );
+
+      GRAPHENE_CHECK_THROW( fork_db.push_block( blocks[3] ), unlinkable_block_buffered_exception );
+      BOOST_CHECK_EQUAL( fork_db.unlinked_blocks(), 1u );
+
+      // a full buffer drops the block that has waited longest to make room, so blocks that never
+      // link can't keep new ones out; the dropped block is no longer known and gets fetched again
+      GRAPHENE_CHECK_THROW( fork_db.push_block( blocks[2] ), unlinkable_block_buffered_exception );
+      BOOST_CHECK_EQUAL( fork_db.unlinked_blocks(), 1u );
+      BOOST_CHECK_EQUAL( fork_db.unlinked_bytes(), fc::raw::pack_size( blocks[2] ) );
+      BOOST_CHECK( fork_db.is_known_block( blocks[2].block_id ) );
+      BOOST_CHECK( !fork_db.is_known_block( blocks[3].block_id ) );
+
+      // blocks too far ahead of the head are refused
+      signed_block far_ahead;
+      far_ahead.previous._hash[0] = fc::endian_reverse_u32( 2 + fork_database::MAX_BLOCK_REORDERING );
+      far_ahead.witness = witness_id_type(1);
+      far_ahead.block_id = far_ahead.make_id();
+      fork_db.set_max_unlinked_bytes( GRAPHENE_DEFAULT_MAX_UNLINKED_BLOCK_BYTES );
+      try
+      {
+         fork_db.push_block( far_ahead );
+         BOOST_FAIL( "expected unlinkable_block_exception" );
+      }
+      catch( const unlinkable_block_buffered_exception& )
+      {
+         BOOST_FAIL( "a block too far ahead must not be reported as kept" );
+      }
+      catch( const unlinkable_block_exception& )
+      {
+      }
+
+      // the kept block is linked once the gap is filled, the dropped one links when fetched again
+      BOOST_CHECK( fork_db.push_block( blocks[1] )->id == blocks[2].block_id );
+      BOOST_CHECK_EQUAL( fork_db.unlinked_blocks(), 0u );
+      BOOST_CHECK( fork_db.push_block( blocks[3] )->id == blocks[3].block_id );
+   } FC_LOG_AND_RETHROW()
+}
+
+BOOST_AUTO_TEST_CASE( prepared_block_transactions )
+{
+   try {
+      fc::temp_directory data_dir1( graphene::utilities::temp_directory_path() );
+      fc::temp_directory data_dir2( graphene::utilities::temp_directory_path() );
+
+      database db1(data_dir1.path());
+      db1.open(data_dir1.path(), make_genesis, "TEST");
+      database db2(data_dir2.path());
+      db2.open(data_dir2.path(), make_genesis, "TEST");
+      db2.set_block_preparation_threads(3);
+
+      auto init_account_priv_key  = fc::ecc::private_key::regenerate(fc::sha256::hash(string("null_key")) );
+      transfer_operation t;
+      t.to = account_id_type(1);
+      for( uint32_t i = 0; i < 100; ++i )
+      {
+         signed_transaction trx;
+         set_expiration( &db1, trx );
+         t.amount = asset( 1000 + i );
+         trx.operations.push_back(t);
+         PUSH_TX( &db1, trx, ~0 );
+      }
+      auto b = db1.generate_block(db1.get_slot_time(1), db1.get_scheduled_witness(1), init_account_priv_key, database::skip_nothing);
+      BOOST_CHECK_EQUAL(b.transactions.size(), 100);
+
+      // the block is hashed, sized and validated on the worker threads, then applied in order
+      PUSH_BLOCK( &db2, b );
+      BOOST_CHECK_EQUAL(db2.head_block_id().str(), db1.head_block_id().str());
+      BOOST_CHECK_EQUAL(db2.get_balance(account_id_type(1), asset_id_type()).amount.value,
+                        db1.get_balance(account_id_type(1), asset_id_type()).amount.value);
+
+      // a tampered transaction still fails the merkle check
+      auto bad = db1.generate_block(db1.get_slot_time(1), db1.get_scheduled_witness(1), init_account_priv_key, database::skip_nothing);
+      bad.transactions.push_back(b.transactions.front());
+      GRAPHENE_REQUIRE_THROW(PUSH_BLOCK( &db2, bad ), fc::exception);
+   } catch (fc::exception& e) {
+      edump((e.to_detail_string()));
+      throw;
+   }
+}
+
+
+BOOST_AUTO_TEST_CASE( prevalidate_network_transactions )
+{
+   try {
+      fc::temp_directory data_dir( graphene::utilities::temp_directory_path() );
+      database db(data_dir.path());
+      db.open(data_dir.path(), make_genesis, "TEST");
+      db.set_block_preparation_threads(2);
+
+      auto init_account_priv_key  = fc::ecc::private_key::regenerate(fc::sha256::hash(string("null_key")) );
+      db.generate_block(db.get_slot_time(1), db.get_scheduled_witness(1), init_account_priv_key, database::skip_nothing);
+
+      public_key_type init_account_pub_key  = init_account_priv_key.get_public_key();
+      const account_object& init1 = *db.get_index_type<account_index>().indices().get<by_name>().find("init1");
+      account_create_operation cop;
+      cop.registrar = init1.id;
+      cop.name = "nathan";
+      cop.owner = authority(1, init_account_pub_key, 1);
+      cop.active = cop.owner;
+      signed_transaction trx;
+      set_expiration( &db, trx );
+      trx.operations.push_back(cop);
+      trx.sign( init_account_priv_key, db.get_chain_id() );
+
+      signed_transaction expired = trx;
+      expired.expiration = db.head_block_time() - fc::seconds(1);
+      GRAPHENE_REQUIRE_THROW(db.prevalidate_transaction(expired), fc::exception);
+
+      // the recovered keys are used when the transaction is pushed with all checks enabled
+      auto prepared = db.prevalidate_transaction(trx);
+      BOOST_REQUIRE(prepared->signature_keys);
+      BOOST_CHECK(prepared->signature_keys->count(init_account_pub_key));
+      db.push_transaction(trx, database::skip_nothing, transaction_push_state::from_net, prepared.get());
+      BOOST_CHECK(db.get_index_type<account_index>().indices().get<by_name>().count("nathan"));
+      // once pushed, the same transaction is dropped before it reaches the main thread
+      GRAPHENE_REQUIRE_THROW(db.prevalidate_transaction(trx), fc::exception);
+
+      // a transaction that fails to push is not taken for a duplicate when it comes again
+      signed_transaction taken_name = trx;
+      taken_name.expiration += 1;
+      taken_name.signatures.clear();
+      taken_name.sign( init_account_priv_key, db.get_chain_id() );
+      auto taken_name_prepared = db.prevalidate_transaction(taken_name);
+      GRAPHENE_REQUIRE_THROW(db.push_transaction(taken_name, database::skip_nothing, transaction_push_state::from_net, taken_name_prepared.get()), fc::exception);
+      db.prevalidate_transaction(taken_name);
+
+      auto statistics = db.get_transaction_prevalidator().get_statistics();
+      BOOST_CHECK_EQUAL(statistics["accepted"].as_uint64(), 3);
+      BOOST_CHECK_EQUAL(statistics["rejected"].get_object()["duplicate"].as_uint64(), 1);
+      BOOST_CHECK_EQUAL(statistics["rejected"].get_object()["expired"].as_uint64(), 1);
+      BOOST_CHECK_EQUAL(statistics["recent_transactions"].as_uint64(), 1);
+   } catch (fc::exception& e) {
+      edump((e.to_detail_string()));
+      throw;
+   }
+}
+
+
 BOOST_AUTO_TEST_CASE( undo_pending )
 {
    try {
@@ -1174,4 +1478,43 @@ BOOST_FIXTURE_TEST_CASE( miss_many_blocks, database_fixture )
    }
 }
 
+BOOST_FIXTURE_TEST_CASE( block_phase_profile, database_fixture )
+{
+   try
+   {
+      ACTORS( (alice)(bob) );
+      fund( alice, asset(1000000) );
+      fc::temp_directory dir( graphene::utilities::temp_directory_path() );
+      const fc::path csv = dir.path() / "blocks.csv";
+      const uint32_t first = db->head_block_num() + 2;
+      db->get_block_profiler().enable( csv, first, first + 1 );
+
+      for( int i = 0; i < 4; ++i )
+      {
+         transfer( alice_id, bob_id, asset(100 + i) );
+         generate_block();
+      }
+      db->get_block_profiler().flush();
+
+      std::ifstream in( csv.generic_string() );
+      vector<string> lines;
+      for( string line; std::getline( in, line ); )
+         lines.push_back( line );
+      // the header and one row per block in range, each with the transfer applied in it
+      BOOST_REQUIRE_EQUAL( lines.size(), 3u );
+      BOOST_CHECK( boost::starts_with( lines[0], "block_num,transactions,operations,total_us,prepare_us" ) );
+      BOOST_CHECK( boost::starts_with( lines[1], fc::to_string( uint64_t(first) ) + ",1,1," ) );
+      BOOST_CHECK( boost::starts_with( lines[2], fc::to_string( uint64_t(first + 1) ) + ",1,1," ) );
+
+      const string summary = db->get_block_profiler().summary();
+      BOOST_CHECK( summary.find( "replayed 2 blocks with 2 transactions" ) != string::npos );
+      BOOST_CHECK( summary.find( "transfer_operation" ) != string::npos );
+   }
+   catch (fc::exception& e)
+   {
+      edump((e.to_detail_string()));
+      throw;
+   }
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -124,4 +124,23 @@ BOOST_AUTO_TEST_CASE( get_potential_signatures_other ) {
    } FC_LOG_AND_RETHROW()
 }
 
+BOOST_AUTO_TEST_CASE( get_packed_blocks ) {
+   try {
+      generate_blocks( 5 );
+      graphene::app::database_api db_api( *db );
+
+      // blocks from the fork database and from the block database come out the same
+      const auto packed = db_api.get_packed_blocks( 1, 10 );
+      BOOST_REQUIRE_EQUAL( packed.size(), db->head_block_num() );
+      for( uint32_t i = 0; i < packed.size(); ++i )
+      {
+         const signed_block block = fc::raw::unpack<signed_block>( packed[i] );
+         BOOST_CHECK_EQUAL( block.block_num(), i + 1 );
+         BOOST_CHECK( block.make_id() == db->fetch_block_by_number( i + 1 )->make_id() );
+      }
+      BOOST_CHECK( db_api.get_packed_blocks( db->head_block_num() + 1, 10 ).empty() );
+      BOOST_CHECK_THROW( db_api.get_packed_blocks( 1, 1001 ), fc::exception );
+   } FC_LOG_AND_RETHROW()
+}
+
 BOOST_AUTO_TEST_SUITE_END()
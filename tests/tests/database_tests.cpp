@@ -81,4 +81,49 @@ BOOST_AUTO_TEST_CASE( merge_test )
    }
 }
 
+BOOST_AUTO_TEST_CASE( asset_holder_index_test )
+{
+   try {
+      data_dir = fc::temp_directory( graphene::utilities::temp_directory_path() );
+      database db(data_dir->path());
+      const auto& holders = dynamic_cast<const primary_index<account_balance_index>&>(
+         db.get_index_type<account_balance_index>() ).get_secondary_index<asset_holder_index>();
+      const asset_id_type asset( 5 );
+
+      vector<account_balance_id_type> balances;
+      for( int64_t i = 1; i <= 10; ++i )
+         balances.push_back( db.create<account_balance_object>( [&]( account_balance_object& obj ){
+            obj.owner = account_id_type( i );
+            obj.asset_type = asset;
+            obj.balance = i % 5 ? i * 100 : 0; // accounts 5 and 10 hold nothing
+         }).id );
+      BOOST_CHECK_EQUAL( holders.holder_count( asset ), 8 );
+      BOOST_CHECK_EQUAL( holders.holder_count( asset_id_type() ), 0 );
+
+      // ranked by balance, largest first
+      auto page = holders.get_holders( asset, 2, 3 );
+      BOOST_REQUIRE_EQUAL( page.size(), 3 );
+      BOOST_CHECK( page[0].owner == account_id_type( 7 ) );
+      BOOST_CHECK( page[1].owner == account_id_type( 6 ) );
+      BOOST_CHECK( page[2].owner == account_id_type( 4 ) );
+      BOOST_CHECK_EQUAL( holders.get_holders( asset, 7, 100 ).size(), 1 );
+      BOOST_CHECK( holders.get_holders( asset, 8, 100 ).empty() );
+
+      {
+         auto ses = db._undo_db.start_undo_session();
+         db.modify( balances[0](db), [&]( account_balance_object& obj ){ obj.balance = 0; } );
+         db.modify( balances[4](db), [&]( account_balance_object& obj ){ obj.balance = 10000; } );
+         db.remove( balances[8](db) );
+         BOOST_CHECK_EQUAL( holders.holder_count( asset ), 7 );
+         BOOST_CHECK( holders.get_holders( asset, 0, 1 )[0].owner == account_id_type( 5 ) );
+      }
+      // undo restores the ranking, including the removed balance
+      BOOST_CHECK_EQUAL( holders.holder_count( asset ), 8 );
+      BOOST_CHECK( holders.get_holders( asset, 0, 1 )[0].owner == account_id_type( 9 ) );
+   } catch ( const fc::exception& e ) {
+      edump( (e.to_detail_string()) );
+      throw;
+   }
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -134,4 +134,112 @@ BOOST_AUTO_TEST_CASE(get_account_history_operations) {
    }
 }
 
+BOOST_AUTO_TEST_CASE(account_history_store) {
+   try {
+      fc::temp_directory data_dir( graphene::utilities::temp_directory_path() );
+      graphene::account_history::account_history_store store;
+      store.open( data_dir.path() );
+
+      auto add = [&]( uint32_t block_num, flat_set<account_id_type> accounts ) {
+         operation_history_object op;
+         op.op = transfer_operation();
+         op.block_num = block_num;
+         return store.add( op, accounts );
+      };
+      // more than a page for account 1
+      for( uint32_t block_num = 1; block_num <= 100; ++block_num )
+         add( block_num, { account_id_type(1), account_id_type(block_num % 2 + 2) } );
+      BOOST_CHECK_EQUAL( store.total_ops( account_id_type(1) ), 100 );
+      BOOST_CHECK_EQUAL( store.total_ops( account_id_type(2) ), 50 );
+
+      // blocks 90 and up are replaced by a fork
+      store.flush( 80 );
+      store.discard_from( 90 );
+      BOOST_CHECK_EQUAL( store.total_ops( account_id_type(1) ), 89 );
+      auto forked = add( 90, { account_id_type(1) } );
+      BOOST_CHECK_EQUAL( forked.instance, 89 );
+      BOOST_CHECK_EQUAL( store.get_operation_id( account_id_type(1), 90 ).instance, 89 );
+
+      // sequences are found from disk and from the reversible tail alike
+      BOOST_CHECK_EQUAL( store.find_sequence( account_id_type(1), operation_history_id_type(40) ), 41 );
+      BOOST_CHECK_EQUAL( store.find_sequence( account_id_type(1), operation_history_id_type(85) ), 86 );
+      BOOST_CHECK_EQUAL( store.find_sequence( account_id_type(2), operation_history_id_type(40) ), 20 );
+      BOOST_CHECK_EQUAL( store.get_operation( operation_history_id_type(40) )->block_num, 41 );
+
+      // only what was flushed survives a restart
+      store.flush( 85 );
+      store.close();
+      store.open( data_dir.path() );
+      BOOST_CHECK_EQUAL( store.last_flushed_block(), 85 );
+      BOOST_CHECK_EQUAL( store.total_ops( account_id_type(1) ), 85 );
+      BOOST_CHECK_EQUAL( add( 86, { account_id_type(1) } ).instance, 85 );
+      BOOST_CHECK( !store.get_operation( operation_history_id_type(86) ).valid() );
+   } catch (fc::exception &e) {
+      edump((e.to_detail_string()));
+      throw;
+   }
+}
+
+BOOST_AUTO_TEST_CASE(market_history_store) {
+   try {
+      fc::temp_directory data_dir( graphene::utilities::temp_directory_path() );
+      const fc::path filename = data_dir.path() / "market_history";
+      const asset_id_type core, usd( 1 );
+      const fc::time_point_sec start( 6000 );
+      graphene::market_history::market_history_store store( { 60 }, 1000, 2, 60 );
+
+      auto fill = [&]( fc::time_point_sec time, int64_t base, int64_t quote ) {
+         const price p = asset( base, core ) / asset( quote, usd );
+         store.add_fill( time, fill_order_operation( object_id_type(), account_id_type(), asset( base, core ),
+                                                     asset( quote, usd ), p, true ) );
+         store.add_to_buckets( graphene::market_history::market_type( core, usd ), time, p, p );
+      };
+      auto bucket = [&]() {
+         return store.get_market_history( usd, core, 60, start, start + 60, 200 ).at( 0 );
+      };
+
+      store.begin_block( 1, 0 );
+      fill( start, 10, 20 );
+      store.begin_block( 2, 1 );
+      fill( start + 3, 10, 10 );
+      BOOST_CHECK_EQUAL( bucket().base_volume.value, 20 );
+      BOOST_CHECK_EQUAL( bucket().close_quote.value, 10 );
+
+      // block 2 is replaced by a fork
+      store.begin_block( 2, 1 );
+      BOOST_CHECK_EQUAL( bucket().base_volume.value, 10 );
+      BOOST_CHECK_EQUAL( bucket().close_quote.value, 20 );
+      BOOST_CHECK_EQUAL( store.get_fill_order_history( core, usd, 10 ).size(), 1 );
+      fill( start + 3, 5, 5 );
+      auto fills = store.get_fill_order_history( usd, core, 10 );
+      BOOST_REQUIRE_EQUAL( fills.size(), 2 );
+      BOOST_CHECK_EQUAL( fills[0].key.sequence, -1 );
+      BOOST_CHECK_EQUAL( fills[0].op.pays.amount.value, 5 );
+      BOOST_CHECK( fills[0].id == object_id_type( MARKET_HISTORY_SPACE_ID, graphene::market_history::order_history_object_type, 1 ) );
+      BOOST_CHECK_EQUAL( bucket().base_volume.value, 15 );
+
+      // irreversible fills beyond both limits are dropped
+      store.begin_block( 3, 2 );
+      fill( start + 200, 1, 1 );
+      BOOST_CHECK_EQUAL( store.get_fill_order_history( core, usd, 10 ).size(), 2 );
+      BOOST_CHECK( store.lower_bound_fill( object_id_type() )->id.instance() == 1 );
+
+      // only the irreversible blocks are saved
+      store.save( filename, 2 );
+      graphene::market_history::market_history_store loaded( { 60 }, 1000, 2, 60 );
+      loaded.load( filename );
+      fills = loaded.get_fill_order_history( core, usd, 10 );
+      BOOST_REQUIRE_EQUAL( fills.size(), 1 );
+      BOOST_CHECK_EQUAL( fills[0].op.pays.amount.value, 5 );
+      BOOST_CHECK_EQUAL( loaded.get_market_history( core, usd, 60, start, start + 60, 200 ).at( 0 ).base_volume.value, 15 );
+
+      // a replay starts over
+      loaded.begin_block( 1, 0 );
+      BOOST_CHECK( loaded.get_fill_order_history( core, usd, 10 ).empty() );
+   } catch (fc::exception &e) {
+      edump((e.to_detail_string()));
+      throw;
+   }
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,447 @@
+/*
+ * Copyright (c) 2015 Cryptonomex, Inc., and contributors.
+ *
+ * The MIT License
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <boost/test/unit_test.hpp>
+
+#include <graphene/net/compact_block_buffer.hpp>
+#include <graphene/net/io_thread_pool.hpp>
+#include <graphene/net/node.hpp>
+#include <graphene/net/peer_connection.hpp>
+#include <graphene/net/peer_database.hpp>
+#include <graphene/utilities/tempdir.hpp>
+#include <graphene/net/sync_scheduler.hpp>
+#include <graphene/net/config.hpp>
+
+#include <graphene/chain/protocol/fee_schedule.hpp>
+
+#include <fc/smart_ref_impl.hpp>
+#include <fc/thread/thread.hpp>
+#include <fc/bitutil.hpp>
+
+using namespace graphene::net;
+
+namespace {
+
+incomplete_compact_block make_incomplete_block( uint32_t block_num, uint8_t peer, fc::time_point received_time )
+{
+   incomplete_compact_block block;
+   block.peer_node_id.data[0] = peer;
+   block.block_message.block_id._hash[0] = block_num;
+   block.received_time = received_time;
+   return block;
+}
+
+block_id_type block_id_of( uint32_t block_num )
+{
+   return make_incomplete_block( block_num, 0, fc::time_point() ).block_message.block_id;
+}
+
+graphene::net::block_message make_sync_block( uint32_t block_num, uint32_t witness = 1 )
+{
+   signed_block block;
+   block.previous._hash[0] = fc::endian_reverse_u32( block_num - 1 );
+   block.witness = graphene::chain::witness_id_type( witness );
+   block.block_id = block.make_id();
+   return graphene::net::block_message( block );
+}
+
+item_id known_item( uint32_t i )
+{
+   return item_id( trx_message_type, fc::ripemd160::hash( std::to_string( i ) ) );
+}
+
+fc::ip::endpoint peer_endpoint( uint32_t i )
+{
+   return fc::ip::endpoint( fc::ip::address( 0x0a000000 + i ), 1776 );
+}
+
+node_id_t peer_id( uint8_t peer )
+{
+   node_id_t id;
+   id.data[0] = peer;
+   return id;
+}
+
+}
+
+BOOST_AUTO_TEST_SUITE( net_tests )
+
+BOOST_AUTO_TEST_CASE( compact_block_buffer_caps_per_peer_and_overall )
+{
+   try {
+      fc::time_point now = fc::time_point::now();
+      compact_block_buffer buffer( 2, 3 );
+
+      buffer.insert( make_incomplete_block( 1, 1, now ) );
+      buffer.insert( make_incomplete_block( 2, 1, now + fc::seconds(1) ) );
+      buffer.insert( make_incomplete_block( 3, 1, now + fc::seconds(2) ) );
+      // the peer's oldest block made room
+      BOOST_CHECK_EQUAL( buffer.count_for_peer( peer_id(1) ), 2u );
+      BOOST_CHECK( !buffer.take( block_id_of(1), peer_id(1) ) );
+
+      buffer.insert( make_incomplete_block( 4, 2, now + fc::seconds(3) ) );
+      buffer.insert( make_incomplete_block( 5, 3, now + fc::seconds(4) ) );
+      // the overall oldest block made room, whichever peer sent it
+      BOOST_CHECK_EQUAL( buffer.size(), 3u );
+      BOOST_CHECK( !buffer.take( block_id_of(2), peer_id(1) ) );
+      BOOST_CHECK_EQUAL( buffer.count_for_peer( peer_id(1) ), 1u );
+
+      // a block sent again replaces the waiting one instead of counting twice
+      buffer.insert( make_incomplete_block( 5, 3, now + fc::seconds(5) ) );
+      BOOST_CHECK_EQUAL( buffer.size(), 3u );
+   } FC_LOG_AND_RETHROW()
+}
+
+BOOST_AUTO_TEST_CASE( compact_block_buffer_take_expire_remove )
+{
+   try {
+      fc::time_point now = fc::time_point::now();
+      compact_block_buffer buffer( 4, 16 );
+      buffer.insert( make_incomplete_block( 1, 1, now - fc::seconds(60) ) );
+      buffer.insert( make_incomplete_block( 2, 1, now ) );
+      buffer.insert( make_incomplete_block( 3, 2, now ) );
+
+      // only the peer that sent the block can complete it
+      BOOST_CHECK( !buffer.take( block_id_of(2), peer_id(2) ) );
+      fc::optional<incomplete_compact_block> block = buffer.take( block_id_of(2), peer_id(1) );
+      BOOST_REQUIRE( block );
+      BOOST_CHECK( block->block_message.block_id == block_id_of(2) );
+      BOOST_CHECK( !buffer.take( block_id_of(2), peer_id(1) ) );
+
+      buffer.expire( now - fc::seconds(30) );
+      BOOST_CHECK_EQUAL( buffer.size(), 1u );
+      BOOST_CHECK( !buffer.take( block_id_of(1), peer_id(1) ) );
+
+      buffer.remove_peer( peer_id(2) );
+      BOOST_CHECK_EQUAL( buffer.size(), 0u );
+   } FC_LOG_AND_RETHROW()
+}
+
+BOOST_AUTO_TEST_CASE( io_thread_pool_assigns_and_releases_threads )
+{
+   try {
+      {
+         io_thread_pool pool( 2 );
+         BOOST_CHECK_EQUAL( pool.get_thread_count(), 2u );
+         fc::thread* first = pool.acquire_thread();
+         fc::thread* second = pool.acquire_thread();
+         BOOST_REQUIRE( first && second );
+         BOOST_CHECK( first != second );
+         BOOST_CHECK( pool.acquire_thread() == first );
+         BOOST_CHECK_EQUAL( pool.get_connection_count(), 3u );
+         BOOST_CHECK_EQUAL( first->async( [](){ return 42; } ).wait(), 42 );
+
+         // connections opened from now on stay on their own thread, the pinned ones keep theirs
+         pool.set_thread_count( 0 );
+         BOOST_CHECK( pool.acquire_thread() == nullptr );
+         BOOST_CHECK_EQUAL( pool.get_connection_count(), 3u );
+         BOOST_CHECK_EQUAL( first->async( [](){ return 7; } ).wait(), 7 );
+
+         pool.release_thread();
+         pool.release_thread();
+         pool.release_thread();
+         BOOST_CHECK_EQUAL( pool.get_connection_count(), 0u );
+      } // the pool joins its threads here
+   } FC_LOG_AND_RETHROW()
+}
+
+BOOST_AUTO_TEST_CASE( bandwidth_limit_and_io_threads_exclude_each_other )
+{
+   try {
+      graphene::net::node p2p_node( "net_tests" );
+      p2p_node.set_advanced_node_parameters( fc::mutable_variant_object( "io_threads", 2 ) );
+      BOOST_CHECK_EQUAL( p2p_node.get_advanced_node_parameters()["io_threads"].as<uint32_t>(), 2u );
+
+      // without connections on the I/O threads a limit moves new connections to the p2p thread
+      p2p_node.set_total_bandwidth_limit( 1024 * 1024, 0 );
+      BOOST_CHECK_EQUAL( p2p_node.get_advanced_node_parameters()["io_threads"].as<uint32_t>(), 0u );
+
+      BOOST_CHECK_THROW( p2p_node.set_advanced_node_parameters( fc::mutable_variant_object( "io_threads", 2 ) ), fc::exception );
+      BOOST_CHECK_EQUAL( p2p_node.get_advanced_node_parameters()["io_threads"].as<uint32_t>(), 0u );
+
+      p2p_node.set_total_bandwidth_limit( 0, 0 );
+      p2p_node.set_advanced_node_parameters( fc::mutable_variant_object( "io_threads", 2 ) );
+      BOOST_CHECK_EQUAL( p2p_node.get_advanced_node_parameters()["io_threads"].as<uint32_t>(), 2u );
+   } FC_LOG_AND_RETHROW()
+}
+
+BOOST_AUTO_TEST_CASE( sync_range_size_follows_throughput )
+{
+   try {
+      const uint32_t max_blocks = GRAPHENE_NET_MAX_BLOCKS_PER_PEER_DURING_SYNCING;
+      // peers we haven't measured get the minimum range
+      BOOST_CHECK_EQUAL( sync_range_size( 0, max_blocks ), GRAPHENE_NET_MIN_BLOCKS_PER_PEER_DURING_SYNCING );
+      BOOST_CHECK_EQUAL( sync_range_size( 1, max_blocks ), GRAPHENE_NET_MIN_BLOCKS_PER_PEER_DURING_SYNCING );
+      BOOST_CHECK_EQUAL( sync_range_size( 40, max_blocks ), 40u * GRAPHENE_NET_SYNC_RANGE_TARGET_SECONDS );
+      BOOST_CHECK_EQUAL( sync_range_size( 1e6, max_blocks ), max_blocks );
+      // a maximum below the minimum wins
+      BOOST_CHECK_EQUAL( sync_range_size( 0, 5 ), 5u );
+
+      double blocks_per_second = sync_throughput_after_range( 0, 100, fc::seconds(2) );
+      BOOST_CHECK_CLOSE( blocks_per_second, 50.0, 0.001 );
+      blocks_per_second = sync_throughput_after_range( blocks_per_second, 100, fc::seconds(1) );
+      BOOST_CHECK_CLOSE( blocks_per_second, 75.0, 0.001 );
+      // a range delivered instantly doesn't divide by zero
+      BOOST_CHECK( sync_throughput_after_range( 0, 10, fc::microseconds(0) ) > 0 );
+   } FC_LOG_AND_RETHROW()
+}
+
+BOOST_AUTO_TEST_CASE( select_sync_range_stops_at_other_ranges )
+{
+   try {
+      boost::container::deque<item_hash_t> ids;
+      for( uint32_t i = 1; i <= 10; ++i )
+         ids.push_back( make_sync_block( i ).block_id );
+      std::set<item_hash_t> unavailable{ ids[0], ids[1], ids[6] };
+      auto is_available = [&]( const item_hash_t& id ) { return unavailable.count( id ) == 0; };
+
+      // skips what's taken at the front, ends where another peer's range begins
+      std::vector<item_hash_t> range = select_sync_range( ids, 20, is_available );
+      BOOST_REQUIRE_EQUAL( range.size(), 4u );
+      BOOST_CHECK( range.front() == ids[2] );
+      BOOST_CHECK( range.back() == ids[5] );
+
+      range = select_sync_range( ids, 3, is_available );
+      BOOST_REQUIRE_EQUAL( range.size(), 3u );
+      BOOST_CHECK( range.back() == ids[4] );
+
+      unavailable.insert( ids.begin(), ids.end() );
+      BOOST_CHECK( select_sync_range( ids, 20, is_available ).empty() );
+   } FC_LOG_AND_RETHROW()
+}
+
+BOOST_AUTO_TEST_CASE( sync_block_buffer_drops_duplicates )
+{
+   try {
+      sync_block_buffer buffer( 16 );
+      graphene::net::block_message block1 = make_sync_block( 1 );
+      graphene::net::block_message block2 = make_sync_block( 2 );
+      graphene::net::block_message block3 = make_sync_block( 3 );
+
+      BOOST_CHECK( buffer.insert( block3 ) );
+      BOOST_CHECK( buffer.insert( block2 ) );
+      BOOST_CHECK( !buffer.insert( block3 ) );
+      BOOST_CHECK_EQUAL( buffer.size(), 2u );
+      BOOST_CHECK( buffer.contains( block3.block_id ) );
+
+      BOOST_CHECK( !buffer.take( block1.block_id ) );
+      fc::optional<graphene::net::block_message> taken = buffer.take( block2.block_id );
+      BOOST_REQUIRE( taken );
+      BOOST_CHECK( taken->block_id == block2.block_id );
+      BOOST_CHECK_EQUAL( buffer.last_processed_block_num(), 2u );
+
+      // a copy of a block already handed out, e.g. from a re-requested stalled range, is dropped
+      BOOST_CHECK( !buffer.insert( block2 ) );
+      BOOST_CHECK( !buffer.contains( block2.block_id ) );
+      // a different block at or below the last processed one may be on a fork and is kept
+      graphene::net::block_message fork_block = make_sync_block( 2, 7 );
+      BOOST_CHECK( buffer.insert( fork_block ) );
+      BOOST_CHECK_EQUAL( buffer.size(), 2u );
+   } FC_LOG_AND_RETHROW()
+}
+
+BOOST_AUTO_TEST_CASE( sync_block_buffer_hands_out_lowest_block_first )
+{
+   try {
+      sync_block_buffer buffer( 16 );
+      graphene::net::block_message block4 = make_sync_block( 4 );
+      graphene::net::block_message block5 = make_sync_block( 5 );
+      graphene::net::block_message block6 = make_sync_block( 6 );
+      graphene::net::block_message block9 = make_sync_block( 9 );
+      BOOST_CHECK( buffer.insert( block9 ) );
+      BOOST_CHECK( buffer.insert( block6 ) );
+      BOOST_CHECK( buffer.insert( block5 ) );
+
+      // of the blocks that can be processed now the lowest numbered one comes first, whatever the arrival order
+      fc::optional<graphene::net::block_message> taken = buffer.take_next( { block9.block_id, block6.block_id, block5.block_id } );
+      BOOST_REQUIRE( taken );
+      BOOST_CHECK( taken->block_id == block5.block_id );
+      taken = buffer.take_next( { block9.block_id, block6.block_id } );
+      BOOST_REQUIRE( taken );
+      BOOST_CHECK( taken->block_id == block6.block_id );
+
+      // a block that isn't buffered yet holds nothing back, blocks nobody can process yet stay
+      BOOST_CHECK( !buffer.take_next( { block4.block_id } ) );
+      BOOST_CHECK( !buffer.take_next( {} ) );
+      BOOST_CHECK_EQUAL( buffer.size(), 1u );
+      BOOST_CHECK( buffer.contains( block9.block_id ) );
+   } FC_LOG_AND_RETHROW()
+}
+
+BOOST_AUTO_TEST_CASE( known_item_filter_remembers_two_generations )
+{
+   try {
+      const uint32_t generation = GRAPHENE_NET_KNOWN_ITEM_FILTER_SIZE;
+      known_item_filter filter;
+      BOOST_CHECK( !filter.contains( known_item( 0 ) ) );
+
+      for( uint32_t i = 0; i < generation; ++i )
+         filter.insert( known_item( i ) );
+      for( uint32_t i = 0; i < generation; ++i )
+         BOOST_REQUIRE( filter.contains( known_item( i ) ) );
+
+      // the first generation is kept as the previous one while the next fills up
+      for( uint32_t i = generation; i < 2 * generation; ++i )
+         filter.insert( known_item( i ) );
+      BOOST_CHECK( filter.contains( known_item( 0 ) ) );
+      BOOST_CHECK( filter.contains( known_item( generation - 1 ) ) );
+      BOOST_CHECK( filter.contains( known_item( 2 * generation - 1 ) ) );
+
+      // and forgotten once a third generation starts
+      filter.insert( known_item( 2 * generation ) );
+      uint32_t still_known = 0;
+      for( uint32_t i = 0; i < generation; ++i )
+         still_known += filter.contains( known_item( i ) );
+      BOOST_CHECK_LE( still_known, 10u );
+      BOOST_CHECK( filter.contains( known_item( generation ) ) );
+      BOOST_CHECK( filter.contains( known_item( 2 * generation ) ) );
+   } FC_LOG_AND_RETHROW()
+}
+
+BOOST_AUTO_TEST_CASE( known_item_filter_false_positive_rate )
+{
+   try {
+      const uint32_t generation = GRAPHENE_NET_KNOWN_ITEM_FILTER_SIZE;
+      known_item_filter filter;
+      for( uint32_t i = 0; i < 2 * generation; ++i )
+         filter.insert( known_item( i ) );
+
+      // both generations are full, so this is the worst case: each can report a false positive
+      const uint32_t probes = 100000;
+      uint32_t false_positives = 0;
+      for( uint32_t i = 0; i < probes; ++i )
+         false_positives += filter.contains( known_item( 10 * generation + i ) );
+      BOOST_CHECK_LE( false_positives, 10 * 2 * GRAPHENE_NET_KNOWN_ITEM_FILTER_FALSE_POSITIVE_RATE * probes );
+   } FC_LOG_AND_RETHROW()
+}
+
+BOOST_AUTO_TEST_CASE( peer_database_evicted_record_stays_gone_after_reload )
+{
+   try {
+      fc::temp_directory data_dir( graphene::utilities::temp_directory_path() );
+      fc::path filename = data_dir.path() / "peers";
+      const uint32_t capacity = GRAPHENE_NET_MAXIMUM_PEERDB_SIZE;
+      {
+         peer_database peer_db;
+         peer_db.open( filename, fc::path() );
+         for( uint32_t i = 0; i < capacity; ++i )
+            peer_db.update_entry( potential_peer_record( peer_endpoint( i ), fc::time_point_sec( 1000 + i ) ) );
+         BOOST_CHECK_EQUAL( peer_db.size(), capacity );
+
+         // ranks with the others but is inserted last among equals, so it's the one evicted
+         peer_db.update_entry( potential_peer_record( peer_endpoint( capacity ), fc::time_point_sec( 1 ) ) );
+         BOOST_CHECK_EQUAL( peer_db.size(), capacity );
+         BOOST_CHECK( !peer_db.lookup_entry_for_endpoint( peer_endpoint( capacity ) ) );
+
+         // a kept record that becomes the least preferred must not trade places with the evicted one on reload
+         potential_peer_record failed = *peer_db.lookup_entry_for_endpoint( peer_endpoint( 0 ) );
+         failed.last_connection_disposition = last_connection_failed;
+         failed.number_of_failed_connection_attempts = 1;
+         peer_db.update_entry( failed );
+         peer_db.close();
+      }
+
+      peer_database peer_db;
+      peer_db.open( filename, fc::path() );
+      BOOST_CHECK_EQUAL( peer_db.size(), capacity );
+      BOOST_CHECK( !peer_db.lookup_entry_for_endpoint( peer_endpoint( capacity ) ) );
+      fc::optional<potential_peer_record> failed = peer_db.lookup_entry_for_endpoint( peer_endpoint( 0 ) );
+      BOOST_REQUIRE( failed );
+      BOOST_CHECK_EQUAL( failed->number_of_failed_connection_attempts, 1u );
+   } FC_LOG_AND_RETHROW()
+}
+
+BOOST_AUTO_TEST_CASE( telemetry_histogram_reports_bucket_upper_bounds )
+{
+   try {
+      telemetry_histogram histogram;
+      fc::variant_object empty = histogram.to_variant();
+      BOOST_CHECK_EQUAL( empty["count"].as_uint64(), 0u );
+      BOOST_CHECK( !empty.contains( "p50" ) );
+
+      for( uint64_t value : { 0, 1, 5, 6, 7, 100, 1000 } )
+         histogram.record( value );
+      BOOST_CHECK_EQUAL( histogram.count(), 7u );
+      BOOST_CHECK_EQUAL( histogram.sum(), 1119u );
+      // 5, 6 and 7 share the [4, 8) bucket
+      BOOST_CHECK_EQUAL( histogram.percentile( 0.5 ), 7u );
+      BOOST_CHECK_EQUAL( histogram.percentile( 0.1 ), 0u );
+      // the top bucket is capped by the largest value seen
+      BOOST_CHECK_EQUAL( histogram.percentile( 0.99 ), 1000u );
+
+      fc::variant_object reported = histogram.to_variant();
+      BOOST_CHECK_EQUAL( reported["min"].as_uint64(), 0u );
+      BOOST_CHECK_EQUAL( reported["max"].as_uint64(), 1000u );
+      BOOST_CHECK_EQUAL( reported["mean"].as_uint64(), 1119u / 7 );
+      BOOST_CHECK_EQUAL( reported["p90"].as_uint64(), 127u );
+
+      // negative durations count as zero
+      telemetry_histogram durations;
+      durations.record( fc::microseconds( -5 ) );
+      BOOST_CHECK_EQUAL( durations.sum(), 0u );
+   } FC_LOG_AND_RETHROW()
+}
+
+BOOST_AUTO_TEST_CASE( peer_telemetry_is_kept_per_peer_and_message_type )
+{
+   try {
+      peer_connection_ptr first = peer_connection::make_shared( nullptr );
+      peer_connection_ptr second = peer_connection::make_shared( nullptr );
+
+      first->telemetry.record_received( trx_message_type, 200, fc::microseconds( 3 ), fc::microseconds( 10 ), fc::microseconds( 50 ) );
+      first->telemetry.record_received( trx_message_type, 300, fc::microseconds( 5 ), fc::microseconds( 20 ), fc::microseconds( 70 ) );
+      first->telemetry.record_sent( block_message_type, 4000 );
+      first->telemetry.record_fetch_round_trip( fc::milliseconds( 2 ) );
+      second->telemetry.record_sent( trx_message_type, 250 );
+
+      fc::variant_object first_reported = first->telemetry.to_variant();
+      fc::variant_object first_messages = first_reported["messages"].get_object();
+      BOOST_REQUIRE( first_messages.contains( "trx_message_type" ) );
+      BOOST_REQUIRE( first_messages.contains( "block_message_type" ) );
+      BOOST_CHECK_EQUAL( first_messages.size(), 2u );
+
+      fc::variant_object first_trx = first_messages["trx_message_type"].get_object();
+      BOOST_CHECK_EQUAL( first_trx["bytes_in"]["count"].as_uint64(), 2u );
+      BOOST_CHECK_EQUAL( first_trx["bytes_in"]["sum"].as_uint64(), 500u );
+      BOOST_CHECK_EQUAL( first_trx["decode_time"]["sum"].as_uint64(), 8u );
+      BOOST_CHECK_EQUAL( first_trx["queue_wait"]["sum"].as_uint64(), 30u );
+      BOOST_CHECK_EQUAL( first_trx["handle_time"]["sum"].as_uint64(), 120u );
+      BOOST_CHECK_EQUAL( first_trx["bytes_out"]["count"].as_uint64(), 0u );
+
+      fc::variant_object first_block = first_messages["block_message_type"].get_object();
+      BOOST_CHECK_EQUAL( first_block["bytes_out"]["sum"].as_uint64(), 4000u );
+      BOOST_CHECK_EQUAL( first_block["bytes_in"]["count"].as_uint64(), 0u );
+      BOOST_CHECK_EQUAL( first_reported["fetch_round_trip"]["sum"].as_uint64(), 2000u );
+
+      // nothing recorded for one peer shows up under the other
+      fc::variant_object second_reported = second->telemetry.to_variant();
+      fc::variant_object second_messages = second_reported["messages"].get_object();
+      BOOST_CHECK_EQUAL( second_messages.size(), 1u );
+      BOOST_CHECK_EQUAL( second_messages["trx_message_type"]["bytes_out"]["sum"].as_uint64(), 250u );
+      BOOST_CHECK_EQUAL( second_messages["trx_message_type"]["bytes_in"]["count"].as_uint64(), 0u );
+      BOOST_CHECK_EQUAL( second_reported["fetch_round_trip"]["count"].as_uint64(), 0u );
+   } FC_LOG_AND_RETHROW()
+}
+
+BOOST_AUTO_TEST_SUITE_END()
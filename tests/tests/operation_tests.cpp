@@ -25,6 +25,7 @@
 #include <boost/test/unit_test.hpp>
 #include <boost/assign/list_of.hpp>
 
+#include <graphene/app/database_api.hpp>
 #include <graphene/chain/database.hpp>
 #include <graphene/chain/exceptions.hpp>
 #include <graphene/chain/hardfork.hpp>
@@ -32,6 +33,7 @@
 #include <graphene/chain/account_object.hpp>
 #include <graphene/chain/asset_object.hpp>
 #include <graphene/chain/committee_member_object.hpp>
+#include <graphene/chain/contract_object.hpp>
 #include <graphene/chain/market_object.hpp>
 #include <graphene/chain/vesting_balance_object.hpp>
 #include <graphene/chain/witness_object.hpp>
@@ -1694,4 +1696,192 @@ BOOST_AUTO_TEST_CASE( vesting_balance_withdraw_test )
    } FC_LOG_AND_RETHROW()
 }
 
+BOOST_AUTO_TEST_CASE( operation_stats_counters )
+{
+   try {
+      ACTORS( (alice)(bob) );
+      fund( alice, asset(1000) );
+      auto transfer_stats = [&]() {
+         for( const auto& stats : db->get_operation_stats().get_operation_stats() )
+            if( stats.which == operation::tag<transfer_operation>::value )
+               return stats;
+         return operation_type_stats();
+      };
+      const auto before = transfer_stats();
+
+      transfer( alice_id, bob_id, asset(100) );
+      transfer( alice_id, bob_id, asset(200) );
+      transfer_operation op;
+      op.from = alice_id;
+      op.to = bob_id;
+      op.amount = asset(1000000);
+      trx.operations.push_back( op );
+      GRAPHENE_REQUIRE_THROW( PUSH_TX( db.get(), trx, ~0 ), fc::exception );
+      trx.operations.clear();
+
+      const auto after = transfer_stats();
+      BOOST_CHECK_EQUAL( after.name, "transfer_operation" );
+      BOOST_CHECK_EQUAL( after.count - before.count, 3u );
+      BOOST_CHECK_EQUAL( after.failures - before.failures, 1u );
+      // each transfer changes the balances of both accounts
+      BOOST_CHECK_GE( after.undo_objects - before.undo_objects, 4u );
+      BOOST_CHECK_GE( after.total_time, after.max_time );
+   } FC_LOG_AND_RETHROW()
+}
+
+BOOST_AUTO_TEST_CASE( invoke_contract_function_by_table )
+{
+   try {
+      ACTORS( (alice) );
+      fund( alice, asset(1000000000) );
+      create_contract( alice_id, "contract.callee",
+                       "function log_pair(first, second)\n"
+                       "    chainhelper:log(first .. ':' .. second)\n"
+                       "end\n" );
+      const vector<lua_types> args = { lua_string( "alpha" ), lua_int( 7 ) };
+      const auto caller = create_contract( alice_id, "contract.caller",
+                       "function relay(first, second)\n"
+                       "    chainhelper:invoke_contract_function_by_table('contract.callee', 'log_pair', {first, second})\n"
+                       "end\n"
+                       "function relay_with_gap(first, second)\n"
+                       "    chainhelper:invoke_contract_function_by_table('contract.callee', 'log_pair', {[1] = first, [3] = second})\n"
+                       "end\n"
+                       "function relay_json()\n"
+                       "    chainhelper:invoke_contract_function('contract.callee', 'log_pair', [=[" + fc::json::to_string( args ) + "]=])\n"
+                       "end\n" );
+      auto nested_logs = []( const contract_result& result ) {
+         vector<string> logs;
+         for( const auto& affected : result.contract_affecteds )
+            if( affected.which() == contract_affected_type::tag<contract_result>::value )
+               for( const auto& nested : affected.get<contract_result>().contract_affecteds )
+                  if( nested.which() == contract_affected_type::tag<contract_logger>::value )
+                     logs.push_back( nested.get<contract_logger>().message );
+         return logs;
+      };
+
+      // nodes that predate the binding fail such calls, so do new nodes until the hardfork
+      GRAPHENE_REQUIRE_THROW( call_contract( alice_id, caller, "relay", args ), fc::exception );
+      trx.operations.clear();
+      // the json binding keeps working as it did, on its own copy of the evaluation state
+      BOOST_CHECK( nested_logs( call_contract( alice_id, caller, "relay_json", {} ) ) == vector<string>{ "alpha:7" } );
+      generate_blocks( CONTRACT_INVOKE_BY_TABLE_TIMEPOINT + 60 );
+
+      BOOST_CHECK( nested_logs( call_contract( alice_id, caller, "relay", args ) ) == vector<string>{ "alpha:7" } );
+      BOOST_CHECK( nested_logs( call_contract( alice_id, caller, "relay_json", {} ) ) == vector<string>{ "alpha:7" } );
+
+      try {
+         call_contract( alice_id, caller, "relay_with_gap", args );
+         BOOST_FAIL( "a table with a hole must not be accepted as an argument list" );
+      } catch( const fc::exception& e ) {
+         BOOST_CHECK( e.to_detail_string().find( "missing index" ) != string::npos );
+      }
+      trx.operations.clear();
+   } FC_LOG_AND_RETHROW()
+}
+
+BOOST_AUTO_TEST_CASE( contract_profiling )
+{
+   try {
+      ACTORS( (alice) );
+      fund( alice, asset(1000000000) );
+      const auto contract = create_contract( alice_id, "contract.profiled",
+                       "function work(n)\n"
+                       "    local t = {}\n"
+                       "    for i = 1, n do t[#t + 1] = tostring(i) end\n"
+                       "    chainhelper:log(tostring(#t))\n"
+                       "end\n" );
+      auto& profiler = db->get_contract_profiler();
+
+      call_contract( alice_id, contract, "work", { lua_int( 10 ) } );
+      BOOST_CHECK( profiler.get_report().contracts.empty() );
+
+      db->enable_contract_profiling( true );
+      call_contract( alice_id, contract, "work", { lua_int( 5000 ) } );
+      const auto report = profiler.get_report();
+      BOOST_REQUIRE( report.contracts.count( "contract.profiled" ) );
+      BOOST_REQUIRE( report.contracts.at( "contract.profiled" ).count( "work" ) );
+      const auto& work = report.contracts.at( "contract.profiled" ).at( "work" );
+      BOOST_CHECK_EQUAL( work.calls, 1u );
+      BOOST_CHECK_GE( work.instructions, uint64_t( contract_profiler::instruction_step ) );
+      BOOST_CHECK_GT( work.alloc_bytes, 0u );
+      BOOST_CHECK_GE( work.total_time, work.max_time );
+      BOOST_CHECK( report.bindings.count( "log" ) );
+
+      // disabling takes the hooks and the allocator wrapper off the VM
+      db->enable_contract_profiling( false );
+      BOOST_CHECK( lua_gethook( db->get_luaVM().mState ) == nullptr );
+      void* ud = nullptr;
+      BOOST_CHECK( lua_getallocf( db->get_luaVM().mState, &ud ) != nullptr );
+      BOOST_CHECK( ud != &profiler );
+      profiler.reset();
+      BOOST_CHECK( profiler.get_report().contracts.empty() );
+      BOOST_CHECK( profiler.get_report().bindings.empty() );
+   } FC_LOG_AND_RETHROW()
+}
+
+BOOST_AUTO_TEST_CASE( contract_code_sharing )
+{
+   try {
+      ACTORS( (alice) );
+      fund( alice, asset(1000000000) );
+      auto create_contract = [&]( const string& name, const string& code ) {
+         contract_create_operation op;
+         op.owner = alice_id;
+         op.name = name;
+         op.data = code;
+         op.contract_authority = alice_private_key.get_public_key();
+         trx.operations.push_back( op );
+         auto ptx = PUSH_TX( db.get(), trx, ~0 );
+         trx.operations.clear();
+         return contract_id_type( ptx.operation_results[0].get<object_id_result>().result );
+      };
+      if( db->get_index_type<contract_index>().get_next_id() == contract_id_type() )
+         create_contract( "contract.base", "return { tostring = tostring }\n" );
+      const string template_code = "function hello(name)\n    chainhelper:log(name)\nend\n";
+
+      const auto first = create_contract( "contract.first", template_code );
+      const auto second = create_contract( "contract.second", template_code );
+      const auto& shared = first(*db).lua_code_b_id(*db);
+      BOOST_CHECK( second(*db).lua_code_b_id == shared.id );
+      BOOST_CHECK_EQUAL( shared.ref_count, 2u );
+      BOOST_CHECK( shared.contract_id == first );
+
+      revise_contract_operation revise;
+      revise.reviser = alice_id;
+      revise.contract_id = second;
+      revise.data = "function bye(name)\n    chainhelper:log(name)\nend\n";
+      trx.operations.push_back( revise );
+      PUSH_TX( db.get(), trx, ~0 );
+      trx.operations.clear();
+      BOOST_CHECK( second(*db).lua_code_b_id != first(*db).lua_code_b_id );
+      BOOST_CHECK_EQUAL( first(*db).lua_code_b_id(*db).ref_count, 1u );
+
+      // code stored compressed reads back through the cache as deployed
+      db->get_contract_code_cache().set_compression_threshold( 16 );
+      string large_code;
+      for( int i = 0; i < 50; i++ )
+         large_code += "function f" + fc::to_string( int64_t(i) ) + "(name)\n    chainhelper:log(name)\nend\n";
+      const auto& compressed = create_contract( "contract.large", large_code )(*db).lua_code_b_id(*db);
+      BOOST_CHECK( compressed.compressed );
+      BOOST_CHECK_LT( compressed.lua_code_b.size(), compressed.code_size );
+      const auto& code = db->get_contract_code( compressed );
+      BOOST_CHECK_EQUAL( code.size(), compressed.code_size );
+      BOOST_CHECK( fc::sha256::hash( code.data(), code.size() ) == compressed.code_hash );
+      BOOST_CHECK_EQUAL( db->get_contract_code_cache().size(), 1u );
+
+      // the API hands the code out uncompressed, like a node that stores it as is
+      graphene::app::database_api db_api( *db );
+      const auto api_code = db_api.get_objects( { compressed.id } )[0].as<contract_bin_code_object>();
+      BOOST_CHECK( !api_code.compressed );
+      BOOST_CHECK( api_code.lua_code_b == code );
+      BOOST_CHECK( api_code.code_hash == compressed.code_hash );
+
+      // damaged code is reported rather than handed to the VM
+      contract_bin_code_object damaged = compressed;
+      damaged.lua_code_b.resize( damaged.lua_code_b.size() / 2 );
+      contract_code_cache fresh_cache;
+      GRAPHENE_REQUIRE_THROW( fresh_cache.get( damaged ), fc::exception );
+   } FC_LOG_AND_RETHROW()
+}
+
 BOOST_AUTO_TEST_SUITE_END()